@@ -0,0 +1,87 @@
+#!/bin/bash
+# Benchmark compile time and generated-code quality of `codegen` against `codeGen.linux`.
+#
+# For every size below, bench/gen.sh writes a MiniJava program to bench/out/, both compilers
+# translate it, and SPIM runs both results. The report lists the time of each `codegen`
+# phase (from --time-report), the static instruction count of each code.s, the number of
+# instructions SPIM executed for each, and whether both programs printed the same output.
+# The no-loop-opt column is the executed count of `codegen -no-loop-opt`, which shows what
+# the loop optimizations save; its output must match too.
+#
+# Usage: ./bench.sh [classes methods depth iterations]...
+#   With no arguments the default sizes are used; otherwise each group of four numbers is
+#   one size (see bench/gen.sh).
+
+chmod +x ./spim.linux ./codeGen.linux
+
+OUT=./bench/out
+STEP_LIMIT=500000000 # Upper bound on the instructions SPIM single-steps per program
+mkdir -p $OUT
+
+if [ $# -eq 0 ]; then
+    set -- 4 4 8 50   8 8 16 100   20 20 24 50   40 40 40 20
+fi
+
+# Count the instruction lines (not labels, directives or comments) of an assembly file
+static_insns() {
+    grep -cE '^[[:space:]]+[a-z]' "$1"
+}
+
+# Count the instructions SPIM executes for an assembly file by single-stepping the whole program
+# and counting the traced instructions
+executed_insns() {
+    printf 'load "%s"\nstep %d\nexit\n' "$1" $STEP_LIMIT | ./spim.linux -quiet 2>/dev/null | grep -c '^\[0x'
+}
+
+# Milliseconds since the epoch
+now_ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+printf "%-16s %7s | %8s %8s %8s %8s %8s %8s %8s | %8s %8s | %11s %11s %11s | %s\n" \
+    size lines parse semantic dump fold codegen emit total \
+    insns ref-insns executed no-loop-opt ref-executed output
+
+while [ $# -ge 4 ]; do
+    name="$1x$2x$3x$4"
+    src=$OUT/$name.mj
+    bash ./bench/gen.sh $1 $2 $3 $4 > $src
+    shift 4
+
+    # Reference compiler
+    ./codeGen.linux < $src > /dev/null 2>&1
+    cp code.s $OUT/$name.ref.s
+    ./spim.linux -quiet -file $OUT/$name.ref.s > $OUT/$name.ref.out 2>&1
+
+    # Our compiler, with its phase times
+    start=$(now_ms)
+    ./codegen --time-report < $src > /dev/null 2> $OUT/$name.time
+    total=$(($(now_ms) - start))
+    cp code.s $OUT/$name.s
+    ./spim.linux -quiet -file $OUT/$name.s > $OUT/$name.out 2>&1
+
+    # Our compiler without loop optimizations
+    ./codegen -no-loop-opt < $src > /dev/null 2>&1
+    cp code.s $OUT/$name.noloop.s
+    ./spim.linux -quiet -file $OUT/$name.noloop.s > $OUT/$name.noloop.out 2>&1
+
+    phase() {
+        awk -v p=$1 '$1 == "phase" && $2 == p { printf "%.1f", $3 }' $OUT/$name.time
+    }
+
+    if diff -b $OUT/$name.ref.out $OUT/$name.out > /dev/null &&
+        diff -b $OUT/$name.ref.out $OUT/$name.noloop.out > /dev/null; then
+        result=same
+    else
+        result=DIFFERENT
+    fi
+
+    printf "%-16s %7d | %8s %8s %8s %8s %8s %8s %8d | %8d %8d | %11d %11d %11d | %s\n" \
+        $name $(wc -l < $src) \
+        "$(phase parse)" "$(phase semantic)" "$(phase dump)" "$(phase fold)" \
+        "$(phase codegen)" "$(phase emit)" $total \
+        $(static_insns $OUT/$name.s) $(static_insns $OUT/$name.ref.s) \
+        $(executed_insns $OUT/$name.s) $(executed_insns $OUT/$name.noloop.s) \
+        $(executed_insns $OUT/$name.ref.s) \
+        $result
+done
@@ -0,0 +1,85 @@
+#!/bin/bash
+# Generate a MiniJava benchmark program on stdout.
+#
+# Usage: bench/gen.sh [classes] [methods] [depth] [iterations]
+#   classes     Number of classes (default 8)
+#   methods     Methods per class (default 8)
+#   depth       Nesting depth of the expression in each loop body (default 16)
+#   iterations  Loop trip count of every method (default 100)
+#
+# Every method runs a loop over a deep expression, which also updates one element of the
+# class's array field per iteration, and then calls the previous method of its class; the first method of each class calls `run` of the previous class through an object
+# field, which starts that class's last method. `main` calls `run` of the last class, so one
+# run executes every method exactly once and prints a single checksum. Calls through an
+# object take no arguments, since the code generator cannot yet pass arguments to a method of
+# another object.
+
+classes=${1:-8}
+methods=${2:-8}
+depth=${3:-16}
+iterations=${4:-100}
+
+awk -v N="$classes" -v M="$methods" -v D="$depth" -v L="$iterations" '
+# leaf(k) - The k-th operand of an expression: parameters, the loop counter, a field, constants
+function leaf(k) {
+    k = k % 6
+    if (k == 0) return "a"
+    if (k == 1) return "i"
+    if (k == 2) return "b"
+    if (k == 3) return "f"
+    if (k == 4) return seq % 9 + 1
+    return "(i - a)"
+}
+
+# expr(n) - An expression nested n levels deep, alternating left- and right-deep operands
+function expr(n,    op) {
+    if (n == 0) return leaf(seq++)
+    op = (n % 3 == 0) ? " - " : " + "
+    if (n % 2) return "(" expr(n - 1) op leaf(seq++) ")"
+    return "(" leaf(seq++) op expr(n - 1) ")"
+}
+
+BEGIN {
+    printf "/* generated by bench/gen.sh %d %d %d %d */\n", N, M, D, L
+    print "program bench;"
+    for (c = 0; c < N; c++) {
+        printf "class k%d\n{\n", c
+        print "\tdeclarations"
+        printf "\t\tint f = %d;\n", c % 7 + 1
+        printf "\t\tint[] v = int [%d];\n", L
+        if (c > 0) printf "\t\tk%d p;\n", c - 1
+        print "\tenddeclarations"
+        for (m = 0; m < M; m++) {
+            seq = c + m
+            printf "\tmethod int m%d(val int a, b)\n", m
+            print "\tdeclarations"
+            print "\t\tint i, s;"
+            print "\tenddeclarations"
+            print "\t{"
+            print "\ti := 0; s := 0;"
+            printf "\twhile (i < %d)\n\t{\n", L
+            printf "\t\tv[i] := v[i] + a;\n"
+            printf "\t\ts := s + %s + v[i];\n", expr(D)
+            print "\t\ti := i + 1;"
+            print "\t};"
+            if (m > 0)
+                printf "\treturn s + m%d(b, a);\n", m - 1
+            else if (c > 0)
+                print "\treturn s + p.run();"
+            else
+                print "\treturn s;"
+            print "\t}"
+        }
+        print "\tmethod int run()\n\t{"
+        printf "\treturn m%d(1, 2);\n", M - 1
+        print "\t}"
+        print "}"
+    }
+    print "class bench\n{"
+    print "\tdeclarations"
+    printf "\t\tk%d p;\n", N - 1
+    print "\tenddeclarations"
+    print "\tmethod void main()\n\t{"
+    print "\tsystem.println(p.run());"
+    print "\t}\n}"
+}'
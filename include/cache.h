@@ -0,0 +1,51 @@
+#ifndef __CACHE_H
+#define __CACHE_H
+
+#include "emit.h"
+#include "ir.h"
+
+/*
+ * Compilation cache.
+ *
+ * With `-cache DIR`, the code generator keeps what it produced for each class in DIR, under a
+ * hash of everything that code depends on (see classKey in codegen.c). A later compilation
+ * that computes the same key for a class replays the stored entry instead of generating the
+ * class again.
+ *
+ * An entry is a sequence of integers and strings, read back in the order it was written. On
+ * disk it is followed by a hash of its contents, so a damaged file reads as a miss.
+ */
+
+typedef unsigned long long CacheKey;
+
+#define CACHE_SEED 14695981039346656037ull // FNV-1a offset basis: the key of nothing
+
+typedef struct CacheEntry {
+    char *buf; // Encoded records
+    int len;   // Bytes used
+    int cap;   // Bytes allocated
+    int pos;   // Read position
+} CacheEntry;
+
+CacheKey cacheMix(CacheKey h, void *bytes, int n);
+CacheKey cacheMixInt(CacheKey h, int v);
+CacheKey cacheMixStr(CacheKey h, char *s);
+CacheKey cacheMixIR(CacheKey h, IRInstr *head);
+
+CacheEntry *cacheNew();
+void cachePutInt(CacheEntry *e, int v);
+void cachePutStr(CacheEntry *e, char *s);
+void cachePutIR(CacheEntry *e, IRInstr *head);
+void cachePutFragment(CacheEntry *e, EmitFragment *f);
+int cacheGetInt(CacheEntry *e);
+char *cacheGetStr(CacheEntry *e);
+IRInstr *cacheGetIR(CacheEntry *e);
+EmitFragment *cacheGetFragment(CacheEntry *e);
+
+CacheEntry *cacheRead(FILE *in);
+int cacheWrite(FILE *out, CacheEntry *e);
+CacheEntry *cacheLoad(char *dir, CacheKey key);
+void cacheSave(char *dir, CacheKey key, CacheEntry *e);
+void cacheFree(CacheEntry *e);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __EMIT_H
+#define __EMIT_H
+
+#include <stdio.h>
+
+/*
+ * Assembly emitter.
+ *
+ * Code generation never writes `code.s` directly. Instructions go to a growable `.text` buffer
+ * and data directives to a growable `.data` buffer, so the generator can add data at any point
+ * without switching sections back and forth. `emitWrite` writes the whole program at the end
+ * with one `.data` and one `.text` section.
+ *
+ * String literals and word constants are pooled: a second request for the same text or value
+ * returns the label of the first one instead of emitting a copy.
+ */
+
+void emitText(char *fmt, ...);
+void emitData(char *fmt, ...);
+
+char *emitString(char *text);
+char *emitWord(int value);
+char *emitLiteralText(char *label, int *is_word);
+
+int emitTextSize();
+int emitCountInstructions(int from);
+
+void emitWrite(FILE *out);
+void emitSections(char **data, int *data_len, char **text, int *text_len);
+void emitReset();
+
+/*
+ * Fragments for the compilation cache (see cache.h).
+ *
+ * Between `emitCaptureBegin` and `emitCaptureEnd`, everything added to both sections is
+ * recorded except the definitions of pooled literals: a fragment lists the literals it refers
+ * to instead, since another compilation may pool and number them differently. `emitReplay`
+ * appends a fragment to the sections, pools its literals again where they were first used
+ * (so a replay gives the same output as the compilation captured), renames its references
+ * to them and shifts its code labels `L_<n>`.
+ */
+typedef struct EmitFragment {
+    char *text;     // `.text` contents (NUL-terminated)
+    char *data;     // `.data` contents without literal definitions (NUL-terminated)
+    int count;      // Number of literals referred to
+    int *is_word;   // Per literal: 1 for a word constant, 0 for a string
+    char **values;  // Per literal: its text (the decimal value of a word constant)
+    char **labels;  // Per literal: its label when the fragment was captured
+    int *offsets;   // Per literal: where in `data` its definition was, or -1 if pooled before
+} EmitFragment;
+
+void emitCaptureBegin();
+void emitReference(char *label);
+EmitFragment *emitCaptureEnd();
+void emitReplay(EmitFragment *f, int shift);
+void emitFreeFragment(EmitFragment *f);
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef __IR_H
+#define __IR_H
+
+#include <stdio.h>
+
+/*
+ * Three-address intermediate representation.
+ *
+ * Code generation builds one `IRFunc` per routine (`Class.init`, `Class.method`, the `main`
+ * start-up sequence) as a linear list of `IRInstr`. When the routine is complete, the list is
+ * split into basic blocks linked into a control-flow graph, optimization passes may run over
+ * it, and the backend in codegen.c lowers it to MIPS assembly.
+ *
+ * Operands name machine registers directly (the `R_*` numbers below follow the MIPS register
+ * file), so the expression register pool and the frame conventions of codegen.c carry over
+ * unchanged. Runtime services (printing, reading, heap allocation) are explicit operations
+ * instead of raw syscalls, so analyses know exactly which registers they read and write.
+ */
+
+/* -------------------- Registers -------------------- */
+
+#define IR_NOREG (-1) // Operand slot not used; a second source of IR_NOREG means "use imm"
+
+#define R_ZERO 0 // Constant zero
+#define R_V0 2   // Return value
+#define R_V1 3   // Length in a bounds check, `$ra` around output calls, scratch of IR_COUNT
+                 // (never live elsewhere)
+#define R_A0 4   // First argument register
+#define R_A1 5
+#define R_A2 6
+#define R_A3 7
+#define R_T0 8 // Caller-saved temporaries $t0-$t7
+#define R_T1 9
+#define R_T2 10
+#define R_T3 11
+#define R_T4 12
+#define R_T5 13
+#define R_T6 14
+#define R_T7 15
+#define R_S0 16 // Callee-saved registers $s0-$s7
+#define R_S1 17
+#define R_S2 18
+#define R_S3 19
+#define R_S4 20
+#define R_S5 21
+#define R_S6 22 // Next free heap byte of the allocator (never used by the IR otherwise)
+#define R_S7 23 // End of the allocator's current heap chunk
+#define R_T8 24 // Caller-saved temporaries $t8-$t9
+#define R_T9 25
+#define R_SP 29 // Stack pointer
+#define R_FP 30 // Frame pointer
+#define R_RA 31 // Return address
+
+#define IR_NUM_REGS 32
+
+/* -------------------- Operations -------------------- */
+
+/* Pseudo operations: no code, no effect on data flow */
+#define IR_LABEL 1   // sym: (or L_label:)
+#define IR_COMMENT 2 // # sym
+
+/* Data movement */
+#define IR_LI 10   // dst = imm
+#define IR_LA 11   // dst = &sym
+#define IR_LW 12   // dst = M[src1 + imm]
+#define IR_SW 13   // M[src2 + imm] = src1
+#define IR_MOVE 14 // dst = src1
+
+/* Arithmetic and logic: dst = src1 op src2, or dst = src1 op imm when src2 is IR_NOREG */
+#define IR_ADD 20
+#define IR_SUB 21
+#define IR_MUL 22
+#define IR_DIV 23
+#define IR_SLT 24
+#define IR_SGT 25
+#define IR_SEQ 26
+#define IR_SNE 27
+#define IR_SLE 28
+#define IR_SGE 29
+#define IR_AND 30
+#define IR_OR 31
+#define IR_SLL 32
+#define IR_NEG 33 // dst = -src1 (src2 and imm unused)
+#define IR_SRA 34 // Arithmetic (sign-filling) shift right
+#define IR_SRL 35 // Logical (zero-filling) shift right
+
+/* Control flow */
+#define IR_J 40    // goto sym (or L_label)
+#define IR_CALL 42 // call sym (clobbers $ra, $v0 and every caller-saved register)
+#define IR_RET 43  // return to $ra
+
+/* Conditional branches: if (src1 cmp src2) goto L_label, or if (src1 cmp imm) when src2 is IR_NOREG */
+#define IR_BEQ 44
+#define IR_BNE 45
+#define IR_BLT 46
+#define IR_BGT 47
+#define IR_BLE 48
+#define IR_BGE 49
+
+/* Runtime services */
+#define IR_PRINT_INT 50 // print src1
+#define IR_PRINT_STR 51 // print the string at label sym
+#define IR_READ_INT 52  // dst = integer read from the console
+#define IR_ALLOC 53     // dst = address of (src1 or imm) fresh heap bytes
+#define IR_EXIT 54      // terminate the program
+#define IR_BOUNDS 55    // stop with an error unless 0 <= src1 < (src2 or imm)
+#define IR_COUNT 56     // add 1 to the word at sym + imm (profile counters, `-profile`)
+
+/* -------------------- Memory classes -------------------- */
+
+/*
+ * What the address of an IR_LW/IR_SW points into (`IRInstr.mem`). Accesses of two different
+ * known classes never overlap, which lets loop optimizations move loads past stores.
+ */
+#define IR_MEM_ANY 0   // Unknown (e.g. through a reference argument): may overlap anything
+#define IR_MEM_FRAME 1 // A slot of the current frame: locals, arguments, saved registers, spills
+#define IR_MEM_FIELD 2 // A field of an object, or the static word of a class
+#define IR_MEM_ELEM 3  // An array element
+#define IR_MEM_CONST 4 // Read-only data (pooled constants)
+
+/*
+ * IRInstr - One three-address instruction.
+ *
+ * Instructions of a function form a doubly linked list so passes can insert and delete in place.
+ */
+typedef struct IRInstr {
+    int op;                     // IR_* operation
+    int dst, src1, src2;        // Register operands (R_* or IR_NOREG)
+    int imm;                    // Immediate operand or memory offset
+    int label;                  // Number of the label defined or targeted (IR_LABEL/IR_J/branches)
+    int mem;                    // Memory class of IR_LW/IR_SW (IR_MEM_*)
+    char *sym;                  // Label, symbol or comment text (owned by the instruction);
+                                // NULL on IR_LABEL/IR_J/branches means the numbered label L_<label>
+    struct IRInstr *prev, *next; // Neighbours in the function's instruction list
+} IRInstr;
+
+/*
+ * IRBlock - A basic block: a maximal straight-line run of instructions.
+ *
+ * A block starts at a label or after a branch, and ends with a branch, a return or the
+ * instruction before the next label. `succ` holds at most two successors (taken branch
+ * target, fall-through).
+ */
+typedef struct IRBlock {
+    int id;                      // Position of the block in its function
+    IRInstr *first, *last;       // Instruction range (inclusive) in the function list
+    int nsucc;                   // Number of successors (0-2)
+    struct IRBlock *succ[2];     // Successor blocks
+    int npred;                   // Number of predecessors
+    struct IRBlock **pred;       // Predecessor blocks
+    struct IRBlock *next;        // Next block in layout order
+} IRBlock;
+
+/*
+ * IRFunc - One routine: its instruction list and, once built, its control-flow graph.
+ */
+typedef struct IRFunc {
+    char *name;            // Routine label (NULL for anonymous start-up code)
+    IRInstr *head, *tail;  // Instruction list
+    IRBlock *blocks;       // Basic blocks in layout order (NULL until irBuildCFG)
+    int nblocks;           // Number of basic blocks
+    char *args;            // Parameter kinds of a method, one each: 'I' (value passed in an
+                           // argument register), 'V' (value passed on the stack) or 'R'
+                           // (reference); NULL for other routines. Not owned by the routine.
+} IRFunc;
+
+/* -------------------- Construction -------------------- */
+
+void irBeginFunc(char *name);
+IRFunc *irEndFunc();
+IRFunc *irCurrentFunc();
+
+IRInstr *irEmit(int op, int dst, int src1, int src2, int imm, char *sym);
+IRInstr *irNewInstr(int op, int dst, int src1, int src2, int imm, char *sym);
+void irLabel(int n);
+void irNamedLabel(char *name);
+void irComment(char *fmt, ...);
+void irLi(int dst, int imm);
+void irLa(int dst, char *sym);
+IRInstr *irLoad(int dst, int offset, int base);
+IRInstr *irStore(int src, int offset, int base);
+void irMove(int dst, int src);
+void irOp(int op, int dst, int src1, int src2);
+void irOpImm(int op, int dst, int src1, int imm);
+void irJump(int n);
+void irBranch(int op, int src1, int src2, int n);
+void irCall(char *sym);
+void irReturn();
+
+/* -------------------- Editing and data flow -------------------- */
+
+void irRemove(IRFunc *f, IRInstr *p);
+void irInsertBefore(IRFunc *f, IRInstr *p, IRInstr *before);
+void irInsertAfter(IRFunc *f, IRInstr *p, IRInstr *after);
+int irIsTemp(int reg);
+int irIsBranch(int op);
+int irInverse(int op);
+int irReads(IRInstr *p, int reg);
+int irWrites(IRInstr *p, int reg);
+int sameLabel(IRInstr *branch, IRInstr *label);
+
+/* -------------------- Analysis and output -------------------- */
+
+void irBuildCFG(IRFunc *f);
+void irDump(IRFunc *f, FILE *out);
+void irFreeFunc(IRFunc *f);
+
+/* -------------------- Optimization -------------------- */
+
+void irPeephole(IRFunc *f); // Implemented in peephole.c
+void irLoops(IRFunc *f);    // Implemented in loop.c
+void irColdLoop(int label); // Implemented in loop.c
+void irClearColdLoops();    // Implemented in loop.c
+void irShapeFrame(IRFunc *f); // Implemented in frame.c
+int irKeepArgs(IRFunc *f);    // Implemented in frame.c
+void irOfferInline(IRFunc *f, int limit); // Implemented in inline.c
+int irInline(IRFunc *f, int *labels);     // Implemented in inline.c
+IRInstr *irInlineBody(char *name);        // Implemented in inline.c
+void irAddInline(char *name, IRInstr *head); // Implemented in inline.c
+void irClearInline();                         // Implemented in inline.c
+
+/* Liveness and editing helpers shared by the passes (implemented in peephole.c) */
+IRInstr *nextCode(IRInstr *p);
+int isStraight(IRInstr *p);
+int fitsImm(int v);
+IRInstr *labelOf(IRFunc *f, IRInstr *branch);
+int deadAfter(IRFunc *f, IRInstr *p, int reg);
+void makeMove(IRInstr *p, int dst, int src);
+int isStackAdjust(IRInstr *p, int delta);
+
+extern char *irRegNames[];
+extern char *irOpNames[];
+
+#endif
@@ -7,9 +7,8 @@
 #define TRUE 1    // Alternative boolean representation for true
 #define bool char // Custom boolean type defined as a char
 
-#define STACK_SIZE 100 // Maximum size of the symbol table stack
-#define ST_SIZE 500    // Maximum number of entries in the symbol table
-#define ATTR_SIZE 2000 // Maximum size for the attributes table
+#define STACK_INIT_SIZE 128 // Initial capacity of the symbol table stack (grows on demand)
+#define ST_INIT_SIZE 512    // Initial capacity of the symbol table (grows on demand)
 
 /*
  * Error type definitions for the error reporting routine.
@@ -17,9 +16,9 @@
  */
 #define STACK_OVERFLOW 100  // Stack overflow error in the symbol table stack
 #define REDECLARATION 101   // Error for redeclaration of a variable or function
-#define ST_OVERFLOW 102     // Symbol table overflow error
+#define ST_OVERFLOW 102     // Symbol table could not grow (out of memory)
 #define UNDECLARATION 103   // Use of an undeclared identifier
-#define ATTR_OVERFLOW 104   // Overflow in the attribute list
+#define ATTR_OVERFLOW 104   // Attribute number without a slot in the symbol table
 #define NOT_USED 105        // Warning for declared but unused variables or functions
 #define ARGUMENTS_NUM1 106  // Incorrect number of arguments in function call (type 1)
 #define ARGUMENTS_NUM2 107  // Incorrect number of arguments in function call (type 2)
@@ -74,6 +73,11 @@
 
 #define DIMEN_ATTR 9   /* Dimension information for arrays (number of dimensions). */
 #define ARGNUM_ATTR 10 /* Number of arguments for function or procedure declarations. */
+#define USED_ATTR 11   /* Present once the identifier is referenced, set by LookUp and field access. */
+#define REACH_ATTR 12  /* Present on methods the program can call, set by markReachable. */
+#define LENGTH_ATTR 13 /* Constant length of an array variable, set by analyzeBounds. */
+
+#define NUM_ATTRS (LENGTH_ATTR + 1) /* Number of attribute slots per symbol (slot 0 unused). */
 
 /*
  * Possible values of the attribute KIND_ATTR.
@@ -108,17 +112,8 @@ typedef struct {
     int st_ptr;  /* Pointer to the identifier's entry in the symbol table. */
     bool dummy;  /* Dummy flag to indicate an undeclared identifier. */
     bool used;   /* Boolean flag indicating if the identifier has been used. */
-} StackEntry;    /* Stack array with a maximum size defined by STACK_SIZE. */
-
-/*
- * Structure for the attribute list of symbol table entries.
- * Each symbol can have multiple attributes (e.g., type, value, nesting level).
- */
-typedef struct {
-    char attr_num; /* Attribute number (< 256), uniquely identifies the attribute type. */
-    int attr_val;  /* Attribute value */
-    int next_attr; /* Pointer (index) to the next attribute in the linked list, or -1 if none. */
-} attr_type;       /* Defines the attribute structure used for symbol table entries. */
+    int shadow;  /* Next older entry in the same scope hash bucket (0 if none); markers: enclosing marker. */
+} StackEntry;    /* Stack array, grown as scopes and declarations are pushed. */
 
 /*
  * Procedure Declarations
@@ -7,6 +7,16 @@ typedef struct treenode {
     struct treenode *LeftC, *RightC;
 } ILTree, *tree;
 
+// An explicit stack of subtrees, for walks over long statement, declaration and argument
+// lists. The first TREE_STACK_LOCAL entries live in the walker's own frame.
+#define TREE_STACK_LOCAL 64
+
+typedef struct TreeStack {
+    tree *items;                  // Entries, bottom first: `local` or a heap block
+    int top, cap;                 // Number of entries and of slots of `items`
+    tree local[TREE_STACK_LOCAL]; // Slots for short lists
+} TreeStack;
+
 /* -------------------- Operator Node Types -------------------- */
 
 /* Represents the root of the program (main entry point) */
@@ -193,6 +203,14 @@ typedef struct treenode {
 // Example: `class MyClass { void print(); };`
 #define ClassDefOp 145
 
+/* Represents a left shift by a constant (strength-reduced multiplication by a power of two) */
+// Example: `x * 8` becomes `x << 3`
+#define ShlOp 146
+
+/* Represents a signed division by a constant power of two, rounding toward zero */
+// Example: `x / 8` becomes `x >> 3`
+#define ShrOp 147
+
 /* -------------------- Node Types -------------------- */
 
 /* Represents an identifier node (variable/function names) */
@@ -251,6 +269,16 @@ void SetLeftChild(tree, tree);
 void SetRightChild(tree, tree);
 int LeftDepth(tree);
 
+void FreeNode(tree);
+void FreeAllNodes();
+void RecycleAllNodes();
+tree CompactTree(tree);
+
+void InitTreeStack(TreeStack *);
+void PushTree(TreeStack *, tree);
+tree PopTree(TreeStack *);
+void FreeTreeStack(TreeStack *);
+
 int IsNull(tree);
 int IntVal(tree);
 int NodeOp(tree);
@@ -0,0 +1,105 @@
+/**************************************************************************************************
+ * File: mjrt.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file is the **Runtime** of programs compiled with `-target x86-64` (see src/x86.c).
+ *    It is linked with the generated `code.s`:
+ *
+ *        gcc -no-pie -o program code.s runtime/mjrt.c
+ *
+ *    The generated code keeps every address in 32 bits, so the MiniJava stack and heap are
+ *    mapped in the low 2 GiB (`MAP_32BIT`) and the program is linked without PIE. Heap memory
+ *    starts out zeroed, as `sbrk` memory does under SPIM, and is never freed.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **int main():**
+ *       - Maps the MiniJava stack and enters the program.
+ *
+ *    2. **mj_print_int, mj_print_str, mj_read_int, mj_alloc, mj_exit:**
+ *       - The services the generated code calls through its `mj.*` stubs.
+ *
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#define MJ_STACK (64 << 20) // Bytes of the MiniJava stack
+#define MJ_CHUNK (1 << 20)  // Bytes of each heap chunk
+
+void mj_start(unsigned stack_top); // Entry point of the generated code
+
+char *heap_next = NULL; // Next free byte of the current heap chunk
+char *heap_end = NULL;  // End of the current heap chunk
+
+/**
+ * mapLow - Maps zeroed memory in the low 2 GiB of the address space, or exits.
+ *
+ * @param n The number of bytes.
+ */
+char *mapLow(size_t n) {
+    void *p = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * mj_print_int - Prints an integer (`system.println` of an expression).
+ */
+void mj_print_int(int v) { printf("%d", v); }
+
+/**
+ * mj_print_str - Prints the string at a 32-bit address.
+ */
+void mj_print_str(unsigned s) { fputs((char *)(unsigned long)s, stdout); }
+
+/**
+ * mj_read_int - Reads an integer (`system.readln`); 0 if there is none.
+ *
+ * What was printed before is flushed first, so a prompt appears before the program waits.
+ */
+int mj_read_int() {
+    int v = 0;
+    fflush(stdout);
+    if (scanf("%d", &v) != 1) {
+        v = 0;
+    }
+    return v;
+}
+
+/**
+ * mj_alloc - Returns the 32-bit address of `n` fresh zeroed bytes.
+ *
+ * Allocations are bumped out of chunks of `MJ_CHUNK` bytes; a larger one gets its own.
+ */
+unsigned mj_alloc(unsigned n) {
+    n = (n + 3) & ~3u;
+    if (n > MJ_CHUNK) {
+        return (unsigned)(unsigned long)mapLow(n);
+    }
+    if (!heap_next || heap_end - heap_next < (long)n) {
+        heap_next = mapLow(MJ_CHUNK);
+        heap_end = heap_next + MJ_CHUNK;
+    }
+    heap_next += n;
+    return (unsigned)(unsigned long)(heap_next - n);
+}
+
+/**
+ * mj_exit - Ends the program.
+ */
+void mj_exit() {
+    fflush(stdout);
+    exit(0);
+}
+
+int main() {
+    char *stack = mapLow(MJ_STACK);
+    mj_start((unsigned)(unsigned long)(stack + MJ_STACK));
+    return 0;
+}
@@ -0,0 +1,290 @@
+/**************************************************************************************************
+ * File: astfile.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Syntax Tree Files** of `-emit-ast FILE` and `-load-ast FILE`.
+ *    A file holds the syntax tree after semantic analysis together with the symbol table and
+ *    the string table it refers to, so a later run (or another tool) can go straight to code
+ *    generation without parsing and checking the program again.
+ *
+ *    1. **Nodes:**
+ *       - Every node reachable from the root or from a tree-valued attribute (`TYPE_ATTR`,
+ *         `TREE_ATTR`) gets an index; index 0 is the shared `DUMMYNode` and -1 is NULL. Each
+ *         node is written as five integers: kind, operator, value, left and right child index.
+ *         The file holds no pointers, so it can be read at any address.
+ *
+ *    2. **Symbols:**
+ *       - The number of entries, then for each entry the mask of attributes set and the value
+ *         of each of them. Tree-valued attributes are written as node indices.
+ *
+ *    3. **Strings:**
+ *       - The entries of the string table (see save_string_tbl in string_hash_table.c), each
+ *         at the index the tree and the symbols use for it.
+ *
+ *    The file starts with the magic `MJA1` and `NUM_ATTRS`, so a file written by a compiler
+ *    with other attributes is refused instead of misread.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **int saveAST(char *path, tree root):**
+ *       - Writes the tree, the symbol table and the string table.
+ *
+ *    2. **tree loadAST(char *path):**
+ *       - Replaces the symbol table and the string table with those of a file and returns its
+ *         tree, or NULL.
+ *
+ **************************************************************************************************/
+
+#include "symbol_table.h"
+#include "tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define AST_MAGIC "MJA1" // First bytes of every syntax tree file
+
+extern int st_top, *st_attrs[], *st_attr_set;
+void growSymbols(int need);
+void save_string_tbl(FILE *out);
+int load_string_tbl(FILE *in);
+
+/*
+ * AstIndex - The numbering of the nodes being written.
+ */
+typedef struct AstIndex {
+    tree *nodes;   // Node of each index, in index order
+    int count;     // Number of indices handed out
+    int cap;       // Number of slots of `nodes`
+    tree *keys;    // Open-addressing map from node to index...
+    int *values;   // ...and the index of each key
+    int mask;      // Number of map slots minus 1
+} AstIndex;
+
+/**
+ * isTreeAttr - Reports whether an attribute holds a pointer to a syntax tree.
+ *
+ * @param attr The attribute number.
+ */
+int isTreeAttr(int attr) { return attr == TYPE_ATTR || attr == TREE_ATTR; }
+
+/**
+ * astIndex - Returns the index of a node, handing out the next one on first sight.
+ *
+ * @param x The numbering.
+ * @param t The node, or NULL.
+ */
+int astIndex(AstIndex *x, tree t) {
+    if (!t) {
+        return -1;
+    }
+    if (t == NullExp()) {
+        return 0;
+    }
+
+    // Step 1: Look the node up
+    unsigned slot = ((unsigned long)t >> 3) & x->mask;
+    while (x->keys[slot] && x->keys[slot] != t) {
+        slot = (slot + 1) & x->mask;
+    }
+    if (x->keys[slot]) {
+        return x->values[slot];
+    }
+
+    // Step 2: Number it and keep the map at most half full
+    if (x->count == x->cap) {
+        x->cap *= 2;
+        x->nodes = realloc(x->nodes, x->cap * sizeof(tree));
+    }
+    x->nodes[x->count] = t;
+    x->keys[slot] = t;
+    x->values[slot] = x->count;
+    if (++x->count * 2 > x->mask) {
+        tree *keys = x->keys;
+        int *values = x->values, old = x->mask;
+        x->mask = old * 2 + 1;
+        x->keys = calloc(x->mask + 1, sizeof(tree));
+        x->values = malloc((x->mask + 1) * sizeof(int));
+        for (int i = 0; i <= old; ++i) {
+            if (keys[i]) {
+                unsigned s = ((unsigned long)keys[i] >> 3) & x->mask;
+                while (x->keys[s]) {
+                    s = (s + 1) & x->mask;
+                }
+                x->keys[s] = keys[i];
+                x->values[s] = values[i];
+            }
+        }
+        free(keys);
+        free(values);
+    }
+    return x->count - 1;
+}
+
+/**
+ * astPut - Writes one integer.
+ *
+ * @param out The file.
+ * @param v   The integer.
+ */
+void astPut(FILE *out, int v) { fwrite(&v, sizeof(v), 1, out); }
+
+/**
+ * astGet - Reads one integer.
+ *
+ * @param in  The file.
+ * @param bad Set if the file ends first.
+ */
+int astGet(FILE *in, int *bad) {
+    int v = 0;
+    if (fread(&v, sizeof(v), 1, in) != 1) {
+        *bad = 1;
+    }
+    return v;
+}
+
+/**
+ * saveAST - Writes a syntax tree with the symbol table and the string table.
+ *
+ * @param path The file to write.
+ * @param root The root of the tree, after semantic analysis.
+ *
+ * @return 1 on success, 0 if the file cannot be written.
+ */
+int saveAST(char *path, tree root) {
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        return 0;
+    }
+
+    // Step 1: Number the nodes. Index 0 is the dummy node; every node numbered is visited
+    // once, in index order, so the list of nodes doubles as the work list.
+    AstIndex x = {0};
+    x.cap = 1024;
+    x.nodes = malloc(x.cap * sizeof(tree));
+    x.mask = 2047;
+    x.keys = calloc(x.mask + 1, sizeof(tree));
+    x.values = malloc((x.mask + 1) * sizeof(int));
+    x.nodes[x.count++] = NullExp();
+    int root_index = astIndex(&x, root);
+    for (int i = 1; i <= st_top; ++i) {
+        for (int a = 1; a < NUM_ATTRS; ++a) {
+            if ((st_attr_set[i] & (1 << a)) && isTreeAttr(a)) {
+                astIndex(&x, (tree)st_attrs[a][i]);
+            }
+        }
+    }
+    for (int i = 1; i < x.count; ++i) {
+        astIndex(&x, x.nodes[i]->LeftC);
+        astIndex(&x, x.nodes[i]->RightC);
+    }
+
+    // Step 2: The header and the nodes
+    fwrite(AST_MAGIC, 1, 4, out);
+    astPut(out, NUM_ATTRS);
+    astPut(out, x.count);
+    astPut(out, root_index);
+    for (int i = 1; i < x.count; ++i) {
+        tree t = x.nodes[i];
+        astPut(out, t->NodeKind);
+        astPut(out, t->NodeOpType);
+        astPut(out, t->IntVal);
+        astPut(out, astIndex(&x, t->LeftC));
+        astPut(out, astIndex(&x, t->RightC));
+    }
+
+    // Step 3: The symbols, with tree-valued attributes as node indices
+    astPut(out, st_top);
+    for (int i = 1; i <= st_top; ++i) {
+        astPut(out, st_attr_set[i]);
+        for (int a = 1; a < NUM_ATTRS; ++a) {
+            if (st_attr_set[i] & (1 << a)) {
+                astPut(out, isTreeAttr(a) ? astIndex(&x, (tree)st_attrs[a][i]) : st_attrs[a][i]);
+            }
+        }
+    }
+
+    // Step 4: The strings
+    save_string_tbl(out);
+
+    free(x.nodes);
+    free(x.keys);
+    free(x.values);
+    return !ferror(out) & !fclose(out);
+}
+
+/**
+ * loadAST - Reads a file written by `saveAST`.
+ *
+ * @param path The file to read.
+ *
+ * @return The root of the tree, or NULL if the file cannot be read or is malformed. The
+ *         symbol table and the string table are replaced by those of the file.
+ *
+ * The nodes are allocated from the node arena like parsed ones, so later phases (and
+ * `FreeAllNodes`) cannot tell the difference.
+ */
+tree loadAST(char *path) {
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        return NULL;
+    }
+
+    // Step 1: The header
+    char magic[4];
+    int bad = fread(magic, 1, 4, in) != 4 || memcmp(magic, AST_MAGIC, 4);
+    bad |= astGet(in, &bad) != NUM_ATTRS;
+    int count = astGet(in, &bad), root = astGet(in, &bad);
+    if (bad || count < 1 || count > (1 << 26) || root < -1 || root >= count) {
+        fclose(in);
+        return NULL;
+    }
+
+    // Step 2: The nodes, then their children once every index has a node
+    tree *nodes = malloc(count * sizeof(tree));
+    int *links = malloc(2 * count * sizeof(int));
+    nodes[0] = NullExp();
+    for (int i = 1; i < count && !bad; ++i) {
+        int kind = astGet(in, &bad), op = astGet(in, &bad), value = astGet(in, &bad);
+        nodes[i] = MakeLeaf(kind, value);
+        nodes[i]->NodeOpType = op;
+        links[2 * i] = astGet(in, &bad);
+        links[2 * i + 1] = astGet(in, &bad);
+        bad |= links[2 * i] < -1 || links[2 * i] >= count || links[2 * i + 1] < -1 || links[2 * i + 1] >= count;
+    }
+    for (int i = 1; i < count && !bad; ++i) {
+        nodes[i]->LeftC = links[2 * i] < 0 ? NULL : nodes[links[2 * i]];
+        nodes[i]->RightC = links[2 * i + 1] < 0 ? NULL : nodes[links[2 * i + 1]];
+    }
+
+    // Step 3: The symbols
+    int top = astGet(in, &bad);
+    if (!bad && top >= 0 && top < (1 << 26)) {
+        growSymbols(top);
+        st_top = top;
+        for (int i = 1; i <= top && !bad; ++i) {
+            st_attr_set[i] = astGet(in, &bad);
+            for (int a = 1; a < NUM_ATTRS; ++a) {
+                if (st_attr_set[i] & (1 << a)) {
+                    int v = astGet(in, &bad);
+                    if (isTreeAttr(a)) {
+                        bad |= v < -1 || v >= count;
+                        v = bad || v < 0 ? 0 : (int)nodes[v];
+                    }
+                    st_attrs[a][i] = v;
+                }
+            }
+        }
+    } else {
+        bad = 1;
+    }
+
+    // Step 4: The strings
+    bad = bad || !load_string_tbl(in);
+
+    tree result = bad ? NULL : root < 0 ? NULL : nodes[root];
+    free(nodes);
+    free(links);
+    fclose(in);
+    return result;
+}
@@ -0,0 +1,545 @@
+/**************************************************************************************************
+ * File: bounds.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Range Analysis** behind `-check-bounds`. In that mode every
+ *    array carries its length in the word before its first element, and code generation
+ *    checks each index against it. The pass runs after constant folding and before code
+ *    generation, and finds the accesses whose check can never fail.
+ *
+ *    1. **Array Lengths:**
+ *       - An array variable declared with a constant size, `int[] a = int[10]` or
+ *         `int[] a = {1, 2, 3}`, gets its length in `LENGTH_ATTR`, unless the program ever
+ *         replaces it: assigns to it as a whole or passes it as an argument, which could be
+ *         a reference argument. Its checks then compare against a constant.
+ *
+ *    2. **Safe Indexes:**
+ *       - A constant index `a[c]` with `0 <= c < length` needs no check.
+ *       - `while (i < n)` or `while (i <= n - 1)` after `i := c` with `c >= 0` keeps
+ *         `0 <= i < n` inside the body as long as the only updates of `i` in the loop are
+ *         `i := i + d` with `d >= 0`. Every `a[i]` of an array of length `n` or more in the
+ *         body is safe up to the first statement that changes `i`. Induction variables are
+ *         locals and value arguments, which nothing but the own routine can change; passing
+ *         one to a call counts as a change.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void analyzeBounds(tree node):**
+ *       - Entry point: records array lengths and safe indexes of the whole program.
+ *
+ *    2. **int isSafeIndex(tree index):**
+ *       - Reports whether the check of an `IndexOp` can be left out.
+ *
+ **************************************************************************************************/
+
+#include "symbol_table.h"
+#include "tree.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SAFE_BUCKETS 1024 // Hash buckets of the safe index set
+#define MAX_FACTS 16      // Variables known to be non-negative at one point of a statement list
+
+/*
+ * SafeIndex - One `IndexOp` whose check can be left out.
+ */
+typedef struct SafeIndex {
+    tree index;             // The IndexOp node
+    struct SafeIndex *next; // Next entry in the same bucket
+} SafeIndex;
+
+SafeIndex *safe_table[SAFE_BUCKETS];
+
+/*
+ * replaced - Flags of the array variables the program replaces as a whole, by symbol index.
+ */
+char *replaced = NULL;
+int replaced_cap = 0;
+
+/*
+ * Facts - The variables known to be non-negative at the current statement of a list.
+ */
+typedef struct Facts {
+    int var[MAX_FACTS];
+    int count;
+} Facts;
+
+/**
+ * safeHash - Returns the bucket of an `IndexOp` node.
+ *
+ * @param index The node.
+ */
+unsigned safeHash(tree index) { return (unsigned)((unsigned long)index >> 4) % SAFE_BUCKETS; }
+
+/**
+ * isSafeIndex - Reports whether the bounds check of an index can be left out.
+ *
+ * @param index The `IndexOp` node.
+ */
+int isSafeIndex(tree index) {
+    for (SafeIndex *s = safe_table[safeHash(index)]; s; s = s->next) {
+        if (s->index == index) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * markSafe - Adds an `IndexOp` to the safe set.
+ *
+ * @param index The node.
+ */
+void markSafe(tree index) {
+    if (isSafeIndex(index)) {
+        return;
+    }
+    SafeIndex *s = malloc(sizeof(SafeIndex));
+    unsigned h = safeHash(index);
+    s->index = index;
+    s->next = safe_table[h];
+    safe_table[h] = s;
+}
+
+/**
+ * targetOf - Returns the variable a `VarOp` designates as a whole.
+ *
+ * @param var The `VarOp`.
+ *
+ * @return The symbol of the variable or the last field in the chain, or 0 if the chain
+ *         ends in an array element.
+ */
+int targetOf(tree var) {
+    int id = IntVal(LeftChild(var));
+    for (tree p = RightChild(var); !IsNull(p); p = RightChild(p)) {
+        if (NodeOp(LeftChild(p)) == IndexOp) {
+            id = 0;
+        } else if (NodeOp(LeftChild(p)) == FieldOp) {
+            id = IntVal(LeftChild(LeftChild(p)));
+        }
+    }
+    return id;
+}
+
+/**
+ * isPlainVar - Reports whether an expression is exactly the variable `id`.
+ *
+ * @param t  The expression.
+ * @param id The symbol.
+ */
+int isPlainVar(tree t, int id) {
+    return NodeKind(t) == EXPRNode && NodeOp(t) == VarOp && IntVal(LeftChild(t)) == id &&
+           IsNull(RightChild(t));
+}
+
+/**
+ * markReplaced - Flags a symbol as replaced as a whole.
+ *
+ * @param id The symbol (0 is ignored).
+ */
+void markReplaced(int id) {
+    if (id >= replaced_cap) {
+        int cap = replaced_cap;
+        replaced_cap = id * 2 + 64;
+        replaced = realloc(replaced, replaced_cap);
+        memset(replaced + cap, 0, replaced_cap - cap);
+    }
+    replaced[id] = 1;
+}
+
+/**
+ * argsWrite - Reports whether an argument list passes the variable `id` as a whole, or
+ *             flags every variable it passes when `id` is 0.
+ *
+ * @param args The arguments (a `CommaOp` tree).
+ * @param id   The symbol, or 0.
+ */
+int argsWrite(tree args, int id) {
+    TreeStack pending; // Arguments still to check
+    int hit = 0;
+    InitTreeStack(&pending);
+    PushTree(&pending, args);
+    while (pending.top) {
+        args = PopTree(&pending);
+        if (IsNull(args) || NodeKind(args) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(args) == CommaOp) {
+            PushTree(&pending, RightChild(args));
+            PushTree(&pending, LeftChild(args));
+        } else if (NodeOp(args) == VarOp) {
+            if (!id) {
+                markReplaced(targetOf(args));
+            } else {
+                hit |= targetOf(args) == id;
+            }
+        }
+    }
+    FreeTreeStack(&pending);
+    return hit;
+}
+
+/**
+ * writes - Reports whether a subtree may change the variable `id`, or flags every variable
+ *          it replaces when `id` is 0.
+ *
+ * @param t  The subtree.
+ * @param id The symbol, or 0.
+ *
+ * Assignments to the whole variable and arguments naming it (reference arguments and
+ * `readln`) count as changes.
+ */
+int writes(tree t, int id) {
+    TreeStack pending; // Subtrees still to check; statement lists are long spines
+    int hit = 0;
+    InitTreeStack(&pending);
+    PushTree(&pending, t);
+    while (pending.top) {
+        t = PopTree(&pending);
+        if (IsNull(t) || NodeKind(t) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(t) == AssignOp) {
+            int target = targetOf(RightChild(LeftChild(t)));
+            if (!id) {
+                markReplaced(target);
+            }
+            hit |= id && target == id;
+        } else if (NodeOp(t) == RoutineCallOp) {
+            hit |= argsWrite(RightChild(t), id);
+        }
+        PushTree(&pending, RightChild(t));
+        PushTree(&pending, LeftChild(t));
+    }
+    FreeTreeStack(&pending);
+    return hit;
+}
+
+/**
+ * recordLength - Records the length of an array declared with a constant size.
+ *
+ * @param decl The declaration (name, then type and initializer).
+ */
+void recordLength(tree decl) {
+    int id = IntVal(LeftChild(decl));
+    tree init = RightChild(RightChild(decl));
+    if (NodeKind(init) != EXPRNode || NodeOp(init) != ArrayTypeOp ||
+        (id < replaced_cap && replaced[id])) {
+        return;
+    }
+    tree obj = LeftChild(init);
+    if (NodeOp(obj) == BoundOp && NodeKind(RightChild(obj)) == NUMNode) {
+        SetAttr(id, LENGTH_ATTR, IntVal(RightChild(obj)));
+    } else if (NodeOp(obj) == CommaOp) {
+        SetAttr(id, LENGTH_ATTR, LeftDepth(obj));
+    }
+}
+
+/**
+ * findLengths - Records the length of every array declaration in a subtree.
+ *
+ * @param t The subtree.
+ */
+void findLengths(tree t) {
+    TreeStack pending; // Subtrees still to search
+    InitTreeStack(&pending);
+    PushTree(&pending, t);
+    while (pending.top) {
+        t = PopTree(&pending);
+        if (IsNull(t) || NodeKind(t) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(t) == DeclOp) {
+            recordLength(RightChild(t));
+        }
+        PushTree(&pending, RightChild(t));
+        PushTree(&pending, LeftChild(t));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * lengthOf - Returns the known length of an array variable, or 0.
+ *
+ * @param id The symbol.
+ */
+int lengthOf(int id) { return id && IsAttr(id, LENGTH_ATTR) ? GetAttr(id, LENGTH_ATTR) : 0; }
+
+/**
+ * markIndexes - Marks the safe indexes of a subtree.
+ *
+ * @param t     The subtree.
+ * @param var   A variable known to be in `[0, bound)` throughout the subtree, or 0.
+ * @param bound Its bound.
+ */
+void markIndexes(tree t, int var, int bound) {
+    TreeStack pending; // Subtrees still to mark
+    InitTreeStack(&pending);
+    PushTree(&pending, t);
+    while (pending.top) {
+        t = PopTree(&pending);
+        if (IsNull(t) || NodeKind(t) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(t) != VarOp) {
+            PushTree(&pending, RightChild(t));
+            PushTree(&pending, LeftChild(t));
+            continue;
+        }
+        int array = IntVal(LeftChild(t));
+        for (tree p = RightChild(t); !IsNull(p); p = RightChild(p)) {
+            tree sel = LeftChild(p);
+            if (NodeOp(sel) == FieldOp) {
+                array = IntVal(LeftChild(sel));
+                continue;
+            }
+            if (NodeOp(sel) != IndexOp) {
+                continue;
+            }
+            tree index = LeftChild(sel);
+            int length = lengthOf(array);
+            if ((NodeKind(index) == NUMNode && IntVal(index) >= 0 && IntVal(index) < length) ||
+                (var && isPlainVar(index, var) && bound <= length)) {
+                markSafe(sel);
+            }
+            PushTree(&pending, index);
+            array = 0;
+        }
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * markBody - Marks the indexes of a loop body that are safe by its induction variable.
+ *
+ * @param list  The body's statement list.
+ * @param var   The induction variable, in `[0, bound)` at the top of the body.
+ * @param bound Its bound.
+ * @param valid Cleared once a statement may have changed the variable.
+ */
+void markBody(tree list, int var, int bound, int *valid) {
+    TreeStack stmts; // Statements of the list, the first one on top
+    InitTreeStack(&stmts);
+    for (; !IsNull(list); list = LeftChild(list)) {
+        PushTree(&stmts, RightChild(list));
+    }
+    while (stmts.top && *valid) {
+        tree stmt = PopTree(&stmts);
+        if (writes(stmt, var)) {
+            *valid = 0;
+        } else {
+            markIndexes(stmt, var, bound);
+        }
+    }
+    FreeTreeStack(&stmts);
+}
+
+/**
+ * onlyIncrements - Reports whether every change of `var` in a subtree is `var := var + d`
+ *                  with a constant `0 <= d <= limit`.
+ *
+ * @param t     The subtree.
+ * @param var   The symbol.
+ * @param limit The largest increment that cannot wrap `var` around to a negative value.
+ */
+int onlyIncrements(tree t, int var, int limit) {
+    TreeStack pending; // Subtrees still to check; loop bodies are long spines
+    int ok = 1;
+    InitTreeStack(&pending);
+    PushTree(&pending, t);
+    while (pending.top && ok) {
+        t = PopTree(&pending);
+        if (IsNull(t) || NodeKind(t) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(t) == AssignOp && targetOf(RightChild(LeftChild(t))) == var) {
+            tree e = RightChild(t);
+            ok = NodeOp(e) == AddOp && ((isPlainVar(LeftChild(e), var) && NodeKind(RightChild(e)) == NUMNode &&
+                                         IntVal(RightChild(e)) >= 0 && IntVal(RightChild(e)) <= limit) ||
+                                        (isPlainVar(RightChild(e), var) && NodeKind(LeftChild(e)) == NUMNode &&
+                                         IntVal(LeftChild(e)) >= 0 && IntVal(LeftChild(e)) <= limit));
+            continue;
+        }
+        if (NodeOp(t) == RoutineCallOp && argsWrite(RightChild(t), var)) {
+            ok = 0;
+            continue;
+        }
+        PushTree(&pending, RightChild(t));
+        PushTree(&pending, LeftChild(t));
+    }
+    FreeTreeStack(&pending);
+    return ok;
+}
+
+/**
+ * isFact - Reports whether a variable is known to be non-negative.
+ *
+ * @param f   The facts.
+ * @param var The symbol.
+ */
+int isFact(Facts *f, int var) {
+    for (int i = 0; i < f->count; ++i) {
+        if (f->var[i] == var) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * scanLoop - Marks the safe indexes of a loop controlled by a non-negative variable.
+ *
+ * @param loop The `LoopOp`.
+ * @param f    The facts before the loop.
+ *
+ * The variable is below `bound` when the body starts, so an increment `d` keeps it
+ * non-negative as long as `bound + d` does not overflow.
+ */
+void scanLoop(tree loop, Facts *f) {
+    tree cond = LeftChild(loop);
+    if (NodeKind(cond) != EXPRNode || (NodeOp(cond) != LTOp && NodeOp(cond) != LEOp) ||
+        NodeOp(LeftChild(cond)) != VarOp || NodeKind(RightChild(cond)) != NUMNode) {
+        return;
+    }
+    if (NodeOp(cond) == LEOp && IntVal(RightChild(cond)) == INT_MAX) {
+        return; // `i <= INT_MAX` always holds, so `i` may wrap around
+    }
+    int var = IntVal(LeftChild(LeftChild(cond)));
+    int bound = IntVal(RightChild(cond)) + (NodeOp(cond) == LEOp);
+    int limit = bound < 0 ? INT_MAX : INT_MAX - bound; // A negative bound never runs the body
+    if (!isPlainVar(LeftChild(cond), var) || !isFact(f, var) || !onlyIncrements(RightChild(loop), var, limit)) {
+        return;
+    }
+    int valid = 1;
+    markBody(RightChild(loop), var, bound, &valid);
+}
+
+void scanList(tree list);
+
+/**
+ * isLocal - Reports whether only its own routine can change a variable.
+ *
+ * @param id The symbol.
+ */
+int isLocal(int id) {
+    int kind = GetAttr(id, KIND_ATTR);
+    return kind == VALUE_ARG || (kind == VAR && GetAttr(id, NEST_ATTR) > 1);
+}
+
+/**
+ * scanStmt - Marks the safe indexes of one statement and updates the facts after it.
+ *
+ * @param stmt The statement.
+ * @param f    The facts before it; on return, the facts after it.
+ */
+void scanStmt(tree stmt, Facts *f) {
+    if (IsNull(stmt) || NodeKind(stmt) != EXPRNode) {
+        return;
+    }
+
+    // Step 1: Constant indexes, loops and nested statement lists, which start over
+    switch (NodeOp(stmt)) {
+    case LoopOp:
+        markIndexes(LeftChild(stmt), 0, 0);
+        scanLoop(stmt, f);
+        scanList(RightChild(stmt));
+        break;
+    case IfElseOp:
+        for (tree c = stmt; !IsNull(c) && NodeOp(c) == IfElseOp; c = LeftChild(c)) {
+            tree rhs = RightChild(c);
+            if (NodeOp(rhs) == CommaOp) {
+                markIndexes(LeftChild(rhs), 0, 0);
+                rhs = RightChild(rhs);
+            }
+            scanList(rhs);
+        }
+        break;
+    case StmtOp:
+        scanList(stmt);
+        break;
+    default:
+        markIndexes(stmt, 0, 0);
+        break;
+    }
+
+    // Step 2: Forget the variables the statement may change, then learn `i := c`
+    for (int i = 0; i < f->count; ++i) {
+        if (writes(stmt, f->var[i])) {
+            f->var[i--] = f->var[--f->count];
+        }
+    }
+    if (NodeOp(stmt) == AssignOp && f->count < MAX_FACTS) {
+        tree target = RightChild(LeftChild(stmt));
+        int var = IntVal(LeftChild(target));
+        if (isPlainVar(target, var) && isLocal(var) && NodeKind(RightChild(stmt)) == NUMNode &&
+            IntVal(RightChild(stmt)) >= 0) {
+            f->var[f->count++] = var;
+        }
+    }
+}
+
+/**
+ * scanList - Marks the safe indexes of a statement list.
+ *
+ * @param list The list (`StmtOp` chain); it starts without facts.
+ */
+void scanList(tree list) {
+    Facts f = {.count = 0};
+    TreeStack stmts; // Statements of the list, the first one on top
+    InitTreeStack(&stmts);
+    for (tree p = list; !IsNull(p) && NodeOp(p) == StmtOp; p = LeftChild(p)) {
+        PushTree(&stmts, RightChild(p));
+    }
+    while (stmts.top) {
+        scanStmt(PopTree(&stmts), &f);
+    }
+    FreeTreeStack(&stmts);
+}
+
+/**
+ * scanMethods - Runs `scanList` over the body of every method of a subtree.
+ *
+ * @param t The subtree.
+ */
+void scanMethods(tree t) {
+    TreeStack pending; // Subtrees still to search
+    InitTreeStack(&pending);
+    PushTree(&pending, t);
+    while (pending.top) {
+        t = PopTree(&pending);
+        if (IsNull(t) || NodeKind(t) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(t) == StmtOp) {
+            scanList(t);
+            continue;
+        }
+        PushTree(&pending, RightChild(t));
+        PushTree(&pending, LeftChild(t));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * analyzeBounds - Records array lengths and safe indexes for `-check-bounds`.
+ *
+ * @param treenode The root of the syntax tree (`ProgramOp`), after folding.
+ */
+void analyzeBounds(tree treenode) {
+    // Forget the nodes and symbols of a previous compilation unit
+    for (int i = 0; i < SAFE_BUCKETS; ++i) {
+        while (safe_table[i]) {
+            SafeIndex *s = safe_table[i];
+            safe_table[i] = s->next;
+            free(s);
+        }
+    }
+    if (replaced) {
+        memset(replaced, 0, replaced_cap);
+    }
+    writes(treenode, 0);
+    findLengths(treenode);
+    scanMethods(treenode);
+}
@@ -0,0 +1,373 @@
+/**************************************************************************************************
+ * File: cache.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the storage of the **Compilation Cache** (`-cache DIR`). The code
+ *    generator decides what goes into an entry and what its key covers (see classKey and
+ *    storeClass in codegen.c); this file hashes, encodes, writes and reads entries.
+ *
+ *    1. **Keys:**
+ *       - 64-bit FNV-1a hashes, built up from integers, strings and IR instruction lists.
+ *
+ *    2. **Entries:**
+ *       - Growable buffers of records: an integer is 4 bytes, a string its length (-1 for
+ *         NULL) followed by its bytes. IR lists and emitter fragments are written as
+ *         sequences of such records.
+ *
+ *    3. **Files:**
+ *       - One file `<key>.mjc` per entry: the magic `MJC1`, the length of the records, the
+ *         records and their hash. A file is written under a temporary name and renamed into
+ *         place, so a reader never sees half an entry.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **CacheEntry *cacheLoad(char *dir, CacheKey key):**
+ *       - Reads the entry stored under a key, or returns NULL.
+ *
+ *    2. **void cacheSave(char *dir, CacheKey key, CacheEntry *e):**
+ *       - Stores an entry under a key.
+ *
+ *    3. **CacheEntry *cacheRead(FILE *in) / int cacheWrite(FILE *out, CacheEntry *e):**
+ *       - Read and write one entry in the file format, also for the workers of `-j N`.
+ *
+ **************************************************************************************************/
+
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "MJC1" // First bytes of every cache file
+
+/**
+ * cacheMix - Adds bytes to a key.
+ *
+ * @param h     The key so far.
+ * @param bytes The bytes.
+ * @param n     Their number.
+ */
+CacheKey cacheMix(CacheKey h, void *bytes, int n) {
+    unsigned char *p = bytes;
+    for (int i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+ * cacheMixInt - Adds an integer to a key.
+ *
+ * @param h The key so far.
+ * @param v The integer.
+ */
+CacheKey cacheMixInt(CacheKey h, int v) { return cacheMix(h, &v, sizeof(v)); }
+
+/**
+ * cacheMixStr - Adds a string to a key.
+ *
+ * @param h The key so far.
+ * @param s The string, or NULL (which differs from every string).
+ */
+CacheKey cacheMixStr(CacheKey h, char *s) {
+    if (!s) {
+        return cacheMixInt(h, -1);
+    }
+    int n = strlen(s);
+    return cacheMix(cacheMixInt(h, n), s, n);
+}
+
+/**
+ * cacheMixIR - Adds an instruction list to a key.
+ *
+ * @param h    The key so far.
+ * @param head The first instruction, or NULL for no list.
+ */
+CacheKey cacheMixIR(CacheKey h, IRInstr *head) {
+    for (IRInstr *p = head; p; p = p->next) {
+        int fields[] = {p->op, p->dst, p->src1, p->src2, p->imm, p->label, p->mem};
+        h = cacheMixStr(cacheMix(h, fields, sizeof(fields)), p->sym);
+    }
+    return cacheMixInt(h, -1);
+}
+
+/**
+ * cacheNew - Returns an empty entry.
+ */
+CacheEntry *cacheNew() { return calloc(1, sizeof(CacheEntry)); }
+
+/**
+ * cachePut - Appends bytes to an entry.
+ *
+ * @param e     The entry.
+ * @param bytes The bytes.
+ * @param n     Their number.
+ */
+void cachePut(CacheEntry *e, void *bytes, int n) {
+    if (e->len + n > e->cap) {
+        while (e->len + n > e->cap) {
+            e->cap = e->cap ? e->cap * 2 : 4096;
+        }
+        e->buf = realloc(e->buf, e->cap);
+    }
+    memcpy(e->buf + e->len, bytes, n);
+    e->len += n;
+}
+
+/**
+ * cachePutInt - Appends an integer record.
+ *
+ * @param e The entry.
+ * @param v The integer.
+ */
+void cachePutInt(CacheEntry *e, int v) { cachePut(e, &v, sizeof(v)); }
+
+/**
+ * cachePutStr - Appends a string record.
+ *
+ * @param e The entry.
+ * @param s The string, or NULL.
+ */
+void cachePutStr(CacheEntry *e, char *s) {
+    cachePutInt(e, s ? (int)strlen(s) : -1);
+    if (s) {
+        cachePut(e, s, strlen(s));
+    }
+}
+
+/**
+ * cachePutIR - Appends an instruction list: each instruction's fields, then -1.
+ *
+ * @param e    The entry.
+ * @param head The first instruction.
+ */
+void cachePutIR(CacheEntry *e, IRInstr *head) {
+    for (IRInstr *p = head; p; p = p->next) {
+        cachePutInt(e, p->op);
+        cachePutInt(e, p->dst);
+        cachePutInt(e, p->src1);
+        cachePutInt(e, p->src2);
+        cachePutInt(e, p->imm);
+        cachePutInt(e, p->label);
+        cachePutInt(e, p->mem);
+        cachePutStr(e, p->sym);
+    }
+    cachePutInt(e, -1);
+}
+
+/**
+ * cachePutFragment - Appends an emitter fragment: its sections, then its literals.
+ *
+ * @param e The entry.
+ * @param f The fragment.
+ */
+void cachePutFragment(CacheEntry *e, EmitFragment *f) {
+    cachePutStr(e, f->text);
+    cachePutStr(e, f->data);
+    cachePutInt(e, f->count);
+    for (int i = 0; i < f->count; ++i) {
+        cachePutInt(e, f->is_word[i]);
+        cachePutStr(e, f->values[i]);
+        cachePutStr(e, f->labels[i]);
+        cachePutInt(e, f->offsets[i]);
+    }
+}
+
+/**
+ * cacheGetInt - Reads the next integer record, or 0 past the end.
+ *
+ * @param e The entry.
+ */
+int cacheGetInt(CacheEntry *e) {
+    int v = 0;
+    if (e->pos + (int)sizeof(v) <= e->len) {
+        memcpy(&v, e->buf + e->pos, sizeof(v));
+        e->pos += sizeof(v);
+    }
+    return v;
+}
+
+/**
+ * cacheGetStr - Reads the next string record.
+ *
+ * @param e The entry.
+ *
+ * @return A newly allocated copy of the string, or NULL if NULL was written.
+ */
+char *cacheGetStr(CacheEntry *e) {
+    int n = cacheGetInt(e);
+    if (n < 0) {
+        return NULL;
+    }
+    if (n > e->len - e->pos) {
+        n = e->len - e->pos;
+    }
+    char *s = malloc(n + 1);
+    memcpy(s, e->buf + e->pos, n);
+    s[n] = '\0';
+    e->pos += n;
+    return s;
+}
+
+/**
+ * cacheGetIR - Reads the next instruction list.
+ *
+ * @param e The entry.
+ *
+ * @return The first instruction of a new, unlinked list (NULL if it is empty).
+ */
+IRInstr *cacheGetIR(CacheEntry *e) {
+    IRInstr *head = NULL, *prev = NULL;
+    for (int op = cacheGetInt(e); op >= 0 && e->pos < e->len; op = cacheGetInt(e)) {
+        int dst = cacheGetInt(e), src1 = cacheGetInt(e), src2 = cacheGetInt(e);
+        int imm = cacheGetInt(e), label = cacheGetInt(e), mem = cacheGetInt(e);
+        char *sym = cacheGetStr(e);
+        IRInstr *p = irNewInstr(op, dst, src1, src2, imm, sym);
+        free(sym);
+        p->label = label;
+        p->mem = mem;
+        p->prev = prev;
+        if (prev) {
+            prev->next = p;
+        } else {
+            head = p;
+        }
+        prev = p;
+    }
+    return head;
+}
+
+/**
+ * cacheGetFragment - Reads the next emitter fragment.
+ *
+ * @param e The entry.
+ */
+EmitFragment *cacheGetFragment(CacheEntry *e) {
+    EmitFragment *f = calloc(1, sizeof(EmitFragment));
+    f->text = cacheGetStr(e);
+    f->data = cacheGetStr(e);
+    f->count = cacheGetInt(e);
+    f->is_word = malloc((f->count + 1) * sizeof(int));
+    f->values = malloc((f->count + 1) * sizeof(char *));
+    f->labels = malloc((f->count + 1) * sizeof(char *));
+    f->offsets = malloc((f->count + 1) * sizeof(int));
+    for (int i = 0; i < f->count; ++i) {
+        f->is_word[i] = cacheGetInt(e);
+        f->values[i] = cacheGetStr(e);
+        f->labels[i] = cacheGetStr(e);
+        f->offsets[i] = cacheGetInt(e);
+    }
+    return f;
+}
+
+/**
+ * cachePath - Returns the file name of the entry stored under a key.
+ *
+ * @param dir The cache directory.
+ * @param key The key.
+ */
+char *cachePath(char *dir, CacheKey key) {
+    char *path = malloc(strlen(dir) + 32);
+    sprintf(path, "%s/%016llx.mjc", dir, key);
+    return path;
+}
+
+/**
+ * cacheRead - Reads an entry written by cacheWrite.
+ *
+ * @param in The file, positioned at the entry.
+ *
+ * @return The entry, positioned at its first record, or NULL if the file holds no intact entry.
+ */
+CacheEntry *cacheRead(FILE *in) {
+    char magic[4];
+    int len = -1;
+    CacheKey sum = 0;
+    CacheEntry *e = cacheNew();
+    if (fread(magic, 1, 4, in) == 4 && !memcmp(magic, CACHE_MAGIC, 4) &&
+        fread(&len, sizeof(len), 1, in) == 1 && len >= 0) {
+        e->buf = malloc(len + 1);
+        e->cap = len + 1;
+        if (fread(e->buf, 1, len, in) == (size_t)len && fread(&sum, sizeof(sum), 1, in) == 1) {
+            e->len = len;
+        }
+    }
+    if (e->len != len || cacheMix(CACHE_SEED, e->buf, len) != sum) {
+        cacheFree(e);
+        return NULL;
+    }
+    return e;
+}
+
+/**
+ * cacheWrite - Writes an entry: the magic, the length of the records, the records and their hash.
+ *
+ * @param out The file.
+ * @param e   The entry.
+ *
+ * @return 1 on success, 0 if writing failed.
+ */
+int cacheWrite(FILE *out, CacheEntry *e) {
+    CacheKey sum = cacheMix(CACHE_SEED, e->buf, e->len);
+    return fwrite(CACHE_MAGIC, 1, 4, out) == 4 && fwrite(&e->len, sizeof(e->len), 1, out) == 1 &&
+           fwrite(e->buf, 1, e->len, out) == (size_t)e->len && fwrite(&sum, sizeof(sum), 1, out) == 1;
+}
+
+/**
+ * cacheLoad - Reads the entry stored under a key.
+ *
+ * @param dir The cache directory.
+ * @param key The key.
+ *
+ * @return The entry, positioned at its first record, or NULL if there is no intact entry.
+ */
+CacheEntry *cacheLoad(char *dir, CacheKey key) {
+    char *path = cachePath(dir, key);
+    FILE *in = fopen(path, "rb");
+    free(path);
+    if (!in) {
+        return NULL;
+    }
+    CacheEntry *e = cacheRead(in);
+    fclose(in);
+    return e;
+}
+
+/**
+ * cacheSave - Stores an entry under a key, replacing any entry stored there before.
+ *
+ * @param dir The cache directory, which must exist.
+ * @param key The key.
+ * @param e   The entry.
+ *
+ * A failure to write only costs the reuse, so it is reported and otherwise ignored.
+ */
+void cacheSave(char *dir, CacheKey key, CacheEntry *e) {
+    char *path = cachePath(dir, key);
+    char *tmp = malloc(strlen(path) + 16);
+    sprintf(tmp, "%s.%d", path, (int)getpid());
+
+    FILE *out = fopen(tmp, "wb");
+    int ok = out && cacheWrite(out, e);
+    if (out && fclose(out)) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp, path)) {
+        fprintf(stderr, "warning: cannot write cache entry %s\n", path);
+        remove(tmp);
+    }
+    free(tmp);
+    free(path);
+}
+
+/**
+ * cacheFree - Releases an entry.
+ *
+ * @param e The entry.
+ */
+void cacheFree(CacheEntry *e) {
+    free(e->buf);
+    free(e);
+}
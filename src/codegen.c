@@ -1,9 +1,17 @@
+#include "cache.h"
+#include "emit.h"
+#include "ir.h"
 #include "symbol_table.h"
 #include "tree.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 /*
  * External function declarations
@@ -17,9 +25,31 @@ extern int loc_str();
 
 /*
  * yyparse - Invokes the parser generated by Yacc/Bison to parse
- * the input and construct the syntax tree.
+ * the input and construct the syntax tree. Returns nonzero on a syntax error.
  */
-extern void yyparse();
+extern int yyparse();
+
+/*
+ * yyin, yyrestart, yyline, yycolumn - The lexer's input file, the function that switches it
+ *                                     to another file and its position, reset between the
+ *                                     units of a batch compilation.
+ */
+extern FILE *yyin;
+void yyrestart(FILE *);
+extern int yyline, yycolumn;
+
+/*
+ * lexMapInput, lexUnmapInput - Scan a regular source file from a memory mapping instead of
+ *                              stdio. Implemented in lex.l.
+ */
+int lexMapInput(int fd);
+void lexUnmapInput();
+
+/*
+ * reset_string_tbl - Empties the string table for the next unit. Implemented in
+ *                    string_hash_table.c.
+ */
+void reset_string_tbl();
 
 /*
  * st_top - Represents the top index or position in the symbol table stack,
@@ -60,6 +90,67 @@ FILE *table;
  */
 void MkST(tree);
 
+/*
+ * foldProgram - Folds constant expressions, simplifies identities and removes branches whose
+ *               conditions are constant. Runs after `MkST` and before code generation.
+ *               Implemented in fold.c.
+ */
+tree foldProgram(tree);
+
+/*
+ * markReachable - Marks the methods reachable from `main` with `REACH_ATTR`. Runs after
+ *                 folding. Implemented in reach.c.
+ */
+void markReachable(tree);
+
+/*
+ * analyzeBounds - Records constant array lengths and the array indexes that cannot be out of
+ *                 bounds, for `-check-bounds`. Runs after folding. Implemented in bounds.c.
+ * isSafeIndex - Reports whether the check of an `IndexOp` can be left out.
+ */
+void analyzeBounds(tree);
+int isSafeIndex(tree);
+
+/*
+ * statsTree, statsRoutine, statsPrint - Count the syntax tree and the code of each routine,
+ *                                       and report them with the table sizes, for `--stats`.
+ *                                       Implemented in stats.c.
+ */
+void statsTree(tree);
+void statsRoutine(char *, int);
+void statsPrint(FILE *);
+void statsReset();
+
+/*
+ * saveAST, loadAST - Write and read the syntax tree with the symbol and string tables, for
+ *                    `-emit-ast FILE` and `-load-ast FILE`. Implemented in astfile.c.
+ */
+int saveAST(char *, tree);
+tree loadAST(char *);
+
+/*
+ * profileCounter, profileReport - Register the execution counters of `-profile` and print
+ *                                 them at exit.
+ * profileLoad, profileCount, profileHot - Read the counts of `-use-profile FILE` and look
+ *                                         them up. Implemented in profile.c.
+ */
+int profileCounter(char *);
+void profileReport();
+int profileLoad(char *);
+int profileCount(char *);
+int profileHot(char *);
+void profileReset();
+
+/*
+ * x86LowerInstr, x86Begin, x86Finish, x86Write - Lower the IR to x86-64 assembly and write
+ *                                               it, for `-target x86-64`. Implemented in
+ *                                               x86.c.
+ */
+void x86LowerInstr(IRInstr *);
+void x86Begin();
+void x86Finish();
+void x86Write(FILE *);
+
 /*
  * typeidop - Handles type identifier operations in the syntax tree.
  *            Implemented in seman.c.
@@ -88,8 +179,9 @@ extern char *opnodenames[];
 
 /*
  * visitVarOp - Visits and processes a variable operation node in the syntax tree.
+ *              Returns the memory class (IR_MEM_*) of the address it computes.
  */
-void visitVarOp(tree treenode);
+int visitVarOp(tree treenode);
 
 /*
  * visitCall - Generates MIPS assembly code for function or method calls.
@@ -101,6 +193,21 @@ void visitCall(tree treenode);
  */
 void visitStmt(tree treenode);
 
+/*
+ * visitExprInto - Generates code that evaluates an expression into a register.
+ */
+void visitExprInto(tree treenode, int dst);
+
+/*
+ * visitExpr - Generates code that evaluates an expression into `$t1`.
+ */
+void visitExpr(tree treenode);
+
+/*
+ * visitClassDefOp - Generates the code of a class definition.
+ */
+void visitClassDefOp(tree treenode);
+
 /*
  * Operation Node Names Mapping
  */
@@ -125,16 +232,10 @@ char *opnames[] = {
  */
 
 /*
- * entry - A character array that holds the entry point name (e.g., the `main` function or class).
- *         Used during code generation or for output purposes.
- */
-char entry[2048];
-
-/*
- * initwords - A buffer to store initialization code or commands in string form.
- *             This is often used during code generation to accumulate initialization steps for later output.
+ * entry - The name of the class holding the entry point (the `main` method).
+ *         Points into the string table; set while generating that class.
  */
-char initwords[10240];
+char *entry = NULL;
 
 /*
  * visit - Function to traverse and process the syntax tree.
@@ -287,345 +388,1340 @@ void myprinttree(tree treenode, int indent) {
 /**
  * Struct: proto
  * -------------
- * Represents a node in a linked list for storing function/method prototypes or variable sizes.
+ * Code generation facts about one symbol. Entries live in `protos`, indexed by the symbol's
+ * symbol table index, so every lookup is a single array access.
  *
  * Members:
- * - next: Pointer to the next `proto` node in the linked list.
- * - id:   Identifier (name) of the function/method or variable.
- * - arg:  Argument type string for functions/methods (NULL for variables).
- * - v:    Integer value, used for different purposes:
- *         - For functions: may be used as a flag or version number.
- *         - For variables: stores the size of the variable.
+ * - label: Assembly label of a method (`ClassName.MethodName`), NULL for other symbols.
+ * - arg:   Argument signature of a method ('R' per reference argument, 'I' per value argument
+ *          passed in a register, 'V' per value argument passed on the stack), NULL for
+ *          other symbols.
+ * - v:     Instance size in bytes of a class, 0 until its fields have been laid out.
  */
 struct proto {
-    struct proto *next; // Pointer to the next prototype in the list.
-    char *id;           // Identifier (function/method name or variable name).
-    char *arg;          // Argument signature (used for functions, NULL for variables).
-    int v;              // Value (0 for functions, size for variables).
-} *proto_list = NULL;   // Head of the linked list for prototypes.
+    char *label; // Method label (NULL if the symbol is not a method).
+    char *arg;   // Argument signature (NULL if the symbol is not a method).
+    int v;       // Size in bytes (classes only).
+} *protos = NULL;   // Registry indexed by symbol table index.
+int proto_cap = 0; // Number of entries in `protos`.
 
-/**
- * addProto - adds a new function/method prototype to the `proto_list`.
+/*
+ * reg_args - Cleared by `-stack-args`: pass every argument on the stack.
  *
- * @param id The name of the function/method.
- * @param arg The argument signature (e.g., "VIV" for "void, int, void").
+ * Otherwise the first `ARG_REGS` value arguments of a call travel in `$a0-$a3`. The caller still
+ * reserves a stack slot for each of them, and the callee stores the register there unless
+ * the frame optimizer can keep the value in the register (see irKeepArgs).
  */
-void addProto(char *id, char *arg) {
-    struct proto *p = malloc(sizeof(struct proto)); // Allocate memory for the new node.
-    p->id = id;                                     // Set the function/method name.
-    p->arg = arg;                                   // Set the argument type signature.
-    p->v = 0;                                       // Initialize value to 0 (used for functions).
+#define ARG_REGS 4
+int reg_args = 1;
 
-    // Insert the new node at the beginning of the linked list.
-    p->next = proto_list;
-    proto_list = p;
-}
+/*
+ * proto_pool - Storage for method labels and signatures.
+ *
+ * Strings are bump-allocated from blocks of at least `PROTO_POOL_SIZE` bytes instead of one
+ * `malloc` per string. Blocks are never moved or freed, so registry strings stay valid for
+ * the whole compilation.
+ */
+#define PROTO_POOL_SIZE 4096
+
+struct proto_pool {
+    struct proto_pool *next; // Previously filled block
+    int used, size;          // Bytes handed out from / capacity of `text`
+    char text[];             // String storage
+} *proto_pool = NULL;
 
 /**
- * addSize - adds a new variable or class size entry to the `proto_list`.
+ * protoText - Allocates `n` bytes for a registry string.
  *
- * @param id The name of the variable or class.
- * @param v The size (in bytes) of the variable or class.
+ * @param n The number of bytes, including the terminating '\0'.
  */
-void addSize(char *id, int v) {
-    struct proto *p = malloc(sizeof(struct proto)); // Allocate memory for the new node.
-    p->id = id;                                     // Set the variable or class name.
-    p->v = v;                                       // Set the size value.
-
-    // Insert the new node at the beginning of the linked list.
-    p->next = proto_list;
-    proto_list = p;
+char *protoText(int n) {
+    if (!proto_pool || proto_pool->used + n > proto_pool->size) {
+        int size = n > PROTO_POOL_SIZE ? n : PROTO_POOL_SIZE;
+        struct proto_pool *b = malloc(sizeof(struct proto_pool) + size);
+        b->next = proto_pool;
+        b->used = 0;
+        b->size = size;
+        proto_pool = b;
+    }
+    char *s = proto_pool->text + proto_pool->used;
+    proto_pool->used += n;
+    return s;
 }
 
 /**
- * findProto - searches for a function/method prototype in the `proto_list` by its identifier (`id`).
+ * protoEntry - Returns the registry entry of a symbol, growing the registry if needed.
  *
- * @param id The name of the function/method to search for.
+ * @param id The symbol table index of the method or class.
  */
-char *findProto(char *id) {
-    // Traverse the linked list of prototypes
-    for (struct proto *p = proto_list; p; p = p->next) {
-        // Compare the provided id with the current node's id (case-sensitive)
-        if (!strcmp(p->id, id)) {
-            return p->arg; // Return the argument signature if a match is found
+struct proto *protoEntry(int id) {
+    if (id >= proto_cap) {
+        int cap = proto_cap ? proto_cap : 64;
+        while (cap <= id) {
+            cap *= 2;
         }
+        protos = realloc(protos, cap * sizeof(struct proto));
+        memset(protos + proto_cap, 0, (cap - proto_cap) * sizeof(struct proto));
+        proto_cap = cap;
     }
-    return NULL; // Return NULL if the prototype is not found
+    return &protos[id];
 }
 
 /**
- * findSize - searches for a variable/class size in the `proto_list` by its identifier (`id`).
+ * addProto - records the label and argument signature of a method.
  *
- * @param id The name of the variable or class to search for.
+ * @param cls  The symbol table index of the class declaring the method.
+ * @param head The method's head (HeadOp): its name and its parameter specification (SpecOp).
  */
-int findSize(char *id) {
-    // Traverse the linked list of prototypes
-    for (struct proto *p = proto_list; p; p = p->next) {
-        // Compare the provided id with the current node's id (case-insensitive)
-        if (!strcasecmp(p->id, id)) {
-            return p->v; // Return the size if a match is found
+void addProto(int cls, tree head) {
+    int id = IntVal(LeftChild(head));                   // The method's symbol table index
+    struct proto *p = protoEntry(id);                   // Its registry entry
+    char *className = getname(GetAttr(cls, NAME_ATTR)); // Get the class name
+    char *methodName = getname(GetAttr(id, NAME_ATTR)); // Get the method name
+    tree spec;
+    int nargs = 0;
+
+    // The label is the fully qualified method name, "ClassName.MethodName"
+    p->label = protoText(strlen(className) + strlen(methodName) + 2);
+    sprintf(p->label, "%s.%s", className, methodName);
+
+    // The signature has one character per parameter: 'R' for a reference, 'I' for one of the
+    // first four value parameters when they travel in `$a0-$a3`, 'V' for any other value.
+    // E.g. `foo(val int a; int b)` gives "IR", or "VR" with `-stack-args`.
+    for (spec = LeftChild(RightChild(head)); !IsNull(spec); spec = RightChild(spec)) {
+        ++nargs;
+    }
+    p->arg = protoText(nargs + 1);
+    nargs = 0;
+    int regs = 0; // Value parameters given an argument register so far
+    for (spec = LeftChild(RightChild(head)); !IsNull(spec); spec = RightChild(spec)) {
+        if (NodeOp(spec) == RArgTypeOp) {
+            p->arg[nargs++] = 'R';
+        } else if (reg_args && regs < ARG_REGS) {
+            p->arg[nargs++] = 'I';
+            ++regs;
+        } else {
+            p->arg[nargs++] = 'V';
         }
     }
-    return 0; // Return 0 if the size is not found
+    p->arg[nargs] = '\0';
 }
 
 /**
- * opGenTable - Lookup table for generating MIPS assembly instructions for basic operations.
- *
- * This table maps operation types (e.g., addition, subtraction, logical comparisons) to their
- * corresponding MIPS assembly code snippets. It simplifies the code generation process by providing
- * quick access to pre-defined instruction patterns for each operation.
+ * addSize - records the instance size of a class.
  *
- * The generated instructions use `$t1` and `$t2` registers for intermediate computations.
+ * @param id The symbol table index of the class.
+ * @param v The size (in bytes) of the class.
  */
-char *opGenTable[] = {
-    /* Arithmetic Operations */
-
-    [AddOp] = "\tadd $t1, $t2, $t1\n",  // Addition: $t1 = $t2 + $t1
-    [SubOp] = "\tsub $t1, $t2, $t1\n",  // Subtraction: $t1 = $t2 - $t1
-    [MultOp] = "\tmul $t1, $t1, $t2\n", // Multiplication: $t1 = $t1 * $t2
-    [DivOp] = "\tdiv $t1, $t1, $t2\n",  // Division: $t1 = $t1 / $t2
-
-    /* Relational Comparison Operations */
-
-    [LTOp] = "\tslt $t1, $t2, $t1\n", // Less than: $t1 = ($t2 < $t1)
-    [GTOp] = "\tsgt $t1, $t2, $t1\n", // Greater than: $t1 = ($t2 > $t1)
-    [EQOp] = "\tseq $t1, $t2, $t1\n", // Equal to: $t1 = ($t2 == $t1)
-    [NEOp] = "\tsne $t1, $t2, $t1\n", // Not equal to: $t1 = ($t2 != $t1)
-    [LEOp] = "\tsle $t1, $t2, $t1\n", // Less than or equal to: $t1 = ($t2 <= $t1)
-    [GEOp] = "\tsge $t1, $t2, $t1\n", // Greater than or equal to: $t1 = ($t2 >= $t1)
-
-    /* Logical Operations */
-
-    [AndOp] = "\tsne $t1, $t1, $0\n" // Logical AND:
-              "\tsne $t2, $t2, $0\n" // Convert both operands to boolean (0 or 1)
-              "\tand $t1, $t2, $t1", // $t1 = $t2 && $t1
-
-    [OrOp] = "\tsne $t1, $t1, $0\n" // Logical OR:
-             "\tsne $t2, $t2, $0\n" // Convert both operands to boolean (0 or 1)
-             "\tor $t1, $t2, $t1",  // $t1 = $t2 || $t1
-};
+void addSize(int id, int v) { protoEntry(id)->v = v; }
 
 /**
- * visitExpr - Generates MIPS assembly code for evaluating expressions in the syntax tree.
+ * findProto - returns the argument signature of a method, or NULL if it has none.
  *
- * @param treenode The syntax tree node representing the expression.
- *
- * This function recursively traverses the expression tree and emits the appropriate
- * MIPS assembly instructions to evaluate the expression. It handles numeric constants,
- * variables, unary/binary operations, and function calls.
+ * @param id The symbol table index of the method.
  */
-void visitExpr(tree treenode) {
+char *findProto(int id) { return id < proto_cap ? protos[id].arg : NULL; }
 
-    // Handle null expressions by setting the result to 0
-    if (IsNull(treenode)) {
-        printf("\tadd $t1, $0, $0\n"); // $t1 = 0
-        return;
-    }
+/**
+ * findLabel - returns the assembly label of a method, or NULL if it has none.
+ *
+ * @param id The symbol table index of the method.
+ */
+char *findLabel(int id) { return id < proto_cap ? protos[id].label : NULL; }
 
-    // Process the expression node based on its kind
-    switch (NodeKind(treenode)) {
+/**
+ * findSize - returns the instance size of a class, or 0 if it is not known yet.
+ *
+ * @param id The symbol table index of the class.
+ */
+int findSize(int id) { return id < proto_cap ? protos[id].v : 0; }
 
-    // Handle numeric constants (e.g., literals like 42)
-    case NUMNode: {
-        int intval = IntVal(treenode); // Get the numeric value of the node
+/**
+ * IR Construction and MIPS Lowering
+ * ---------------------------------
+ * The visitors below no longer print instructions. They append three-address instructions
+ * (see ir.h) to the routine currently being generated; `closeFunction` then builds the
+ * routine's control-flow graph and lowers it to MIPS assembly on `stdout`. Data directives
+ * (`.data` strings, constants and singletons) are still printed directly, since they are
+ * not part of any routine.
+ */
 
-        // If the value fits in a 12-bit immediate, load it directly
-        if (-2048 < intval && intval <= 2048) {
-            printf("\tli $t1, %d\n", intval); // Load immediate: $t1 = intval, for 12-bit values
-        } else {
-            // For larger numbers, store them in the data section and load them
-            int label = ++current_label;
-            printf(".data\n");
-            printf("\tC_%d: .word %d\n", label, intval); // Define constant in data section
-            printf(".text\n");
-            printf("la $t1, C_%d\n", label); // Load address of constant
-            printf("lw $t1, 0($t1)\n");      // Load the constant into $t1
-        }
-        return;
-    }
+/*
+ * emit_ir - Set by `-emit-ir`: dump the IR of every unit next to its assembly.
+ * ir_dump - Destination of the textual IR dump of the unit being compiled, or NULL when
+ *           disabled.
+ */
+int emit_ir = 0;
+FILE *ir_dump = NULL;
 
-    // Handle expression nodes (binary/unary operations, function calls, etc.)
-    case EXPRNode: {
-        switch (NodeOp(treenode)) {
+/*
+ * time_report - Set by `--time-report`: print the wall-clock and CPU time of every phase to
+ *               stderr.
+ * phase_start - When the phase currently running started.
+ * phase_cpu - CPU time used when the phase currently running started.
+ */
+int time_report = 0;
+struct timespec phase_start;
+clock_t phase_cpu;
 
-        // Handle unary negation (e.g., -x)
-        case UnaryNegOp: {
-            ActionVisitExprLeft             // Evaluate the left child
-                printf("\tneg $t1, $t1\n"); // Negate the result
-            return;
-        }
+/*
+ * stats - Set by `--stats`: also count the syntax tree and the instructions of each routine,
+ *         and report them with the sizes of the symbol and string tables (see stats.c).
+ */
+int stats = 0;
 
-        // Handle logical NOT (e.g., !x)
-        case NotOp: {
-            ActionVisitExprLeft                // Evaluate the left child
-                printf("\tseq $t1, $t1, 0\n"); // Set $t1 to 1 if $t1 == 0, else 0
-            return;
-        }
+/*
+ * loop_opt - Cleared by `-no-loop-opt`: leave loops as code generation emitted them.
+ */
+int loop_opt = 1;
 
-        // Handle variable access (e.g., x)
-        case VarOp: {
-            visitVarOp(treenode);            // Load the address of the variable
-            printf("\tlw $t1, 0($t1) #1\n"); // Load the variable's value into $t1
-            return;
-        }
+/*
+ * inline_limit - Maximum number of instructions of a method the inliner copies into its
+ *                callers (`-inline-limit N`; 0 disables inlining).
+ */
+int inline_limit = 16;
 
-        // Handle binary arithmetic and logical operations
-        case AddOp:  // Addition (+)
-        case SubOp:  // Subtraction (-)
-        case MultOp: // Multiplication (*)
-        case DivOp:  // Division (/)
-        case LTOp:   // Less than (<)
-        case GTOp:   // Greater than (>)
-        case EQOp:   // Equal (==)
-        case NEOp:   // Not equal (!=)
-        case GEOp:   // Greater than or equal (>=)
-        case LEOp:   // Less than or equal (<=)
-        case AndOp:  // Logical AND (&&)
-        case OrOp: { // Logical OR (||)
+/*
+ * static_init - Cleared by `-no-static-init`: initialize every singleton at run time instead
+ *               of laying out constant fields as `.word` data.
+ */
+int static_init = 1;
 
-            ActionVisitExprLeft                  // Evaluate the left operand
-                printf("\taddi $sp, $sp, -4\n"); // Make space for the value on the stack by decreasing 4 bytes
-            printf("\tsw $t1, 0($sp)\n");        // Store the value from $t1 onto the stack
+/*
+ * check_bounds - Set by `-check-bounds`: arrays carry their length in the word before their
+ *                first element, and every index is checked against it.
+ * bounds_used - Set once a check was generated, so `codegenFinish` emits `bounds.error`.
+ */
+int check_bounds = 0;
+int bounds_used = 0;
 
-            ActionVisitExprRight              // Evaluate the right operand
-                printf("\tlw $t2, 0($sp)\n"); // Load the left operand back into $t2
-            printf("\taddi $sp, $sp, 4\n");   // Restore the stack pointer
+/*
+ * buffer_output - Set by `-buffer-output`: printing appends to a buffer in the `.data`
+ *                 section, which is written with one syscall when it fills up, before
+ *                 reading input and at exit (see emitOutputRuntime).
+ */
+int buffer_output = 0;
 
-            // Emit the corresponding operation code from the lookup table
-            puts(opGenTable[NodeOp(treenode)]);
-            break;
-        }
+/*
+ * dump_symtab, dump_ast - Print the symbol table and the syntax tree to stdout after semantic
+ *                         analysis. Chosen with `-dump all|symtab|ast|none`; both by default.
+ */
+int dump_symtab = 1;
+int dump_ast = 1;
 
-        // Handle function or method calls
-        case RoutineCallOp: {
-            visitCall(treenode);         // Generate code for the function call
-            printf("\tmove $t1, $v0\n"); // Move the return value into $t1
-            return;
-        }
-        }
-    }
-    }
-}
+/*
+ * emit_ast - File to write the checked syntax tree to (`-emit-ast FILE`), or NULL.
+ * load_ast - File to read the checked syntax tree from instead of parsing stdin
+ *            (`-load-ast FILE`), or NULL.
+ */
+char *emit_ast = NULL;
+char *load_ast = NULL;
 
-/**
- * visitArrayComma - Generates MIPS code to allocate and initialize an array.
- *
- * @param treenode The syntax tree representing a comma-separated array initializer.
- *
- * This function handles array initialization with multiple values, like:
- *     int arr[] = {1, 2, 3};
- *
- * The function does the following:
- * 1. Calculates the number of elements.
- * 2. Allocates memory on the heap.
- * 3. Iterates through the initializer and stores each value in the array.
+/*
+ * target_x86 - Set by `-target x86-64`: lower the IR to x86-64 assembly linked with
+ *              runtime/mjrt.c instead of MIPS assembly for SPIM (see x86.c).
  */
-void visitArrayComma(tree treenode) {
-    // Calculate the number of elements to initialize (depth - 1 due to tree structure)
-    int n = LeftDepth(treenode) - 1;
+int target_x86 = 0;
 
-    /*** Memory Allocation for the Array ***/
+/*
+ * profile - Set by `-profile`: count the calls of every method and the iterations of every
+ *           loop, and print the counts when `main` returns (see profile.c).
+ * use_profile - Set by `-use-profile FILE`: the counts of an earlier run guide inlining and
+ *               loop optimization (see closeFunction).
+ * loop_number - Number of loops of the current method so far, which names each loop's
+ *               counter.
+ */
+int profile = 0;
+int use_profile = 0;
+int loop_number = 0;
 
-    // Allocate memory for the array: size = number of elements * 4 (word size)
-    printf("\tli $a0, %d\n", LeftDepth(treenode) * 4); // Load size into $a0
-    printf("\tli $v0, 9\n");                           // System call code for sbrk (memory allocation)
-    printf("\tsyscall\n");                             // Request memory allocation
-    printf("\tmove $t1, $v0\n");                       // Store the base address of the allocated memory in $t1
+/*
+ * cache_dir - Directory of the compilation cache (`-cache DIR`), or NULL to generate every
+ *             class (see lookupClass).
+ */
+char *cache_dir = NULL;
 
-    // Push the base address of the array onto the stack for temporary storage
-    printf("\taddi $sp, $sp, -4\n"); // Adjust stack pointer to make space
-    printf("\tsw $t1, 0($sp)\n");    // Store array base address on the stack
+/*
+ * jobs - Number of classes generated at the same time (`-j N`, see mergeClass).
+ * job_output - In a worker, the file its class's entry goes to; NULL otherwise.
+ */
+int jobs = 1;
+FILE *job_output = NULL;
 
-    /*** Array Initialization Loop ***/
+/**
+ * phaseDone - Reports the time spent in the phase that just finished (with `--time-report`).
+ *
+ * @param name The name of the phase.
+ */
+void phaseDone(char *name) {
+    if (!time_report) {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock_t cpu = clock();
+    double ms = (now.tv_sec - phase_start.tv_sec) * 1e3 + (now.tv_nsec - phase_start.tv_nsec) / 1e6;
+    double cpu_ms = (cpu - phase_cpu) * 1e3 / CLOCKS_PER_SEC;
+    fprintf(stderr, "phase %-9s %10.3f ms %10.3f ms cpu\n", name, ms, cpu_ms);
+    phase_start = now;
+    phase_cpu = cpu;
+}
 
-    // Loop to evaluate and store each initializer expression into the allocated array
-    while (n >= 0) {
-        visitExpr(RightChild(treenode)); // Evaluate the current initializer expression
+/*
+ * field_words - Values of the fields of the class being generated, by offset / 4, as far as
+ *               they are known at compile time (see staticField).
+ * field_labels - Label of the static array a field points to, or NULL, by offset / 4.
+ * field_dynamic - Set once a field of the class needs code to be initialized.
+ */
+int *field_words = NULL;
+char **field_labels = NULL;
+int field_word_cap = 0;
+int field_dynamic = 0;
 
-        printf("\tlw $t2, 0($sp)\n");         // Load the base address of the array into $t2
-        printf("\tsw $t1, %d($t2)\n", n * 4); // Store the evaluated value into the correct array index
+/*
+ * init_classes - Classes whose singleton must be initialized before `main` runs, in
+ *                declaration order.
+ */
+char **init_classes = NULL;
+int init_class_count = 0;
+int init_class_cap = 0;
 
-        treenode = LeftChild(treenode); // Move to the next initializer (left child)
-        n--;                            // Decrement the index for the next array element
+/**
+ * addInitClass - Records a class whose `.init` routine runs in the start-up sequence.
+ *
+ * @param name The class name.
+ */
+void addInitClass(char *name) {
+    if (init_class_count == init_class_cap) {
+        init_class_cap = init_class_cap ? init_class_cap * 2 : 8;
+        init_classes = realloc(init_classes, init_class_cap * sizeof(char *));
     }
+    init_classes[init_class_count++] = name;
+}
 
-    /*** Restore Stack Pointer ***/
+/*
+ * HEAP_CHUNK - Bytes the allocator requests from `sbrk` beyond the allocation that runs out.
+ *
+ * Objects and arrays are carved out of the chunk between `$s6` (next free byte) and `$s7`
+ * (end of the chunk) by bumping `$s6`, so an allocation only makes a syscall when the chunk
+ * is exhausted. Nothing is ever freed, so the rest of an exhausted chunk is simply dropped.
+ */
+#define HEAP_CHUNK 16384
 
-    // Restore the stack pointer by popping the array base address
-    printf("\tlw $t1, 0($sp)\n");   // Reload the base address into $t1
-    printf("\taddi $sp, $sp, 4\n"); // Restore the stack pointer
-}
+/*
+ * OUTPUT_BUFFER - Size in bytes of the output buffer of `-buffer-output`, including the NUL
+ *                 that ends its contents when it is written.
+ */
+#define OUTPUT_BUFFER 4096
 
 /**
- * visitLoadInit - Generates MIPS code for initializing variables and arrays.
+ * callRuntime - Emits a call to a routine of the output runtime.
  *
- * @param treenode The syntax tree node representing a variable or array initialization.
+ * @param name The routine.
  *
- * This function handles different types of variable initializations:
- * 1. **Array Initialization** - Dynamically allocates memory for arrays and initializes elements.
- * 2. **Scalar Initialization** - Initializes scalar variables (integers, expressions).
- * 3. **Default Initialization** - Sets variables to zero if no initializer is provided.
+ * The IR treats printing as an instruction that writes `$v0`, `$a0` and `$v1` (see `irWrites`),
+ * so the calling routine may not have saved `$ra`; it is kept in `$v1` across the call.
  */
-void visitLoadInit(tree treenode) {
-    int type = NodeOp(RightChild(treenode));   // Operation type of the initializer
-    int kind = NodeKind(RightChild(treenode)); // Node kind of the initializer (e.g., NUMNode, EXPRNode)
-
-    /*** Case 1: Array Initialization ***/
-    if (type == ArrayTypeOp) {
-        tree obj = LeftChild(RightChild(treenode)); // Extract the array initializer object
-
-        // Check how the array is initialized: by size (`BoundOp`) or by values (`CommaOp`)
-        switch (NodeOp(obj)) {
-
-        /*** Case 1.1: Array Initialized with a Size (BoundOp) ***/
-        case BoundOp: {
-            // Evaluate the size expression (e.g., int arr[10]; → evaluate 10)
-            visitExpr(RightChild(obj));
-
-            // Multiply the size by 4 to allocate space for 32-bit words
-            printf("\tsll $t1, $t1, 2\n"); // $t1 = $t1 << 2 → $t1 = size * 4
-
-            // Pass the size to the memory allocation syscall
-            printf("\tmove $a0, $t1\n"); // Move size into $a0 for syscall
-            printf("\tli $v0, 9\n");     // Syscall 9: sbrk (allocate memory)
-            printf("\tsyscall\n");       // Allocate memory
-            printf("\tmove $t1, $v0\n"); // Store the base address of the allocated array in $t1
-            break;
-        }
-
-        /*** Case 1.2: Array Initialized with Explicit Values (CommaOp) ***/
-        case CommaOp: {
-            // Handle array initialization with multiple values (e.g., int arr[] = {1, 2, 3};)
-            visitArrayComma(obj);
-            break;
-        }
-        }
-
-        /*** Case 2: Scalar Initialization (e.g., int x = 5; or int x = a + b;) ***/
-    } else if (kind == NUMNode || kind == EXPRNode) {
-        printf("\t# init scalar\n");
-        visitExpr(RightChild(treenode)); // Evaluate and load the scalar initializer into $t1
-
-        /*** Case 3: Default Initialization (Uninitialized Variables) ***/
-    } else {
-        printf("\t# init zero\n");
-        printf("\tli $t1, 0\n"); // Default initialization to 0 if no explicit initializer
-    }
-}
+void callRuntime(char *name) { emitText("\tmove $v1, $ra\n\tjal %s\n\tmove $ra, $v1\n", name); }
 
 /**
- * visitClassStore - Generates MIPS code to initialize and store a **class field**.
+ * emitOutputRuntime - Emits the output buffer and the routines that fill and write it.
  *
- * @param treenode The syntax tree node representing the **class field** declaration.
- *
- * This function is responsible for initializing and storing **class fields** (member variables).
- * It performs the following steps:
+ * - `out.str` appends the NUL-terminated string at `$a0`, writing the buffer out first
+ *   whenever it is full.
+ * - `out.int` converts the integer in `$a0` to decimal and appends it like a string.
+ * - `out.flush` writes out what the buffer holds and empties it.
  *
- * 1. **Allocates memory** for the field if it is an object of another class.
- * 2. **Calls the field's class `.init` method** to properly initialize the object.
- * 3. **Stores the initialized object's address** into the correct memory offset of the class.
- * 4. **Updates the symbol table** to mark the member as a **FIELD** with its memory offset.
+ * The routines change only `$v0` and `$a0`, and `callRuntime` changes `$v1`; the temporaries
+ * they need are saved in the `.data` section.
+ */
+void emitOutputRuntime() {
+    emitData("out.buf: .space %d\n", OUTPUT_BUFFER - 1);
+    emitData("out.end: .space 1\n");          // Room for the NUL when the buffer is full
+    emitData("out.num: .space 11\n");         // Digits of `out.int`, written backwards
+    emitData("out.num.end: .space 1\n");      // NUL after the digits
+    emitData(".align 2\n");
+    emitData("out.ptr: .word out.buf\n");     // First free byte of the buffer
+    emitData("out.t0: .word 0\n");
+    emitData("out.t1: .word 0\n");
+    emitData("out.src: .word 0\n");
+
+    emitText("out.int:\n");
+    emitText("\tsw $t0, out.t0\n\tsw $t1, out.t1\n");
+    emitText("\tla $v0, out.num.end\n\tmove $t1, $a0\n"); // Keep the sign in $t1
+    emitText("\tbgez $a0, out.int.digit\n\tsubu $a0, $zero, $a0\n");
+    emitText("out.int.digit:\n"); // Unsigned division handles the negation of -2^31 too
+    emitText("\tli $t0, 10\n\tdivu $a0, $t0\n\tmflo $a0\n\tmfhi $t0\n\taddiu $t0, $t0, 48\n");
+    emitText("\taddiu $v0, $v0, -1\n\tsb $t0, 0($v0)\n\tbnez $a0, out.int.digit\n");
+    emitText("\tbgez $t1, out.int.done\n\tli $t0, 45\n\taddiu $v0, $v0, -1\n\tsb $t0, 0($v0)\n");
+    emitText("out.int.done:\n\tmove $a0, $v0\n\tj out.copy\n");
+
+    emitText("out.str:\n");
+    emitText("\tsw $t0, out.t0\n\tsw $t1, out.t1\n");
+    emitText("out.copy:\n\tlw $v0, out.ptr\n\tla $t1, out.end\n");
+    emitText("out.copy.next:\n\tlb $t0, 0($a0)\n\tbeqz $t0, out.copy.done\n");
+    emitText("\tbltu $v0, $t1, out.copy.put\n");
+    emitText("\tsw $a0, out.src\n\tsb $zero, 0($v0)\n\tla $a0, out.buf\n\tli $v0, 4\n\tsyscall\n");
+    emitText("\tlw $a0, out.src\n\tla $v0, out.buf\n");
+    emitText("out.copy.put:\n\tsb $t0, 0($v0)\n\taddiu $v0, $v0, 1\n\taddiu $a0, $a0, 1\n");
+    emitText("\tj out.copy.next\n");
+    emitText("out.copy.done:\n\tsw $v0, out.ptr\n\tlw $t0, out.t0\n\tlw $t1, out.t1\n\tjr $ra\n");
+
+    emitText("out.flush:\n");
+    emitText("\tlw $v0, out.ptr\n\tla $a0, out.buf\n\tbeq $v0, $a0, out.flush.done\n");
+    emitText("\tsb $zero, 0($v0)\n\tli $v0, 4\n\tsyscall\n\tla $v0, out.buf\n\tsw $v0, out.ptr\n");
+    emitText("out.flush.done:\n\tjr $ra\n");
+}
+
+/**
+ * lowerInstr - Emits the MIPS assembly for one IR instruction into the `.text` section.
+ *
+ * @param i The instruction to lower.
+ */
+void lowerInstr(IRInstr *i) {
+    char **r = irRegNames;
+    if (i->sym) {
+        emitReference(i->sym);
+    }
+    switch (i->op) {
+    case IR_LABEL:
+        if (i->sym) {
+            emitText("%s:\n", i->sym);
+        } else {
+            emitText("L_%d:\n", i->label);
+        }
+        break;
+    case IR_COMMENT:
+        emitText("\t# %s\n", i->sym);
+        break;
+    case IR_LI:
+        emitText("\tli %s, %d\n", r[i->dst], i->imm);
+        break;
+    case IR_LA:
+        emitText("\tla %s, %s\n", r[i->dst], i->sym);
+        break;
+    case IR_LW:
+        emitText("\tlw %s, %d(%s)\n", r[i->dst], i->imm, r[i->src1]);
+        break;
+    case IR_SW:
+        emitText("\tsw %s, %d(%s)\n", r[i->src1], i->imm, r[i->src2]);
+        break;
+    case IR_MOVE:
+        emitText("\tmove %s, %s\n", r[i->dst], r[i->src1]);
+        break;
+    case IR_NEG:
+        emitText("\tneg %s, %s\n", r[i->dst], r[i->src1]);
+        break;
+    case IR_J:
+        if (i->sym) {
+            emitText("\tj %s\n", i->sym);
+        } else {
+            emitText("\tj L_%d\n", i->label);
+        }
+        break;
+    case IR_CALL:
+        emitText("\tjal %s\n", i->sym);
+        break;
+    case IR_RET:
+        emitText("\tjr $ra\n");
+        break;
+    case IR_PRINT_INT:
+        if (buffer_output) {
+            emitText("\tmove $a0, %s\n", r[i->src1]);
+            callRuntime("out.int");
+        } else {
+            emitText("\tli $v0, 1\n\tmove $a0, %s\n\tsyscall\n", r[i->src1]);
+        }
+        break;
+    case IR_PRINT_STR:
+        if (buffer_output) {
+            emitText("\tla $a0, %s\n", i->sym);
+            callRuntime("out.str");
+        } else {
+            emitText("\tli $v0, 4\n\tla $a0, %s\n\tsyscall\n", i->sym);
+        }
+        break;
+    case IR_READ_INT:
+        if (buffer_output) { // The prompt printed before must appear first
+            callRuntime("out.flush");
+        }
+        emitText("\tli $v0, 5\n\tsyscall\n");
+        if (i->dst != R_V0) {
+            emitText("\tmove %s, $v0\n", r[i->dst]);
+        }
+        break;
+    case IR_ALLOC: {
+        int done = ++current_label;
+        emitText("\tmove $v0, $s6\n");
+        if (i->src1 == IR_NOREG) {
+            emitText("\taddiu $s6, $s6, %d\n", i->imm);
+        } else {
+            emitText("\taddu $s6, $s6, %s\n", r[i->src1]);
+        }
+        emitText("\tbgeu $s7, $s6, L_%d\n", done);
+        // Out of room: take a new chunk with the allocation at its start
+        emitText("\tsubu $a0, $s6, $v0\n\taddiu $a0, $a0, %d\n", HEAP_CHUNK);
+        emitText("\tli $v0, 9\n\tsyscall\n");
+        emitText("\taddu $s7, $v0, $a0\n\taddiu $s6, $s7, %d\n", -HEAP_CHUNK);
+        emitText("L_%d:\n", done);
+        if (i->dst != R_V0) {
+            emitText("\tmove %s, $v0\n", r[i->dst]);
+        }
+        break;
+    }
+    case IR_EXIT:
+        if (buffer_output) {
+            emitText("\tjal out.flush\n");
+        }
+        emitText("\tli $v0, 10\n\tsyscall\n");
+        break;
+    case IR_BOUNDS: // One unsigned comparison also catches negative indexes
+        if (i->src2 != IR_NOREG) {
+            emitText("\tbgeu %s, %s, bounds.error\n", r[i->src1], r[i->src2]);
+        } else {
+            emitText("\tbgeu %s, %d, bounds.error\n", r[i->src1], i->imm);
+        }
+        break;
+    case IR_COUNT:
+        emitText("\tlw $v1, %s+%d\n\taddiu $v1, $v1, 1\n", i->sym, i->imm);
+        emitText("\tsw $v1, %s+%d\n", i->sym, i->imm);
+        break;
+    default: // Binary operation or conditional branch with a register or an immediate second operand
+        if (irIsBranch(i->op)) {
+            if (i->src2 != IR_NOREG) {
+                emitText("\t%s %s, %s, L_%d\n", irOpNames[i->op], r[i->src1], r[i->src2], i->label);
+            } else {
+                emitText("\t%s %s, %d, L_%d\n", irOpNames[i->op], r[i->src1], i->imm, i->label);
+            }
+        } else if (i->src2 != IR_NOREG) {
+            emitText("\t%s %s, %s, %s\n", irOpNames[i->op], r[i->dst], r[i->src1], r[i->src2]);
+        } else if (i->op == IR_ADD) {
+            emitText("\taddi %s, %s, %d\n", r[i->dst], r[i->src1], i->imm);
+        } else if (i->op == IR_SLT) {
+            emitText("\tslti %s, %s, %d\n", r[i->dst], r[i->src1], i->imm);
+        } else {
+            emitText("\t%s %s, %s, %d\n", irOpNames[i->op], r[i->dst], r[i->src1], i->imm);
+        }
+        break;
+    }
+}
+
+/**
+ * lowerFunction - Prints the MIPS assembly for every instruction of a routine.
+ *
+ * @param f The routine to lower.
+ */
+void lowerFunction(IRFunc *f) {
+    int start = stats ? emitTextSize() : 0;
+    for (IRInstr *i = f->head; i; i = i->next) {
+        if (target_x86) {
+            x86LowerInstr(i);
+        } else {
+            lowerInstr(i);
+        }
+    }
+    if (stats) {
+        statsRoutine(f->name, emitCountInstructions(start));
+    }
+}
+
+/**
+ * closeFunction - Finishes the routine under construction, if any.
+ *
+ * Substitutes the bodies of small methods for its calls, runs the peephole optimizer over
+ * it, then the register argument and loop optimizers and the peephole optimizer again to
+ * clean up after them, then the frame optimizer, and offers the result to the inliner. It
+ * then builds its control-flow graph, dumps it when `-emit-ir` was given, lowers it to MIPS
+ * and releases it.
+ *
+ * With `-use-profile`, a method the profile saw never run is neither inlined into nor
+ * offered for inlining, and its loops are not optimized: its code only needs to be small.
+ * A hot method may be inlined at up to twice the usual size.
+ */
+void closeFunction() {
+    IRFunc *f = irEndFunc();
+    if (!f) {
+        return;
+    }
+    int cold = use_profile && profileCount(f->name) == 0;
+    int limit = use_profile && profileHot(f->name) ? 2 * inline_limit : inline_limit;
+    if (inline_limit && !cold) {
+        irInline(f, &current_label);
+    }
+    irPeephole(f);
+    int again = irKeepArgs(f);
+    if (loop_opt && !cold) {
+        irLoops(f);
+        again = 1;
+    }
+    if (again) {
+        irPeephole(f);
+    }
+    irShapeFrame(f);
+    if (inline_limit && !cold) {
+        irOfferInline(f, limit);
+    }
+    irBuildCFG(f);
+    if (ir_dump) {
+        irDump(f, ir_dump);
+    }
+    lowerFunction(f);
+    irFreeFunc(f);
+}
+
+/**
+ * openFunction - Starts a new routine, finishing the previous one first.
+ *
+ * @param name The routine's label.
+ */
+void openFunction(char *name) {
+    closeFunction();
+    irBeginFunc(name);
+}
+
+/**
+ * framePrologue - Emits the standard 12-byte frame setup: save `$ra`, `$s1` and `$fp`,
+ *                 then point `$fp` at the new frame.
+ */
+void framePrologue() {
+    irOpImm(IR_ADD, R_SP, R_SP, -12);
+    irStore(R_RA, 0, R_SP);
+    irStore(R_S1, 4, R_SP);
+    irStore(R_FP, 8, R_SP);
+    irMove(R_FP, R_SP);
+}
+
+/**
+ * frameEpilogue - Tears down the frame built by `framePrologue` and returns to the caller.
+ */
+void frameEpilogue() {
+    irMove(R_SP, R_FP);
+    irLoad(R_RA, 0, R_SP);
+    irLoad(R_S1, 4, R_SP);
+    irLoad(R_FP, 8, R_SP);
+    irOpImm(IR_ADD, R_SP, R_SP, 12);
+    irReturn();
+}
+
+/**
+ * qualify - Formats the label `name.member` (e.g. `Point.init`, `Point.singleton`).
+ *
+ * @param name   The class name.
+ * @param member The member or routine name.
+ *
+ * The result lives in a buffer that grows with the longest label and is reused by the next
+ * call; IR instructions copy the labels they are given, so callers pass it on directly.
+ */
+char *qualify(char *name, char *member) {
+    static char *buf = NULL;
+    static int cap = 0;
+    int n = strlen(name) + strlen(member) + 2;
+    if (n > cap) {
+        cap = n * 2;
+        buf = realloc(buf, cap);
+    }
+    sprintf(buf, "%s.%s", name, member);
+    return buf;
+}
+
+/**
+ * callInit - Emits a call to a class's `.init` routine.
+ *
+ * @param cls The class name.
+ */
+void callInit(char *cls) { irCall(qualify(cls, "init")); }
+
+/**
+ * Expression Register Pool
+ * ------------------------
+ * Temporaries of an expression live in a small pool of caller-saved registers instead of
+ * being pushed through `$sp`. `$t1` stays the result register every caller of `visitExpr`
+ * expects, and `$t2` stays the scratch register of `visitVarOp`/`visitAssign`; neither is
+ * handed out by the pool. `$s0`/`$s1` hold the object context and are never used.
+ *
+ * Pool registers are identified by their index into `exprRegs`; `RESULT_REG` names `$t1`.
+ */
+#define NUM_EXPR_REGS 8
+#define RESULT_REG (-1)
+
+int exprRegs[NUM_EXPR_REGS] = {R_T0, R_T3, R_T4, R_T5, R_T6, R_T7, R_T8, R_T9};
+
+/*
+ * exprRegBusy - Bitmask of pool registers currently holding a live temporary.
+ */
+int exprRegBusy = 0;
+
+/**
+ * regOf - Returns the machine register of a pool index or of the result register `$t1`.
+ *
+ * @param r Pool index or `RESULT_REG`.
+ */
+int regOf(int r) { return r == RESULT_REG ? R_T1 : exprRegs[r]; }
+
+/**
+ * freeRegCount - Returns the number of pool registers that are currently free.
+ */
+int freeRegCount() {
+    int n = 0;
+    for (int i = 0; i < NUM_EXPR_REGS; ++i) {
+        if (!(exprRegBusy & (1 << i))) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+/**
+ * allocReg - Takes the lowest free register out of the pool.
+ *
+ * `visitExprInto` spills before evaluating a subtree whose need exceeds the free registers,
+ * so running dry here is an internal error rather than a property of the input program.
+ */
+int allocReg() {
+    for (int i = 0; i < NUM_EXPR_REGS; ++i) {
+        if (!(exprRegBusy & (1 << i))) {
+            exprRegBusy |= 1 << i;
+            return i;
+        }
+    }
+    fprintf(stderr, "Internal error: expression register pool exhausted\n");
+    exit(1);
+}
+
+/**
+ * freeReg - Returns a register to the pool (`RESULT_REG` is ignored).
+ *
+ * @param r Pool index or `RESULT_REG`.
+ */
+void freeReg(int r) {
+    if (r != RESULT_REG) {
+        exprRegBusy &= ~(1 << r);
+    }
+}
+
+/**
+ * pushReg - Pushes a register onto the stack.
+ *
+ * @param r Machine register (R_*).
+ */
+void pushReg(int r) {
+    irOpImm(IR_ADD, R_SP, R_SP, -4); // Make space for the value on the stack by decreasing 4 bytes
+    irStore(r, 0, R_SP);             // Store the value onto the stack
+}
+
+/**
+ * popReg - Pops the top of the stack into a register.
+ *
+ * @param r Machine register (R_*).
+ */
+void popReg(int r) {
+    irLoad(r, 0, R_SP);             // Load the value back from the stack
+    irOpImm(IR_ADD, R_SP, R_SP, 4); // Restore the stack pointer
+}
+
+/**
+ * opGenTable - Lookup table mapping binary expression operators to IR operations.
+ *
+ * This table maps operation types (e.g., addition, subtraction, logical comparisons) to the
+ * three-address operation computing them, `dst = lhs op rhs`. The logical operators `&&` and
+ * `||` are not in the table: they short-circuit, so `visitCond` compiles them to branches.
+ */
+int opGenTable[] = {
+    /* Arithmetic Operations */
+
+    [AddOp] = IR_ADD,  // Addition: dst = lhs + rhs
+    [SubOp] = IR_SUB,  // Subtraction: dst = lhs - rhs
+    [MultOp] = IR_MUL, // Multiplication: dst = lhs * rhs
+    [DivOp] = IR_DIV,  // Division: dst = lhs / rhs
+
+    /* Relational Comparison Operations */
+
+    [LTOp] = IR_SLT, // Less than: dst = (lhs < rhs)
+    [GTOp] = IR_SGT, // Greater than: dst = (lhs > rhs)
+    [EQOp] = IR_SEQ, // Equal to: dst = (lhs == rhs)
+    [NEOp] = IR_SNE, // Not equal to: dst = (lhs != rhs)
+    [LEOp] = IR_SLE, // Less than or equal to: dst = (lhs <= rhs)
+    [GEOp] = IR_SGE, // Greater than or equal to: dst = (lhs >= rhs)
+};
+
+/**
+ * opBranchTable - Lookup table mapping relational operators to the conditional branch that is
+ *                 taken when the relation holds (see `visitCond`).
+ */
+int opBranchTable[] = {
+    [LTOp] = IR_BLT, // Branch if lhs < rhs
+    [GTOp] = IR_BGT, // Branch if lhs > rhs
+    [EQOp] = IR_BEQ, // Branch if lhs == rhs
+    [NEOp] = IR_BNE, // Branch if lhs != rhs
+    [LEOp] = IR_BLE, // Branch if lhs <= rhs
+    [GEOp] = IR_BGE, // Branch if lhs >= rhs
+};
+
+/**
+ * genBinary - Emits the IR of a binary expression operator.
+ *
+ * @param op  The AST operator (`NodeOp`).
+ * @param dst Destination register (R_*).
+ * @param lhs Register holding the left operand; may be overwritten.
+ * @param rhs Register holding the right operand; may be overwritten.
+ */
+void genBinary(int op, int dst, int lhs, int rhs) { irOp(opGenTable[op], dst, lhs, rhs); }
+
+/**
+ * hasCall - Reports whether an expression subtree contains a routine call.
+ *
+ * @param treenode The expression subtree.
+ *
+ * Calls may have side effects on variables read by the sibling operand, so operands
+ * are only reordered when neither side contains one.
+ */
+int hasCall(tree treenode) {
+    TreeStack pending; // Subtrees still to search; array initializers are long spines
+    int found = 0;
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top && !found) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+            continue;
+        }
+        found = NodeOp(treenode) == RoutineCallOp;
+        PushTree(&pending, RightChild(treenode));
+        PushTree(&pending, LeftChild(treenode));
+    }
+    FreeTreeStack(&pending);
+    return found;
+}
+
+/**
+ * isBinaryExprOp - Reports whether an operator is evaluated through `opGenTable`.
+ *
+ * @param op The operator (`NodeOp`) of an expression node.
+ */
+int isBinaryExprOp(int op) {
+    switch (op) {
+    case AddOp:
+    case SubOp:
+    case MultOp:
+    case DivOp:
+    case LTOp:
+    case GTOp:
+    case EQOp:
+    case NEOp:
+    case GEOp:
+    case LEOp:
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * leftFirst - Decides the evaluation order of a binary operator's operands.
+ *
+ * @param treenode The binary expression node.
+ * @param l        Register need of the left operand (see `exprNeed`).
+ * @param r        Register need of the right operand.
+ *
+ * Following Sethi-Ullman, the operand that needs more registers is evaluated first so
+ * the other one can be computed while its result is held. Source order is kept on ties
+ * and whenever a call makes reordering observable.
+ */
+int leftFirst(tree treenode, int l, int r) {
+    if (l >= r || hasCall(LeftChild(treenode)) || hasCall(RightChild(treenode))) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * exprNeed - Computes the Sethi-Ullman number of an expression subtree.
+ *
+ * @param treenode The expression subtree.
+ *
+ * The result is the number of pool registers, including the destination, needed to
+ * evaluate the subtree without spilling:
+ *   - Constants, calls (which save the live pool themselves) and null expressions need 1.
+ *   - A variable access needs 1 plus whatever its array index expressions need,
+ *     since the destination is reserved while `visitVarOp` evaluates them.
+ *   - A binary operator needs max(first, second + 1) in its evaluation order.
+ *   - `&&` and `||` hold only their destination while each operand is tested on its own,
+ *     so they need 1 + max(left, right).
+ */
+int exprNeed(tree treenode) {
+    if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+        return 1;
+    }
+
+    int op = NodeOp(treenode);
+
+    if (op == UnaryNegOp || op == NotOp || op == ShlOp || op == ShrOp) {
+        return exprNeed(LeftChild(treenode));
+    }
+
+    if (op == VarOp) {
+        int need = 0;
+        for (tree p = RightChild(treenode); !IsNull(p); p = RightChild(p)) {
+            if (NodeOp(p) == SelectOp && NodeOp(LeftChild(p)) == IndexOp) {
+                int n = exprNeed(LeftChild(LeftChild(p)));
+                need = n > need ? n : need;
+            }
+        }
+        return 1 + need;
+    }
+
+    if (op == AndOp || op == OrOp) {
+        int l = exprNeed(LeftChild(treenode));
+        int r = exprNeed(RightChild(treenode));
+        return 1 + (l > r ? l : r);
+    }
+
+    if (isBinaryExprOp(op)) {
+        int l = exprNeed(LeftChild(treenode));
+        int r = exprNeed(RightChild(treenode));
+        int left_first = leftFirst(treenode, l, r);
+        int first = left_first ? l : r;
+        int second = left_first ? r : l;
+        return first > second ? first : second + 1;
+    }
+
+    return 1;
+}
+
+/*
+ * Operands - The registers `visitOperands` left the two operands of a binary operator in.
+ */
+typedef struct Operands {
+    int lhs, rhs; // Machine registers (R_*) holding the left and right operand
+    int a, b;     // Pool registers of the first and second evaluated operand
+    int spilled;  // Whether the first operand went through the stack (it is then in `$t2`)
+} Operands;
+
+/**
+ * visitOperands - Evaluates both operands of a binary operator into registers.
+ *
+ * @param treenode The binary expression node.
+ * @param dst      Destination of the operator: a pool register owned by the caller, which
+ *                 then receives the first operand, or `RESULT_REG`.
+ *
+ * @return The operand registers; release them with `freeOperands` once the operator has
+ *         been emitted.
+ *
+ * The first operand is kept in a pool register while the second one is evaluated, and is
+ * spilled to the stack only when the second one needs more registers than are left.
+ */
+Operands visitOperands(tree treenode, int dst) {
+    Operands o;
+    int left_first = leftFirst(treenode, exprNeed(LeftChild(treenode)), exprNeed(RightChild(treenode)));
+    tree first = left_first ? LeftChild(treenode) : RightChild(treenode);
+    tree second = left_first ? RightChild(treenode) : LeftChild(treenode);
+
+    // Step 1: Evaluate the first operand; `$t1` is clobbered by variable accesses,
+    // so a pool register holds it unless the caller already gave us one
+    o.a = dst == RESULT_REG ? allocReg() : dst;
+    visitExprInto(first, o.a);
+    int held = regOf(o.a);
+
+    // Step 2: Spill the first operand only if the second one cannot fit otherwise
+    o.spilled = freeRegCount() < exprNeed(second);
+    if (o.spilled) {
+        pushReg(held);
+        freeReg(o.a);
+    }
+
+    // Step 3: Evaluate the second operand into a fresh register
+    o.b = allocReg();
+    visitExprInto(second, o.b);
+
+    // Step 4: Reload a spilled operand into the scratch register
+    if (o.spilled) {
+        popReg(R_T2);
+        held = R_T2;
+        if (o.a == dst && o.b != dst) {
+            exprRegBusy |= 1 << dst; // The caller still owns its destination
+        }
+    }
+
+    // Step 5: Report the operands in source order
+    o.lhs = left_first ? held : regOf(o.b);
+    o.rhs = left_first ? regOf(o.b) : held;
+    return o;
+}
+
+/**
+ * freeOperands - Returns the registers of evaluated operands to the pool.
+ *
+ * @param o   The operands from `visitOperands`.
+ * @param dst The destination passed to `visitOperands`; it stays with the caller.
+ */
+void freeOperands(Operands o, int dst) {
+    if (o.b != dst) {
+        freeReg(o.b);
+    }
+    if (o.a != dst && !o.spilled) {
+        freeReg(o.a);
+    }
+}
+
+/**
+ * visitCond - Generates the IR of a condition in control-flow context.
+ *
+ * @param treenode The condition expression.
+ * @param label    The label to branch to.
+ * @param jump_if  1 to branch when the condition holds, 0 to branch when it does not;
+ *                 otherwise control falls through.
+ *
+ * A relational operator becomes a single compare-and-branch instead of a 0/1 value in `$t1`
+ * tested against zero. `&&` and `||` short-circuit: the right operand is evaluated only when
+ * the left one does not decide the result. `!` reverses the branch sense, and a constant
+ * becomes an unconditional jump or nothing. Other expressions are evaluated into `$t1` and
+ * compared with zero.
+ */
+void visitCond(tree treenode, int label, int jump_if) {
+    if (!IsNull(treenode) && NodeKind(treenode) == NUMNode) {
+        if ((IntVal(treenode) != 0) == jump_if) {
+            irJump(label);
+        }
+        return;
+    }
+
+    if (!IsNull(treenode) && NodeKind(treenode) == EXPRNode) {
+        int op = NodeOp(treenode);
+        switch (op) {
+        case NotOp:
+            visitCond(LeftChild(treenode), label, !jump_if);
+            return;
+        case AndOp:
+        case OrOp: {
+            // The left operand decides `&&` when it is false and `||` when it is true
+            int decides = op == OrOp;
+            if (decides == jump_if) {
+                visitCond(LeftChild(treenode), label, jump_if);
+                visitCond(RightChild(treenode), label, jump_if);
+            } else {
+                int skip = ++current_label; // Reached when the left operand decides the other way
+                visitCond(LeftChild(treenode), skip, decides);
+                visitCond(RightChild(treenode), label, jump_if);
+                irLabel(skip);
+            }
+            return;
+        }
+        case LTOp:
+        case GTOp:
+        case EQOp:
+        case NEOp:
+        case GEOp:
+        case LEOp: {
+            Operands o = visitOperands(treenode, RESULT_REG);
+            int branch = opBranchTable[op];
+            irBranch(jump_if ? branch : irInverse(branch), o.lhs, o.rhs, label);
+            freeOperands(o, RESULT_REG);
+            return;
+        }
+        }
+    }
+
+    visitExpr(treenode);
+    irBranch(jump_if ? IR_BNE : IR_BEQ, R_T1, R_ZERO, label);
+}
+
+/**
+ * visitExprInto - Generates the IR that evaluates an expression into a register.
+ *
+ * @param treenode The syntax tree node representing the expression.
+ * @param dst      Destination register: a pool register owned by the caller, or `RESULT_REG`.
+ *
+ * Binary operators keep their first operand in a pool register while the second one is
+ * evaluated. The first operand is spilled to the stack only when the second one needs
+ * more registers than are left. Calls save the live part of the pool around the `jal`,
+ * because callees use the same registers.
+ */
+void visitExprInto(tree treenode, int dst) {
+    int d = regOf(dst);
+
+    // Handle null expressions by setting the result to 0
+    if (IsNull(treenode)) {
+        irLi(d, 0); // dst = 0
+        return;
+    }
+
+    // Process the expression node based on its kind
+    switch (NodeKind(treenode)) {
+
+    // Handle numeric constants (e.g., literals like 42)
+    case NUMNode: {
+        int intval = IntVal(treenode); // Get the numeric value of the node
+
+        // If the value fits in a 12-bit immediate, load it directly
+        if (-2048 < intval && intval <= 2048) {
+            irLi(d, intval); // Load immediate: dst = intval, for 12-bit values
+        } else {
+            // For larger numbers, store them in the data section (once per value) and load them
+            char *sym = emitWord(intval);
+            irLa(d, sym);                       // Load address of constant
+            irLoad(d, 0, d)->mem = IR_MEM_CONST; // Load the constant into dst
+        }
+        return;
+    }
+
+    // Handle expression nodes (binary/unary operations, function calls, etc.)
+    case EXPRNode: {
+        switch (NodeOp(treenode)) {
+
+        // Handle unary negation (e.g., -x)
+        case UnaryNegOp: {
+            visitExprInto(LeftChild(treenode), dst); // Evaluate the left child
+            irOp(IR_NEG, d, d, IR_NOREG);            // Negate the result
+            return;
+        }
+
+        // Handle logical NOT (e.g., !x)
+        case NotOp: {
+            visitExprInto(LeftChild(treenode), dst); // Evaluate the left child
+            irOpImm(IR_SEQ, d, d, 0);                // Set dst to 1 if dst == 0, else 0
+            return;
+        }
+
+        // Handle a left shift by a constant (e.g., x * 8 folded to x << 3)
+        case ShlOp: {
+            visitExprInto(LeftChild(treenode), dst);             // Evaluate the shifted operand
+            irOpImm(IR_SLL, d, d, IntVal(RightChild(treenode))); // dst <<= k
+            return;
+        }
+
+        // Handle a signed division by a power of two (e.g., x / 8 folded to x >> 3)
+        case ShrOp: {
+            int k = IntVal(RightChild(treenode));
+            visitExprInto(LeftChild(treenode), dst); // Evaluate the dividend
+
+            // An arithmetic shift rounds toward minus infinity; adding 2^k - 1 to negative
+            // dividends first makes it round toward zero like `div`. `$t2` holds the bias.
+            irOpImm(IR_SRA, R_T2, d, 31);      // $t2 = -1 if dst < 0, else 0
+            irOpImm(IR_SRL, R_T2, R_T2, 32 - k); // $t2 = 2^k - 1 if dst < 0, else 0
+            irOp(IR_ADD, d, d, R_T2);            // dst += bias
+            irOpImm(IR_SRA, d, d, k);            // dst >>= k
+            return;
+        }
+
+        // Handle variable access (e.g., x)
+        case VarOp: {
+            int mem = visitVarOp(treenode); // Load the address of the variable into $t1
+            irLoad(d, 0, R_T1)->mem = mem;  // Load the variable's value into dst
+            return;
+        }
+
+        // Handle binary arithmetic and logical operations
+        case AddOp:  // Addition (+)
+        case SubOp:  // Subtraction (-)
+        case MultOp: // Multiplication (*)
+        case DivOp:  // Division (/)
+        case LTOp:   // Less than (<)
+        case GTOp:   // Greater than (>)
+        case EQOp:   // Equal (==)
+        case NEOp:   // Not equal (!=)
+        case GEOp:   // Greater than or equal (>=)
+        case LEOp: { // Less than or equal (<=)
+            Operands o = visitOperands(treenode, dst);
+            genBinary(NodeOp(treenode), d, o.lhs, o.rhs);
+            freeOperands(o, dst);
+            return;
+        }
+
+        // Handle short-circuit logical operations as branches around two constants
+        case AndOp:  // Logical AND (&&)
+        case OrOp: { // Logical OR (||)
+            int no = ++current_label;
+            int end = ++current_label;
+            visitCond(treenode, no, 0); // Fall through when true, branch to `no` when false
+            irLi(d, 1);
+            irJump(end);
+            irLabel(no);
+            irLi(d, 0);
+            irLabel(end);
+            return;
+        }
+
+        // Handle function or method calls
+        case RoutineCallOp: {
+            // Step 1: Save the live temporaries; the destination holds nothing yet
+            int live = exprRegBusy & ~(dst == RESULT_REG ? 0 : 1 << dst);
+            int n = 0;
+            for (int i = 0; i < NUM_EXPR_REGS; ++i) {
+                if (live & (1 << i)) {
+                    ++n;
+                }
+            }
+            if (n) {
+                irOpImm(IR_ADD, R_SP, R_SP, -n * 4);
+                for (int i = 0, k = 0; i < NUM_EXPR_REGS; ++i) {
+                    if (live & (1 << i)) {
+                        irStore(exprRegs[i], 4 * k++, R_SP);
+                    }
+                }
+            }
+
+            // Step 2: The whole pool is available to the argument expressions
+            int busy = exprRegBusy;
+            exprRegBusy = 0;
+            visitCall(treenode); // Generate code for the function call
+            exprRegBusy = busy;
+
+            // Step 3: Restore the saved temporaries and fetch the return value
+            if (n) {
+                for (int i = 0, k = 0; i < NUM_EXPR_REGS; ++i) {
+                    if (live & (1 << i)) {
+                        irLoad(exprRegs[i], 4 * k++, R_SP);
+                    }
+                }
+                irOpImm(IR_ADD, R_SP, R_SP, n * 4);
+            }
+            irMove(d, R_V0); // Move the return value into dst
+            return;
+        }
+        }
+    }
+    }
+}
+
+/**
+ * visitExpr - Generates MIPS assembly code for evaluating expressions in the syntax tree.
+ *
+ * @param treenode The syntax tree node representing the expression.
+ *
+ * This function recursively traverses the expression tree and emits the appropriate
+ * MIPS assembly instructions to evaluate the expression. It handles numeric constants,
+ * variables, unary/binary operations, and function calls. The result is left in `$t1`.
+ */
+void visitExpr(tree treenode) { visitExprInto(treenode, RESULT_REG); }
+
+/**
+ * visitArrayComma - Generates MIPS code to allocate and initialize an array.
+ *
+ * @param treenode The syntax tree representing a comma-separated array initializer.
+ *
+ * This function handles array initialization with multiple values, like:
+ *     int arr[] = {1, 2, 3};
+ *
+ * The function does the following:
+ * 1. Calculates the number of elements.
+ * 2. Allocates memory on the heap.
+ * 3. Iterates through the initializer and stores each value in the array.
+ */
+void visitArrayComma(tree treenode) {
+    // Calculate the number of elements to initialize (depth - 1 due to tree structure)
+    int length = LeftDepth(treenode);
+    int n = length - 1;
+
+    /*** Memory Allocation for the Array ***/
+
+    // Allocate memory for the array: size = number of elements * 4 (word size)
+    // and keep the base address of the allocated memory in $t1
+    irEmit(IR_ALLOC, R_T1, IR_NOREG, IR_NOREG, (length + check_bounds) * 4, NULL);
+
+    // With `-check-bounds`, the first word holds the length and the array starts after it
+    if (check_bounds) {
+        irLi(R_T2, n + 1);
+        irStore(R_T2, 0, R_T1)->mem = IR_MEM_ELEM;
+        irOpImm(IR_ADD, R_T1, R_T1, 4);
+    }
+
+    // Push the base address of the array onto the stack for temporary storage
+    pushReg(R_T1);
+
+    /*** Array Initialization Loop ***/
+
+    // Loop to evaluate and store each initializer expression into the allocated array
+    while (n >= 0) {
+        visitExpr(RightChild(treenode)); // Evaluate the current initializer expression
+
+        irLoad(R_T2, 0, R_SP);      // Load the base address of the array into $t2
+        irStore(R_T1, n * 4, R_T2)->mem = IR_MEM_ELEM; // Store the evaluated value into the correct array index
+
+        treenode = LeftChild(treenode); // Move to the next initializer (left child)
+        n--;                            // Decrement the index for the next array element
+    }
+
+    /*** Restore Stack Pointer ***/
+
+    // Restore the stack pointer by popping the array base address
+    popReg(R_T1); // Reload the base address into $t1
+}
+
+/**
+ * visitLoadInit - Generates MIPS code for initializing variables and arrays.
+ *
+ * @param treenode The syntax tree node representing a variable or array initialization.
+ *
+ * This function handles different types of variable initializations:
+ * 1. **Array Initialization** - Dynamically allocates memory for arrays and initializes elements.
+ * 2. **Scalar Initialization** - Initializes scalar variables (integers, expressions).
+ * 3. **Default Initialization** - Sets variables to zero if no initializer is provided.
+ */
+void visitLoadInit(tree treenode) {
+    int type = NodeOp(RightChild(treenode));   // Operation type of the initializer
+    int kind = NodeKind(RightChild(treenode)); // Node kind of the initializer (e.g., NUMNode, EXPRNode)
+
+    /*** Case 1: Array Initialization ***/
+    if (type == ArrayTypeOp) {
+        tree obj = LeftChild(RightChild(treenode)); // Extract the array initializer object
+
+        // Check how the array is initialized: by size (`BoundOp`) or by values (`CommaOp`)
+        switch (NodeOp(obj)) {
+
+        /*** Case 1.1: Array Initialized with a Size (BoundOp) ***/
+        case BoundOp: {
+            // Evaluate the size expression (e.g., int arr[10]; → evaluate 10)
+            visitExpr(RightChild(obj));
+
+            if (check_bounds) {
+                // One more word in front of the elements holds the length
+                irOpImm(IR_SLL, R_T2, R_T1, 2);
+                irOpImm(IR_ADD, R_T2, R_T2, 4);
+                irEmit(IR_ALLOC, R_T2, R_T2, IR_NOREG, 0, NULL);
+                irStore(R_T1, 0, R_T2)->mem = IR_MEM_ELEM;
+                irOpImm(IR_ADD, R_T1, R_T2, 4); // The array starts after its length
+                break;
+            }
+
+            // Multiply the size by 4 to allocate space for 32-bit words
+            irOpImm(IR_SLL, R_T1, R_T1, 2); // $t1 = $t1 << 2 → $t1 = size * 4
+
+            // Allocate the memory and store the base address of the allocated array in $t1
+            irEmit(IR_ALLOC, R_T1, R_T1, IR_NOREG, 0, NULL);
+            break;
+        }
+
+        /*** Case 1.2: Array Initialized with Explicit Values (CommaOp) ***/
+        case CommaOp: {
+            // Handle array initialization with multiple values (e.g., int arr[] = {1, 2, 3};)
+            visitArrayComma(obj);
+            break;
+        }
+        }
+
+        /*** Case 2: Scalar Initialization (e.g., int x = 5; or int x = a + b;) ***/
+    } else if (kind == NUMNode || kind == EXPRNode) {
+        irComment("init scalar");
+        visitExpr(RightChild(treenode)); // Evaluate and load the scalar initializer into $t1
+
+        /*** Case 3: Default Initialization (Uninitialized Variables) ***/
+    } else {
+        irComment("init zero");
+        irLi(R_T1, 0); // Default initialization to 0 if no explicit initializer
+    }
+}
+
+/**
+ * visitClassStore - Generates MIPS code to initialize and store a **class field**.
+ *
+ * @param treenode The syntax tree node representing the **class field** declaration.
+ *
+ * This function is responsible for initializing and storing **class fields** (member variables).
+ * It performs the following steps:
+ *
+ * 1. **Allocates memory** for the field if it is an object of another class.
+ * 2. **Calls the field's class `.init` method** to properly initialize the object.
+ * 3. **Stores the initialized object's address** into the correct memory offset of the class.
+ * 4. **Updates the symbol table** to mark the member as a **FIELD** with its memory offset.
  *
  * ---
  * **Example Usage:**
@@ -645,9 +1741,11 @@ void visitLoadInit(tree treenode) {
  *
  * ```assembly
  * # Allocate memory for 'addr' (Address object)
- * li $a0, 8            # Assume Address object requires 8 bytes
- * li $v0, 9            # Syscall 9: sbrk (memory allocation)
- * syscall
+ * move $v0, $s6        # Next free byte of the heap chunk
+ * addiu $s6, $s6, 8    # Assume Address object requires 8 bytes
+ * bgeu $s7, $s6, L_2   # Still inside the chunk: no syscall
+ * ...                  # Otherwise request a new chunk with sbrk
+ * L_2:
  * move $s1, $s0        # Save the current object context
  * move $s0, $v0        # $s0 now points to the new Address object
  *
@@ -661,14 +1759,14 @@ void visitLoadInit(tree treenode) {
  * ```
  *
  * **Explanation:**
- * - **Memory Allocation:** Allocates 8 bytes for the `Address` object using the `sbrk` system call.
+ * - **Memory Allocation:** Allocates 8 bytes for the `Address` object from the current heap chunk.
  * - **Initialization:** Calls `Address.init` to initialize the `addr` object.
  * - **Storage:** Stores the initialized object's address at the correct offset in the `Person` object.
  */
 void visitClassStore(tree treenode) {
     // Retrieve the name of the class field being initialized
     DefGetNameAt(treenode);
-    printf("\t# init class var %s\n", name);
+    irComment("init class var %s", name);
 
     /*** Step 1: Retrieve the Field's Type Information ***/
 
@@ -684,17 +1782,11 @@ void visitClassStore(tree treenode) {
         /**
          * Allocate memory for the field if it is an object of another class.
          * - `findSize` determines how many bytes to allocate for the object.
-         * - Uses the `sbrk` syscall (syscall 9) to allocate memory dynamically.
+         * - Takes the bytes from the allocator's current heap chunk (see `HEAP_CHUNK`).
          */
 
-        // Load the size of the field's class type into $a0 (argument for syscall)
-        printf("\tli $a0, %d\n", findSize(getname(GetAttr(IntVal(t), NAME_ATTR))));
-
-        // Load syscall number 9 (`sbrk`) into $v0 for dynamic memory allocation
-        printf("\tli $v0, 9\n");
-
-        // Perform the syscall to allocate memory
-        printf("\tsyscall\n");
+        // Allocate as many bytes as the field's class type needs; the address lands in $v0
+        irEmit(IR_ALLOC, R_V0, IR_NOREG, IR_NOREG, findSize(IntVal(t)), NULL);
 
         /**
          * Save the current object context in `$s1` and set `$s0` to the newly allocated object.
@@ -702,22 +1794,22 @@ void visitClassStore(tree treenode) {
          * - `$s0` typically holds the **current object context** during class initialization.
          * - `$s1` is used as temporary storage to **preserve the outer object's context**.
          */
-        printf("\tmove $s1, $s0\n"); // Save current object context
-        printf("\tmove $s0, $v0\n"); // `$s0` now points to the allocated field object
+        irMove(R_S1, R_S0); // Save current object context
+        irMove(R_S0, R_V0); // `$s0` now points to the allocated field object
 
         /**
          * Call the `.init` method of the field's class to initialize its attributes.
          * - Ensures the newly allocated object is properly set up.
          */
-        printf("\tjal %s.init\n", getname(GetAttr(IntVal(t), NAME_ATTR)));
+        callInit(getname(GetAttr(IntVal(t), NAME_ATTR)));
 
         /**
          * After initialization, store the object's address in `$t1` and restore `$s0`.
          * - `$t1` will be used to store the object into the current class.
          * - `$s0` is restored to continue initializing other fields in the class.
          */
-        printf("\tmove $t1, $s0\n"); // Save initialized object's address into `$t1`
-        printf("\tmove $s0, $s1\n"); // Restore outer object context
+        irMove(R_T1, R_S0); // Save initialized object's address into `$t1`
+        irMove(R_S0, R_S1); // Restore outer object context
     }
 
     /*** Step 3: Store the Initialized Field in the Class Object ***/
@@ -727,7 +1819,7 @@ void visitClassStore(tree treenode) {
      * - **`current_offset`** holds the memory offset where this field should be stored.
      * - `$s0` holds the **base address** of the class object being initialized.
      */
-    printf("\tsw $t1, %d($s0)\n", current_offset); // Store field address at proper offset
+    irStore(R_T1, current_offset, R_S0)->mem = IR_MEM_FIELD; // Store field address at proper offset
 
     /*** Step 4: Update the Symbol Table to Reflect the Field's State ***/
 
@@ -756,7 +1848,7 @@ void visitClassStore(tree treenode) {
 void visitLocalStore(tree treenode) {
     // Retrieve the name of the local variable being initialized
     DefGetNameAt(treenode);
-    printf("\t# init local var %s %d\n", name, current_offset);
+    irComment("init local var %s %d", name, current_offset);
 
     /*** Step 1: Retrieve the Local Variable's Type Information ***/
 
@@ -772,20 +1864,14 @@ void visitLocalStore(tree treenode) {
         /**
          * Allocate memory for the local variable if it is an object of a class.
          * - `findSize` determines how many bytes to allocate for the object's type.
-         * - Uses the `sbrk` syscall (syscall 9) to allocate memory dynamically.
+         * - Takes the bytes from the allocator's current heap chunk (see `HEAP_CHUNK`).
          */
 
         // Print the type of the object being initialized
-        printf("\t# : %s\n", getname(GetAttr(IntVal(t), NAME_ATTR)));
-
-        // Load the size of the object's type into $a0 (argument for syscall)
-        printf("\tli $a0, %d\n", findSize(getname(GetAttr(IntVal(t), NAME_ATTR))));
-
-        // Load syscall number 9 (`sbrk`) into $v0 for dynamic memory allocation
-        printf("\tli $v0, 9\n");
+        irComment(": %s", getname(GetAttr(IntVal(t), NAME_ATTR)));
 
-        // Perform the syscall to allocate memory
-        printf("\tsyscall\n");
+        // Allocate as many bytes as the object's type needs; the address lands in $v0
+        irEmit(IR_ALLOC, R_V0, IR_NOREG, IR_NOREG, findSize(IntVal(t)), NULL);
 
         /**
          * Save the current context in `$s1` and assign the allocated memory address to `$s0`.
@@ -793,42 +1879,835 @@ void visitLocalStore(tree treenode) {
          * - `$s0` holds the base address of the current object being initialized.
          * - `$s1` temporarily holds the outer context to restore after initialization.
          */
-        printf("\tmove $s1, $s0\n"); // Save the current object context
-        printf("\tmove $s0, $v0\n"); // `$s0` now points to the newly allocated object
+        irMove(R_S1, R_S0); // Save the current object context
+        irMove(R_S0, R_V0); // `$s0` now points to the newly allocated object
 
         /**
          * Call the object's `.init` method to initialize its attributes.
          * - Ensures the object is properly set up after memory allocation.
          */
-        printf("\tjal %s.init\n", getname(GetAttr(IntVal(t), NAME_ATTR)));
+        callInit(getname(GetAttr(IntVal(t), NAME_ATTR)));
 
         /**
          * After initialization, save the object's address into `$t1` and restore `$s0`.
          * - `$t1` will be used to store the object on the stack.
          */
-        printf("\tmove $t1, $s0\n"); // Save initialized object's address into `$t1`
-        printf("\tmove $s0, $s1\n"); // Restore the previous object context
+        irMove(R_T1, R_S0); // Save initialized object's address into `$t1`
+        irMove(R_S0, R_S1); // Restore the previous object context
+    }
+
+    /*** Step 3: Update the Symbol Table for the Local Variable ***/
+
+    /**
+     * Update the symbol table to:
+     * - Record the variable's **memory offset** in the current stack frame.
+     * - Mark the symbol as a **local variable (VAR)**.
+     */
+    SetAttr(IntVal(treenode), OFFSET_ATTR, current_offset); // Set memory offset
+    SetAttr(IntVal(treenode), KIND_ATTR, VAR);              // Mark as a local variable
+
+    /*** Step 4: Store the Initialized Object or Primitive Variable on the Stack ***/
+
+    /**
+     * Reserve space on the stack and store the address of the initialized variable.
+     * - **`addi $sp, $sp, -4`** decreases the stack pointer to make space.
+     * - **`sw $t1, 0($sp)`** stores the variable's address or value on the stack.
+     */
+    pushReg(R_T1); // Allocate space on the stack and store the object's address or value
+}
+
+/**
+ * staticArray - Lays out the array a field starts with in the `.data` section.
+ *
+ * @param treenode The field's declaration (name, then type and initializer).
+ *
+ * Only the singleton of a class that is never used as a type ever has the field, so its
+ * array can be static data instead of heap memory when its size and values are constants:
+ * `int[10]` becomes `.space 40` and `{1, 2, 3}` becomes `.word 1, 2, 3`. With
+ * `-check-bounds`, the length word precedes the elements as on the heap.
+ *
+ * @return The label of the elements, or NULL if the array must be allocated at run time.
+ */
+char *staticArray(tree treenode) {
+    tree init = RightChild(RightChild(treenode));
+    if (!static_init || IsAttr(current_class, USED_ATTR) || NodeKind(init) != EXPRNode ||
+        NodeOp(init) != ArrayTypeOp) {
+        return NULL;
+    }
+    tree obj = LeftChild(init);
+    int n = NodeOp(obj) == BoundOp ? IntVal(RightChild(obj)) : LeftDepth(obj);
+    if (NodeOp(obj) == BoundOp && (NodeKind(RightChild(obj)) != NUMNode || n < 0)) {
+        return NULL;
+    }
+    if (NodeOp(obj) == CommaOp) {
+        for (tree p = obj; !IsNull(p) && NodeOp(p) == CommaOp; p = LeftChild(p)) {
+            if (NodeKind(RightChild(p)) != NUMNode) {
+                return NULL;
+            }
+        }
+    }
+
+    char *classname = getname(GetAttr(current_class, NAME_ATTR));
+    char *field = getname(GetAttr(IntVal(LeftChild(treenode)), NAME_ATTR));
+    char *label = malloc(strlen(classname) + strlen(field) + 7);
+    sprintf(label, "%s.%s.data", classname, field);
+    emitData(".align 4\n");
+    if (check_bounds) {
+        emitData("\t.word %d\n", n);
+    }
+    emitData("%s:", label);
+    if (NodeOp(obj) == BoundOp || !n) {
+        emitData(" .space %d\n", n * 4);
+        return label;
+    }
+
+    // The initializer lists the elements from the last one down (see visitArrayComma)
+    tree *elems = malloc(n * sizeof(tree));
+    tree p = obj;
+    for (int i = n - 1; i >= 0; --i) {
+        elems[i] = RightChild(p);
+        p = LeftChild(p);
+    }
+    for (int i = 0; i < n; ++i) {
+        emitData(i % 8 ? ", %d" : "\n\t.word %d", IntVal(elems[i]));
+    }
+    emitData("\n");
+    free(elems);
+    return label;
+}
+
+/**
+ * staticField - Records the value a field starts with, if it is known at compile time.
+ *
+ * @param treenode The field's declaration (name, then type and initializer).
+ *
+ * A field without an initializer starts at 0 and a field whose initializer folded to a
+ * constant starts at that constant. A constant array of a singleton starts as the address
+ * of its static data (see staticArray). Objects, other arrays and other initializers need
+ * code, which marks the class with `field_dynamic`.
+ *
+ * @return The label of the field's static array, or NULL.
+ */
+char *staticField(tree treenode) {
+    tree t = LeftChild(GetAttr(IntVal(LeftChild(treenode)), TYPE_ATTR));
+    tree init = RightChild(RightChild(treenode));
+    int slot = current_offset / 4;
+
+    if (slot >= field_word_cap) {
+        field_word_cap = slot * 2 + 16;
+        field_words = realloc(field_words, field_word_cap * sizeof(int));
+        field_labels = realloc(field_labels, field_word_cap * sizeof(char *));
+    }
+    field_words[slot] = NodeKind(init) == NUMNode ? IntVal(init) : 0;
+    field_labels[slot] = staticArray(treenode);
+    if (!field_labels[slot] && (NodeKind(t) == STNode || NodeKind(init) == EXPRNode)) {
+        field_dynamic = 1;
+    }
+    return field_labels[slot];
+}
+
+/**
+ * closeClassInit - Finishes the `.init` routine of the current class and creates its
+ *                  singleton instance.
+ *
+ * The singleton holds the class's data in the `.data` section, and `.addr` points to it.
+ * When every field is known at compile time (see staticField), the singleton is laid out
+ * with those values, so it needs no initialization at start-up. `.init` is then only kept
+ * if the class is used as a type, since allocated objects still run it.
+ */
+void closeClassInit() {
+    char *name = getname(GetAttr(current_class, NAME_ATTR));
+    int words = current_offset / 4;
+
+    // Restore the stack frame and return from the initialization routine
+    frameEpilogue();
+    if (static_init && !field_dynamic && !IsAttr(current_class, USED_ATTR)) {
+        irFreeFunc(irEndFunc()); // Nothing ever calls it
+    } else {
+        closeFunction();
+    }
+
+    // Lay out the singleton: its field values, or space for `.init` to fill
+    emitData(".align 4\n%s.singleton:", name);
+    if (static_init && !field_dynamic && words) {
+        for (int i = 0; i < words; ++i) {
+            emitData(i % 8 ? ", " : "\n\t.word ");
+            if (field_labels[i]) {
+                emitData("%s", field_labels[i]);
+            } else {
+                emitData("%d", field_words[i]);
+            }
+        }
+        emitData("\n");
+    } else {
+        emitData(" .space %d\n", current_offset);
+    }
+    emitData(".align 4\n%s.addr: .word %s.singleton\n", name, name); // Pointer to the singleton
+
+    // Record the size of the class for future memory allocation
+    addSize(current_class, current_offset);
+
+    // Mark that the first method has been handled
+    first_method = 0;
+}
+
+/*
+ * ClassCache - What the compilation cache needs to know about the class being generated
+ *              (see lookupClass): its key, the symbols its subtree refers to and the state
+ *              of code generation before it.
+ */
+typedef struct ClassCache {
+    CacheKey key;   // Hash of everything the class's code depends on
+    int *syms;      // Distinct symbols of the subtree, in the order they first appear
+    int count;      // Number of entries of `syms`
+    int cap;        // Number of slots of `syms`
+    int label;      // `current_label` before the class
+    int inits;      // `init_class_count` before the class
+    char *entry;    // `entry` before the class
+    int bounds;     // `bounds_used` before the class (cleared while it is generated)
+} ClassCache;
+
+/*
+ * LiteralFix - An instruction of a cached inline candidate that refers to a pooled literal.
+ *              The literal's label depends on the compilation, so the entry holds its text.
+ */
+typedef struct LiteralFix {
+    IRInstr *instr; // The instruction
+    int is_word;    // 1 for a word constant, 0 for a string
+    char *text;     // The literal's text
+} LiteralFix;
+
+/*
+ * layout_attrs - The attributes code generation sets while laying out a class.
+ */
+int layout_attrs[] = {KIND_ATTR, OFFSET_ATTR};
+
+/*
+ * symbol_seen - Position + 1 of each symbol in the `syms` of the class being hashed, by
+ *               symbol table index (0 if not listed).
+ */
+int *symbol_seen = NULL;
+int symbol_seen_cap = 0;
+
+/**
+ * symbolPosition - Returns the position of a symbol in the class's symbol list, adding it.
+ *
+ * @param c  The class.
+ * @param id The symbol table index.
+ */
+int symbolPosition(ClassCache *c, int id) {
+    if (id >= symbol_seen_cap) {
+        int cap = symbol_seen_cap;
+        symbol_seen_cap = id * 2 + 64;
+        symbol_seen = realloc(symbol_seen, symbol_seen_cap * sizeof(int));
+        memset(symbol_seen + cap, 0, (symbol_seen_cap - cap) * sizeof(int));
+    }
+    if (!symbol_seen[id]) {
+        if (c->count == c->cap) {
+            c->cap = c->cap ? c->cap * 2 : 64;
+            c->syms = realloc(c->syms, c->cap * sizeof(int));
+        }
+        c->syms[c->count++] = id;
+        symbol_seen[id] = c->count;
+    }
+    return symbol_seen[id] - 1;
+}
+
+/**
+ * mixLeaf - Adds the contents of a leaf to a key, after its kind.
+ *
+ * @param h        The key so far.
+ * @param treenode The leaf.
+ * @param c        As for mixTree.
+ */
+CacheKey mixLeaf(CacheKey h, tree treenode, ClassCache *c) {
+    switch (NodeKind(treenode)) {
+    case STNode:
+        if (!c) {
+            h = cacheMixStr(h, getname(GetAttr(IntVal(treenode), NAME_ATTR)));
+            return cacheMixInt(h, findSize(IntVal(treenode)));
+        }
+        return cacheMixInt(h, symbolPosition(c, IntVal(treenode)));
+    case IDNode:
+        return cacheMixStr(h, getname(IntVal(treenode)));
+    case STRINGNode:
+        return cacheMixStr(h, getstring(IntVal(treenode)));
+    case INTEGERTNode:
+    case CHARTNode:
+    case BOOLEANTNode:
+        return h; // Their value is the token's, which says nothing about the type
+    default:
+        return cacheMixInt(h, IntVal(treenode));
+    }
+}
+
+/**
+ * mixTree - Adds the shape and contents of a subtree to a key.
+ *
+ * @param h        The key so far.
+ * @param treenode The subtree.
+ * @param c        The class, whose symbol list records the symbols met; NULL to only add
+ *                 the names and sizes of symbols (for type trees).
+ *
+ * Symbols count by their position in the list, so the key does not depend on symbol table
+ * indexes, which change when earlier classes do. Nodes are added in pre-order, through an
+ * explicit stack since method bodies are long statement spines.
+ */
+CacheKey mixTree(CacheKey h, tree treenode, ClassCache *c) {
+    TreeStack pending; // Subtrees still to add, the next one on top
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (!treenode) {
+            h = cacheMixInt(h, -1);
+        } else if (NodeKind(treenode) == EXPRNode) {
+            h = cacheMixInt(cacheMixInt(h, EXPRNode), NodeOp(treenode));
+            PushTree(&pending, RightChild(treenode));
+            PushTree(&pending, LeftChild(treenode));
+        } else {
+            h = mixLeaf(cacheMixInt(h, NodeKind(treenode)), treenode, c);
+        }
+    }
+    FreeTreeStack(&pending);
+    return h;
+}
+
+/**
+ * mixSymbol - Adds what code generation reads of a symbol to a key.
+ *
+ * @param h  The key so far.
+ * @param id The symbol table index.
+ *
+ * That is its name, type, the attributes semantic analysis and the passes before code
+ * generation set, the layout earlier classes gave it, and the inline candidate of a method.
+ */
+CacheKey mixSymbol(CacheKey h, int id) {
+    static int attrs[] = {NEST_ATTR, KIND_ATTR, OFFSET_ATTR, USED_ATTR, REACH_ATTR, LENGTH_ATTR};
+    h = cacheMixStr(h, getname(GetAttr(id, NAME_ATTR)));
+    for (int i = 0; i < (int)(sizeof(attrs) / sizeof(attrs[0])); ++i) {
+        h = cacheMixInt(h, IsAttr(id, attrs[i]) ? GetAttr(id, attrs[i]) : -1);
+    }
+    h = mixTree(h, IsAttr(id, TYPE_ATTR) ? (tree)GetAttr(id, TYPE_ATTR) : NULL, NULL);
+    h = cacheMixStr(cacheMixStr(h, findLabel(id)), findProto(id));
+    h = cacheMixInt(h, findSize(id));
+    return cacheMixIR(h, irInlineBody(findLabel(id)));
+}
+
+/**
+ * classKey - Computes the cache key of a class.
+ *
+ * @param treenode The class definition (`ClassDefOp`).
+ * @param c        The class, whose symbol list is filled.
+ *
+ * The key covers the build of the compiler, the options that change code, the folded
+ * subtree and every symbol it refers to.
+ */
+CacheKey classKey(tree treenode, ClassCache *c) {
+    CacheKey h = cacheMixStr(CACHE_SEED, __DATE__ " " __TIME__);
+    int options[] = {loop_opt, inline_limit, static_init, check_bounds, reg_args, buffer_output, target_x86};
+    h = cacheMix(h, options, sizeof(options));
+    h = mixTree(h, treenode, c);
+    for (int i = 0; i < c->count; ++i) {
+        h = mixSymbol(h, c->syms[i]);
+    }
+    return h;
+}
+
+/**
+ * forgetSymbols - Releases the symbol list of a class.
+ *
+ * @param c The class.
+ */
+void forgetSymbols(ClassCache *c) {
+    for (int i = 0; i < c->count; ++i) {
+        symbol_seen[c->syms[i]] = 0;
+    }
+    free(c->syms);
+}
+
+/**
+ * classMethods - Lists the methods a class declares.
+ *
+ * @param treenode A subtree of the class.
+ * @param list     The list, growing.
+ * @param count    Number of entries of `list`.
+ */
+void classMethods(tree treenode, int **list, int *count) {
+    TreeStack pending; // Subtrees still to search, the next one on top
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(treenode) == MethodOp) {
+            *list = realloc(*list, (*count + 1) * sizeof(int));
+            (*list)[(*count)++] = IntVal(LeftChild(LeftChild(treenode)));
+            continue;
+        }
+        PushTree(&pending, RightChild(treenode));
+        PushTree(&pending, LeftChild(treenode));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * replayClass - Applies a cache entry in place of generating the class.
+ *
+ * @param treenode The class definition.
+ * @param c        The class.
+ * @param e        The entry (see storeClass for its layout).
+ */
+void replayClass(tree treenode, ClassCache *c, CacheEntry *e) {
+    int id = IntVal(RightChild(treenode));
+    char *name = getname(GetAttr(id, NAME_ATTR));
+    int base = cacheGetInt(e);
+    int labels = cacheGetInt(e);
+
+    // The layout code generation gave the symbols
+    for (int i = 0; i < c->count; ++i) {
+        int sym = c->syms[i];
+        for (int j = 0; j < 2; ++j) {
+            if (cacheGetInt(e)) {
+                SetAttr(sym, layout_attrs[j], cacheGetInt(e));
+            }
+        }
+        char *label = cacheGetStr(e), *arg = cacheGetStr(e);
+        int size = cacheGetInt(e);
+        struct proto *p = protoEntry(sym);
+        if (label) {
+            p->label = strcpy(protoText(strlen(label) + 1), label);
+            p->arg = strcpy(protoText(strlen(arg) + 1), arg);
+        }
+        if (size) {
+            p->v = size;
+        }
+        free(label);
+        free(arg);
+    }
+
+    // The start-up sequence, the entry point and the error routine
+    if (cacheGetInt(e)) {
+        addInitClass(name);
+    }
+    if (cacheGetInt(e)) {
+        entry = name;
+    }
+    bounds_used = cacheGetInt(e);
+
+    // Inline candidates for the classes after this one, and the literals they refer to
+    int n = cacheGetInt(e), fixes = 0, cap = 0;
+    char **names = malloc((n + 1) * sizeof(char *));
+    IRInstr **bodies = malloc((n + 1) * sizeof(IRInstr *));
+    LiteralFix *fix = NULL;
+    for (int i = 0; i < n; ++i) {
+        names[i] = cacheGetStr(e);
+        bodies[i] = cacheGetIR(e);
+        for (IRInstr *p = bodies[i]; p; p = p->next) {
+            int is_word = p->sym ? cacheGetInt(e) : -1;
+            if (is_word < 0) {
+                continue;
+            }
+            if (fixes == cap) {
+                cap = cap ? cap * 2 : 16;
+                fix = realloc(fix, cap * sizeof(LiteralFix));
+            }
+            fix[fixes].instr = p;
+            fix[fixes].is_word = is_word;
+            fix[fixes++].text = cacheGetStr(e);
+        }
+    }
+
+    // The code and data, with labels renumbered after those used so far
+    EmitFragment *f = cacheGetFragment(e);
+    emitReplay(f, current_label - base);
+    emitFreeFragment(f);
+    current_label += labels;
+
+    // The fragment has pooled the literals again, so this finds their current labels
+    for (int i = 0; i < fixes; ++i) {
+        free(fix[i].instr->sym);
+        fix[i].instr->sym = strdup(fix[i].is_word ? emitWord(atoi(fix[i].text)) : emitString(fix[i].text));
+        free(fix[i].text);
+    }
+    for (int i = 0; i < n; ++i) {
+        irAddInline(names[i], bodies[i]);
+        free(names[i]);
+    }
+    free(fix);
+    free(names);
+    free(bodies);
+}
+
+/**
+ * applyClass - Replays an entry for a class and releases it.
+ *
+ * @param treenode The class definition.
+ * @param c        The class, with its key and symbols computed in this compilation.
+ * @param e        The entry.
+ */
+void applyClass(tree treenode, ClassCache *c, CacheEntry *e) {
+    replayClass(treenode, c, e);
+    bounds_used |= c->bounds;
+    cacheFree(e);
+    forgetSymbols(c);
+}
+
+/**
+ * lookupClass - Looks a class up in the compilation cache (`-cache DIR`).
+ *
+ * @param treenode The class definition.
+ * @param c        Filled with the class's key and the state before it.
+ *
+ * On a hit the entry is replayed. Otherwise recording starts, and storeClass saves what
+ * the class generated once it is done. A worker of `-j N` records even without a cache.
+ *
+ * @return 1 on a hit.
+ */
+int lookupClass(tree treenode, ClassCache *c) {
+    closeFunction(); // Finish the routine before, which may become an inline candidate
+    memset(c, 0, sizeof(ClassCache));
+    c->key = classKey(treenode, c);
+    c->label = current_label;
+    c->inits = init_class_count;
+    c->entry = entry;
+    c->bounds = bounds_used;
+
+    CacheEntry *e = emit_ir || !cache_dir ? NULL : cacheLoad(cache_dir, c->key); // A hit has no IR to dump
+    if (e) {
+        applyClass(treenode, c, e);
+        return 1;
+    }
+    bounds_used = 0;
+    emitCaptureBegin();
+    return 0;
+}
+
+/**
+ * storeClass - Saves what a class generated in the compilation cache, or hands it to the
+ *              compiler that started the worker (see mergeClass).
+ *
+ * @param treenode The class definition.
+ * @param c        The class, as lookupClass left it.
+ *
+ * The entry holds the first and number of code labels the class used, the kind, offset,
+ * label, signature and size of each symbol of the class's list, whether the class joined
+ * the start-up sequence, held the entry point or used bounds checks, the inline candidates
+ * among its methods (with the text of each literal they refer to), and its code and data.
+ */
+void storeClass(tree treenode, ClassCache *c) {
+    closeFunction();
+    CacheEntry *e = cacheNew();
+    cachePutInt(e, c->label);
+    cachePutInt(e, current_label - c->label);
+
+    for (int i = 0; i < c->count; ++i) {
+        int sym = c->syms[i];
+        for (int j = 0; j < 2; ++j) {
+            cachePutInt(e, IsAttr(sym, layout_attrs[j]));
+            if (IsAttr(sym, layout_attrs[j])) {
+                cachePutInt(e, GetAttr(sym, layout_attrs[j]));
+            }
+        }
+        cachePutStr(e, findLabel(sym));
+        cachePutStr(e, findProto(sym));
+        cachePutInt(e, findSize(sym));
+    }
+
+    cachePutInt(e, init_class_count > c->inits);
+    cachePutInt(e, entry != c->entry);
+    cachePutInt(e, bounds_used);
+    bounds_used |= c->bounds;
+
+    int *methods = NULL, count = 0, candidates = 0;
+    classMethods(treenode, &methods, &count);
+    for (int i = 0; i < count; ++i) {
+        candidates += irInlineBody(findLabel(methods[i])) != NULL;
+    }
+    cachePutInt(e, candidates);
+    for (int i = 0; i < count; ++i) {
+        IRInstr *body = irInlineBody(findLabel(methods[i]));
+        if (body) {
+            cachePutStr(e, findLabel(methods[i]));
+            cachePutIR(e, body);
+            for (IRInstr *p = body; p; p = p->next) {
+                int is_word;
+                char *text = p->sym ? emitLiteralText(p->sym, &is_word) : NULL;
+                if (p->sym) {
+                    cachePutInt(e, text ? is_word : -1);
+                }
+                if (text) {
+                    cachePutStr(e, text);
+                }
+            }
+        }
+    }
+    free(methods);
+
+    EmitFragment *f = emitCaptureEnd();
+    cachePutFragment(e, f);
+    emitFreeFragment(f);
+
+    if (cache_dir) {
+        cacheSave(cache_dir, c->key, e);
+    }
+    if (job_output && !cacheWrite(job_output, e)) {
+        _exit(1);
+    }
+    cacheFree(e);
+    forgetSymbols(c);
+}
+
+/*
+ * ClassJob - A class of a `-j N` compilation and the worker that generates it.
+ */
+typedef struct ClassJob {
+    tree node;    // The class definition
+    int after;    // The last earlier class it depends on, or -1
+    int settled;  // 1 once startClass has run for it, whether or not it started a worker
+    pid_t pid;    // The worker, or 0 if there is none
+    int done;     // 1 once the worker has exited...
+    int status;   // ...with this status
+    FILE *result; // The file the worker writes the class's entry to
+} ClassJob;
+
+/*
+ * class_jobs - The classes of the program in source order, the next one to merge and the
+ *              number of workers running.
+ */
+ClassJob *class_jobs = NULL;
+int class_job_count = 0;
+int class_next = 0;
+int workers_running = 0;
+
+/**
+ * collectClasses - Lists the class definitions in the order `visit` reaches them.
+ *
+ * @param treenode A subtree of the program.
+ */
+void collectClasses(tree treenode) {
+    TreeStack pending; // Subtrees still to search, the next one on top
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+            continue;
+        }
+        if (NodeOp(treenode) == ClassDefOp) {
+            class_jobs = realloc(class_jobs, (class_job_count + 1) * sizeof(ClassJob));
+            class_jobs[class_job_count++] = (ClassJob){treenode, -1, 0, 0, 0, 0, NULL};
+            continue;
+        }
+        PushTree(&pending, RightChild(treenode));
+        PushTree(&pending, LeftChild(treenode));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * classOwner - Returns the class that declares a symbol.
+ *
+ * The semantic analyzer enters each class and then its members, one class after the other,
+ * so a class owns the symbols from its own entry up to the next class's.
+ *
+ * @param id The symbol table index.
+ *
+ * @return The class's position in `class_jobs`, or -1 for the predefined symbols.
+ */
+int classOwner(int id) {
+    int lo = 0, hi = class_job_count - 1, owner = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (IntVal(RightChild(class_jobs[mid].node)) <= id) {
+            owner = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return owner;
+}
+
+/**
+ * noteDependencies - Records which earlier classes declare the symbols of a subtree.
+ *
+ * @param job      The class being planned, at position `index`.
+ * @param index    Its position.
+ * @param treenode A subtree of the class, or a type tree it refers to.
+ * @param types    1 to follow the types of the symbols too (whose sizes the key covers).
+ */
+void noteDependencies(ClassJob *job, int index, tree treenode, int types) {
+    TreeStack pending; // Subtrees still to search; method bodies are long spines
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode)) {
+            continue;
+        }
+        if (NodeKind(treenode) == STNode) {
+            int id = IntVal(treenode), owner = classOwner(id);
+            if (owner < index && owner > job->after) {
+                job->after = owner;
+            }
+            if (types && IsAttr(id, TYPE_ATTR)) {
+                noteDependencies(job, index, (tree)GetAttr(id, TYPE_ATTR), 0);
+            }
+            continue;
+        }
+        if (NodeKind(treenode) == EXPRNode) {
+            PushTree(&pending, RightChild(treenode));
+            PushTree(&pending, LeftChild(treenode));
+        }
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * planClasses - Lists the classes of a `-j N` compilation and what each depends on.
+ *
+ * A class's code depends on the layout, signatures, sizes and inline candidates of the
+ * symbols it refers to (the same symbols its cache key covers), so it can be generated as
+ * soon as the classes declaring them are. If the classes' symbols are not in source order,
+ * every class depends on the one before.
+ *
+ * @param program The syntax tree.
+ */
+void planClasses(tree program) {
+    collectClasses(program);
+    int ordered = 1;
+    for (int i = 1; i < class_job_count; ++i) {
+        ordered &= IntVal(RightChild(class_jobs[i - 1].node)) < IntVal(RightChild(class_jobs[i].node));
+    }
+    for (int i = 0; i < class_job_count; ++i) {
+        if (ordered) {
+            noteDependencies(&class_jobs[i], i, class_jobs[i].node, 1);
+        } else {
+            class_jobs[i].after = i - 1;
+        }
+    }
+}
+
+/**
+ * startClass - Forks a worker that generates a class into an entry.
+ *
+ * The worker is a copy of this compiler with every class before the one being merged
+ * already generated, which includes everything the class depends on. It generates the
+ * class as a cache miss would (recording from its own label numbers), writes the entry to
+ * a temporary file and exits. A class that is a cache hit needs no worker. Either way the
+ * class is settled: it is not considered again, and without a worker it is generated when
+ * it is merged.
+ *
+ * @param job The class.
+ */
+void startClass(ClassJob *job) {
+    job->settled = 1;
+    if (cache_dir) {
+        ClassCache c;
+        memset(&c, 0, sizeof(ClassCache));
+        c.key = classKey(job->node, &c);
+        forgetSymbols(&c);
+        CacheEntry *e = cacheLoad(cache_dir, c.key);
+        if (e) {
+            cacheFree(e);
+            return;
+        }
+    }
+
+    job->result = tmpfile();
+    if (!job->result) {
+        return;
+    }
+    fflush(NULL); // Nothing buffered is written twice
+    pid_t pid = fork();
+    if (pid == 0) {
+        jobs = 1;
+        job_output = job->result;
+        visitClassDefOp(job->node);
+        _exit(fflush(job_output) ? 1 : 0);
     }
+    if (pid < 0) {
+        fclose(job->result);
+        job->result = NULL;
+        return;
+    }
+    job->pid = pid;
+    ++workers_running;
+}
 
-    /*** Step 3: Update the Symbol Table for the Local Variable ***/
+/**
+ * scheduleClasses - Notes the workers that finished and starts classes that can run.
+ *
+ * The compiler itself generates the class being merged if it has no worker, so at most
+ * `jobs - 1` workers run at a time.
+ */
+void scheduleClasses() {
+    int status;
+    pid_t pid;
+    while (workers_running && (pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < class_job_count; ++i) {
+            if (class_jobs[i].pid == pid) {
+                class_jobs[i].done = 1;
+                class_jobs[i].status = status;
+                --workers_running;
+            }
+        }
+    }
+    for (int i = class_next + 1; i < class_job_count && workers_running < jobs - 1; ++i) {
+        ClassJob *job = &class_jobs[i];
+        if (!job->settled && job->after < class_next) {
+            startClass(job);
+        }
+    }
+}
 
-    /**
-     * Update the symbol table to:
-     * - Record the variable's **memory offset** in the current stack frame.
-     * - Mark the symbol as a **local variable (VAR)**.
-     */
-    SetAttr(IntVal(treenode), OFFSET_ATTR, current_offset); // Set memory offset
-    SetAttr(IntVal(treenode), KIND_ATTR, VAR);              // Mark as a local variable
+/**
+ * mergeClass - Takes the code of a class from its worker (`-j N`).
+ *
+ * Classes are merged in source order, so labels, pooled literals, the start-up sequence
+ * and therefore `code.s` come out exactly as in a serial compilation.
+ *
+ * @param treenode The class definition.
+ *
+ * @return 1 if the worker's entry was replayed, 0 if the class must be generated here
+ *         (no worker, or the worker failed).
+ */
+int mergeClass(tree treenode) {
+    if (class_next >= class_job_count || class_jobs[class_next].node != treenode) {
+        return 0;
+    }
+    closeFunction(); // Workers start after the routine before
+    scheduleClasses();
+    ClassJob *job = &class_jobs[class_next++];
+    if (!job->pid) {
+        return 0;
+    }
 
-    /*** Step 4: Store the Initialized Object or Primitive Variable on the Stack ***/
+    // Step 1: Wait for the worker and read its entry
+    if (!job->done) {
+        waitpid(job->pid, &job->status, 0);
+        --workers_running;
+    }
+    CacheEntry *e = NULL;
+    if (WIFEXITED(job->status) && !WEXITSTATUS(job->status)) {
+        rewind(job->result);
+        e = cacheRead(job->result);
+    }
+    fclose(job->result);
+    if (!e) {
+        return 0;
+    }
 
-    /**
-     * Reserve space on the stack and store the address of the initialized variable.
-     * - **`addi $sp, $sp, -4`** decreases the stack pointer to make space.
-     * - **`sw $t1, 0($sp)`** stores the variable's address or value on the stack.
-     */
-    printf("\taddi $sp, $sp, -4\n"); // Allocate space on the stack
-    printf("\tsw $t1, 0($sp)\n");    // Store the object's address or value
+    // Step 2: Replay it against the symbols this compilation lists for the class
+    ClassCache c;
+    memset(&c, 0, sizeof(ClassCache));
+    c.key = classKey(treenode, &c);
+    c.bounds = bounds_used;
+    applyClass(treenode, &c, e);
+    return 1;
 }
 
 /**
@@ -844,27 +2723,34 @@ void visitLocalStore(tree treenode) {
  * 5. Appends initialization code to ensure the class is properly set up at runtime.
  */
 void visitClassDefOp(tree treenode) {
+    /*** Step 0: Reuse the Code of an Unchanged Class ***/
+    ClassCache cache;
+    if (jobs > 1 && mergeClass(treenode)) {
+        return;
+    }
+    if ((cache_dir || job_output) && lookupClass(treenode, &cache)) {
+        return;
+    }
+
     /*** Step 1: Retrieve the Class Name ***/
 
     // Extract the class name from the right child of the class definition node
     DefGetNameAt(RightChild(treenode));
-    printf("\t# class %s\n", name); // Comment for debugging: which class is being initialized
 
     /*** Step 2: Define the Class Initialization Routine ***/
 
     // Start the class's `.init` method, which initializes class fields
-    printf("%s.init:\n", name);
+    char *label = qualify(name, "init");
+    openFunction(label);
+    irComment("class %s", name); // Comment for debugging: which class is being initialized
+    irNamedLabel(label);
 
     /**
      * Step 2.1: Set up the stack frame for the `.init` method.
      * - Save the return address (`$ra`) to return after initialization.
      * - Save `$s1` (object context) and `$fp` (frame pointer) for restoration later.
      */
-    printf("\taddi $sp, $sp, -12\n"); // Allocate space for `$ra`, `$s1`, and `$fp`
-    printf("\tsw $ra, 0($sp)\n");     // Save return address
-    printf("\tsw $s1, 4($sp)\n");     // Save `$s1` (object context)
-    printf("\tsw $fp, 8($sp)\n");     // Save frame pointer
-    printf("\tmove $fp, $sp\n");      // Set up the frame pointer
+    framePrologue();
 
     /*** Step 3: Initialize Class Fields ***/
 
@@ -872,6 +2758,7 @@ void visitClassDefOp(tree treenode) {
     first_method = 1;                             // Flag to track if any method was defined
     current_class = IntVal(RightChild(treenode)); // Record the current class's symbol table index
     current_offset = 0;                           // Reset field offset for the class
+    field_dynamic = 0;                            // No field needs code yet
 
     // Visit the left and right children to initialize fields and methods
     ActionVisitLeft      // Initialize class fields
@@ -881,100 +2768,34 @@ void visitClassDefOp(tree treenode) {
 
         if (first_method) {
         /**
-         * If no methods were defined, finalize the `.init` routine.
-         * - Restore the stack frame and return.
-         */
-        printf("\tmove $sp, $fp\n");    // Restore stack pointer
-        printf("\tlw $ra, 0($sp)\n");   // Restore return address
-        printf("\tlw $s1, 4($sp)\n");   // Restore `$s1`
-        printf("\tlw $fp, 8($sp)\n");   // Restore frame pointer
-        printf("\tadd $sp, $sp, 12\n"); // Deallocate stack frame
-        printf("\tjr $ra\n");           // Return from `.init`
-
-        /*** Step 5: Allocate Memory for the Singleton Instance of the Class ***/
-
-        /**
-         * Create a singleton instance of the class in the `.data` section.
-         * - This allows global access to a single shared instance of the class.
-         * - The `.singleton` holds the class's data, and `.addr` points to it.
+         * Step 5: If no methods were defined, finalize the `.init` routine and create the
+         * singleton instance of the class.
          */
-        printf(".data\n");
-        char *name = getname(GetAttr(current_class, NAME_ATTR));             // Retrieve the class name again
-        printf(".align 4\n%s.singleton: .space %d\n", name, current_offset); // Reserve space for fields
-        printf(".align 4\n%s.addr: .word %s.singleton\n", name, name);       // Pointer to the singleton
-
-        // Record the size of the class for future memory allocation
-        addSize(getname(GetAttr(current_class, NAME_ATTR)), current_offset);
-
-        // Switch back to the `.text` section for executable code
-        printf(".text\n");
-
-        // Reset the method flag after setup
-        first_method = 0;
+        closeClassInit();
     }
 
     /**
-     * Step 6: Append Initialization Code for Singleton Setup
-     * ------------------------------------------------------
-     * This block of code generates the necessary MIPS assembly instructions to
-     * initialize the **singleton instance** of a class. The generated code is
-     * collected and stored in the global buffer `initwords` for deferred execution.
-     *
-     * **Why This Is Needed:**
-     * - **Deferred Initialization:** Singleton objects must be initialized **before**
-     *   the program's `main` function runs. Collecting the initialization code ensures
-     *   all singleton objects are properly set up at program startup.
-     * - **Centralized Initialization:** If there are multiple classes, this approach
-     *   consolidates all singleton initializations in one place, ensuring a consistent
-     *   and ordered setup.
-     * - **Avoids Redundant Initialization:** This prevents initializing objects multiple
-     *   times or out of order, which could happen if immediate `printf` statements were used.
-     *
-     * **How It Works:**
-     * 1. **Code Generation:**
-     *    - `sprintf` formats the assembly code to load the singleton object into `$s0`
-     *      and call its `.init` method.
-     *    - Example for class `Person`:
-     *      ```
-     *      la $s0, Person.singleton   # Load the singleton object's address
-     *      jal Person.init            # Call the class's initializer
-     *      ```
-     *
-     * 2. **Code Collection:**
-     *    - `strcat` appends the generated code to the `initwords` buffer, allowing
-     *      all singleton initializations to be collected together.
-     *
-     * 3. **Execution at Startup:**
-     *    - The collected code in `initwords` is injected into the program's startup
-     *      sequence in `codegenFinish()`:
-     *      ```c
-     *      printf("main:\n%s\tla $s0, %s.singleton\n\tjal %s.main\n\tli $v0, 10\n\tsyscall\n",
-     *             initwords, entry, entry);
-     *      ```
-     *    - This ensures that all singleton objects are **fully initialized** before
-     *      the program's logic begins.
-     *
-     * **Example Workflow:**
-     * - For classes `Person` and `Address`, the following initialization code is generated:
+     * Step 6: Register the Class for Singleton Setup
+     * ----------------------------------------------
+     * Singleton objects must be initialized **before** the program's `main` method runs.
+     * Instead of emitting the call here, the class is appended to `init_classes`, and
+     * `codegenFinish()` generates the start-up routine from that list:
      *   ```
-     *   la $s0, Person.singleton
-     *   jal Person.init
-     *   la $s0, Address.singleton
-     *   jal Address.init
+     *   la $s0, Person.singleton   # Load the singleton object's address
+     *   jal Person.init            # Call the class's initializer
      *   ```
-     * - This ensures both objects are **allocated** and **initialized** before any
-     *   function calls (like `main`) occur.
-     *
-     * **Why Not Just Use `printf` Directly?**
-     * - Using `printf` would immediately output the code, potentially scattering
-     *   initializations across the program and risking incorrect order.
-     * - Collecting in `initwords` ensures a **centralized** and **ordered** setup
-     *   of all necessary singleton objects.
+     * This keeps every initialization in one place and in declaration order. A singleton
+     * laid out with its final values (see closeClassInit) needs no call.
      */
 
-    char s[1024];
-    sprintf(s, "\tla $s0, %s.singleton\n\tjal %s.init\n", name, name);
-    strcat(initwords, s); // Add the initialization sequence to the global setup
+    if (field_dynamic || !static_init) {
+        addInitClass(name); // Add the class to the start-up initialization sequence
+    }
+
+    /*** Step 7: Keep the Class's Code for Later Compilations ***/
+    if (cache_dir || job_output) {
+        storeClass(treenode, &cache);
+    }
 }
 
 /**
@@ -993,13 +2814,9 @@ void visitClassDefOp(tree treenode) {
  *    - Traverses the parameter list to determine whether each parameter is a **reference** or **value** argument.
  *    - Updates the **symbol table** with this information and assigns each parameter an **offset** for memory access.
  *
- * 2. **Build Prototype Signature:**
- *    - Constructs a compact signature (`arg`) representing the parameter types (`'R'` for reference, `'V'` for value).
- *    - Example: For a method with signature `foo(int a, ref int b)`, the argument string would be `"VR"`.
- *
- * 3. **Register the Method Prototype:**
- *    - Combines the class name and method name to form a fully qualified method name (e.g., `"ClassName.MethodName"`).
- *    - Stores the method prototype using `addProto()` for later use during method calls.
+ * 2. **Register the Method Prototype:**
+ *    - `addProto()` records the method's label (`"ClassName.MethodName"`) and argument signature
+ *      (e.g. `"VR"` for `foo(int a, ref int b)`) under the method's symbol table index.
  */
 
 void visitHead(tree treenode, tree head) {
@@ -1008,10 +2825,6 @@ void visitHead(tree treenode, tree head) {
     tree spec = LeftChild(treenode); // Get the parameter specification list
     current_offset = 0;              // Reset the offset counter for method arguments
 
-    // Allocate memory for storing the argument type signature ('R' for ref, 'V' for value)
-    char *arg = malloc(20); // Assume a max of 20 parameters
-    char *pp = arg;         // Pointer to fill in the argument signature
-
     /*** Step 2: Process Each Parameter ***/
 
     while (!IsNull(spec)) {
@@ -1022,8 +2835,6 @@ void visitHead(tree treenode, tree head) {
         case RArgTypeOp: {
             SetAttr(id, KIND_ATTR, REF_ARG);          // Mark as a reference argument
             SetAttr(id, OFFSET_ATTR, current_offset); // Set memory offset
-            *pp = 'R';                                // Add 'R' to the argument signature
-            ++pp;
             break;
         }
 
@@ -1031,8 +2842,6 @@ void visitHead(tree treenode, tree head) {
         case VArgTypeOp: {
             SetAttr(id, KIND_ATTR, VALUE_ARG);        // Mark as a value argument
             SetAttr(id, OFFSET_ATTR, current_offset); // Set memory offset
-            *pp = 'V';                                // Add 'V' to the argument signature
-            ++pp;
             break;
         }
         }
@@ -1041,20 +2850,8 @@ void visitHead(tree treenode, tree head) {
         spec = RightChild(spec); // Move to the next parameter in the list
     }
 
-    *pp = '\0'; // Null-terminate the argument signature string
-
     /*** Step 3: Register the Method Prototype ***/
-
-    // Allocate memory for the full method name (ClassName.MethodName)
-    char *name = malloc(1024);
-    char *currentClass = getname(GetAttr(current_class, NAME_ATTR));         // Get current class name
-    char *methodName = getname(GetAttr(IntVal(LeftChild(head)), NAME_ATTR)); // Get method name
-
-    // Format the fully qualified method name as "ClassName.MethodName"
-    sprintf(name, "%s.%s", currentClass, methodName);
-
-    // Add the method prototype (name and argument signature) to the prototype list
-    addProto(name, arg);
+    addProto(current_class, head);
 }
 
 /**
@@ -1092,42 +2889,41 @@ void visitInitMethod(tree treenode) {
 
     /*** Step 3: Define the Method Label ***/
 
-    // Print the method's label in the format: ClassName.MethodName:
-    printf("%s.%s:\n",
-           getname(GetAttr(current_class, NAME_ATTR)), // Class name
-           name);                                      // Method name
+    // Open the method's routine, labelled in the format: ClassName.MethodName:
+    char *label = qualify(getname(GetAttr(current_class, NAME_ATTR)), name);
+    char *args = findProto(current_method);
+    openFunction(label);
+    irCurrentFunc()->args = args; // Lets the frame optimizer find tail calls and register arguments
+    irNamedLabel(label);
 
     /*** Step 4: Handle the `main` Method Entry Point ***/
 
     // If this is the `main` method, mark it as the program entry point
     if (!strcmp(name, "main")) {
         // Store the class name that contains `main` into `entry` for later use
-        strcpy(entry, getname(GetAttr(current_class, NAME_ATTR)));
+        entry = getname(GetAttr(current_class, NAME_ATTR));
     }
 
     /*** Step 5: Stack Frame Setup ***/
 
     /**
-     * Allocate 12 bytes on the stack to save:
-     * - `$ra`: Return address (for function returns)
-     * - `$s1`: Saved register (for preserving important values)
-     * - `$fp`: Frame pointer (for local variable access)
+     * Allocate 12 bytes on the stack to save `$ra`, `$s1` and `$fp`,
+     * then point the frame pointer (`$fp`) at the saved area.
      */
-    printf("\taddi $sp, $sp, -12\n"); // Make space on the stack
-
-    // Save the return address to the stack
-    printf("\tsw $ra, 0($sp)\n");
-
-    // Save the `$s1` register to the stack (used to preserve outer object context)
-    printf("\tsw $s1, 4($sp)\n");
-
-    // Save the current frame pointer to the stack
-    printf("\tsw $fp, 8($sp)\n");
+    framePrologue();
 
-    /*** Step 6: Initialize the Frame Pointer ***/
+    // Store the arguments that arrived in `$a0-$a3` into their slots, where the body reads them
+    for (int i = 0, reg = R_A0; args[i]; ++i) {
+        if (args[i] == 'I') {
+            irStore(reg++, i * 4 + 12, R_FP);
+        }
+    }
 
-    // Set the frame pointer (`$fp`) to the current stack pointer (`$sp`)
-    printf("\tadd $fp, $sp, $0\n");
+    // Count the call, with `-profile`
+    loop_number = 0;
+    if (profile) {
+        irEmit(IR_COUNT, IR_NOREG, IR_NOREG, IR_NOREG, profileCounter(label), "prof.counts");
+    }
 }
 
 /**
@@ -1141,27 +2937,11 @@ void visitInitMethod(tree treenode) {
  * 3. Control is returned to the calling function via the return address (`$ra`).
  */
 void visitExitMethod(tree treenode) {
-    /*** Step 1: Restore the Stack Pointer ***/
-    // Reset `$sp` to point to the method's stack frame (saved in `$fp`)
-    printf("\tmove $sp, $fp\n");
-
-    /*** Step 2: Restore Saved Registers ***/
-    // Restore the return address (`$ra`) to return to the caller
-    printf("\tlw $ra, 0($sp)\n");
+    // Restore `$sp`, `$ra`, `$s1` and `$fp`, then return to the caller
+    frameEpilogue();
 
-    // Restore the `$s1` register (previous object context or saved data)
-    printf("\tlw $s1, 4($sp)\n");
-
-    // Restore the previous frame pointer (`$fp`)
-    printf("\tlw $fp, 8($sp)\n");
-
-    /*** Step 3: Deallocate the Stack Frame ***/
-    // Reclaim the 12 bytes of stack space used to save `$ra`, `$s1`, and `$fp`
-    printf("\tadd $sp, $sp, 12\n");
-
-    /*** Step 4: Return to the Caller ***/
-    // Jump back to the return address saved in `$ra`
-    printf("\tjr $ra\n");
+    // The method is complete: hand its IR to the backend
+    closeFunction();
 }
 
 /**
@@ -1190,38 +2970,15 @@ void visitMethodOp(tree treenode) {
     if (first_method) {
         /**
          * If this is the first method being processed:
-         * - Restore the previous stack frame (if any).
-         * - Finalize the singleton instance setup for the class.
+         * - Return from the initialization routine.
+         * - Create the singleton instance of the class (Step 2).
          */
+        closeClassInit();
+    }
 
-        // Restore the previous stack frame
-        printf("\tmove $sp, $fp\n");    // Reset stack pointer to frame pointer
-        printf("\tlw $ra, 0($sp)\n");   // Restore return address
-        printf("\tlw $s1, 4($sp)\n");   // Restore `$s1` register
-        printf("\tlw $fp, 8($sp)\n");   // Restore frame pointer
-        printf("\tadd $sp, $sp, 12\n"); // Deallocate the saved stack frame
-        printf("\tjr $ra\n");           // Return from the initialization routine
-
-        /*** Step 2: Create Singleton Instance for the Class ***/
-        printf(".data\n");
-
-        // Retrieve the current class name for memory allocation
-        char *name = getname(GetAttr(current_class, NAME_ATTR));
-
-        // Allocate space for the singleton instance of the class
-        printf(".align 4\n%s.singleton: .space %d\n", name, current_offset);
-
-        // Define a pointer to the singleton instance
-        printf(".align 4\n%s.addr: .word %s.singleton\n", name, name);
-
-        // Record the size of the class for future allocations
-        addSize(getname(GetAttr(current_class, NAME_ATTR)), current_offset);
-
-        // Switch back to the `.text` section for executable code
-        printf(".text\n");
-
-        // Mark that the first method has been handled
-        first_method = 0;
+    // Methods the program never calls (see reach.c) get no code
+    if (!IsAttr(IntVal(LeftChild(LeftChild(treenode))), REACH_ATTR)) {
+        return;
     }
 
     /*** Step 3: Initialize the Method ***/
@@ -1252,10 +3009,17 @@ void visitClassInit(tree treenode) {
 
     // Retrieve the current class name for debugging/comment purposes
     char *classname = getname(GetAttr(current_class, NAME_ATTR));
-    printf("\t# %s.%s\n", classname, name); // Comment for the assembly output
+    irComment("%s.%s", classname, name); // Comment for the assembly output
 
-    // Initialize the field (allocate memory or set default value)
-    visitLoadInit(RightChild(treenode));
+    // Record the field's value for the singleton's data, if it is a constant
+    char *data = staticField(treenode);
+
+    // Initialize the field (allocate memory or set default value), or point it at its array
+    if (data) {
+        irLa(R_T1, data);
+    } else {
+        visitLoadInit(RightChild(treenode));
+    }
 
     // Store the initialized field in the appropriate offset of the class
     visitClassStore(LeftChild(treenode));
@@ -1285,15 +3049,28 @@ void visitLocalInit(tree treenode) {
  *
  * - **Class Field (Level 1):** Calls `visitClassInit` for member variables.
  * - **Local Variable (Level > 1):** Calls `visitLocalInit` for method-local variables.
+ *
+ * A variable that is never referenced (no `USED_ATTR`) gets no code and no space, unless its
+ * initializer contains a call or it holds an object. Together with the methods `reach.c`
+ * finds unreachable, these are what dead code elimination removes; statements after a
+ * `return` are still generated, since a `return` does not leave the method.
  */
 void visitInit(tree treenode) {
+    // A variable nobody references needs neither code nor space, unless its initializer
+    // has a call or it holds an object, whose `.init` routine runs field initializers
+    int id = IntVal(LeftChild(treenode));
+    if (!IsAttr(id, USED_ATTR) && NodeKind(LeftChild(GetAttr(id, TYPE_ATTR))) != STNode &&
+        !hasCall(RightChild(treenode))) {
+        return;
+    }
+
     DefGetNameAt(LeftChild(treenode)); // Get the variable/field name
-    printf("\t# init %s\n", name);     // Comment indicating the initialization step
+    irComment("init %s", name);         // Comment indicating the initialization step
 
     // Determine the variable's scope by its nesting level:
     // - Level 1 → Class field (global to the class)
     // - Level > 1 → Local variable (inside a method)
-    int level = GetAttr(IntVal(LeftChild(treenode)), NEST_ATTR);
+    int level = GetAttr(id, NEST_ATTR);
     if (level == 1) {
         visitClassInit(treenode); // Initialize class field
     } else {
@@ -1484,7 +3261,7 @@ char *visitVarSingle(tree treenode) {
 
     /*** Case 1: Local Variable (VAR) ***/
     case VAR: {
-        printf("\t# access local variable %s\n", name);
+        irComment("access local variable %s", name);
 
         int offset = GetAttr(y, OFFSET_ATTR); // Offset in the stack
 
@@ -1500,13 +3277,13 @@ char *visitVarSingle(tree treenode) {
          *       8($fp): Saved Frame Pointer (`$fp`)
          *   - Local variables begin at lower offsets, accessed using `$fp - offset - 4`.
          */
-        printf("\taddi $t1, $fp, %d\n", -offset - 4); // Compute variable address
+        irOpImm(IR_ADD, R_T1, R_FP, -offset - 4); // Compute variable address
         break;
     }
 
     /*** Case 2: Class Field (FIELD) ***/
     case FIELD: {
-        printf("\t# access class field %s\n", name);
+        irComment("access class field %s", name);
 
         int offset = GetAttr(y, OFFSET_ATTR); // Offset in the object's memory
         type = getTypeName(y);                // Get the field's type
@@ -1519,7 +3296,7 @@ char *visitVarSingle(tree treenode) {
          *   - `offset`: Byte offset of the field
          * Fields are accessed as `$s0 + offset`.
          */
-        printf("\taddi $t1, $s0, %d\n", offset); // Compute field address
+        irOpImm(IR_ADD, R_T1, R_S0, offset); // Compute field address
         break;
     }
 
@@ -1532,8 +3309,8 @@ char *visitVarSingle(tree treenode) {
          *   - `<class>.addr`: Points to the singleton instance
          *   - `la`: Loads the singleton's address into `$t1`
          */
-        printf("\tla $t1, %s.addr\n", name); // Load singleton address
-        type = name;                         // The class name serves as its type
+        irLa(R_T1, qualify(name, "addr")); // Load singleton address
+        type = name;                       // The class name serves as its type
         break;
     }
 
@@ -1552,7 +3329,7 @@ char *visitVarSingle(tree treenode) {
          *       8($fp): Saved Frame Pointer (`$fp`)
          *   - Arguments begin at `$fp + 12` and are accessed as `$fp + offset + 12`.
          */
-        printf("\tadd $t1, $fp, %d\n", offset + 12); // Compute argument address
+        irOpImm(IR_ADD, R_T1, R_FP, offset + 12); // Compute argument address
         break;
     }
 
@@ -1568,7 +3345,7 @@ char *visitVarSingle(tree treenode) {
          *   - Stored above the saved registers, starting at `$fp + 12`
          *   - The pointer is loaded from the stack using `lw`.
          */
-        printf("\tlw $t1, %d($fp)\n", offset + 12); // Load argument pointer
+        irLoad(R_T1, offset + 12, R_FP); // Load argument pointer
         break;
     }
     }
@@ -1576,6 +3353,32 @@ char *visitVarSingle(tree treenode) {
     return type; // Return the variable's type for further processing
 }
 
+/**
+ * checkIndex - Checks the index in `$t1` against the length of its array (`-check-bounds`).
+ *
+ * @param index The `IndexOp` node.
+ * @param array The symbol of the array variable, or 0 for an element of another array.
+ *
+ * The array's base address is on top of the stack. Without a known length, the check pops
+ * it into `$t2` to read the length word in front of the elements.
+ *
+ * @return 1 if the base address was popped into `$t2`.
+ */
+int checkIndex(tree index, int array) {
+    if (!check_bounds || isSafeIndex(index)) {
+        return 0;
+    }
+    bounds_used = 1;
+    if (array && IsAttr(array, LENGTH_ATTR)) {
+        irEmit(IR_BOUNDS, IR_NOREG, R_T1, IR_NOREG, GetAttr(array, LENGTH_ATTR), NULL);
+        return 0;
+    }
+    popReg(R_T2);
+    irLoad(R_V1, -4, R_T2)->mem = IR_MEM_CONST; // Lengths never change
+    irEmit(IR_BOUNDS, IR_NOREG, R_T1, R_V1, 0, NULL);
+    return 1;
+}
+
 /**
  * visitVarOp - Generates MIPS assembly code to access variables, fields, and array elements.
  *
@@ -1588,8 +3391,27 @@ char *visitVarSingle(tree treenode) {
  *
  * It generates the appropriate MIPS instructions to compute the correct memory address
  * or value for the given access pattern.
+ *
+ * @return The memory class (IR_MEM_*) of the computed address, for the load or store
+ *         that uses it: frame for locals and value arguments, field for fields and class
+ *         words, element for array elements, and unknown behind a reference argument.
  */
-void visitVarOp(tree treenode) {
+int visitVarOp(tree treenode) {
+    int mem;                                 // Memory class of the address currently in `$t1`
+    int array = IntVal(LeftChild(treenode)); // Variable whose value `$t1` addresses, if any
+    switch (GetAttr(IntVal(LeftChild(treenode)), KIND_ATTR)) {
+    case VAR:
+    case VALUE_ARG:
+        mem = IR_MEM_FRAME;
+        break;
+    case REF_ARG:
+        mem = IR_MEM_ANY;
+        break;
+    default:
+        mem = IR_MEM_FIELD;
+        break;
+    }
+
     /*** Step 1: Handle Simple Variable Access ***/
     // Calls `visitVarSingle` to handle simple variables, fields, or arguments
     // This loads the base address of the variable/object into `$t1`
@@ -1611,39 +3433,45 @@ void visitVarOp(tree treenode) {
                 int ofs = GetAttr(id, OFFSET_ATTR);
 
                 // Load the base address of the object instance stored at `$t1`
-                printf("\tlw $t1, 0($t1)\n");
+                irLoad(R_T1, 0, R_T1)->mem = mem;
 
                 // Add the field's offset to `$t1` to access the correct field
-                printf("\taddi $t1, $t1, %d\n", ofs);
+                irOpImm(IR_ADD, R_T1, R_T1, ofs);
+                mem = IR_MEM_FIELD;
+                array = id;
             }
 
             /*** Case 2: Array Indexing (`[]` operator) ***/
             else if (NodeOp(LeftChild(RightChild(treenode))) == IndexOp) {
                 // Load the base address of the array into `$t1`
-                printf("\tlw $t1, 0($t1)\n");
+                irLoad(R_T1, 0, R_T1)->mem = mem;
 
                 // Push the base address of the array onto the stack for later use
-                printf("\taddi $sp, $sp, -4\n");
-                printf("\tsw $t1, 0($sp)\n");
+                pushReg(R_T1);
 
                 // Evaluate the index expression (e.g., `arr[i]` → compute `i`)
                 visitExpr(LeftChild(LeftChild(RightChild(treenode))));
+                int popped = checkIndex(LeftChild(RightChild(treenode)), array);
 
                 // Multiply the index by 4 (`sll` shifts left by 2 bits) to convert to a byte offset
-                printf("\tsll $t1, $t1, 2\n");
+                irOpImm(IR_SLL, R_T1, R_T1, 2);
 
                 // Pop the array's base address back into `$t2`
-                printf("\tlw $t2, 0($sp)\n");
-                printf("\taddi $sp, $sp, 4\n");
+                if (!popped) {
+                    popReg(R_T2);
+                }
 
                 // Add the computed offset to the base address → `$t1 = base + index * 4`
-                printf("\tadd $t1, $t2, $t1\n");
+                irOp(IR_ADD, R_T1, R_T2, R_T1);
+                mem = IR_MEM_ELEM;
+                array = 0;
             }
         }
 
         // Move to the next right child for further chained access
         treenode = RightChild(treenode);
     }
+    return mem;
 }
 
 /**
@@ -1698,7 +3526,8 @@ void visitVarOp(tree treenode) {
  */
 void visitVarOpWithCall(tree treenode, char **proto, char **funcname) {
     // Step 1: Resolve the base variable or object reference
-    char *name = visitVarSingle(treenode); // Process the base variable or object
+    visitVarSingle(treenode);                // Process the base variable or object
+    int array = IntVal(LeftChild(treenode)); // Variable whose value `$t1` addresses, if any
 
     // Step 2: Traverse through chained field or array accesses
     while (!IsNull(RightChild(treenode))) {
@@ -1712,42 +3541,40 @@ void visitVarOpWithCall(tree treenode, char **proto, char **funcname) {
                 tree type = GetAttr(id, KIND_ATTR);                          // Get the kind of the accessed entity
 
                 if (type == FIELD) {                                          // If it is a class field
-                    int k = GetAttr(id, TYPE_ATTR);                           // Get the field's type
-                    name = getname(GetAttr(IntVal(LeftChild(k)), NAME_ATTR)); // Update the name for chained access
                     int ofs = GetAttr(id, OFFSET_ATTR);                       // Get the field's offset
 
                     // Load the field's value
-                    printf("\tlw $t1, 0($t1)\n");                       // Dereference the current object pointer
-                    printf("\taddi $t1, $t1, %d\n", ofs);               // Add the offset to access the field
-                } else {                                                // If it is a method
-                    char *fname = getname(GetAttr(id, NAME_ATTR));      // Get the method name
-                    char *s = malloc(strlen(name) + strlen(fname) + 2); // Allocate space for the fully qualified name
-                    sprintf(s, "%s.%s", name, fname);                   // Format the fully qualified name (e.g., Class.method)
-                    *funcname = s;                                      // Set the function name
-                    *proto = findProto(s);                              // Retrieve the method's prototype
+                    irLoad(R_T1, 0, R_T1);                              // Dereference the current object pointer
+                    irOpImm(IR_ADD, R_T1, R_T1, ofs);                   // Add the offset to access the field
+                    array = id;
+                } else {                       // If it is a method
+                    *funcname = findLabel(id); // Its fully qualified name (e.g., Class.method)
+                    *proto = findProto(id);    // Retrieve the method's prototype
                 }
             }
             // Check if the accessed entity is an array element (IndexOp)
             else if (NodeOp(LeftChild(RightChild(treenode))) == IndexOp) {
                 // Load the base address of the array
-                printf("\tlw $t1, 0($t1)\n");
+                irLoad(R_T1, 0, R_T1);
 
                 // Push the base address onto the stack for later use
-                printf("\taddi $sp, $sp, -4\n");
-                printf("\tsw $t1, 0($sp)\n");
+                pushReg(R_T1);
 
                 // Evaluate the index expression (e.g., `arr[i]`)
                 visitExpr(LeftChild(LeftChild(RightChild(treenode))));
+                int popped = checkIndex(LeftChild(RightChild(treenode)), array);
 
                 // Convert the index to a byte offset (multiply by 4)
-                printf("\tsll $t1, $t1, 2\n");
+                irOpImm(IR_SLL, R_T1, R_T1, 2);
 
                 // Pop the base address of the array from the stack
-                printf("\tlw $t2, 0($sp)\n");
-                printf("\taddi $sp, $sp, 4\n");
+                if (!popped) {
+                    popReg(R_T2);
+                }
 
                 // Add the computed offset to the base address
-                printf("\tadd $t1, $t2, $t1\n");
+                irOp(IR_ADD, R_T1, R_T2, R_T1);
+                array = 0;
             }
         }
         // Move to the next node in the access chain
@@ -1823,8 +3650,8 @@ void visitRoutineCallOp(tree treenode) {}
  *
  * Assembly Output:
  *   # if
- *   <evaluate (x > 0) into $t1>
- *   beq $t1, $0, L_false  # Branch to L_false if (x > 0) is false
+ *   <evaluate x into $t0>
+ *   ble $t0, 0, L_false   # Branch to L_false if (x > 0) is false
  *   <generate code for print(x)>
  *   j L_end               # Jump to L_end after execution
  * L_false:
@@ -1850,11 +3677,11 @@ void visitRoutineCallOp(tree treenode) {}
  *
  * Assembly Output:
  *   # if
- *   <evaluate (x > 0) into $t1>
- *   beq $t1, $0, L_false
+ *   <evaluate x into $t0>
+ *   ble $t0, 0, L_false
  *   L_nested:
- *     <evaluate (y < 5) into $t1>
- *     beq $t1, $0, L_nested_false
+ *     <evaluate y into $t0>
+ *     bge $t0, 5, L_nested_false
  *     <generate code for print(y)>
  *     j L_end
  *   L_nested_false:
@@ -1862,13 +3689,13 @@ void visitRoutineCallOp(tree treenode) {}
  *   L_end:
  */
 void visitIfStmt(tree treenode, int false_label, int end_label) {
-    printf("\t# if\n"); // Add a comment in the assembly code for clarity
+    irComment("if"); // Add a comment in the assembly code for clarity
 
     // Step 1: Handle nested conditions on the left child
     if (!IsNull(LeftChild(treenode))) {
         int here = ++current_label;                        // Generate a new label for the current condition
         visitIfStmt(LeftChild(treenode), here, end_label); // Recursively process the left child
-        printf("\tL_%d:\n", here);                         // Emit the label for the current condition
+        irLabel(here);                                     // Emit the label for the current condition
     }
 
     // Step 2: Process the right child (the main `if` condition and its body)
@@ -1876,15 +3703,14 @@ void visitIfStmt(tree treenode, int false_label, int end_label) {
 
     // Case 1: The right child is a `CommaOp` node (condition, statement)
     if (NodeOp(rhs) == CommaOp) {
-        visitExpr(LeftChild(rhs));                    // Evaluate the condition and leave the result in `$t1`
-        printf("\tbeq $t1, $0, L_%d\n", false_label); // Branch to `false_label` if the condition is false
+        visitCond(LeftChild(rhs), false_label, 0);    // Branch to `false_label` if the condition is false
         visitStmt(RightChild(rhs));                   // Generate code for the `if` body (executed when the condition is true)
-        printf("\tj L_%d\n", end_label);              // Jump to the end of the `if` block after execution
+        irJump(end_label);                            // Jump to the end of the `if` block after execution
     }
     // Case 2: The right child is not a `CommaOp` (e.g., simple `if` without a condition)
     else {
         visitStmt(rhs);                  // Generate code for the `if` body
-        printf("\tj L_%d\n", end_label); // Jump to the end of the `if` block
+        irJump(end_label);               // Jump to the end of the `if` block
     }
 }
 
@@ -1955,19 +3781,17 @@ int isSystem(tree treenode) {
 /**
  * visitLoadString - Generates MIPS assembly code to load a string constant into memory.
  *
- * This function allocates a new label in the `.data` section for the given string,
- * stores it as a null-terminated ASCII string, and returns the label index for later use.
+ * This function places the given string in the `.data` section as a null-terminated ASCII
+ * string and returns its label for later use. Identical strings share one label.
  *
- * @param str The input string to be loaded into memory.
- * @return An integer representing the unique label index assigned to the string.
+ * @param str The input string to be loaded into memory, with its enclosing quotes.
+ * @return The label assigned to the string (owned by the emitter).
  *
  * Workflow:
- * 1. Switch to the `.data` section for defining string constants.
- * 2. Allocate a new label for the string using an incremented global label counter.
- * 3. Create a copy of the input string, removing the enclosing quotes.
- * 4. Emit the string as an `.asciiz` directive in the assembly code.
- * 5. Free the allocated memory for the modified string.
- * 6. Return the label index for referencing the string in the `.text` section.
+ * 1. Strip the enclosing quotes from the input string.
+ * 2. Hand the string to `emitString`, which emits an `.asciiz` directive the first time the
+ *    string is seen and returns the existing label afterwards.
+ * 3. Return the label for referencing the string in the `.text` section.
  *
  * Example Usage:
  *
@@ -1982,26 +3806,19 @@ int isSystem(tree treenode) {
  *     la $a0, S_1     # Load address of string S_1
  *     syscall
  */
-int visitLoadString(char *str) {
-    printf(".data\n"); // Switch to the `.data` section for string constants
-
-    int p = ++current_label; // Generate a unique label index for the string
-
-    // Allocate memory for the input string and create a copy
-    char *s = malloc(strlen(str) + 1);
-    strcpy(s, str);
-
-    // Remove the enclosing quotes from the string
-    s[strlen(s) - 1] = '\0';
+char *visitLoadString(char *str) {
+    // Copy the input string without its enclosing quotes
+    int len = strlen(str);
+    char *s = malloc(len - 1);
+    memcpy(s, str + 1, len - 2);
+    s[len - 2] = '\0';
 
-    // Emit the string as a null-terminated ASCII string in the `.data` section
-    printf("S_%d: .asciiz \"%s\"\n", p, s + 1);
+    // Emit the string as a null-terminated ASCII string in the `.data` section (once)
+    char *label = emitString(s);
 
     free(s); // Free the memory allocated for the modified string
 
-    printf(".text\n"); // Switch back to the `.text` section for executable code
-
-    return p; // Return the label index for referencing the string
+    return label; // Return the label for referencing the string
 }
 
 /**
@@ -2052,12 +3869,10 @@ void cbPrint(tree treenode) {
     /*** Case 1: String Node ***/
     case STRINGNode: {
         // Load the string into memory and get its label
-        int c = visitLoadString(getstring(IntVal(treenode)));
+        char *sym = visitLoadString(getstring(IntVal(treenode)));
 
-        // Set up the MIPS system call for printing strings
-        printf("\tli $v0, 4\n");       // System call code for print string
-        printf("\tla $a0, S_%d\n", c); // Load the address of the string label into $a0
-        printf("\tsyscall\n");         // Perform the system call to print the string
+        // Print the string at its label
+        irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, sym);
 
         strNode = 1; // Indicate that a string node was processed
         return;      // Exit after handling the string
@@ -2067,10 +3882,8 @@ void cbPrint(tree treenode) {
     default:
         visitExpr(treenode); // Evaluate the expression (result stored in $t1)
 
-        // Set up the MIPS system call for printing integers
-        printf("\tli $v0, 1\n");        // System call code for print integer
-        printf("\tadd $a0, $t1, $0\n"); // Move the result from $t1 to $a0
-        printf("\tsyscall\n");          // Perform the system call to print the integer
+        // Print the integer held in $t1
+        irEmit(IR_PRINT_INT, IR_NOREG, R_T1, IR_NOREG, 0, NULL);
     }
 }
 
@@ -2118,19 +3931,14 @@ void cbPrint(tree treenode) {
 void cbRead(tree treenode) {
     // Step 1: Resolve the memory location of the variable
     // This generates the code to load the variable's address into `$t1`.
-    visitVarOp(treenode);
-
-    // Step 2: Set up the syscall for reading an integer
-    // `$v0 = 5` specifies the syscall number for reading an integer in MIPS.
-    printf("\tli $v0, 5\n");
+    int mem = visitVarOp(treenode);
 
-    // Step 3: Execute the syscall
-    // This performs the read operation and stores the result in `$v0`.
-    printf("\tsyscall\n");
+    // Step 2: Read an integer from the console into `$v0`
+    irEmit(IR_READ_INT, R_V0, IR_NOREG, IR_NOREG, 0, NULL);
 
-    // Step 4: Store the read value into the variable's memory location
+    // Step 3: Store the read value into the variable's memory location
     // The address of the variable is in `$t1`, and the value read from input is in `$v0`.
-    printf("\tsw $v0 0($t1)\n");
+    irStore(R_V0, 0, R_T1)->mem = mem;
 
     return;
 }
@@ -2150,7 +3958,7 @@ void cbRead(tree treenode) {
  *
  * Workflow:
  * 1. If the current node is null, the function immediately returns.
- * 2. If the current node is a `CommaOp`, it recursively traverses its left and right children.
+ * 2. If the current node is a `CommaOp`, it traverses its left and then its right children.
  * 3. For non-CommaOp nodes, it invokes the callback function, allowing for custom processing.
  *
  * Example 1: Printing multiple variables
@@ -2182,20 +3990,29 @@ void cbRead(tree treenode) {
  * Callback: `cbRead`, which generates input assembly code for each variable.
  */
 void visitCommaOp(tree treenode, void(callback)(tree)) {
-    // Step 1: If the node is null, return immediately
-    if (IsNull(treenode)) {
-        return;
-    }
+    TreeStack pending; // Subtrees still to visit, the next one on top
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
 
-    // Step 2: If the node is a `CommaOp`, recursively visit its children
-    if (NodeOp(treenode) == CommaOp) {
-        visitCommaOp(LeftChild(treenode), callback);  // Process the left child
-        visitCommaOp(RightChild(treenode), callback); // Process the right child
-    }
-    // Step 3: If the node is not a `CommaOp`, invoke the callback function
-    else {
-        callback(treenode); // Process the node using the provided callback
+    while (pending.top) {
+        treenode = PopTree(&pending);
+
+        // Step 1: If the node is null, skip it
+        if (IsNull(treenode)) {
+            continue;
+        }
+
+        // Step 2: If the node is a `CommaOp`, visit its left child and then its right child
+        if (NodeOp(treenode) == CommaOp) {
+            PushTree(&pending, RightChild(treenode)); // Process the right child second
+            PushTree(&pending, LeftChild(treenode));  // Process the left child first
+        }
+        // Step 3: If the node is not a `CommaOp`, invoke the callback function
+        else {
+            callback(treenode); // Process the node using the provided callback
+        }
     }
+    FreeTreeStack(&pending);
 }
 
 /**
@@ -2204,6 +4021,7 @@ void visitCommaOp(tree treenode, void(callback)(tree)) {
  * @param treenode The syntax tree node representing the arguments of the function call.
  * @param proto A string representing the argument types for the function:
  *              - 'R': Reference argument (address of the variable)
+ *              - 'I': Value argument passed in the next of `$a0-$a3`
  *              - Any other character (e.g., 'V'): Value argument (actual value)
  *
  * Workflow:
@@ -2213,9 +4031,12 @@ void visitCommaOp(tree treenode, void(callback)(tree)) {
  *    - 'R': Generate code to push the reference (address) of the variable.
  *    - 'V' or others: Generate code to evaluate the expression and push the result.
  * 4. Store each argument on the stack in reverse order for compatibility with function calling conventions.
+ *    A register argument is moved into its register instead, unless a later argument contains
+ *    a call (which would clobber `$a0-$a3`); then it waits in its stack slot and is loaded
+ *    into the register just before the call.
  *
  * Example:
- * Function call: `foo(a, b + c, &d)` with proto `"VVV"`
+ * Function call: `foo(a, b + c, &d)` with proto `"VVR"`
  * Argument tree:
  *          CommaOp
  *         /      \
@@ -2236,11 +4057,19 @@ void visitCallOp(tree treenode, char *proto) {
     // Step 2: Calculate the total stack space needed to store all arguments.
     // Each argument occupies 4 bytes, and `proto` specifies the number of arguments.
     size_t len = strlen(proto);                 // Number of arguments in the prototype
-    printf("\taddi $sp, $sp, -%zu\n", len * 4); // Adjust the stack pointer to allocate space for all arguments
+    irOpImm(IR_ADD, R_SP, R_SP, -(int)len * 4); // Adjust the stack pointer to allocate space for all arguments
 
     // Step 3: Traverse the argument tree and process each argument.
     tree p = treenode; // Pointer to the current argument node in the tree
     int i = 0;         // Index to track the current argument in `proto`
+    int reg = R_A0;    // Register of the next register argument
+    int last_call = 0; // Index of the last argument that contains a call
+    for (tree q = treenode; !IsNull(q); q = RightChild(q), ++i) {
+        if (hasCall(LeftChild(q))) {
+            last_call = i;
+        }
+    }
+    i = 0;
 
     // Loop through the argument tree until all arguments are processed
     while (!IsNull(p)) {
@@ -2255,12 +4084,24 @@ void visitCallOp(tree treenode, char *proto) {
 
         // Step 5: Store the argument in the appropriate location on the stack.
         // Arguments are stored in reverse order (rightmost argument is stored first).
-        printf("\tsw $t1, %d($sp)\n", i * 4); // Store the value of `$t1` at the correct offset
+        if (proto[i] == 'I' && i >= last_call) {
+            irMove(reg, R_T1); // No later call can clobber the register
+        } else {
+            irStore(R_T1, i * 4, R_SP); // Store the value of `$t1` at the correct offset
+        }
+        reg += proto[i] == 'I';
 
         // Move to the next argument in the tree and increment the index for `proto`.
         p = RightChild(p);
         ++i;
     }
+
+    // Step 6: Load the register arguments that had to wait on the stack.
+    for (i = 0, reg = R_A0; i < last_call; ++i) {
+        if (proto[i] == 'I') {
+            irLoad(reg++, i * 4, R_SP);
+        }
+    }
 }
 
 /**
@@ -2324,9 +4165,7 @@ void visitCall(tree treenode) {
 
             // If no strings were printed, print a newline explicitly.
             if (!strNode) {
-                printf("\tla $a0, Enter\n");
-                printf("\tli $v0, 4\n");
-                printf("\tsyscall\n");
+                irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, "Enter");
             }
             return;
         }
@@ -2347,17 +4186,14 @@ void visitCall(tree treenode) {
 
         // Case 1: Regular function call (no object involved).
         if (IsNull(RightChild(lhs))) {
-            // Retrieve the function name and generate a fully qualified name.
-            DefGetNameAt(LeftChild(lhs));
-            char *namec = getname(GetAttr(current_class, NAME_ATTR)); // Get the current class name.
-            char s[1024];
-            sprintf(s, "%s.%s", namec, name); // Create `ClassName.MethodName`.
-            char *arg = findProto(s);         // Retrieve the method's prototype (parameter types).
+            // Retrieve the method's prototype (parameter types) by its symbol table index.
+            int id = IntVal(LeftChild(lhs));
+            char *arg = findProto(id);
 
             // Process arguments and call the function.
             visitCallOp(rhs, arg);                             // Generate argument passing code.
-            printf("\tjal %s.%s\n", namec, name);              // Jump to the function.
-            printf("\taddi $sp, $sp, %zu\n", strlen(arg) * 4); // Restore the stack pointer.
+            irCall(findLabel(id));                             // Jump to `ClassName.MethodName`.
+            irOpImm(IR_ADD, R_SP, R_SP, (int)strlen(arg) * 4); // Restore the stack pointer.
         }
         // Case 2: Method call on an object.
         else {
@@ -2367,15 +4203,14 @@ void visitCall(tree treenode) {
             visitVarOpWithCall(lhs, &arg, &s);
 
             // Load the object's method address and process arguments.
-            printf("\tlw $t1, 0($t1) #2\n"); // Load the method address into `$t1`.
+            irLoad(R_T1, 0, R_T1);           // Load the method address into `$t1`.
             visitCallOp(rhs, arg);           // Generate argument passing code.
 
             // Save and restore the object's base address during the call.
-            printf("\tmove $s1, $s0\n"); // Save current object base address.
-            printf("\tmove $s0, $t1\n"); // Set the new object base address.
-            printf("\tjal %s\n", s);     // Jump to the method.
-            printf("\tmove $s0, $s1\n"); // Restore the previous object base address.
-            free(s);                     // Free the dynamically allocated string.
+            irMove(R_S1, R_S0); // Save current object base address.
+            irMove(R_S0, R_T1); // Set the new object base address.
+            irCall(s);          // Jump to the method.
+            irMove(R_S0, R_S1); // Restore the previous object base address.
         }
     }
 }
@@ -2393,56 +4228,47 @@ void visitCall(tree treenode) {
  * Workflow:
  * - The left child of `treenode` is the target variable.
  * - The right child of `treenode` is the expression to compute the value.
+ *
+ * The address of a plain variable (no field or index) does not depend on the expression, so
+ * it is computed after the value instead and the store names the variable's slot directly.
  */
 void visitAssign(tree treenode) {
+    if (IsNull(RightChild(RightChild(LeftChild(treenode))))) {
+        visitExpr(RightChild(treenode)); // Evaluate the expression into `$t1`
+        irMove(R_T2, R_T1);              // Keep the value in `$t2`
+        int mem = visitVarOp(RightChild(LeftChild(treenode)));
+        irStore(R_T2, 0, R_T1)->mem = mem; // Store it at the variable's address in `$t1`
+        return;
+    }
+
     // Step 1: Process the left-hand side (LHS) variable
     // `RightChild(LeftChild(treenode))` points to the LHS variable.
-    visitVarOp(RightChild(LeftChild(treenode))); // Load the address of the variable into `$t1`.
+    int mem = visitVarOp(RightChild(LeftChild(treenode))); // Load the address of the variable into `$t1`.
 
     // Step 2: Save the LHS variable's address onto the stack for later use.
-    printf("\taddi $sp, $sp, -4\n"); // Adjust the stack pointer to create space for the address.
-    printf("\tsw $t1, 0($sp)\n");    // Store the address of the LHS variable on the stack.
+    pushReg(R_T1); // Store the address of the LHS variable on the stack.
 
     // Step 3: Process the right-hand side (RHS) expression
     // `RightChild(treenode)` points to the RHS expression.
     visitExpr(RightChild(treenode)); // Evaluate the expression and store its result in `$t1`.
 
     // Step 4: Retrieve the saved address of the LHS variable from the stack.
-    printf("\tlw $t2, 0($sp)\n");   // Load the address of the LHS variable into `$t2`.
-    printf("\taddi $sp, $sp, 4\n"); // Restore the stack pointer to its previous state.
+    popReg(R_T2); // Load the address of the LHS variable into `$t2` and restore the stack pointer.
 
     // Step 5: Store the value of the RHS expression into the LHS variable.
-    printf("\tsw $t1, 0($t2)\n"); // Store the value in `$t1` at the address in `$t2`.
+    irStore(R_T1, 0, R_T2)->mem = mem; // Store the value in `$t1` at the address in `$t2`.
 }
 
 /**
- * visitStmt - Processes and generates code for a statement node in the syntax tree.
+ * visitListStmt - Generates code for the statement of one node of a statement list.
  *
- * @param treenode The syntax tree node representing a statement.
+ * @param treenode The `StmtOp` node; its right child is the statement.
  *
  * This function identifies the type of statement (e.g., routine call, if-else, loop, assignment, return)
  * and invokes the appropriate handler to generate assembly code.
- *
- * Workflow:
- * - Handles the first statement of the method by setting the offset attribute.
- * - Recursively processes child statements and handles their specific operations.
  */
-void visitStmt(tree treenode) {
-    // Step 1: Handle the first statement in a method
-    if (first_statement) {
-        first_statement = 1;                                  // Mark that the first statement has been handled
-        SetAttr(current_method, OFFSET_ATTR, current_offset); // Save the current offset for the method
-    }
-
-    // Step 2: Return immediately if the node is null
-    if (IsNull(treenode)) {
-        return; // No statement to process
-    }
-
-    // Step 3: Visit the left child of the statement node (if applicable)
-    ActionVisitStmtLeft;
-
-    // Step 4: Process the specific type of statement based on the operation type
+void visitListStmt(tree treenode) {
+    // Process the specific type of statement based on the operation type
     switch (NodeOp(RightChild(treenode))) {
     case RoutineCallOp: {
         // Case 1: Routine (function/method) call
@@ -2453,20 +4279,30 @@ void visitStmt(tree treenode) {
         // Case 2: If-Else statement
         int p = ++current_label;                 // Generate a new label for the end of the if-else block
         visitIfStmt(RightChild(treenode), p, p); // Generate code for the if-else statement
-        printf("L_%d:\n", p);                    // Emit the label for the end of the block
+        irLabel(p);                              // Emit the label for the end of the block
         return;
     }
     case LoopOp: {
-        // Case 3: Loop statement (e.g., while loop)
-        int start = ++current_label; // Label for the start of the loop
-        int end = ++current_label;   // Label for the end of the loop
+        // Case 3: Loop statement (e.g., while loop), compiled bottom-tested: the condition is
+        // tested once on entry and then after the body, so each iteration takes one branch
+        // instead of a conditional branch and a jump
+        int body = ++current_label; // Label for the start of the loop body
+        int end = ++current_label;  // Label for the end of the loop
+        tree cond = LeftChild(RightChild(treenode));
+        char loop[256];             // Name of the loop in profiles
+        snprintf(loop, sizeof(loop), "%s/loop%d", irCurrentFunc()->name, ++loop_number);
+        if (use_profile && profileCount(loop) == 0) {
+            irColdLoop(body); // The loop optimizer leaves loops that never ran alone
+        }
 
-        printf("L_%d:\n", start);                    // Emit the start label
-        visitExpr(LeftChild(RightChild(treenode)));  // Evaluate the loop condition
-        printf("beq $t1, $0, L_%d\n", end);          // Branch to the end if the condition is false
+        visitCond(cond, end, 0);                     // Skip the loop if the condition is false on entry
+        irLabel(body);                               // Emit the body label
+        if (profile) {
+            irEmit(IR_COUNT, IR_NOREG, IR_NOREG, IR_NOREG, profileCounter(loop), "prof.counts");
+        }
         visitStmt(RightChild(RightChild(treenode))); // Generate code for the loop body
-        printf("j L_%d\n", start);                   // Jump back to the start to reevaluate the condition
-        printf("L_%d:\n", end);                      // Emit the end label
+        visitCond(cond, body, 1);                    // Repeat while the condition holds
+        irLabel(end);                                // Emit the end label
         return;
     }
     case StmtOp: {
@@ -2482,7 +4318,7 @@ void visitStmt(tree treenode) {
     case ReturnOp: {
         // Case 6: Return statement
         visitExpr(LeftChild(RightChild(treenode))); // Evaluate the return expression
-        printf("\tmove $v0, $t1\n");                // Move the result into the return register ($v0)
+        irMove(R_V0, R_T1);                         // Move the result into the return register ($v0)
         return;
     }
     case DUMMYNode: {
@@ -2493,17 +4329,65 @@ void visitStmt(tree treenode) {
 }
 
 /**
- * visit - Recursive traversal function to generate code for the syntax tree.
+ * visitStmt - Processes and generates code for a statement list in the syntax tree.
+ *
+ * @param treenode The last `StmtOp` node of the list, or a null node for an empty list.
+ *
+ * A list is a left spine of `StmtOp` nodes, the last statement at the top. The spine is
+ * walked into an explicit stack and the statements are generated from its bottom, in
+ * source order, so long lists take no more C stack than short ones.
+ *
+ * Workflow:
+ * - Handles the first statement of the method by setting the offset attribute.
+ * - Collects the nodes of the list, then generates each statement with `visitListStmt`.
+ */
+void visitStmt(tree treenode) {
+    TreeStack list; // Nodes of the list, the first statement on top
+    InitTreeStack(&list);
+
+    // Step 1: Handle the first statement in a method
+    if (first_statement) {
+        first_statement = 1;                                  // Mark that the first statement has been handled
+        SetAttr(current_method, OFFSET_ATTR, current_offset); // Save the current offset for the method
+    }
+
+    // Step 2: Collect the list; the left child of each node holds the statements before it
+    for (; !IsNull(treenode); treenode = LeftChild(treenode)) {
+        PushTree(&list, treenode);
+    }
+
+    // Step 3: Generate the statements in order
+    while (list.top) {
+        visitListStmt(PopTree(&list));
+    }
+    FreeTreeStack(&list);
+}
+
+/**
+ * visit - Traversal function to generate code for the syntax tree.
  *
  * This function dispatches code generation tasks based on the operation type (`NodeOp`)
  * of the current syntax tree node. It acts as the main driver for visiting and processing
  * different types of nodes, such as class definitions, method declarations, statements, etc.
  *
  * @param treenode The current syntax tree node being visited.
+ *
+ * Nodes without a handler of their own (the `BodyOp` spine of a class, for instance) are
+ * walked through an explicit stack of their children rather than by recursive calls.
  */
 void visit(tree treenode) {
-    // Check if the current tree node is null. If yes, return immediately.
-    if (!IsNull(treenode)) {
+    TreeStack pending; // Subtrees still to visit, the next one on top
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+
+    while (pending.top) {
+        treenode = PopTree(&pending);
+
+        // Check if the current tree node is null. If yes, skip it.
+        if (IsNull(treenode)) {
+            continue;
+        }
+
         // Dispatch code generation based on the operation type of the current node.
         switch (NodeOp(treenode)) {
         /*** Case 1: Class Definition ***/
@@ -2551,15 +4435,16 @@ void visit(tree treenode) {
             visitStmt(treenode);
             break;
 
-        /*** Default Case: Recursive Traversal ***/
+        /*** Default Case: Traversal of the Children ***/
         default:
-            // For nodes that don't match any specific cases, recursively visit the left
-            // and right children to process all parts of the syntax tree.
-            visit((tree)LeftChild(treenode));
-            visit((tree)RightChild(treenode));
+            // For nodes that don't match any specific cases, visit the left and then the
+            // right child to process all parts of the syntax tree.
+            PushTree(&pending, (tree)RightChild(treenode));
+            PushTree(&pending, (tree)LeftChild(treenode));
             break;
         }
     }
+    FreeTreeStack(&pending);
 }
 
 /**
@@ -2599,7 +4484,7 @@ void visit(tree treenode) {
  * Example Assembly Output (From `codegenFinish`):
  * ---------------------------------------------------
  * main:
- *     # Any initialization from `initwords` (if applicable)
+ *     # `.init` calls for every class in `init_classes`
  *     la $s0, Program.singleton  # Load singleton instance address
  *     jal Program.main           # Jump to the user-defined `Program.main`
  *
@@ -2645,18 +4530,22 @@ void visit(tree treenode) {
  * for the generated program.
  */
 void codegenInit() {
-    // Begin the `.data` section for declaring global variables or strings.
-    printf(".data\n");
-
     // Define a string constant `Enter` containing a newline character.
-    printf("Enter: .asciiz \"\n\"\n");
+    emitData("Enter: .asciiz \"\n\"\n");
 
-    // Switch to the `.text` section for executable instructions.
-    printf(".text\n");
+    // The x86-64 runtime enters the program here, with the top of its stack
+    if (target_x86) {
+        x86Begin();
+    }
 
     // Emit a jump instruction to transfer control to the `main` method.
     // This marks the starting point of the program.
-    printf("\tj main\n\t");
+    irEmit(IR_J, IR_NOREG, IR_NOREG, IR_NOREG, 0, "main");
+    closeFunction();
+
+    if (buffer_output) {
+        emitOutputRuntime();
+    }
 }
 
 /**
@@ -2666,66 +4555,389 @@ void codegenInit() {
  * - Invoking the `main` method of the program.
  * - Ending the program with a system call to terminate execution.
  *
- * The emitted code uses placeholders (`%s`) for the `main` method and any
- * initialization code.
+ * The routine initializes every class recorded in `init_classes` before
+ * calling the entry class's `main` method.
  */
 void codegenFinish() {
     // Define the `main` label as the entry point of the program.
     // This label is the target of the `j main` instruction from `codegenInit`.
-    printf("main:\n");
+    openFunction("main");
+    irNamedLabel("main");
+
+    // Start with an empty heap chunk, so the first allocation requests one.
+    irLi(R_S6, 0);
+    irLi(R_S7, 0);
+
+    // Initialize every class singleton in declaration order.
+    for (int i = 0; i < init_class_count; ++i) {
+        irLa(R_S0, qualify(init_classes[i], "singleton"));
+        callInit(init_classes[i]);
+    }
 
-    // Emit any initialization instructions stored in `initwords`.
     // Load the singleton instance address for the program and call `main`.
-    printf("%s\tla $s0, %s.singleton\n\tjal %s.main\n", initwords, entry, entry);
+    irLa(R_S0, qualify(entry, "singleton"));
+    irCall(qualify(entry, "main"));
+
+    // Print the execution counts, with `-profile`.
+    if (profile) {
+        profileReport();
+    }
+
+    // Terminate the program.
+    irEmit(IR_EXIT, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL);
+
+    // Failed bounds checks branch here: report the error and stop.
+    if (bounds_used) {
+        openFunction("bounds.error");
+        irNamedLabel("bounds.error");
+        irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, emitString("Array index out of bounds"));
+        irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, "Enter");
+        irEmit(IR_EXIT, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL);
+    }
+    closeFunction();
+
+    // The stubs that call the x86-64 runtime
+    if (target_x86) {
+        x86Finish();
+    }
+}
+
+/**
+ * unitPath - Returns the name of an output of a compilation unit: the input file's name with
+ *            its extension (if any) replaced.
+ *
+ * @param input The input file, e.g. `test/src1` or `prog.mj`.
+ * @param ext   The new extension, e.g. `.s`.
+ */
+char *unitPath(char *input, char *ext) {
+    char *path = malloc(strlen(input) + strlen(ext) + 1);
+    strcpy(path, input);
+    char *dot = strrchr(path, '.'), *slash = strrchr(path, '/');
+    if (dot && dot > path && (!slash || dot > slash + 1)) {
+        *dot = '\0';
+    }
+    return strcat(path, ext);
+}
 
-    // Use a MIPS system call (code `10`) to terminate the program.
-    printf("\tli $v0, 10\n\tsyscall\n");
+/**
+ * resetUnit - Empties everything a compilation unit filled, before the next unit of a batch.
+ *
+ * The lexer starts at line 0 again, the string table, the symbol table (in STInit), the
+ * syntax tree nodes and the code generator's registries, literal pools and section buffers
+ * are emptied but keep the memory they grew to, so later units mostly run in memory the first
+ * unit allocated. Options and a profile read by `-use-profile` apply to every unit.
+ */
+void resetUnit() {
+    // Step 1: The front end
+    yyline = 0;
+    yycolumn = 0;
+    reset_string_tbl();
+    RecycleAllNodes();
+
+    // Step 2: What code generation remembers between classes and routines
+    memset(protos, 0, proto_cap * sizeof(struct proto));
+    while (proto_pool && proto_pool->next) {
+        struct proto_pool *next = proto_pool->next;
+        free(proto_pool);
+        proto_pool = next;
+    }
+    if (proto_pool) {
+        proto_pool->used = 0;
+    }
+    entry = NULL;
+    current_label = 0;
+    init_class_count = 0;
+    bounds_used = 0;
+    strNode = 0;
+    free(class_jobs);
+    class_jobs = NULL;
+    class_job_count = class_next = workers_running = 0;
+
+    // Step 3: The other modules
+    emitReset();
+    irClearInline();
+    irClearColdLoops();
+    profileReset();
+    statsReset();
 }
 
-int main() {
+/**
+ * compileUnit - Compiles one program through every phase.
+ *
+ * @param input     The source file, or NULL for stdin.
+ * @param code_path The assembly file to write.
+ * @param dump      Where the symbol table and syntax tree dumps go (NULL with `-dump none`).
+ *
+ * @return 1 on success, 0 if the tree could not be built or the files cannot be opened.
+ */
+int compileUnit(char *input, char *code_path, FILE *dump) {
+    clock_gettime(CLOCK_MONOTONIC, &phase_start);
+    phase_cpu = clock();
+
     // Step 1: Initialize the syntax tree to NULL
     SyntaxTree = NULL;
 
-    // Step 2: Parse the source code and generate the syntax tree
-    yyparse(); /* make syntax tree */
+    // Step 2: Parse the source code and generate the syntax tree, or read a checked one
+    if (load_ast) {
+        SyntaxTree = loadAST(load_ast);
+        if (SyntaxTree == NULL) {
+            fprintf(stderr, "Cannot load syntax tree file %s, exiting...\n", load_ast);
+            exit(1);
+        }
+    } else {
+        // Scan a regular file from a mapping of it, anything else through stdio
+        int fd = input ? open(input, O_RDONLY) : 0;
+        if (fd < 0) {
+            fprintf(stderr, "Cannot read %s\n", input);
+            return 0;
+        }
+        int mapped = lexMapInput(fd);
+        if (mapped && input) {
+            close(fd);
+        } else if (input) {
+            yyrestart(fdopen(fd, "r"));
+        }
+        if (yyparse()) { /* make syntax tree */
+            // A default reduction may have set a tree for the part before the error
+            SyntaxTree = NULL;
+        }
+        if (mapped) {
+            lexUnmapInput();
+        } else if (input) {
+            fclose(yyin);
+        }
+    }
+    phaseDone("parse");
+    if (stats && SyntaxTree) {
+        statsTree(SyntaxTree);
+    }
 
     // Step 3: Check if the syntax tree was successfully created
     if (SyntaxTree == NULL) {
-        // If not, print an error message and exit the program
-        fprintf(stderr, "Syntax Tree not created, exiting...\n");
-        exit(1);
+        // If not, print an error message and give up on this unit
+        if (input) {
+            fprintf(stderr, "Syntax Tree not created for %s\n", input);
+        } else {
+            fprintf(stderr, "Syntax Tree not created, exiting...\n");
+        }
+        return 0;
     }
 
-    // Step 4: Print the symbol table and syntax tree to standard output
-    FILE *outputFile = stdout;
-    table = outputFile;   // Set the output for the symbol table
-    treelst = outputFile; // Set the output for the syntax tree
-
-    // Initialize the symbol table (semantic analysis phase)
-    STInit();
+    // Step 4: Print the symbol table and syntax tree
+    table = dump;   // Set the output for the symbol table
+    treelst = dump; // Set the output for the syntax tree
 
-    // Perform semantic checks and modifications on the syntax tree
-    MkST(SyntaxTree);
+    // Initialize the symbol table and perform semantic checks and modifications on the
+    // syntax tree (a loaded tree was checked before it was written)
+    if (!load_ast) {
+        STInit();
+        MkST(SyntaxTree);
+    }
+    if (emit_ast && !saveAST(emit_ast, SyntaxTree)) {
+        fprintf(stderr, "warning: cannot write syntax tree file %s\n", emit_ast);
+    }
+    phaseDone("semantic");
 
     // Print the symbol table and syntax tree
-    STPrint();                // Print the symbol table
-    printtree(SyntaxTree, 0); // Print the syntax tree
+    if (dump_symtab) {
+        STPrint(); // Print the symbol table
+    }
+    if (dump_ast) {
+        printtree(SyntaxTree, 0); // Print the syntax tree
+    }
+    phaseDone("dump");
+
+    // Step 5: Fold constant expressions and drop dead branches before generating code
+    SyntaxTree = foldProgram(SyntaxTree);
+
+    // Lay the folded tree out in depth-first order for the code generator's traversal
+    SyntaxTree = CompactTree(SyntaxTree);
 
-    // Step 5: Redirect standard output to the generated assembly file
-    freopen("code.s", "w", stdout);
+    // Find the methods the program can call; no code is generated for the others
+    markReachable(SyntaxTree);
+
+    // Find the array accesses whose bounds checks can be left out
+    if (check_bounds) {
+        analyzeBounds(SyntaxTree);
+    }
+    phaseDone("fold");
+
+    // Step 6: Open the generated assembly file, and the IR dump next to it
+    FILE *codeFile = fopen(code_path, "w");
+    if (!codeFile) {
+        fprintf(stderr, "Cannot write %s\n", code_path);
+        return 0;
+    }
+    if (emit_ir) {
+        char *ir_path = unitPath(code_path, ".ir");
+        ir_dump = fopen(ir_path, "w");
+        if (!ir_dump) {
+            fprintf(stderr, "Cannot write %s\n", ir_path);
+        }
+        free(ir_path);
+    }
 
-    // Step 6: Begin the code generation process with initialization steps
+    // Step 7: Begin the code generation process with initialization steps
     codegenInit();
 
-    // Step 7: Traverse the syntax tree and generate assembly instructions
+    // Step 8: Traverse the syntax tree and generate assembly instructions
+    if (jobs > 1) {
+        planClasses(SyntaxTree);
+    }
     visit(SyntaxTree);
 
-    // Step 8: Finalize the code generation process
+    // Step 9: Finalize the code generation process
     codegenFinish();
+    phaseDone("codegen");
 
-    // Step 9: Close the output file
-    fclose(stdout);
+    // Step 10: Write the assembly in one go and close the output files
+    if (target_x86) {
+        x86Write(codeFile);
+    } else {
+        emitWrite(codeFile);
+    }
+    fclose(codeFile);
+    phaseDone("emit");
+    if (ir_dump) {
+        fclose(ir_dump);
+        ir_dump = NULL;
+    }
 
-    // Return 0 to indicate successful execution
-    return 0;
+    if (stats) {
+        statsPrint(stderr);
+    }
+
+    // Release the syntax tree, keeping the node arena for the next unit
+    RecycleAllNodes();
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    // Step 0: Parse command-line options
+    char **inputs = malloc(argc * sizeof(char *));
+    int input_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-emit-ir")) {
+            // Dump the IR of every routine, with its basic blocks, to `code.ir`
+            emit_ir = 1;
+        } else if (!strcmp(argv[i], "--time-report")) {
+            // Report the time of each phase on stderr
+            time_report = 1;
+        } else if (!strcmp(argv[i], "--stats")) {
+            // Report the phase times, tree and table sizes and code size of each routine
+            time_report = stats = 1;
+        } else if (!strcmp(argv[i], "-no-loop-opt")) {
+            // Skip loop-invariant code motion and strength reduction
+            loop_opt = 0;
+        } else if (!strcmp(argv[i], "-inline-limit") && i + 1 < argc) {
+            // Inline methods of at most N instructions (0: never)
+            inline_limit = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-no-static-init")) {
+            // Initialize every singleton at run time, constant fields included
+            static_init = 0;
+        } else if (!strcmp(argv[i], "-cache") && i + 1 < argc) {
+            // Reuse the code of classes that did not change since an earlier compilation
+            cache_dir = argv[++i];
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            // Generate up to N classes at the same time
+            jobs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-check-bounds")) {
+            // Check every array index that cannot be proven in bounds at run time
+            check_bounds = 1;
+        } else if (!strcmp(argv[i], "-buffer-output")) {
+            // Collect printed text in a buffer and write it with few syscalls
+            buffer_output = 1;
+        } else if (!strcmp(argv[i], "-stack-args")) {
+            // Pass all arguments on the stack instead of the first four values in `$a0-$a3`
+            reg_args = 0;
+        } else if (!strcmp(argv[i], "-target") && i + 1 < argc) {
+            // Generate MIPS assembly for SPIM (mips) or x86-64 assembly for Linux (x86-64)
+            char *name = argv[++i];
+            target_x86 = !strcmp(name, "x86-64");
+            if (!target_x86 && strcmp(name, "mips")) {
+                fprintf(stderr, "Unknown target %s\n", name);
+                exit(1);
+            }
+        } else if (!strcmp(argv[i], "-profile")) {
+            // Count method calls and loop iterations and print the counts at exit
+            profile = 1;
+        } else if (!strcmp(argv[i], "-use-profile") && i + 1 < argc) {
+            // Inline and optimize by the counts a `-profile` run printed
+            use_profile = 1;
+            if (!profileLoad(argv[++i])) {
+                fprintf(stderr, "Cannot read profile %s\n", argv[i]);
+                exit(1);
+            }
+        } else if (!strcmp(argv[i], "-dump") && i + 1 < argc) {
+            // Choose what is printed to stdout: all, symtab, ast or none
+            char *what = argv[++i];
+            dump_symtab = !strcmp(what, "all") || !strcmp(what, "symtab");
+            dump_ast = !strcmp(what, "all") || !strcmp(what, "ast");
+            if (!dump_symtab && !dump_ast && strcmp(what, "none")) {
+                fprintf(stderr, "Unknown dump %s\n", what);
+                exit(1);
+            }
+        } else if (!strcmp(argv[i], "-emit-ast") && i + 1 < argc) {
+            // Write the checked syntax tree and symbol table to a file
+            emit_ast = argv[++i];
+        } else if (!strcmp(argv[i], "-load-ast") && i + 1 < argc) {
+            // Compile a file written by `-emit-ast` instead of parsing stdin
+            load_ast = argv[++i];
+        } else if (argv[i][0] != '-') {
+            // Compile the named files one after another, each to its own `.s` and `.txt`
+            inputs[input_count++] = argv[i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            exit(1);
+        }
+    }
+    if (profile || use_profile) {
+        cache_dir = NULL; // Counters and profile decisions are not part of the cache keys
+    }
+    if (emit_ir || profile) {
+        jobs = 1; // The IR dump and the counter table are written in the order of generation
+    }
+    if (target_x86) {
+        buffer_output = 0; // The x86-64 runtime prints through stdio, which buffers already
+    }
+    if (input_count && (emit_ast || load_ast)) {
+        fprintf(stderr, "-emit-ast and -load-ast take no input files\n");
+        exit(1);
+    }
+
+    // Step 1: Compile stdin to `code.s`, or each input file to its own outputs
+    int failed = 0;
+    if (!input_count) {
+        if (!compileUnit(NULL, "code.s", stdout)) {
+            exit(1);
+        }
+    }
+    for (int i = 0; i < input_count; ++i) {
+        char *code_path = unitPath(inputs[i], ".s");
+        char *dump_path = unitPath(inputs[i], ".txt");
+        FILE *dump = dump_symtab || dump_ast ? fopen(dump_path, "w") : NULL;
+        if (i) {
+            resetUnit();
+        }
+        if (time_report) {
+            fprintf(stderr, "unit %s\n", inputs[i]);
+        }
+        if ((dump_symtab || dump_ast) && !dump) {
+            fprintf(stderr, "Cannot write %s\n", dump_path);
+            failed = 1;
+        } else if (!compileUnit(inputs[i], code_path, dump)) {
+            failed = 1;
+        }
+        if (dump) {
+            fclose(dump);
+        }
+        free(code_path);
+        free(dump_path);
+    }
+    free(inputs);
+
+    // Release the syntax tree arena in one step
+    FreeAllNodes();
+
+    return failed;
 }
@@ -0,0 +1,531 @@
+#include "emit.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * EmitBuf - A growable character buffer holding one section of the program.
+ */
+typedef struct EmitBuf {
+    char *text; // Section contents (not NUL-terminated)
+    int len;    // Bytes used
+    int cap;    // Bytes allocated
+} EmitBuf;
+
+EmitBuf data_buf = {NULL, 0, 0}; // `.data` section
+EmitBuf text_buf = {NULL, 0, 0}; // `.text` section
+
+/*
+ * EmitPool - Labels of the literals already placed in the `.data` section.
+ *
+ * An open-addressed hash table (linear probing, at most half full) from the literal's text to
+ * its label. Labels are `<prefix>_<n>`, numbered from 1 in order of first use.
+ */
+typedef struct EmitPool {
+    char **keys;   // Literal text of each slot (NULL if empty)
+    char **labels; // Label of each slot
+    char **texts;  // Literal text by label number: `<prefix>_<n>` at index n - 1
+    int cap;       // Number of slots (a power of two)
+    int count;     // Number of occupied slots
+    char *prefix;  // Label prefix
+} EmitPool;
+
+EmitPool string_pool = {NULL, NULL, NULL, 0, 0, "S"}; // String literals (`.asciiz`)
+EmitPool word_pool = {NULL, NULL, NULL, 0, 0, "C"};   // Word constants (`.word`)
+
+/*
+ * EmitCapture - The fragment being captured (see emitCaptureBegin).
+ */
+typedef struct EmitCapture {
+    int active;           // Set between emitCaptureBegin and emitCaptureEnd
+    int text_start;       // Length of the `.text` section when the capture began
+    int data_start;       // Length of the `.data` section when the capture began
+    int *cuts;            // Ranges [cuts[2i], cuts[2i + 1]) of `.data` holding literal definitions
+    int cut_count;        // Number of ranges
+    int cut_cap;          // Number of ranges allocated
+    int cut_bytes;        // Total length of the ranges
+    EmitFragment *frag;   // Literals referred to so far
+    int literal_cap;      // Number of literal slots allocated in `frag`
+} EmitCapture;
+
+EmitCapture capture = {0};
+
+/**
+ * emitAppend - Appends formatted text to a section buffer.
+ *
+ * @param b   The section buffer.
+ * @param fmt printf-style format.
+ * @param ap  Format arguments.
+ */
+void emitAppend(EmitBuf *b, char *fmt, va_list ap) {
+    va_list again;
+    va_copy(again, ap);
+    int n = vsnprintf(b->text + b->len, b->cap - b->len, fmt, ap);
+    if (b->len + n >= b->cap) {
+        // Not enough room: grow to fit and format again
+        while (b->len + n >= b->cap) {
+            b->cap = b->cap ? b->cap * 2 : 4096;
+        }
+        b->text = realloc(b->text, b->cap);
+        vsnprintf(b->text + b->len, b->cap - b->len, fmt, again);
+    }
+    va_end(again);
+    b->len += n;
+}
+
+/**
+ * emitText - Appends formatted text to the `.text` section.
+ *
+ * @param fmt printf-style format.
+ */
+void emitText(char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    emitAppend(&text_buf, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * emitData - Appends formatted text to the `.data` section.
+ *
+ * @param fmt printf-style format.
+ */
+void emitData(char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    emitAppend(&data_buf, fmt, ap);
+    va_end(ap);
+}
+
+/**
+ * poolHash - Computes the 32-bit FNV-1a hash of a string.
+ *
+ * @param s The string to hash.
+ */
+unsigned poolHash(char *s) {
+    unsigned h = 2166136261u;
+    for (; *s; ++s) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * poolSlot - Finds the slot of a literal, or the empty slot where it belongs.
+ *
+ * @param p   The pool.
+ * @param key The literal text.
+ */
+int poolSlot(EmitPool *p, char *key) {
+    unsigned mask = p->cap - 1;
+    unsigned i = poolHash(key) & mask;
+    while (p->keys[i] && strcmp(p->keys[i], key)) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/**
+ * poolGrow - Doubles the slots of a pool and reinserts its literals.
+ *
+ * @param p The pool.
+ */
+void poolGrow(EmitPool *p) {
+    char **keys = p->keys, **labels = p->labels;
+    int cap = p->cap;
+
+    p->cap = cap ? cap * 2 : 64;
+    p->keys = calloc(p->cap, sizeof(char *));
+    p->labels = calloc(p->cap, sizeof(char *));
+    p->texts = realloc(p->texts, p->cap * sizeof(char *));
+    for (int i = 0; i < cap; ++i) {
+        if (keys[i]) {
+            int j = poolSlot(p, keys[i]);
+            p->keys[j] = keys[i];
+            p->labels[j] = labels[i];
+        }
+    }
+    free(keys);
+    free(labels);
+}
+
+/**
+ * poolLookup - Returns the label of a literal, creating one if the literal is new.
+ *
+ * @param p     The pool.
+ * @param key   The literal text (copied if new).
+ * @param isNew Set to 1 if a label was created, 0 if an existing one was found.
+ */
+char *poolLookup(EmitPool *p, char *key, int *isNew) {
+    if ((p->count + 1) * 2 > p->cap) {
+        poolGrow(p);
+    }
+
+    int i = poolSlot(p, key);
+    *isNew = !p->keys[i];
+    if (*isNew) {
+        char label[32];
+        sprintf(label, "%s_%d", p->prefix, ++p->count);
+        p->keys[i] = strdup(key);
+        p->labels[i] = strdup(label);
+        p->texts[p->count - 1] = p->keys[i];
+    }
+    return p->labels[i];
+}
+
+/**
+ * captureLiteral - Records a pooled literal the fragment being captured refers to.
+ *
+ * @param is_word 1 for a word constant, 0 for a string.
+ * @param text    The literal text.
+ * @param label   Its label.
+ * @param start   Length of the `.data` section before the literal's definition was added, or
+ *                -1 if the literal was pooled already.
+ */
+void captureLiteral(int is_word, char *text, char *label, int start) {
+    if (!capture.active) {
+        return;
+    }
+    EmitFragment *f = capture.frag;
+    for (int i = 0; i < f->count; ++i) {
+        if (!strcmp(f->labels[i], label)) {
+            return;
+        }
+    }
+    if (f->count == capture.literal_cap) {
+        capture.literal_cap = capture.literal_cap ? capture.literal_cap * 2 : 16;
+        f->is_word = realloc(f->is_word, capture.literal_cap * sizeof(int));
+        f->values = realloc(f->values, capture.literal_cap * sizeof(char *));
+        f->labels = realloc(f->labels, capture.literal_cap * sizeof(char *));
+        f->offsets = realloc(f->offsets, capture.literal_cap * sizeof(int));
+    }
+    f->is_word[f->count] = is_word;
+    f->values[f->count] = strdup(text);
+    f->labels[f->count] = strdup(label);
+    f->offsets[f->count++] = start >= 0 ? start - capture.data_start - capture.cut_bytes : -1;
+
+    if (start >= 0) {
+        if (capture.cut_count == capture.cut_cap) {
+            capture.cut_cap = capture.cut_cap ? capture.cut_cap * 2 : 16;
+            capture.cuts = realloc(capture.cuts, capture.cut_cap * 2 * sizeof(int));
+        }
+        capture.cuts[2 * capture.cut_count] = start;
+        capture.cuts[2 * capture.cut_count++ + 1] = data_buf.len;
+        capture.cut_bytes += data_buf.len - start;
+    }
+}
+
+/**
+ * emitString - Places a string literal in the `.data` section.
+ *
+ * @param text The characters of the string, without quotes.
+ * @return The label of the `.asciiz` holding the string; identical strings share one label.
+ */
+char *emitString(char *text) {
+    int isNew, start = data_buf.len;
+    char *label = poolLookup(&string_pool, text, &isNew);
+    if (isNew) {
+        emitData("%s: .asciiz \"%s\"\n", label, text);
+    }
+    captureLiteral(0, text, label, isNew ? start : -1);
+    return label;
+}
+
+/**
+ * emitWord - Places a word constant in the `.data` section.
+ *
+ * @param value The value of the constant.
+ * @return The label of the `.word` holding the value; equal values share one label.
+ */
+char *emitWord(int value) {
+    char key[16];
+    int isNew, start = data_buf.len;
+    sprintf(key, "%d", value);
+    char *label = poolLookup(&word_pool, key, &isNew);
+    if (isNew) {
+        emitData("\t%s: .word %d\n", label, value);
+    }
+    captureLiteral(1, key, label, isNew ? start : -1);
+    return label;
+}
+
+/**
+ * emitLiteralText - Returns the text of a pooled literal.
+ *
+ * @param label   A label, which need not be a literal's.
+ * @param is_word Set to 1 for a word constant, 0 for a string.
+ *
+ * @return The literal's text (the decimal value of a word constant), or NULL if the label is
+ *         not one of a pooled literal.
+ */
+char *emitLiteralText(char *label, int *is_word) {
+    EmitPool *p = label[0] == 'S' ? &string_pool : label[0] == 'C' ? &word_pool : NULL;
+    if (!p || label[1] != '_') {
+        return NULL;
+    }
+    int n = atoi(label + 2);
+    if (n < 1 || n > p->count) {
+        return NULL;
+    }
+    char check[32];
+    sprintf(check, "%s_%d", p->prefix, n);
+    if (strcmp(check, label)) { // Something such as `S_1.x` that only starts like a literal
+        return NULL;
+    }
+    *is_word = p == &word_pool;
+    return p->texts[n - 1];
+}
+
+/**
+ * emitReference - Notes that code is being emitted which refers to a label.
+ *
+ * @param label The label.
+ *
+ * Code copied from elsewhere, such as the body of an inlined method, can refer to literals
+ * pooled outside the fragment being captured; they must be listed in it all the same.
+ */
+void emitReference(char *label) {
+    int is_word;
+    char *text = capture.active ? emitLiteralText(label, &is_word) : NULL;
+    if (text) {
+        captureLiteral(is_word, text, label, -1);
+    }
+}
+
+/**
+ * emitTextSize - Returns the number of bytes in the `.text` section so far.
+ */
+int emitTextSize() { return text_buf.len; }
+
+/**
+ * emitCountInstructions - Counts the instructions in the `.text` section after a point.
+ *
+ * @param from A size `emitTextSize` returned earlier.
+ *
+ * An instruction is a line that starts with a tab and is not a comment.
+ */
+int emitCountInstructions(int from) {
+    int n = 0;
+    for (int i = from; i < text_buf.len; ++i) {
+        if ((i == 0 || text_buf.text[i - 1] == '\n') && text_buf.text[i] == '\t' &&
+            (i + 1 == text_buf.len || text_buf.text[i + 1] != '#')) {
+            ++n;
+        }
+    }
+    return n;
+}
+
+/**
+ * emitSections - Returns the `.data` and `.text` sections, for a backend that writes them
+ *                itself (see x86Write).
+ *
+ * @param data     Receives the `.data` section.
+ * @param data_len Receives its length.
+ * @param text     Receives the `.text` section.
+ * @param text_len Receives its length.
+ */
+void emitSections(char **data, int *data_len, char **text, int *text_len) {
+    *data = data_buf.text;
+    *data_len = data_buf.len;
+    *text = text_buf.text;
+    *text_len = text_buf.len;
+}
+
+/**
+ * emitWrite - Writes the program, `.data` section first, and empties both sections.
+ *
+ * @param out The assembly file.
+ */
+void emitWrite(FILE *out) {
+    fputs(".data\n", out);
+    fwrite(data_buf.text, 1, data_buf.len, out);
+    fputs(".text\n", out);
+    fwrite(text_buf.text, 1, text_buf.len, out);
+    data_buf.len = 0;
+    text_buf.len = 0;
+}
+
+/**
+ * emitReset - Empties both sections and the literal pools for the next compilation unit,
+ *             keeping their memory.
+ */
+void emitReset() {
+    EmitPool *pools[] = {&string_pool, &word_pool};
+    for (int k = 0; k < 2; ++k) {
+        EmitPool *p = pools[k];
+        for (int i = 0; i < p->cap; ++i) {
+            free(p->keys[i]);
+            free(p->labels[i]);
+            p->keys[i] = p->labels[i] = NULL;
+        }
+        p->count = 0;
+    }
+    data_buf.len = 0;
+    text_buf.len = 0;
+}
+
+/**
+ * emitBytes - Appends raw bytes to a section buffer.
+ *
+ * @param b The section buffer.
+ * @param s The bytes.
+ * @param n Their number.
+ */
+void emitBytes(EmitBuf *b, char *s, int n) {
+    if (b->len + n >= b->cap) {
+        while (b->len + n >= b->cap) {
+            b->cap = b->cap ? b->cap * 2 : 4096;
+        }
+        b->text = realloc(b->text, b->cap);
+    }
+    memcpy(b->text + b->len, s, n);
+    b->len += n;
+}
+
+/**
+ * emitCaptureBegin - Starts recording a fragment of the program.
+ */
+void emitCaptureBegin() {
+    capture.active = 1;
+    capture.text_start = text_buf.len;
+    capture.data_start = data_buf.len;
+    capture.cut_count = 0;
+    capture.cut_bytes = 0;
+    capture.literal_cap = 0;
+    capture.frag = calloc(1, sizeof(EmitFragment));
+}
+
+/**
+ * emitCaptureEnd - Stops recording and returns the fragment added since emitCaptureBegin.
+ *
+ * The sections keep their contents; the fragment is a copy.
+ */
+EmitFragment *emitCaptureEnd() {
+    EmitFragment *f = capture.frag;
+    int n = text_buf.len - capture.text_start;
+    f->text = malloc(n + 1);
+    memcpy(f->text, text_buf.text + capture.text_start, n);
+    f->text[n] = '\0';
+
+    // Copy the data between the definitions of the literals pooled meanwhile
+    f->data = malloc(data_buf.len - capture.data_start + 1);
+    int from = capture.data_start, len = 0;
+    for (int i = 0; i <= capture.cut_count; ++i) {
+        int to = i < capture.cut_count ? capture.cuts[2 * i] : data_buf.len;
+        memcpy(f->data + len, data_buf.text + from, to - from);
+        len += to - from;
+        from = i < capture.cut_count ? capture.cuts[2 * i + 1] : to;
+    }
+    f->data[len] = '\0';
+
+    capture.active = 0;
+    capture.frag = NULL;
+    return f;
+}
+
+/**
+ * isLabelChar - Reports whether a character can continue a label or register name.
+ *
+ * @param c The character.
+ */
+int isLabelChar(int c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' ||
+           c == '.' || c == '$';
+}
+
+/**
+ * replayInto - Appends fragment contents to a section, renaming the labels it refers to.
+ *
+ * @param b      The section buffer.
+ * @param s      The contents.
+ * @param n      Their length.
+ * @param f      The fragment.
+ * @param labels The labels of the fragment's literals in this compilation.
+ * @param shift  Amount added to the number of every code label `L_<n>`.
+ *
+ * Labels are whole words `L_<n>`, `S_<n>` or `C_<n>`, possibly after the `$` of an x86-64
+ * immediate. Comments are copied unchanged.
+ */
+void replayInto(EmitBuf *b, char *s, int n, EmitFragment *f, char **labels, int shift) {
+    int comment = 0;
+    for (char *start = s, *end = s + n; s < end;) {
+        if (*s == '#') {
+            comment = 1;
+        } else if (*s == '\n') {
+            comment = 0;
+        }
+        if (comment || (*s != 'L' && *s != 'S' && *s != 'C') || end - s < 3 || s[1] != '_' ||
+            s[2] < '0' || s[2] > '9' || (s > start && isLabelChar(s[-1]) && s[-1] != '$')) {
+            emitBytes(b, s++, 1);
+            continue;
+        }
+        char *p = s + 2;
+        while (p < end && *p >= '0' && *p <= '9') {
+            ++p;
+        }
+        if ((p < end && isLabelChar(*p)) || p - s > 16) { // Part of a longer name such as `L_1.main`
+            emitBytes(b, s, p - s);
+            s = p;
+            continue;
+        }
+
+        char label[32];
+        memcpy(label, s, p - s);
+        label[p - s] = '\0';
+        if (*s == 'L') {
+            sprintf(label, "L_%d", atoi(label + 2) + shift);
+        } else {
+            for (int i = 0; i < f->count; ++i) {
+                if (labels[i] && !strcmp(f->labels[i], label)) {
+                    strcpy(label, labels[i]);
+                    break;
+                }
+            }
+        }
+        emitBytes(b, label, strlen(label));
+        s = p;
+    }
+}
+
+/**
+ * emitReplay - Appends a captured fragment to the program.
+ *
+ * @param f     The fragment.
+ * @param shift Amount added to the number of every code label `L_<n>` in it.
+ */
+void emitReplay(EmitFragment *f, int shift) {
+    char **labels = calloc(f->count + 1, sizeof(char *));
+    int done = 0; // Bytes of the data replayed
+    for (int i = 0; i < f->count; ++i) {
+        if (f->offsets[i] > done) {
+            replayInto(&data_buf, f->data + done, f->offsets[i] - done, f, labels, shift);
+            done = f->offsets[i];
+        }
+        labels[i] = f->is_word[i] ? emitWord(atoi(f->values[i])) : emitString(f->values[i]);
+    }
+    replayInto(&data_buf, f->data + done, strlen(f->data) - done, f, labels, shift);
+    replayInto(&text_buf, f->text, strlen(f->text), f, labels, shift);
+    free(labels);
+}
+
+/**
+ * emitFreeFragment - Releases a fragment.
+ *
+ * @param f The fragment.
+ */
+void emitFreeFragment(EmitFragment *f) {
+    for (int i = 0; i < f->count; ++i) {
+        free(f->values[i]);
+        free(f->labels[i]);
+    }
+    free(f->is_word);
+    free(f->values);
+    free(f->labels);
+    free(f->offsets);
+    free(f->text);
+    free(f->data);
+    free(f);
+}
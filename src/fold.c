@@ -0,0 +1,435 @@
+/**************************************************************************************************
+ * File: fold.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Constant Folding** pass. It runs over the Abstract Syntax Tree
+ *    (AST) after semantic analysis (`MkST`) and before code generation (`visit`), rewriting
+ *    expressions whose value is known at compile time so the code generator never sees them.
+ *
+ *    The pass performs the following rewrites:
+ *
+ *    1. **Constant Folding:**
+ *       - Arithmetic (`+ - * /`), relational (`< > == != <= >=`), logical (`&& || !`) and
+ *         unary negation operators whose operands are all `NUMNode` leaves become a single
+ *         `NUMNode`, e.g. `-1` → `NUMNode(-1)` and `2 * 3 + 1` → `NUMNode(7)`.
+ *       - Results follow the target: 32-bit wrap-around arithmetic, division truncating toward
+ *         zero, and 0/1 for relational and logical operators. Division by zero is left to
+ *         the program at run time.
+ *
+ *    2. **Algebraic Simplification:**
+ *       - `x + 0`, `0 + x`, `x - 0`, `x * 1`, `1 * x` and `x / 1` become `x`.
+ *       - `0 - x`, `x * -1` and `x / -1` become `-x`.
+ *       - `x * 0` and `0 * x` become `0` when `x` contains no routine call.
+ *
+ *    3. **Strength Reduction:**
+ *       - Multiplication by a power of two becomes `ShlOp` (shift left).
+ *       - Division by a power of two becomes `ShrOp` (shift right, rounding toward zero).
+ *
+ *    4. **Dead Branch Elimination:**
+ *       - Clauses of an `IfElseOp` chain whose condition folds to `0` are removed; a clause
+ *         whose condition folds to non-zero becomes the `else` and every later clause is
+ *         removed. A chain reduced to its `else` is replaced by that statement list, and an
+ *         empty chain by an empty statement.
+ *       - A `LoopOp` whose condition folds to `0` is removed.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **tree foldProgram(tree node):**
+ *       - Entry point: folds the whole program tree in place and returns it.
+ *
+ *    2. **tree foldTree(tree node):**
+ *       - Folds a subtree and returns its replacement.
+ *
+ *    3. **tree foldIfChain(tree node, int *closed):**
+ *       - Prunes the clauses of an `IfElseOp` chain whose conditions are constant.
+ *
+ **************************************************************************************************/
+
+#include "tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+tree foldTree(tree treenode);
+
+/**
+ * isConst - Reports whether a subtree is a numeric constant leaf.
+ *
+ * @param treenode The subtree to inspect.
+ */
+int isConst(tree treenode) { return NodeKind(treenode) == NUMNode; }
+
+/**
+ * isConstValue - Reports whether a subtree is the numeric constant `v`.
+ *
+ * @param treenode The subtree to inspect.
+ * @param v        The expected value.
+ */
+int isConstValue(tree treenode, int v) { return isConst(treenode) && IntVal(treenode) == v; }
+
+/**
+ * constant - Creates a fresh numeric constant leaf.
+ *
+ * @param v The value of the constant.
+ */
+tree constant(int v) { return MakeLeaf(NUMNode, v); }
+
+/**
+ * log2Exact - Returns `k` if `v` is `2^k` with `k >= 1`, or `0` otherwise.
+ *
+ * @param v The value to test.
+ */
+int log2Exact(int v) {
+    if (v < 2 || (v & (v - 1))) {
+        return 0;
+    }
+    int k = 0;
+    while (v > 1) {
+        v >>= 1;
+        ++k;
+    }
+    return k;
+}
+
+/**
+ * containsCall - Reports whether a subtree contains a routine call.
+ *
+ * Expressions with a call may have side effects, so they are never discarded.
+ *
+ * @param treenode The subtree to inspect.
+ */
+int containsCall(tree treenode) {
+    if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+        return 0;
+    }
+    if (NodeOp(treenode) == RoutineCallOp) {
+        return 1;
+    }
+    return containsCall(LeftChild(treenode)) || containsCall(RightChild(treenode));
+}
+
+/**
+ * evalBinary - Computes `a op b` the way the generated MIPS code would.
+ *
+ * @param op The binary operator (`NodeOp`).
+ * @param a  The left operand.
+ * @param b  The right operand.
+ * @param ok Set to 0 when the operation must be left to run time (division by zero or overflow).
+ */
+int evalBinary(int op, int a, int b, int *ok) {
+    unsigned ua = (unsigned)a, ub = (unsigned)b;
+    *ok = 1;
+    switch (op) {
+    case AddOp:
+        return (int)(ua + ub);
+    case SubOp:
+        return (int)(ua - ub);
+    case MultOp:
+        return (int)(ua * ub);
+    case DivOp:
+        if (b == 0 || (b == -1 && a == (int)0x80000000u)) {
+            *ok = 0;
+            return 0;
+        }
+        return a / b;
+    case LTOp:
+        return a < b;
+    case GTOp:
+        return a > b;
+    case EQOp:
+        return a == b;
+    case NEOp:
+        return a != b;
+    case LEOp:
+        return a <= b;
+    case GEOp:
+        return a >= b;
+    case AndOp:
+        return a != 0 && b != 0;
+    case OrOp:
+        return a != 0 || b != 0;
+    }
+    *ok = 0;
+    return 0;
+}
+
+/**
+ * simplifyBinary - Applies identities and strength reduction to a binary expression.
+ *
+ * @param treenode The binary expression node; its operands are already folded.
+ *
+ * Returns the replacement subtree, or `treenode` itself when nothing applies.
+ */
+tree simplifyBinary(tree treenode) {
+    int op = NodeOp(treenode);
+    tree l = LeftChild(treenode);
+    tree r = RightChild(treenode);
+
+    switch (op) {
+    case AddOp:
+        if (isConstValue(r, 0)) {
+            return l; // x + 0 → x
+        }
+        if (isConstValue(l, 0)) {
+            return r; // 0 + x → x
+        }
+        break;
+    case SubOp:
+        if (isConstValue(r, 0)) {
+            return l; // x - 0 → x
+        }
+        if (isConstValue(l, 0)) {
+            return MakeTree(UnaryNegOp, r, NullExp()); // 0 - x → -x
+        }
+        break;
+    case MultOp: {
+        if ((isConstValue(r, 0) && !containsCall(l)) || (isConstValue(l, 0) && !containsCall(r))) {
+            return constant(0); // x * 0 → 0
+        }
+        // Put the constant operand, if any, on the right
+        if (isConst(l)) {
+            tree t = l;
+            l = r;
+            r = t;
+        }
+        if (isConstValue(r, 1)) {
+            return l; // x * 1 → x
+        }
+        if (isConstValue(r, -1)) {
+            return MakeTree(UnaryNegOp, l, NullExp()); // x * -1 → -x
+        }
+        int k = isConst(r) ? log2Exact(IntVal(r)) : 0;
+        if (k) {
+            return MakeTree(ShlOp, l, constant(k)); // x * 2^k → x << k
+        }
+        break;
+    }
+    case DivOp: {
+        if (isConstValue(r, 1)) {
+            return l; // x / 1 → x
+        }
+        if (isConstValue(r, -1)) {
+            return MakeTree(UnaryNegOp, l, NullExp()); // x / -1 → -x
+        }
+        int k = isConst(r) ? log2Exact(IntVal(r)) : 0;
+        if (k) {
+            return MakeTree(ShrOp, l, constant(k)); // x / 2^k → x >> k, rounded toward zero
+        }
+        break;
+    }
+    }
+    return treenode;
+}
+
+/**
+ * foldExpr - Folds an expression node whose children are already folded.
+ *
+ * @param treenode The expression node.
+ *
+ * Returns the replacement subtree, or `treenode` itself when nothing applies.
+ */
+tree foldExpr(tree treenode) {
+    int op = NodeOp(treenode);
+    tree l = LeftChild(treenode);
+    tree r = RightChild(treenode);
+
+    switch (op) {
+    case UnaryNegOp:
+        if (isConst(l)) {
+            return constant((int)(0u - (unsigned)IntVal(l)));
+        }
+        if (NodeOp(l) == UnaryNegOp) {
+            return LeftChild(l); // -(-x) → x
+        }
+        return treenode;
+    case NotOp:
+        if (isConst(l)) {
+            return constant(IntVal(l) == 0);
+        }
+        return treenode;
+    case AddOp:
+    case SubOp:
+    case MultOp:
+    case DivOp:
+    case LTOp:
+    case GTOp:
+    case EQOp:
+    case NEOp:
+    case LEOp:
+    case GEOp:
+    case AndOp:
+    case OrOp:
+        if (isConst(l) && isConst(r)) {
+            int ok;
+            int v = evalBinary(op, IntVal(l), IntVal(r), &ok);
+            if (ok) {
+                return constant(v);
+            }
+            return treenode;
+        }
+        return simplifyBinary(treenode);
+    }
+    return treenode;
+}
+
+/**
+ * foldIfChain - Folds an `IfElseOp` chain and drops clauses that can never run.
+ *
+ * @param treenode The innermost-first `IfElseOp` chain (or a null node).
+ * @param closed   Set to 1 when the returned chain ends with an unconditional clause,
+ *                 which makes every later clause unreachable.
+ *
+ * Returns the pruned chain, or a null node when no clause remains.
+ */
+tree foldIfChain(tree treenode, int *closed) {
+    if (IsNull(treenode)) {
+        *closed = 0;
+        return treenode;
+    }
+
+    // Step 1: Fold the earlier clauses; if one of them always runs, this clause is dead
+    tree prev = foldIfChain(LeftChild(treenode), closed);
+    if (*closed) {
+        return prev;
+    }
+
+    // Step 2: Fold this clause's condition and body
+    tree clause = RightChild(treenode);
+    if (NodeOp(clause) == CommaOp) {
+        tree cond = foldTree(LeftChild(clause));
+        SetLeftChild(clause, cond);
+        SetRightChild(clause, foldTree(RightChild(clause)));
+
+        if (isConst(cond)) {
+            if (!IntVal(cond)) {
+                return prev; // Never taken: drop the clause
+            }
+            clause = RightChild(clause); // Always taken: the body becomes the `else`
+            *closed = 1;
+        }
+    } else {
+        clause = foldTree(clause); // The `else` body
+        *closed = 1;
+    }
+
+    SetLeftChild(treenode, prev);
+    SetRightChild(treenode, clause);
+    return treenode;
+}
+
+/*
+ * FoldFrame - A node whose children `foldTree` is folding.
+ */
+typedef struct FoldFrame {
+    tree node;  // The node
+    int right;  // 0 while its left child is folded, 1 while its right child is
+} FoldFrame;
+
+/**
+ * isFoldedAfterChildren - Reports whether a node is folded after its two children, like
+ *                         expressions and the `StmtOp`/`CommaOp` nodes of lists.
+ *
+ * @param treenode The node.
+ */
+int isFoldedAfterChildren(tree treenode) {
+    return !IsNull(treenode) && NodeKind(treenode) == EXPRNode && NodeOp(treenode) != IfElseOp &&
+           NodeOp(treenode) != LoopOp;
+}
+
+/**
+ * foldStatement - Folds a leaf, an `IfElseOp` chain or a `LoopOp`.
+ *
+ * @param treenode The subtree to fold.
+ *
+ * Returns the replacement subtree.
+ */
+tree foldStatement(tree treenode) {
+    switch (NodeOp(treenode)) {
+    case IfElseOp: {
+        int closed;
+        tree chain = foldIfChain(treenode, &closed);
+        if (IsNull(chain)) {
+            return NullExp(); // No clause can run: empty statement
+        }
+        if (IsNull(LeftChild(chain)) && NodeOp(RightChild(chain)) != CommaOp) {
+            return RightChild(chain); // Only the `else` is left: run its statements directly
+        }
+        return chain;
+    }
+    case LoopOp: {
+        tree cond = foldTree(LeftChild(treenode));
+        if (isConstValue(cond, 0)) {
+            return NullExp(); // The body never runs
+        }
+        SetLeftChild(treenode, cond);
+        SetRightChild(treenode, foldTree(RightChild(treenode)));
+        return treenode;
+    }
+    }
+    return treenode;
+}
+
+/**
+ * foldTree - Folds a subtree.
+ *
+ * @param treenode The subtree to fold.
+ *
+ * Returns the replacement subtree; callers store it back into the parent.
+ *
+ * Statement lists and initializers are spines as long as the list, so the nodes waiting
+ * for their children are kept on an explicit stack of frames instead of the C stack. Each
+ * node is folded after its left and then its right child, and each child is replaced by
+ * its folded version.
+ */
+tree foldTree(tree treenode) {
+    FoldFrame local[64], *stack = local;
+    int top = 0, cap = 64;
+    tree folded; // Replacement of the subtree folded last
+
+    for (;;) {
+        // Step 1: Descend the left spine, leaving a frame for every node on the way
+        while (isFoldedAfterChildren(treenode)) {
+            if (top == cap) {
+                FoldFrame *grown = malloc(2 * cap * sizeof(FoldFrame));
+                memcpy(grown, stack, top * sizeof(FoldFrame));
+                if (stack != local) {
+                    free(stack);
+                }
+                stack = grown;
+                cap *= 2;
+            }
+            stack[top++] = (FoldFrame){treenode, 0};
+            treenode = LeftChild(treenode);
+        }
+        folded = foldStatement(treenode);
+
+        // Step 2: Store the result in the waiting frame; a node with both children folded
+        // is folded itself and its result goes one frame further up
+        for (;;) {
+            if (!top) {
+                if (stack != local) {
+                    free(stack);
+                }
+                return folded;
+            }
+            FoldFrame *f = &stack[top - 1];
+            if (!f->right) {
+                SetLeftChild(f->node, folded);
+                f->right = 1;
+                treenode = RightChild(f->node); // Fold the right child next
+                break;
+            }
+            SetRightChild(f->node, folded);
+            folded = foldExpr(f->node);
+            --top;
+        }
+    }
+}
+
+/**
+ * foldProgram - Runs constant folding over the whole program.
+ *
+ * @param treenode The root of the syntax tree (`ProgramOp`).
+ */
+tree foldProgram(tree treenode) { return foldTree(treenode); }
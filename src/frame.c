@@ -0,0 +1,591 @@
+/**************************************************************************************************
+ * File: frame.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Frame Optimizer**. It runs over the IR instruction list of each
+ *    method (see ir.h) after the other passes, and cuts the cost of calling it.
+ *
+ *    Code generation gives every routine the same 12-byte frame: the prologue saves `$ra`, `$s1`
+ *    and `$fp` and points `$fp` at the saved area, the epilogue restores all three, and locals,
+ *    arguments and spills are addressed from `$fp`. Most routines need less than that.
+ *
+ *    1. **Self Tail Calls:**
+ *       - `return m(...)` inside `m` itself, when nothing but the return follows the call and
+ *         every argument is passed by value, becomes a jump back to the top of the body: the new
+ *         arguments are copied over the current ones and the frame is reused. Deep recursion
+ *         then runs in constant stack space.
+ *
+ *    2. **Frame Shaping:**
+ *       - `$ra` is only saved by routines that make calls, and `$s1` only by routines that
+ *         change it (method calls on objects do).
+ *       - `$fp` is not set up at all: the distance between `$sp` and the frame is known at every
+ *         instruction, so frame accesses are rewritten to use `$sp` directly.
+ *
+ *    3. **Register Arguments:**
+ *       - Value arguments passed in `$a0-$a3` are stored into their stack slots on entry. When
+ *         nothing in the routine changes the register or the slot, the body reads the register
+ *         instead and the store goes away. This part runs before the other passes.
+ *
+ *    A routine whose code does not have the shape the pass expects is left unchanged.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void irShapeFrame(IRFunc *f):**
+ *       - Entry point: rewrites the tail calls and the frame of a routine.
+ *
+ *    2. **int isTailCall(IRFunc *f, IRInstr *call):**
+ *       - Decides whether a call can reuse the caller's frame.
+ *
+ *    3. **int walkFrame(IRFunc *f, IRInstr *start, FrameShape *s, int rewrite):**
+ *       - Tracks the stack depth through the routine and moves its frame accesses to `$sp`.
+ *
+ *    4. **int irKeepArgs(IRFunc *f):**
+ *       - Keeps register arguments in their registers.
+ *
+ **************************************************************************************************/
+
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAME_SIZE 12       // Bytes of the standard frame: saved `$ra`, `$s1` and `$fp`
+#define FRAME_TAIL_STEPS 16 // Maximum number of instructions between a tail call and the return
+
+/*
+ * FrameShape - What a routine needs of its frame, and the stack depth at its labels.
+ *
+ * Depths are measured in bytes from the stack pointer on entry, in terms of the standard frame.
+ */
+typedef struct FrameShape {
+    int save_ra, save_s1; // Registers the new prologue saves
+    int size;             // Bytes the new prologue reserves
+    char *entry;          // Label at the top of the body, target of tail calls (or NULL)
+    int lo, hi;           // Range of the numbered labels of the routine
+    int *depth;           // Depth at each numbered label, -1 while unknown
+} FrameShape;
+
+/**
+ * isStep - Reports whether an instruction is one step of the standard prologue or epilogue.
+ *
+ * @param p    The instruction (may be NULL).
+ * @param op   IR_ADD (`reg = base + imm`), IR_MOVE (`reg = base`), IR_LW or IR_SW.
+ * @param reg  The register written, or stored by IR_SW.
+ * @param base The source register, or the address register of IR_LW/IR_SW.
+ * @param imm  The immediate or offset (ignored by IR_MOVE).
+ */
+int isStep(IRInstr *p, int op, int reg, int base, int imm) {
+    if (!p || p->op != op) {
+        return 0;
+    }
+    switch (op) {
+    case IR_MOVE:
+        return p->dst == reg && p->src1 == base;
+    case IR_SW:
+        return p->src1 == reg && p->src2 == base && p->imm == imm;
+    default:
+        return p->dst == reg && p->src1 == base && p->src2 == IR_NOREG && p->imm == imm;
+    }
+}
+
+/**
+ * findPrologue - Finds the standard prologue at the top of a routine.
+ *
+ * @param f The routine.
+ *
+ * @return The first prologue instruction, or NULL if the routine does not start with one.
+ *
+ * The final `$fp = $sp` is missing when the peephole optimizer found `$fp` unused.
+ */
+IRInstr *findPrologue(IRFunc *f) {
+    IRInstr *label = f->head;
+    while (label && label->op == IR_COMMENT) {
+        label = label->next;
+    }
+    if (!label || label->op != IR_LABEL || !label->sym || strcmp(label->sym, f->name)) {
+        return NULL;
+    }
+    IRInstr *p = nextCode(label), *q = p;
+    if (!isStep(q, IR_ADD, R_SP, R_SP, -FRAME_SIZE) || !isStep(q = nextCode(q), IR_SW, R_RA, R_SP, 0) ||
+        !isStep(q = nextCode(q), IR_SW, R_S1, R_SP, 4) || !isStep(q = nextCode(q), IR_SW, R_FP, R_SP, 8)) {
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * epilogueEnd - Reports whether an instruction starts the standard epilogue.
+ *
+ * @param p The instruction.
+ *
+ * @return The return instruction ending the epilogue, or NULL.
+ *
+ * The peephole optimizer drops the leading `$sp = $fp` when the two are known to be equal.
+ */
+IRInstr *epilogueEnd(IRInstr *p) {
+    IRInstr *q = isStep(p, IR_MOVE, R_SP, R_FP, 0) ? nextCode(p) : p;
+    if (isStep(q, IR_LW, R_RA, R_SP, 0) && isStep(q = nextCode(q), IR_LW, R_S1, R_SP, 4) &&
+        isStep(q = nextCode(q), IR_LW, R_FP, R_SP, 8) && isStep(q = nextCode(q), IR_ADD, R_SP, R_SP, FRAME_SIZE) &&
+        (q = nextCode(q)) && q->op == IR_RET) {
+        return q;
+    }
+    return NULL;
+}
+
+/**
+ * isTailCall - Reports whether a call can jump back into the caller instead.
+ *
+ * @param f    The routine.
+ * @param call The instruction.
+ *
+ * The call must be a direct call of the routine itself whose arguments are all passed by value
+ * (a reference could point into the frame about to be reused), and everything from the call to
+ * the epilogue must only pop the arguments and copy the result around, so that `$v0` still
+ * holds it when the routine returns.
+ */
+int isTailCall(IRFunc *f, IRInstr *call) {
+    if (call->op != IR_CALL || !f->args || strcmp(call->sym, f->name) || strchr(f->args, 'R')) {
+        return 0;
+    }
+    int n = strlen(f->args);
+    IRInstr *p = nextCode(call);
+    if (n) {
+        if (!isStackAdjust(p, 4 * n)) {
+            return 0;
+        }
+        p = nextCode(p);
+    }
+
+    unsigned result = 1u << R_V0; // Registers holding the result of the call
+    for (int steps = 0; p && steps < FRAME_TAIL_STEPS; ++steps) {
+        switch (p->op) {
+        case IR_LABEL:
+            p = nextCode(p);
+            break;
+        case IR_J:
+            p = labelOf(f, p);
+            break;
+        case IR_LW:
+            return epilogueEnd(p) && (result & 1u << R_V0);
+        case IR_MOVE:
+            if (p->dst == R_SP) {
+                return epilogueEnd(p) && (result & 1u << R_V0);
+            }
+            if (!irIsTemp(p->dst) && p->dst != R_V0) {
+                return 0;
+            }
+            result = (result & ~(1u << p->dst)) | ((result >> p->src1 & 1) << p->dst);
+            p = nextCode(p);
+            break;
+        default:
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * makeTailCall - Replaces a tail call with a jump to the top of the body.
+ *
+ * @param f     The routine.
+ * @param call  The call (see isTailCall).
+ * @param entry The label after the prologue.
+ *
+ * @return The jump.
+ *
+ * The arguments the call pushed are copied into the routine's own argument slots, the stack is
+ * cut back to the frame, and the code after the call, which can no longer run, is deleted.
+ */
+IRInstr *makeTailCall(IRFunc *f, IRInstr *call, IRInstr *entry) {
+    int n = strlen(f->args);
+    for (int i = 0; i < n; ++i) {
+        if (f->args[i] == 'I') {
+            continue; // Already in its argument register, which the body stores again
+        }
+        IRInstr *load = irNewInstr(IR_LW, R_T1, R_SP, IR_NOREG, 4 * i, NULL);
+        IRInstr *store = irNewInstr(IR_SW, IR_NOREG, R_T1, R_FP, FRAME_SIZE + 4 * i, NULL);
+        load->mem = store->mem = IR_MEM_FRAME;
+        irInsertBefore(f, load, call);
+        irInsertBefore(f, store, call);
+    }
+    irInsertBefore(f, irNewInstr(IR_MOVE, R_SP, R_FP, IR_NOREG, 0, NULL), call);
+    IRInstr *jump = irNewInstr(IR_J, IR_NOREG, IR_NOREG, IR_NOREG, 0, entry->sym);
+    irInsertBefore(f, jump, call);
+    while (jump->next && jump->next->op != IR_LABEL) {
+        irRemove(f, jump->next);
+    }
+    return jump;
+}
+
+/**
+ * labelDepth - Returns the slot holding the stack depth at a numbered label.
+ *
+ * @param s The frame shape.
+ * @param p An IR_LABEL, IR_J or branch instruction.
+ *
+ * @return The slot, or NULL for named labels and labels outside the routine.
+ */
+int *labelDepth(FrameShape *s, IRInstr *p) {
+    if (p->sym || p->label < s->lo || p->label > s->hi) {
+        return NULL;
+    }
+    return &s->depth[p->label - s->lo];
+}
+
+/**
+ * toStack - Rewrites `reg = $fp + imm`, or an access at `imm($fp)`, to use `$sp`.
+ *
+ * @param p       The instruction.
+ * @param depth   The stack depth at the instruction (see walkFrame).
+ * @param s       The frame shape.
+ * @param rewrite Zero to only check that the instruction can be rewritten.
+ *
+ * Slots below the save area (locals, spills) keep their distance from `$sp`, since everything
+ * pushed after the prologue moves up together; arguments above it get closer by the bytes the
+ * new prologue no longer reserves.
+ */
+int toStack(IRInstr *p, int depth, FrameShape *s, int rewrite) {
+    int imm = p->imm + depth - FRAME_SIZE;
+    if (p->imm >= FRAME_SIZE) {
+        imm -= FRAME_SIZE - s->size;
+    } else if (p->imm >= 0) {
+        return 0; // The save area itself
+    }
+    if (!fitsImm(imm)) {
+        return 0;
+    }
+    if (rewrite) {
+        if (p->op == IR_SW) {
+            p->src2 = R_SP;
+        } else {
+            p->src1 = R_SP;
+        }
+        p->imm = imm;
+    }
+    return 1;
+}
+
+/**
+ * rewriteEpilogue - Replaces the standard epilogue with one matching the new frame.
+ *
+ * @param f     The routine.
+ * @param p     The first epilogue instruction (see epilogueEnd).
+ * @param s     The frame shape.
+ * @param depth The stack depth of the new frame at the epilogue.
+ *
+ * @return The return instruction.
+ */
+IRInstr *rewriteEpilogue(IRFunc *f, IRInstr *p, FrameShape *s, int depth) {
+    IRInstr *ra = p->op == IR_MOVE ? nextCode(p) : p;
+    IRInstr *s1 = nextCode(ra), *fp = nextCode(s1), *pop = nextCode(fp), *ret = nextCode(pop);
+    int base = depth - s->size; // Offset of the save area from `$sp`
+    if (p != ra) {
+        irRemove(f, p);
+    }
+    irRemove(f, fp);
+    if (s->save_ra) {
+        ra->imm = base;
+    } else {
+        irRemove(f, ra);
+    }
+    if (s->save_s1) {
+        s1->imm = base + 4 * s->save_ra;
+    } else {
+        irRemove(f, s1);
+    }
+    if (depth) {
+        pop->imm = depth;
+    } else {
+        irRemove(f, pop);
+    }
+    return ret;
+}
+
+/**
+ * walkFrame - Follows the stack depth through a routine and moves its frame accesses to `$sp`.
+ *
+ * @param f       The routine.
+ * @param start   The first instruction after the prologue.
+ * @param s       The frame shape; collects the depth at each label.
+ * @param rewrite Zero to only check that every frame access can be rewritten.
+ *
+ * @return 1 on success, 0 if the routine uses `$sp` or `$fp` in a way the pass cannot follow.
+ *
+ * `depth` is the distance from the entry stack pointer down to `$sp` in the standard frame, so
+ * `$fp` is `depth - FRAME_SIZE` bytes above `$sp`; in the new frame `$sp` sits
+ * `FRAME_SIZE - size` bytes higher all the time. Every label must be reached at a single depth.
+ */
+int walkFrame(IRFunc *f, IRInstr *start, FrameShape *s, int rewrite) {
+    int depth = FRAME_SIZE, known = 1;
+    for (IRInstr *p = start, *next; p; p = next) {
+        next = p->next;
+        int *slot = p->op == IR_LABEL || p->op == IR_J || irIsBranch(p->op) ? labelDepth(s, p) : NULL;
+
+        if (p->op == IR_LABEL) {
+            if (p->sym && s->entry && !strcmp(p->sym, s->entry)) {
+                continue;
+            }
+            if (!slot || (!known && *slot < 0) || (known && *slot >= 0 && *slot != depth)) {
+                return 0;
+            }
+            if (known) {
+                *slot = depth;
+            }
+            depth = *slot;
+            known = 1;
+            continue;
+        }
+        if (!known) {
+            // Unreachable until the next label: only code that need not be rewritten is allowed
+            if (p->op != IR_COMMENT && (irWrites(p, R_SP) || (p->op != IR_CALL && p->op != IR_RET &&
+                                                              irReads(p, R_FP)))) {
+                return 0;
+            }
+            continue;
+        }
+
+        switch (p->op) {
+        case IR_COMMENT:
+        case IR_CALL:
+            continue;
+        case IR_J:
+            if (p->sym) {
+                // Tail calls cut the stack back to the frame before jumping to the top
+                if (!s->entry || strcmp(p->sym, s->entry) || depth != FRAME_SIZE) {
+                    return 0;
+                }
+                known = 0;
+                continue;
+            }
+            // Fall through
+        case IR_BEQ:
+        case IR_BNE:
+        case IR_BLT:
+        case IR_BGT:
+        case IR_BLE:
+        case IR_BGE:
+            if (p->src1 == R_FP || p->src2 == R_FP || !slot || (*slot >= 0 && *slot != depth)) {
+                return 0;
+            }
+            *slot = depth;
+            known = p->op != IR_J;
+            continue;
+        case IR_RET:
+        case IR_EXIT:
+            return 0;
+        }
+
+        IRInstr *ret = epilogueEnd(p);
+        if (ret) {
+            if (p->op == IR_LW && depth != FRAME_SIZE) {
+                return 0;
+            }
+            next = rewrite ? rewriteEpilogue(f, p, s, depth - FRAME_SIZE + s->size)->next : ret->next;
+            known = 0;
+            continue;
+        }
+        if (isStep(p, IR_MOVE, R_SP, R_FP, 0)) {
+            // `$sp = $fp`: back to the empty frame, which the new prologue leaves `size` deep
+            if (rewrite) {
+                if (depth != FRAME_SIZE) {
+                    p->op = IR_ADD;
+                    p->src1 = R_SP;
+                    p->src2 = IR_NOREG;
+                    p->imm = depth - FRAME_SIZE;
+                } else {
+                    irRemove(f, p);
+                }
+            }
+            depth = FRAME_SIZE;
+            continue;
+        }
+        if (p->dst == R_SP) {
+            if (p->op != IR_ADD || p->src1 != R_SP || p->src2 != IR_NOREG) {
+                return 0;
+            }
+            depth -= p->imm;
+            continue;
+        }
+        if (p->dst == R_FP) {
+            return 0;
+        }
+        if ((p->op == IR_LW && p->src1 == R_FP) || (p->op == IR_SW && p->src2 == R_FP && p->src1 != R_FP) ||
+            (p->op == IR_ADD && p->src1 == R_FP && p->src2 == IR_NOREG)) {
+            if (!toStack(p, depth, s, rewrite)) {
+                return 0;
+            }
+            continue;
+        }
+        if (irReads(p, R_FP)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * findNeeds - Works out which registers the new prologue must save, and the label range.
+ *
+ * @param f     The routine.
+ * @param start The first instruction after the prologue.
+ * @param s     The frame shape to fill in.
+ */
+void findNeeds(IRFunc *f, IRInstr *start, FrameShape *s) {
+    s->lo = s->hi = -1;
+    for (IRInstr *p = start; p; p = p->next) {
+        IRInstr *ret = epilogueEnd(p);
+        if (ret) {
+            p = ret;
+            continue;
+        }
+        if (p->op == IR_CALL) {
+            s->save_ra = 1;
+        } else if (irWrites(p, R_S1)) {
+            s->save_s1 = 1;
+        }
+        if ((p->op == IR_LABEL || p->op == IR_J || irIsBranch(p->op)) && !p->sym) {
+            if (s->lo < 0 || p->label < s->lo) {
+                s->lo = p->label;
+            }
+            if (p->label > s->hi) {
+                s->hi = p->label;
+            }
+        }
+    }
+    s->size = 4 * (s->save_ra + s->save_s1);
+}
+
+/**
+ * rewritePrologue - Replaces the standard prologue with one that saves what the routine needs.
+ *
+ * @param f     The routine.
+ * @param p     The first prologue instruction.
+ * @param s     The frame shape.
+ */
+void rewritePrologue(IRFunc *f, IRInstr *p, FrameShape *s) {
+    IRInstr *ra = nextCode(p), *s1 = nextCode(ra), *fp = nextCode(s1), *top = nextCode(fp);
+    irRemove(f, fp);
+    if (isStep(top, IR_MOVE, R_FP, R_SP, 0)) {
+        irRemove(f, top);
+    }
+    if (!s->save_ra) {
+        irRemove(f, ra);
+    }
+    if (s->save_s1) {
+        s1->imm = 4 * s->save_ra;
+    } else {
+        irRemove(f, s1);
+    }
+    if (s->size) {
+        p->imm = -s->size;
+    } else {
+        irRemove(f, p);
+    }
+}
+
+/**
+ * irShapeFrame - Turns self tail calls into jumps and trims the frame of a routine.
+ *
+ * @param f The routine.
+ *
+ * Step 1 rewrites the tail calls, which keep working with the standard frame. Step 2 checks
+ * the whole routine before step 3 changes its frame, so a routine the pass cannot follow keeps
+ * the standard one.
+ */
+void irShapeFrame(IRFunc *f) {
+    IRInstr *prologue = f->name ? findPrologue(f) : NULL;
+    if (!prologue) {
+        return;
+    }
+    IRInstr *last = nextCode(nextCode(nextCode(prologue))); // The end of the prologue
+    int has_fp = isStep(nextCode(last), IR_MOVE, R_FP, R_SP, 0);
+    if (has_fp) {
+        last = nextCode(last);
+    }
+    FrameShape s = {0};
+
+    /*** Step 1: Self Tail Calls ***/
+    IRInstr *entry = NULL;
+    for (IRInstr *p = last->next, *next; p && has_fp; p = next) {
+        next = p->next;
+        if (isTailCall(f, p)) {
+            if (!entry) {
+                char *name = malloc(strlen(f->name) + 6);
+                sprintf(name, "%s.tail", f->name);
+                entry = irNewInstr(IR_LABEL, IR_NOREG, IR_NOREG, IR_NOREG, 0, name);
+                irInsertAfter(f, entry, last);
+                free(name);
+            }
+            next = makeTailCall(f, p, entry)->next;
+        }
+    }
+    s.entry = entry ? entry->sym : NULL;
+
+    /*** Step 2: Find What the Frame Must Hold ***/
+    findNeeds(f, last->next, &s);
+    int labels = s.lo < 0 ? 0 : s.hi - s.lo + 1;
+    s.depth = malloc((labels ? labels : 1) * sizeof(int));
+    memset(s.depth, -1, labels * sizeof(int));
+    int ok = walkFrame(f, last->next, &s, 0);
+
+    /*** Step 3: Move Frame Accesses to $sp and Rebuild the Prologue and Epilogues ***/
+    if (ok) {
+        memset(s.depth, -1, labels * sizeof(int));
+        walkFrame(f, last->next, &s, 1);
+        rewritePrologue(f, prologue, &s);
+    }
+    free(s.depth);
+}
+
+/**
+ * keepArg - Keeps one register argument in its register if nothing can change it.
+ *
+ * @param f    The routine.
+ * @param slot The `$fp` offset of the argument's slot.
+ * @param reg  The argument register.
+ *
+ * @return 1 if the routine was changed.
+ *
+ * The slot must only be written by the entry store and never have its address taken (a
+ * reference to it could be written through), and no instruction, calls and runtime services
+ * included, may write the register.
+ */
+int keepArg(IRFunc *f, int slot, int reg) {
+    IRInstr *home = NULL;
+    for (IRInstr *p = f->head; p; p = p->next) {
+        if (!home && p->op == IR_SW && p->src1 == reg && p->src2 == R_FP && p->imm == slot) {
+            home = p;
+        } else if (irWrites(p, reg) || (p->op == IR_SW && p->src2 == R_FP && p->imm == slot) ||
+                   (p->op == IR_ADD && p->src1 == R_FP) || (p->op == IR_MOVE && p->src1 == R_FP && p->dst != R_SP)) {
+            return 0;
+        }
+    }
+    if (!home) {
+        return 0;
+    }
+    for (IRInstr *p = home->next; p; p = p->next) {
+        if (p->op == IR_LW && p->src1 == R_FP && p->imm == slot) {
+            makeMove(p, p->dst, reg);
+        }
+    }
+    irRemove(f, home);
+    return 1;
+}
+
+/**
+ * irKeepArgs - Lets a routine read its register arguments from the registers.
+ *
+ * @param f The routine.
+ *
+ * @return 1 if the routine was changed (the new moves are worth a peephole run).
+ */
+int irKeepArgs(IRFunc *f) {
+    int changed = 0;
+    for (int i = 0, reg = R_A0; f->args && f->args[i]; ++i) {
+        if (f->args[i] == 'I') {
+            changed |= keepArg(f, FRAME_SIZE + 4 * i, reg++);
+        }
+    }
+    return changed;
+}
@@ -1428,7 +1428,7 @@ FormalParameterList_rec :
                   t = t->RightC;
 
               t->RightC = NullExp();  // Clear dangling nodes.
-              free(argtype);          // Free temporary node memory.
+              FreeNode(argtype);      // Return the temporary node to the arena.
           }
 
           $$ = $2;  // Return the constructed regular argument node.
@@ -1459,7 +1459,7 @@ FormalParameterList_rec :
                   t = t->RightC;
 
               t->RightC = NullExp();  // Clear dangling nodes.
-              free(argtype);          // Free temporary node memory.
+              FreeNode(argtype);      // Return the temporary node to the arena.
           }
 
           $$ = $3;  // Return the constructed value argument node.
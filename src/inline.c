@@ -0,0 +1,301 @@
+/**************************************************************************************************
+ * File: inline.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Inliner**. It copies the bodies of small methods into the
+ *    routines that call them, so a call to a getter or an arithmetic helper costs no `jal`,
+ *    no frame and no return jump.
+ *
+ *    Routines are generated and finished one at a time in source order. A finished routine
+ *    (see closeFunction in codegen.c) is offered to the inliner after all other passes ran on
+ *    it. It is kept as an inline candidate when it is a leaf that the frame optimizer left
+ *    without any frame: no calls, no saved registers, no `$fp`. Its code then addresses its
+ *    arguments and locals from `$sp` only, relative to the stack pointer at its entry, and
+ *    the caller has already reserved and filled the argument area at that point. Substituting
+ *    the body for the call therefore needs no remapping of parameters: labels are renamed and
+ *    returns become jumps to the end of the copy.
+ *
+ *    Leaves cannot be recursive, and a routine that only calls candidates becomes a leaf
+ *    once they are substituted, so a candidate may itself contain inlined code.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void irOfferInline(IRFunc *f, int limit):**
+ *       - Keeps a copy of a finished routine if it is small enough to inline.
+ *
+ *    2. **int irInline(IRFunc *f, int *labels):**
+ *       - Replaces the calls of a routine to candidates with their bodies.
+ *
+ *    3. **IRInstr *irInlineBody(char *name) / void irAddInline(char *name, IRInstr *head):**
+ *       - Look up and add candidates directly, for the compilation cache.
+ *
+ **************************************************************************************************/
+
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INLINE_BUCKETS 1024 // Hash buckets of the candidate table
+#define INLINE_LABELS 64    // Maximum number of labels in a candidate
+
+/*
+ * Inline - One inline candidate: a copy of the code of a finished routine.
+ */
+typedef struct Inline {
+    char *name;          // Routine label
+    IRInstr *head;       // Copied instructions, without the routine label (not linked to a routine)
+    struct Inline *next; // Next candidate in the same bucket
+} Inline;
+
+Inline *inline_table[INLINE_BUCKETS];
+
+/**
+ * inlineHash - Returns the bucket of a routine label.
+ *
+ * @param name The label.
+ */
+unsigned inlineHash(char *name) {
+    unsigned h = 0;
+    while (*name) {
+        h = h * 31 + (unsigned char)*name++;
+    }
+    return h % INLINE_BUCKETS;
+}
+
+/**
+ * findInline - Looks up the candidate for a routine label.
+ *
+ * @param name The label.
+ *
+ * @return The candidate, or NULL.
+ */
+Inline *findInline(char *name) {
+    for (Inline *c = inline_table[inlineHash(name)]; c; c = c->next) {
+        if (!strcmp(c->name, name)) {
+            return c;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * copyInstr - Returns an unlinked copy of an instruction.
+ *
+ * @param p The instruction.
+ */
+IRInstr *copyInstr(IRInstr *p) {
+    IRInstr *q = irNewInstr(p->op, p->dst, p->src1, p->src2, p->imm, p->sym);
+    q->label = p->label;
+    q->mem = p->mem;
+    return q;
+}
+
+/**
+ * isInlinable - Reports whether a finished routine can be substituted for its calls.
+ *
+ * @param f     The routine.
+ * @param limit Maximum number of instructions.
+ *
+ * The routine must be a leaf without a frame (see the file comment). Some registers every
+ * call leaves intact must stay intact too: it may only write temporaries, `$v0`, `$v1` (bounds
+ * checks), `$a0-$a3` and `$sp`.
+ */
+int isInlinable(IRFunc *f, int limit) {
+    int size = 0, labels = 0;
+    for (IRInstr *p = f->head; p; p = p->next) {
+        switch (p->op) {
+        case IR_COMMENT:
+            continue;
+        case IR_LABEL:
+            ++labels;
+            continue;
+        case IR_CALL:
+        case IR_EXIT:
+            return 0;
+        case IR_RET:
+            continue;
+        }
+        if (irReads(p, R_FP) || irReads(p, R_RA) || irReads(p, R_S1) ||
+            (p->dst != IR_NOREG && !irIsTemp(p->dst) && p->dst != R_V0 && p->dst != R_V1 &&
+             p->dst != R_SP && (p->dst < R_A0 || p->dst > R_A3))) {
+            return 0;
+        }
+        ++size;
+    }
+    return size <= limit && labels <= INLINE_LABELS;
+}
+
+/**
+ * irInlineBody - Returns the instructions of the inline candidate for a routine label.
+ *
+ * @param name The label.
+ *
+ * @return The candidate's instructions (not to be modified), or NULL if it is no candidate.
+ */
+IRInstr *irInlineBody(char *name) {
+    Inline *c = name ? findInline(name) : NULL;
+    return c ? c->head : NULL;
+}
+
+/**
+ * irAddInline - Adds an inline candidate.
+ *
+ * @param name The routine label (copied).
+ * @param head Its instructions, without the routine label; the table takes them over.
+ */
+void irAddInline(char *name, IRInstr *head) {
+    Inline *c = calloc(1, sizeof(Inline));
+    c->name = strdup(name);
+    c->head = head;
+    unsigned h = inlineHash(c->name);
+    c->next = inline_table[h];
+    inline_table[h] = c;
+}
+
+/**
+ * irClearInline - Drops every inline candidate, for the next compilation unit.
+ */
+void irClearInline() {
+    for (int i = 0; i < INLINE_BUCKETS; ++i) {
+        while (inline_table[i]) {
+            Inline *c = inline_table[i];
+            inline_table[i] = c->next;
+            while (c->head) {
+                IRInstr *next = c->head->next;
+                free(c->head->sym);
+                free(c->head);
+                c->head = next;
+            }
+            free(c->name);
+            free(c);
+        }
+    }
+}
+
+/**
+ * irOfferInline - Keeps a copy of a finished routine as an inline candidate if it qualifies.
+ *
+ * @param f     The routine, after all passes.
+ * @param limit Maximum number of instructions of a candidate (0 disables inlining).
+ */
+void irOfferInline(IRFunc *f, int limit) {
+    if (!f->name || !f->args || !isInlinable(f, limit)) {
+        return;
+    }
+    IRInstr *head = NULL, *prev = NULL;
+    for (IRInstr *p = f->head; p; p = p->next) {
+        if (p->op == IR_COMMENT || (p->op == IR_LABEL && p->sym && !strcmp(p->sym, f->name))) {
+            continue;
+        }
+        IRInstr *q = copyInstr(p);
+        q->prev = prev;
+        if (prev) {
+            prev->next = q;
+        } else {
+            head = q;
+        }
+        prev = q;
+    }
+    irAddInline(f->name, head);
+}
+
+/*
+ * LabelMap - The fresh label given to each label of the candidate being substituted.
+ */
+typedef struct LabelMap {
+    IRInstr *from[INLINE_LABELS]; // Label instructions of the candidate
+    int to[INLINE_LABELS];        // Their new numbers
+    int count;
+} LabelMap;
+
+/**
+ * mapLabel - Points a copied label, jump or branch at the fresh label for its target.
+ *
+ * @param m The label map, filled with the candidate's labels.
+ * @param q The copy.
+ */
+void mapLabel(LabelMap *m, IRInstr *q) {
+    for (int i = 0; i < m->count; ++i) {
+        if (sameLabel(q, m->from[i])) {
+            free(q->sym);
+            q->sym = NULL;
+            q->label = m->to[i];
+            return;
+        }
+    }
+}
+
+/**
+ * substitute - Replaces one call with the body of a candidate.
+ *
+ * @param f      The calling routine.
+ * @param call   The call.
+ * @param c      The candidate.
+ * @param labels The label counter of code generation.
+ */
+void substitute(IRFunc *f, IRInstr *call, Inline *c, int *labels) {
+    LabelMap m = {.count = 0};
+    IRInstr *last = NULL; // Last instruction of the body that is not a label
+    for (IRInstr *p = c->head; p; p = p->next) {
+        if (p->op == IR_LABEL) {
+            m.from[m.count] = p;
+            m.to[m.count++] = ++*labels;
+        } else {
+            last = p;
+        }
+    }
+
+    int end = 0; // Label after the copy, once a return needs it
+    char *note = malloc(strlen(call->sym) + 8);
+    sprintf(note, "inline %s", call->sym);
+    irInsertBefore(f, irNewInstr(IR_COMMENT, IR_NOREG, IR_NOREG, IR_NOREG, 0, note), call);
+    free(note);
+    for (IRInstr *p = c->head; p; p = p->next) {
+        if (p->op == IR_RET) {
+            if (p == last) {
+                continue; // Falls through to the code after the call
+            }
+            if (!end) {
+                end = ++*labels;
+            }
+            IRInstr *q = irNewInstr(IR_J, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL);
+            q->label = end;
+            irInsertBefore(f, q, call);
+            continue;
+        }
+        IRInstr *q = copyInstr(p);
+        if (p->op == IR_LABEL || p->op == IR_J || irIsBranch(p->op)) {
+            mapLabel(&m, q);
+        }
+        irInsertBefore(f, q, call);
+    }
+    if (end) {
+        IRInstr *q = irNewInstr(IR_LABEL, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL);
+        q->label = end;
+        irInsertBefore(f, q, call);
+    }
+    irRemove(f, call);
+}
+
+/**
+ * irInline - Substitutes the bodies of inline candidates for the calls of a routine.
+ *
+ * @param f      The routine, before any other pass.
+ * @param labels The label counter of code generation, for the labels of the copies.
+ *
+ * @return 1 if any call was replaced.
+ */
+int irInline(IRFunc *f, int *labels) {
+    int changed = 0;
+    for (IRInstr *p = f->head, *next; p; p = next) {
+        next = p->next;
+        Inline *c = p->op == IR_CALL ? findInline(p->sym) : NULL;
+        if (c) {
+            substitute(f, p, c, labels);
+            changed = 1;
+        }
+    }
+    return changed;
+}
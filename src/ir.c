@@ -0,0 +1,626 @@
+#include "ir.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * irRegNames - Assembly names of the registers, indexed by `R_*` number.
+ */
+char *irRegNames[IR_NUM_REGS] = {"$0",  "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+                                 "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+                                 "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+                                 "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"};
+
+/*
+ * irOpNames - MIPS mnemonics of the arithmetic and logic operations.
+ *             Also used by `irDump` to name the operation of a binary instruction.
+ */
+char *irOpNames[] = {
+    [IR_ADD] = "add", [IR_SUB] = "sub", [IR_MUL] = "mul", [IR_DIV] = "div", [IR_SLT] = "slt",
+    [IR_SGT] = "sgt", [IR_SEQ] = "seq", [IR_SNE] = "sne", [IR_SLE] = "sle", [IR_SGE] = "sge",
+    [IR_AND] = "and", [IR_OR] = "or",   [IR_SLL] = "sll", [IR_NEG] = "neg",
+    [IR_SRA] = "sra", [IR_SRL] = "srl", [IR_BEQ] = "beq", [IR_BNE] = "bne", [IR_BLT] = "blt",
+    [IR_BGT] = "bgt", [IR_BLE] = "ble", [IR_BGE] = "bge",
+};
+
+/*
+ * irOpSymbols - Infix operators used by `irDump` for the three-address notation.
+ */
+char *irOpSymbols[] = {
+    [IR_ADD] = "+",  [IR_SUB] = "-",  [IR_MUL] = "*",  [IR_DIV] = "/", [IR_SLT] = "<",
+    [IR_SGT] = ">",  [IR_SEQ] = "==", [IR_SNE] = "!=", [IR_SLE] = "<=", [IR_SGE] = ">=",
+    [IR_AND] = "&",  [IR_OR] = "|",   [IR_SLL] = "<<", [IR_SRA] = ">>", [IR_SRL] = ">>>",
+    [IR_BEQ] = "==", [IR_BNE] = "!=", [IR_BLT] = "<",  [IR_BGT] = ">", [IR_BLE] = "<=",
+    [IR_BGE] = ">=",
+};
+
+extern int buffer_output; // Set by `-buffer-output` (see codegen.c)
+
+/*
+ * ir_func - The routine currently under construction (NULL when none is open).
+ */
+IRFunc *ir_func = NULL;
+
+/**
+ * irBeginFunc - Opens a new routine; subsequent instructions are appended to it.
+ *
+ * @param name Routine label, or NULL for anonymous code. The string is copied.
+ *
+ * The previous routine must have been closed with `irEndFunc`.
+ */
+void irBeginFunc(char *name) {
+    ir_func = calloc(1, sizeof(IRFunc));
+    ir_func->name = name ? strdup(name) : NULL;
+}
+
+/**
+ * irEndFunc - Closes the routine under construction and hands it to the caller.
+ *
+ * @return The finished routine, or NULL if none was open.
+ */
+IRFunc *irEndFunc() {
+    IRFunc *f = ir_func;
+    ir_func = NULL;
+    return f;
+}
+
+/**
+ * irCurrentFunc - Returns the routine under construction (NULL when none is open).
+ */
+IRFunc *irCurrentFunc() { return ir_func; }
+
+/**
+ * irEmit - Appends one instruction to the routine under construction.
+ *
+ * @param op   IR_* operation.
+ * @param dst  Destination register or IR_NOREG.
+ * @param src1 First source register or IR_NOREG.
+ * @param src2 Second source register, or IR_NOREG to use `imm`.
+ * @param imm  Immediate operand or memory offset.
+ * @param sym  Symbol operand or NULL. The string is copied.
+ *
+ * Instructions emitted while no routine is open start an anonymous one, so nothing is lost.
+ */
+IRInstr *irEmit(int op, int dst, int src1, int src2, int imm, char *sym) {
+    if (!ir_func) {
+        irBeginFunc(NULL);
+    }
+
+    IRInstr *p = irNewInstr(op, dst, src1, src2, imm, sym);
+
+    // Link at the tail of the instruction list
+    p->prev = ir_func->tail;
+    if (ir_func->tail) {
+        ir_func->tail->next = p;
+    } else {
+        ir_func->head = p;
+    }
+    ir_func->tail = p;
+    return p;
+}
+
+/**
+ * irNewInstr - Creates one instruction that is not yet part of any routine.
+ *
+ * @param op   IR_* operation.
+ * @param dst  Destination register or IR_NOREG.
+ * @param src1 First source register or IR_NOREG.
+ * @param src2 Second source register, or IR_NOREG to use `imm`.
+ * @param imm  Immediate operand or memory offset.
+ * @param sym  Symbol operand or NULL. The string is copied.
+ */
+IRInstr *irNewInstr(int op, int dst, int src1, int src2, int imm, char *sym) {
+    IRInstr *p = malloc(sizeof(IRInstr));
+    p->op = op;
+    p->dst = dst;
+    p->src1 = src1;
+    p->src2 = src2;
+    p->imm = imm;
+    p->label = 0;
+    p->mem = IR_MEM_ANY;
+    p->sym = sym ? strdup(sym) : NULL;
+    p->prev = p->next = NULL;
+    return p;
+}
+
+/*
+ * Construction helpers - one per instruction shape, mirroring the MIPS mnemonics.
+ */
+
+void irLabel(int n) { irEmit(IR_LABEL, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL)->label = n; }
+
+void irNamedLabel(char *name) { irEmit(IR_LABEL, IR_NOREG, IR_NOREG, IR_NOREG, 0, name); }
+
+void irComment(char *fmt, ...) {
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    irEmit(IR_COMMENT, IR_NOREG, IR_NOREG, IR_NOREG, 0, buf);
+}
+
+void irLi(int dst, int imm) { irEmit(IR_LI, dst, IR_NOREG, IR_NOREG, imm, NULL); }
+
+void irLa(int dst, char *sym) { irEmit(IR_LA, dst, IR_NOREG, IR_NOREG, 0, sym); }
+
+/*
+ * Loads and stores relative to `$fp` or `$sp` are frame accesses; callers set the memory class
+ * of other accesses when they know it.
+ */
+
+IRInstr *irLoad(int dst, int offset, int base) {
+    IRInstr *p = irEmit(IR_LW, dst, base, IR_NOREG, offset, NULL);
+    p->mem = base == R_FP || base == R_SP ? IR_MEM_FRAME : IR_MEM_ANY;
+    return p;
+}
+
+IRInstr *irStore(int src, int offset, int base) {
+    IRInstr *p = irEmit(IR_SW, IR_NOREG, src, base, offset, NULL);
+    p->mem = base == R_FP || base == R_SP ? IR_MEM_FRAME : IR_MEM_ANY;
+    return p;
+}
+
+void irMove(int dst, int src) { irEmit(IR_MOVE, dst, src, IR_NOREG, 0, NULL); }
+
+void irOp(int op, int dst, int src1, int src2) { irEmit(op, dst, src1, src2, 0, NULL); }
+
+void irOpImm(int op, int dst, int src1, int imm) { irEmit(op, dst, src1, IR_NOREG, imm, NULL); }
+
+void irJump(int n) { irEmit(IR_J, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL)->label = n; }
+
+void irBranch(int op, int src1, int src2, int n) { irEmit(op, IR_NOREG, src1, src2, 0, NULL)->label = n; }
+
+void irCall(char *sym) { irEmit(IR_CALL, IR_NOREG, IR_NOREG, IR_NOREG, 0, sym); }
+
+void irReturn() { irEmit(IR_RET, IR_NOREG, IR_NOREG, IR_NOREG, 0, NULL); }
+
+/**
+ * irRemove - Unlinks an instruction from a routine and releases it.
+ *
+ * @param f The routine.
+ * @param p The instruction. Basic blocks that refer to it must be rebuilt afterwards.
+ */
+void irRemove(IRFunc *f, IRInstr *p) {
+    if (p->prev) {
+        p->prev->next = p->next;
+    } else {
+        f->head = p->next;
+    }
+    if (p->next) {
+        p->next->prev = p->prev;
+    } else {
+        f->tail = p->prev;
+    }
+    free(p->sym);
+    free(p);
+}
+
+/**
+ * irInsertBefore - Links an instruction into a routine just before another one.
+ *
+ * @param f      The routine.
+ * @param p      The instruction, not linked into any routine (see irNewInstr).
+ * @param before The instruction `p` is placed in front of.
+ */
+void irInsertBefore(IRFunc *f, IRInstr *p, IRInstr *before) {
+    p->next = before;
+    p->prev = before->prev;
+    if (before->prev) {
+        before->prev->next = p;
+    } else {
+        f->head = p;
+    }
+    before->prev = p;
+}
+
+/**
+ * irInsertAfter - Links an instruction into a routine just after another one.
+ *
+ * @param f     The routine.
+ * @param p     The instruction, not linked into any routine (see irNewInstr).
+ * @param after The instruction `p` is placed behind.
+ */
+void irInsertAfter(IRFunc *f, IRInstr *p, IRInstr *after) {
+    p->prev = after;
+    p->next = after->next;
+    if (after->next) {
+        after->next->prev = p;
+    } else {
+        f->tail = p;
+    }
+    after->next = p;
+}
+
+/**
+ * irIsTemp - Reports whether a register is a caller-saved temporary ($t0-$t9).
+ *
+ * @param reg The register.
+ */
+int irIsTemp(int reg) { return (reg >= R_T0 && reg <= R_T7) || reg == R_T8 || reg == R_T9; }
+
+/**
+ * irIsBranch - Reports whether an operation is a conditional branch (IR_BEQ-IR_BGE).
+ *
+ * @param op The IR_* operation.
+ */
+int irIsBranch(int op) { return op >= IR_BEQ && op <= IR_BGE; }
+
+/**
+ * irInverse - Returns the conditional branch taken exactly when `op` is not.
+ *
+ * @param op A conditional branch operation.
+ */
+int irInverse(int op) {
+    static int inverse[] = {
+        [IR_BEQ] = IR_BNE, [IR_BNE] = IR_BEQ, [IR_BLT] = IR_BGE,
+        [IR_BGT] = IR_BLE, [IR_BLE] = IR_BGT, [IR_BGE] = IR_BLT,
+    };
+    return inverse[op];
+}
+
+/**
+ * irReads - Reports whether an instruction reads a register.
+ *
+ * @param p   The instruction.
+ * @param reg The register.
+ *
+ * Calls and returns hand every register except the temporaries to other code, so they count
+ * as reading all of them.
+ */
+int irReads(IRInstr *p, int reg) {
+    switch (p->op) {
+    case IR_LABEL:
+    case IR_COMMENT:
+    case IR_LI:
+    case IR_LA:
+    case IR_J:
+    case IR_PRINT_STR:
+    case IR_READ_INT:
+    case IR_EXIT:
+    case IR_COUNT:
+        return 0;
+    case IR_CALL:
+    case IR_RET:
+        return !irIsTemp(reg);
+    default:
+        return reg != IR_NOREG && (p->src1 == reg || p->src2 == reg);
+    }
+}
+
+/**
+ * irWrites - Reports whether an instruction writes a register.
+ *
+ * @param p   The instruction.
+ * @param reg The register.
+ *
+ * Runtime services count as writing the `$v0`/`$a0` registers their syscall sequence uses.
+ * With `-buffer-output` they call a routine of the output runtime, which also writes `$v1`;
+ * reading input then flushes the buffer first, which writes `$a0` as well.
+ */
+int irWrites(IRInstr *p, int reg) {
+    switch (p->op) {
+    case IR_CALL:
+        return irIsTemp(reg) || reg == R_V0 || (reg >= R_A0 && reg <= R_A3) || reg == R_RA;
+    case IR_PRINT_INT:
+    case IR_PRINT_STR:
+        return reg == R_V0 || reg == R_A0 || (buffer_output && reg == R_V1);
+    case IR_READ_INT:
+        return reg == p->dst || reg == R_V0 || (buffer_output && (reg == R_A0 || reg == R_V1));
+    case IR_ALLOC:
+        return reg == p->dst || reg == R_V0 || reg == R_A0;
+    case IR_COUNT:
+        return reg == R_V1;
+    default:
+        return reg != IR_NOREG && p->dst == reg;
+    }
+}
+
+/**
+ * isBlockEnd - Reports whether an instruction ends its basic block.
+ *
+ * @param p The instruction.
+ */
+int isBlockEnd(IRInstr *p) {
+    return p->op == IR_J || irIsBranch(p->op) || p->op == IR_RET || p->op == IR_EXIT;
+}
+
+/**
+ * sameLabel - Reports whether a branch or jump refers to the label defined by `label`.
+ *
+ * @param branch The branch or jump instruction.
+ * @param label  An IR_LABEL instruction.
+ */
+int sameLabel(IRInstr *branch, IRInstr *label) {
+    if (!branch->sym || !label->sym) {
+        return !branch->sym && !label->sym && branch->label == label->label;
+    }
+    return !strcmp(branch->sym, label->sym);
+}
+
+/**
+ * findTarget - Finds the block that defines the label a branch refers to.
+ *
+ * @param f      The routine.
+ * @param branch The branch or jump instruction.
+ *
+ * @return The target block, or NULL for labels outside the routine.
+ */
+IRBlock *findTarget(IRFunc *f, IRInstr *branch) {
+    for (IRBlock *b = f->blocks; b; b = b->next) {
+        // Labels only appear at the start of a block, possibly after comments
+        for (IRInstr *p = b->first; p; p = p->next) {
+            if (p->op == IR_LABEL && sameLabel(branch, p)) {
+                return b;
+            }
+            if ((p->op != IR_LABEL && p->op != IR_COMMENT) || p == b->last) {
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * addEdge - Records a control-flow edge between two blocks.
+ *
+ * @param from Source block.
+ * @param to   Destination block (ignored when NULL).
+ */
+void addEdge(IRBlock *from, IRBlock *to) {
+    if (!to) {
+        return;
+    }
+    from->succ[from->nsucc++] = to;
+    to->pred = realloc(to->pred, (to->npred + 1) * sizeof(IRBlock *));
+    to->pred[to->npred++] = from;
+}
+
+/**
+ * freeBlocks - Releases the basic blocks of a routine (the instructions are kept).
+ *
+ * @param f The routine.
+ */
+void freeBlocks(IRFunc *f) {
+    IRBlock *b = f->blocks;
+    while (b) {
+        IRBlock *next = b->next;
+        free(b->pred);
+        free(b);
+        b = next;
+    }
+    f->blocks = NULL;
+    f->nblocks = 0;
+}
+
+/**
+ * irBuildCFG - Splits a routine into basic blocks and links them into a control-flow graph.
+ *
+ * @param f The routine. A previously built graph is discarded, so passes that rewrite
+ *          the instruction list can simply rebuild it.
+ *
+ * Step 1 partitions the instruction list: a block starts at the first instruction, at a
+ * label that follows a real instruction, and after every block-ending branch. Step 2 adds
+ * the edges: jumps to their target, conditional branches to their target and the next
+ * block, returns and exits to nothing, and everything else falls through.
+ */
+void irBuildCFG(IRFunc *f) {
+    freeBlocks(f);
+
+    /*** Step 1: Partition the instruction list into blocks ***/
+    IRBlock *last = NULL;
+    int has_code = 0; // Whether the current block holds anything besides labels/comments
+    for (IRInstr *p = f->head; p; p = p->next) {
+        if (!last || (p->op == IR_LABEL && has_code) || isBlockEnd(last->last)) {
+            IRBlock *b = calloc(1, sizeof(IRBlock));
+            b->id = f->nblocks++;
+            b->first = p;
+            if (last) {
+                last->next = b;
+            } else {
+                f->blocks = b;
+            }
+            last = b;
+            has_code = 0;
+        }
+        last->last = p;
+        if (p->op != IR_LABEL && p->op != IR_COMMENT) {
+            has_code = 1;
+        }
+    }
+
+    /*** Step 2: Connect the blocks ***/
+    for (IRBlock *b = f->blocks; b; b = b->next) {
+        IRInstr *end = b->last;
+        switch (end->op) {
+        case IR_J:
+            addEdge(b, findTarget(f, end));
+            break;
+        case IR_RET:
+        case IR_EXIT:
+            break;
+        default:
+            if (irIsBranch(end->op)) {
+                addEdge(b, findTarget(f, end));
+            }
+            addEdge(b, b->next);
+            break;
+        }
+    }
+}
+
+/**
+ * dumpLabel - Prints the label operand of a label, jump or branch instruction.
+ */
+void dumpLabel(IRInstr *p, FILE *out) {
+    if (p->sym) {
+        fprintf(out, "%s", p->sym);
+    } else {
+        fprintf(out, "L_%d", p->label);
+    }
+}
+
+/**
+ * dumpInstr - Prints one instruction in three-address notation.
+ *
+ * @param p   The instruction.
+ * @param out Destination stream.
+ */
+void dumpInstr(IRInstr *p, FILE *out) {
+    char **r = irRegNames;
+
+    if (p->op == IR_LABEL) {
+        dumpLabel(p, out);
+        fprintf(out, ":\n");
+        return;
+    }
+
+    fprintf(out, "\t");
+    switch (p->op) {
+    case IR_COMMENT:
+        fprintf(out, "# %s", p->sym);
+        break;
+    case IR_LI:
+        fprintf(out, "%s = %d", r[p->dst], p->imm);
+        break;
+    case IR_LA:
+        fprintf(out, "%s = &%s", r[p->dst], p->sym);
+        break;
+    case IR_LW:
+        fprintf(out, "%s = M[%s + %d]", r[p->dst], r[p->src1], p->imm);
+        break;
+    case IR_SW:
+        fprintf(out, "M[%s + %d] = %s", r[p->src2], p->imm, r[p->src1]);
+        break;
+    case IR_MOVE:
+        fprintf(out, "%s = %s", r[p->dst], r[p->src1]);
+        break;
+    case IR_NEG:
+        fprintf(out, "%s = -%s", r[p->dst], r[p->src1]);
+        break;
+    case IR_J:
+        fprintf(out, "goto ");
+        dumpLabel(p, out);
+        break;
+    case IR_CALL:
+        fprintf(out, "call %s", p->sym);
+        break;
+    case IR_RET:
+        fprintf(out, "return");
+        break;
+    case IR_PRINT_INT:
+        fprintf(out, "print_int %s", r[p->src1]);
+        break;
+    case IR_PRINT_STR:
+        fprintf(out, "print_str %s", p->sym);
+        break;
+    case IR_READ_INT:
+        fprintf(out, "%s = read_int", r[p->dst]);
+        break;
+    case IR_ALLOC:
+        if (p->src1 != IR_NOREG) {
+            fprintf(out, "%s = alloc %s", r[p->dst], r[p->src1]);
+        } else {
+            fprintf(out, "%s = alloc %d", r[p->dst], p->imm);
+        }
+        break;
+    case IR_EXIT:
+        fprintf(out, "exit");
+        break;
+    case IR_COUNT:
+        fprintf(out, "count %s+%d", p->sym, p->imm);
+        break;
+    case IR_BOUNDS:
+        if (p->src2 != IR_NOREG) {
+            fprintf(out, "check 0 <= %s < %s", r[p->src1], r[p->src2]);
+        } else {
+            fprintf(out, "check 0 <= %s < %d", r[p->src1], p->imm);
+        }
+        break;
+    default:
+        if (irIsBranch(p->op)) {
+            fprintf(out, "if %s %s ", r[p->src1], irOpSymbols[p->op]);
+            if (p->src2 == IR_NOREG) {
+                fprintf(out, "%d goto ", p->imm);
+            } else if (p->src2 == R_ZERO) {
+                fprintf(out, "0 goto ");
+            } else {
+                fprintf(out, "%s goto ", r[p->src2]);
+            }
+            dumpLabel(p, out);
+            break;
+        }
+        // Binary arithmetic and logic
+        if (p->src2 != IR_NOREG) {
+            fprintf(out, "%s = %s %s %s", r[p->dst], r[p->src1], irOpSymbols[p->op], r[p->src2]);
+        } else {
+            fprintf(out, "%s = %s %s %d", r[p->dst], r[p->src1], irOpSymbols[p->op], p->imm);
+        }
+        break;
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * irDump - Prints a routine's control-flow graph for the `-emit-ir` mode.
+ *
+ * @param f   The routine (its CFG must have been built).
+ * @param out Destination stream.
+ *
+ * Example:
+ * ```
+ * function c1.main
+ * B0: preds: -  succs: B1
+ * c1.main:
+ *     $t1 = $fp + -4
+ *     ...
+ * ```
+ */
+void irDump(IRFunc *f, FILE *out) {
+    fprintf(out, "function %s\n", f->name ? f->name : "(start)");
+    for (IRBlock *b = f->blocks; b; b = b->next) {
+        fprintf(out, "B%d: preds:", b->id);
+        if (!b->npred) {
+            fprintf(out, " -");
+        }
+        for (int i = 0; i < b->npred; ++i) {
+            fprintf(out, " B%d", b->pred[i]->id);
+        }
+        fprintf(out, "  succs:");
+        if (!b->nsucc) {
+            fprintf(out, " -");
+        }
+        for (int i = 0; i < b->nsucc; ++i) {
+            fprintf(out, " B%d", b->succ[i]->id);
+        }
+        fprintf(out, "\n");
+
+        for (IRInstr *p = b->first; p; p = p->next) {
+            dumpInstr(p, out);
+            if (p == b->last) {
+                break;
+            }
+        }
+    }
+    fprintf(out, "\n");
+}
+
+/**
+ * irFreeFunc - Releases a routine with its instructions and blocks.
+ *
+ * @param f The routine.
+ */
+void irFreeFunc(IRFunc *f) {
+    freeBlocks(f);
+    IRInstr *p = f->head;
+    while (p) {
+        IRInstr *next = p->next;
+        free(p->sym);
+        free(p);
+        p = next;
+    }
+    free(f->name);
+    free(f);
+}
@@ -0,0 +1,637 @@
+/**************************************************************************************************
+ * File: loop.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Loop Optimizer**. It runs over the IR instruction list of each
+ *    routine (see ir.h) between two runs of the peephole optimizer, and removes work that the
+ *    body of a loop would otherwise repeat on every iteration.
+ *
+ *    Code generation emits every `while` loop in bottom-tested form: the condition is tested
+ *    once before the loop and again at the bottom of the body, which branches back to the
+ *    label at its top. A loop is therefore the code from such a label to the backward branch
+ *    that targets it, and the code just before the label runs once each time the loop is
+ *    entered, and only if the body runs at least once. That spot is the loop's preheader.
+ *
+ *    1. **Loop-Invariant Code Motion:**
+ *       - An address computation or load whose operands no instruction of the loop changes is
+ *         computed once into a free register in the preheader, and its uses in the body read
+ *         that register instead. Loads must also run on every iteration and must not be
+ *         overwritten by a store of the loop; the memory class of each access (`IRInstr.mem`)
+ *         tells which stores may overlap which loads.
+ *
+ *    2. **Strength Reduction:**
+ *       - A local variable whose only stores in the loop are `i := i + c` is an induction
+ *         variable. An element address `base + (i << 2)` computed from it with an invariant
+ *         base becomes a pointer kept in a free register: set up once in the preheader and
+ *         advanced by `c << 2` after every store of `i`.
+ *
+ *    Loops are processed innermost first, so an outer loop can move the setup code of its
+ *    inner loops further out. Loops that contain a call are left alone, since a call may change
+ *    any field and clobbers the registers the optimizations would keep values in. So are loops
+ *    a profile (`-use-profile`) saw never run, whose setup code would only cost space.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void irLoops(IRFunc *f):**
+ *       - Entry point: optimizes every loop of a routine.
+ *
+ *    2. **void hoistInvariants(IRFunc *f, Loop *l, unsigned used):**
+ *       - Moves loop-invariant computations into the preheader.
+ *
+ *    3. **void reduceStrength(IRFunc *f, Loop *l, unsigned used):**
+ *       - Replaces element address arithmetic on induction variables with pointers.
+ *
+ *    4. **void irColdLoop(int label):**
+ *       - Marks a loop to be left alone.
+ *
+ **************************************************************************************************/
+
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOOP_MAX_POINTERS 4 // Maximum number of strength-reduced pointers per loop
+
+/*
+ * Loop - One loop of a routine: the instructions from `head` to `latch`.
+ */
+typedef struct Loop {
+    IRInstr *head;  // Label at the top of the body
+    IRInstr *latch; // Backward branch to `head` at the bottom of the body
+    int size;       // Number of instructions from `head` to `latch` when the loop was found
+    unsigned regs;  // Registers this loop's preheader and pointers use (bit per R_* number)
+} Loop;
+
+/*
+ * Pointer - A strength-reduced element address: `reg` holds `base + (slot << shift)`, where
+ * `slot` is the `$fp` offset of an induction variable.
+ */
+typedef struct Pointer {
+    int slot, base, shift;
+    int reg;
+} Pointer;
+
+/*
+ * cold_loops - Labels at the top of the loops to leave alone (see irColdLoop).
+ */
+int *cold_loops = NULL;
+int cold_count = 0;
+int cold_cap = 0;
+
+/**
+ * irColdLoop - Marks a loop that never ran, so irLoops leaves it alone.
+ *
+ * @param label The number of the label at the top of its body.
+ */
+void irColdLoop(int label) {
+    if (cold_count == cold_cap) {
+        cold_cap = cold_cap ? cold_cap * 2 : 16;
+        cold_loops = realloc(cold_loops, cold_cap * sizeof(int));
+    }
+    cold_loops[cold_count++] = label;
+}
+
+/**
+ * irClearColdLoops - Forgets the loops marked with irColdLoop, for the next compilation unit.
+ */
+void irClearColdLoops() { cold_count = 0; }
+
+/**
+ * isCold - Reports whether a loop was marked with irColdLoop.
+ *
+ * @param l The loop.
+ */
+int isCold(Loop *l) {
+    for (int i = 0; i < cold_count; ++i) {
+        if (!l->head->sym && l->head->label == cold_loops[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * bySize - Orders loops by size, smallest (innermost) first. Comparison function for qsort.
+ */
+int bySize(const void *a, const void *b) { return ((Loop *)a)->size - ((Loop *)b)->size; }
+
+/**
+ * findLoops - Collects the loops of a routine, innermost first.
+ *
+ * @param f     The routine.
+ * @param count Receives the number of loops.
+ *
+ * @return A malloc'ed array of loops (NULL when there are none).
+ */
+Loop *findLoops(IRFunc *f, int *count) {
+    Loop *loops = NULL;
+    int n = 0;
+    for (IRInstr *p = f->head; p; p = p->next) {
+        if (!irIsBranch(p->op) || p->sym) {
+            continue;
+        }
+        // The branch goes backwards if its label comes before it
+        IRInstr *head = labelOf(f, p), *q = head;
+        int size = 0;
+        for (; q && q != p; q = q->next) {
+            ++size;
+        }
+        if (head && q) {
+            loops = realloc(loops, (n + 1) * sizeof(Loop));
+            loops[n++] = (Loop){head, p, size, 0};
+        }
+    }
+    qsort(loops, n, sizeof(Loop), bySize);
+    *count = n;
+    return loops;
+}
+
+/**
+ * prevCode - Returns the instruction before `p`, skipping comments.
+ *
+ * @param p The instruction.
+ */
+IRInstr *prevCode(IRInstr *p) {
+    for (p = p->prev; p && p->op == IR_COMMENT; p = p->prev)
+        ;
+    return p;
+}
+
+/**
+ * inLoop - Reports whether an instruction belongs to a loop.
+ *
+ * @param l The loop.
+ * @param p The instruction.
+ */
+int inLoop(Loop *l, IRInstr *p) {
+    for (IRInstr *q = l->head; q != l->latch->next; q = q->next) {
+        if (q == p) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * canOptimize - Reports whether a loop has a preheader, is only entered through it and
+ *               contains no call.
+ *
+ * @param f The routine.
+ * @param l The loop.
+ */
+int canOptimize(IRFunc *f, Loop *l) {
+    // Step 1: The code before the label must fall through into it
+    IRInstr *pre = prevCode(l->head);
+    if (!pre || pre->op == IR_J || pre->op == IR_RET || pre->op == IR_EXIT) {
+        return 0;
+    }
+
+    // Step 2: Calls, returns and exits inside the loop rule it out
+    for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+        if (q->op == IR_CALL || q->op == IR_RET || q->op == IR_EXIT) {
+            return 0;
+        }
+    }
+
+    // Step 3: No jump or branch outside the loop may target a label inside it
+    int inside = 0;
+    for (IRInstr *q = f->head; q; q = q->next) {
+        if (q == l->head) {
+            inside = 1;
+        }
+        if (!inside && (q->op == IR_J || irIsBranch(q->op)) && inLoop(l, labelOf(f, q))) {
+            return 0;
+        }
+        if (q == l->latch) {
+            inside = 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * writtenIn - Reports whether any instruction of a loop writes a register.
+ *
+ * @param l   The loop.
+ * @param reg The register.
+ */
+int writtenIn(Loop *l, int reg) {
+    for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+        if (irWrites(q, reg)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * mentions - Reports whether an instruction names a register as an operand.
+ *
+ * @param p   The instruction.
+ * @param reg The register.
+ */
+int mentions(IRInstr *p, int reg) { return p->dst == reg || p->src1 == reg || p->src2 == reg; }
+
+/**
+ * spareReg - Picks a temporary that neither the routine's own code nor the loop uses.
+ *
+ * @param l    The loop.
+ * @param used Registers the routine used before any loop was optimized.
+ *
+ * @return The register, now recorded in `l->regs`, or IR_NOREG if none is left.
+ *
+ * Registers picked for a loop are only live from its preheader to its latch, so two loops
+ * that do not nest may use the same one.
+ */
+int spareReg(Loop *l, unsigned used) {
+    static int pool[] = {R_T4, R_T5, R_T6, R_T7, R_T8, R_T9, R_T3, R_T0};
+    for (int i = 0; i < sizeof(pool) / sizeof(pool[0]); ++i) {
+        int reg = pool[i];
+        if ((used | l->regs) & (1u << reg)) {
+            continue;
+        }
+        IRInstr *q = l->head;
+        while (q != l->latch->next && !mentions(q, reg)) {
+            q = q->next;
+        }
+        if (q == l->latch->next) {
+            l->regs |= 1u << reg;
+            return reg;
+        }
+    }
+    return IR_NOREG;
+}
+
+/**
+ * renameUses - Makes the straight-line code after a definition read another register.
+ *
+ * @param f   The routine.
+ * @param def The instruction defining `reg`.
+ * @param reg The register `def` defines.
+ * @param to  The register holding the same value, which the readers use instead.
+ *
+ * @return 1 if the value `def` gives `reg` is no longer read afterwards, so `def` can go.
+ *
+ * The scan stops where `reg` is overwritten, where control may leave the straight line, or
+ * where `to` is about to change.
+ */
+int renameUses(IRFunc *f, IRInstr *def, int reg, int to) {
+    IRInstr *q;
+    for (q = def->next; q && !irWrites(q, to); q = q->next) {
+        if (irReads(q, reg)) {
+            if (q->src1 == reg) {
+                q->src1 = to;
+            }
+            if (q->src2 == reg) {
+                q->src2 = to;
+            }
+        }
+        if (irWrites(q, reg)) {
+            return 1;
+        }
+        if (!isStraight(q)) {
+            break;
+        }
+    }
+    return q && deadAfter(f, q->prev, reg);
+}
+
+/**
+ * isConditional - Reports whether an instruction of a loop may be skipped by an iteration.
+ *
+ * @param l The loop.
+ * @param p The instruction.
+ *
+ * That is the case when a jump or branch before it in the loop targets a label after it (or
+ * outside the loop).
+ */
+int isConditional(Loop *l, IRInstr *p) {
+    for (IRInstr *q = l->head->next; q != p; q = q->next) {
+        if (q->op != IR_J && !irIsBranch(q->op)) {
+            continue;
+        }
+        IRInstr *t = l->head;
+        while (t != p && !(t->op == IR_LABEL && sameLabel(q, t))) {
+            t = t->next;
+        }
+        if (t == p) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * mayAlias - Reports whether a store may overwrite the word a load reads.
+ *
+ * @param l     The loop both belong to.
+ * @param load  The load.
+ * @param store The store.
+ *
+ * Expression spills are pushed below every local and argument, so a store relative to `$sp`
+ * never reaches a `$fp` slot. Two field or element accesses off the same unchanging base only
+ * meet at the same offset.
+ */
+int mayAlias(Loop *l, IRInstr *load, IRInstr *store) {
+    if (load->mem == IR_MEM_CONST) {
+        return 0;
+    }
+    if (load->mem == IR_MEM_ANY || store->mem == IR_MEM_ANY) {
+        return 1;
+    }
+    if (load->mem != store->mem) {
+        return 0;
+    }
+    if (load->mem == IR_MEM_FRAME && load->src1 == R_FP && store->src2 == R_SP) {
+        return 0;
+    }
+    if (load->src1 == store->src2 && (load->src1 == R_FP || !writtenIn(l, load->src1))) {
+        return load->imm == store->imm;
+    }
+    return 1;
+}
+
+/**
+ * isInvariant - Reports whether an instruction of a loop computes the same value on every
+ *               iteration and may be computed once in the preheader instead.
+ *
+ * @param l The loop.
+ * @param p The instruction.
+ *
+ * Constants are left where they are: they cost one instruction wherever they are loaded, and
+ * keeping them in registers would use up the registers better spent on loads; so do frame
+ * addresses, which the peephole optimizer folds into the offsets of their loads and stores.
+ * Division is left alone so a division by zero still only happens when the program reaches
+ * it.
+ */
+int isInvariant(Loop *l, IRInstr *p) {
+    if (!(p->op == IR_LA || p->op == IR_LW || (p->op >= IR_ADD && p->op <= IR_SRL)) ||
+        p->op == IR_DIV || !irIsTemp(p->dst) || (p->op != IR_LW && p->src1 == R_FP)) {
+        return 0;
+    }
+    if ((p->src1 != IR_NOREG && writtenIn(l, p->src1)) ||
+        (p->src2 != IR_NOREG && writtenIn(l, p->src2))) {
+        return 0;
+    }
+    if (p->op == IR_LW) {
+        if (isConditional(l, p)) {
+            return 0;
+        }
+        for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+            if (q->op == IR_SW && mayAlias(l, p, q)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * sameValue - Reports whether two instructions compute the same value from the same operands.
+ *
+ * @param a First instruction.
+ * @param b Second instruction.
+ */
+int sameValue(IRInstr *a, IRInstr *b) {
+    return a->op == b->op && a->src1 == b->src1 && a->src2 == b->src2 && a->imm == b->imm &&
+           (a->sym == b->sym || (a->sym && b->sym && !strcmp(a->sym, b->sym)));
+}
+
+/**
+ * hoistInvariants - Moves the loop-invariant computations of a loop into its preheader.
+ *
+ * @param f    The routine.
+ * @param l    The loop.
+ * @param used Registers the routine used before any loop was optimized.
+ *
+ * Each invariant computation is copied to the preheader with a free register as its
+ * destination. The straight-line code after the original reads that register instead; the
+ * original is removed if nothing else reads its result, or becomes a move from the register.
+ * Moving one computation can make the ones that use it invariant, so the loop is scanned
+ * until nothing more moves. A computation the preheader already makes reuses its register.
+ */
+void hoistInvariants(IRFunc *f, Loop *l, unsigned used) {
+    IRInstr *hoisted[IR_NUM_REGS];
+    int count = 0;
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        IRInstr *next;
+        for (IRInstr *p = l->head; p != l->latch; p = next) {
+            next = p->next;
+            if (!isInvariant(l, p)) {
+                continue;
+            }
+            int i = 0;
+            while (i < count && !sameValue(hoisted[i], p)) {
+                ++i;
+            }
+            int reg = i < count ? hoisted[i]->dst : spareReg(l, used);
+            if (reg == IR_NOREG) {
+                return;
+            }
+
+            if (i == count) {
+                IRInstr *copy = irNewInstr(p->op, reg, p->src1, p->src2, p->imm, p->sym);
+                copy->mem = p->mem;
+                irInsertBefore(f, copy, l->head);
+                hoisted[count++] = copy;
+            }
+            if (renameUses(f, p, p->dst, reg)) {
+                irRemove(f, p);
+            } else {
+                makeMove(p, p->dst, reg);
+            }
+            changed = 1;
+        }
+    }
+}
+
+/**
+ * isInduction - Reports whether a `$fp` slot is an induction variable of a loop.
+ *
+ * @param l    The loop.
+ * @param slot The `$fp` offset of the slot.
+ *
+ * Every store to the slot in the loop must be the `lw $t, slot($fp); addi $u, $t, c;
+ * sw $u, slot($fp)` of `i := i + c`, and no store of unknown target may hit it.
+ */
+int isInduction(Loop *l, int slot) {
+    int stores = 0;
+    for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+        if (q->op != IR_SW) {
+            continue;
+        }
+        if (q->mem == IR_MEM_ANY || (q->mem == IR_MEM_FRAME && q->src2 != R_FP && q->src2 != R_SP)) {
+            return 0;
+        }
+        if (q->mem != IR_MEM_FRAME || q->src2 != R_FP || q->imm != slot) {
+            continue;
+        }
+        IRInstr *add = prevCode(q), *load = add ? prevCode(add) : NULL;
+        if (!load || add->op != IR_ADD || add->src2 != IR_NOREG || add->dst != q->src1 ||
+            load->op != IR_LW || load->src1 != R_FP || load->imm != slot ||
+            load->dst != add->src1) {
+            return 0;
+        }
+        ++stores;
+    }
+    return stores > 0;
+}
+
+/**
+ * pointerFor - Finds or sets up the pointer register for `base + (slot << shift)`.
+ *
+ * @param f        The routine.
+ * @param l        The loop.
+ * @param used     Registers the routine used before any loop was optimized.
+ * @param pointers The pointers of the loop so far.
+ * @param count    Number of entries in `pointers`; incremented for a new pointer.
+ *
+ * @return The pointer register, or IR_NOREG if no register or pointer slot is left.
+ *
+ * A new pointer is computed in the preheader and advanced after every store of the induction
+ * variable, by the variable's step scaled like the index.
+ */
+int pointerFor(IRFunc *f, Loop *l, unsigned used, Pointer *pointers, int *count, int slot,
+               int base, int shift) {
+    for (int i = 0; i < *count; ++i) {
+        if (pointers[i].slot == slot && pointers[i].base == base && pointers[i].shift == shift) {
+            return pointers[i].reg;
+        }
+    }
+
+    // Step 1: Every step must fit the immediate of the pointer update
+    for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+        if (q->op == IR_SW && q->mem == IR_MEM_FRAME && q->src2 == R_FP && q->imm == slot &&
+            !fitsImm(prevCode(q)->imm * (1 << shift))) {
+            return IR_NOREG;
+        }
+    }
+    int reg = *count < LOOP_MAX_POINTERS ? spareReg(l, used) : IR_NOREG;
+    if (reg == IR_NOREG) {
+        return IR_NOREG;
+    }
+
+    // Step 2: Compute the pointer in the preheader
+    IRInstr *init = irNewInstr(IR_LW, reg, R_FP, IR_NOREG, slot, NULL);
+    init->mem = IR_MEM_FRAME;
+    irInsertBefore(f, init, l->head);
+    irInsertBefore(f, irNewInstr(IR_SLL, reg, reg, IR_NOREG, shift, NULL), l->head);
+    irInsertBefore(f, irNewInstr(IR_ADD, reg, base, reg, 0, NULL), l->head);
+
+    // Step 3: Advance it with the induction variable
+    for (IRInstr *q = l->head; q != l->latch; q = q->next) {
+        if (q->op == IR_SW && q->mem == IR_MEM_FRAME && q->src2 == R_FP && q->imm == slot) {
+            int step = prevCode(q)->imm * (1 << shift);
+            irInsertAfter(f, irNewInstr(IR_ADD, reg, reg, IR_NOREG, step, NULL), q);
+            q = q->next;
+        }
+    }
+
+    pointers[*count] = (Pointer){slot, base, shift, reg};
+    ++*count;
+    return reg;
+}
+
+/**
+ * reduceStrength - Replaces element addresses computed from induction variables with
+ *                  pointers that advance with them.
+ *
+ * @param f    The routine.
+ * @param l    The loop.
+ * @param used Registers the routine used before any loop was optimized.
+ *
+ * The address pattern is `lw $i, slot($fp); [addi $j, $i, d;] sll $k, $j, s;
+ * add $a, $base, $k` with an invariant base, as code generation emits it for `a[i]` and
+ * `a[i + d]`. It becomes `move $a, $p` or `addi $a, $p, d << s` for the pointer `$p`.
+ */
+void reduceStrength(IRFunc *f, Loop *l, unsigned used) {
+    Pointer pointers[LOOP_MAX_POINTERS];
+    int count = 0;
+
+    IRInstr *next;
+    for (IRInstr *p = l->head; p != l->latch; p = next) {
+        next = p->next;
+        if (p->op != IR_LW || p->mem != IR_MEM_FRAME || p->src1 != R_FP) {
+            continue;
+        }
+
+        // Step 1: Match the address pattern
+        IRInstr *offset = nextCode(p), *shift, *add;
+        int index = p->dst, d = 0;
+        if (offset && offset->op == IR_ADD && offset->src1 == index && offset->src2 == IR_NOREG &&
+            (offset->dst == index || deadAfter(f, offset, index))) {
+            d = offset->imm;
+            index = offset->dst;
+            shift = nextCode(offset);
+        } else {
+            offset = NULL;
+            shift = nextCode(p);
+        }
+        if (!shift || shift->op != IR_SLL || shift->src1 != index || shift->src2 != IR_NOREG ||
+            (shift->dst != index && !deadAfter(f, shift, index))) {
+            continue;
+        }
+        add = nextCode(shift);
+        int scaled = shift->dst;
+        if (!add || add->op != IR_ADD || add->src2 == IR_NOREG ||
+            (add->src1 == scaled) == (add->src2 == scaled) ||
+            (add->dst != scaled && !deadAfter(f, add, scaled))) {
+            continue;
+        }
+        int base = add->src1 == scaled ? add->src2 : add->src1;
+        if (writtenIn(l, base) || !fitsImm(d * (1 << shift->imm)) || !isInduction(l, p->imm)) {
+            continue;
+        }
+
+        // Step 2: Replace it with the pointer
+        int reg = pointerFor(f, l, used, pointers, &count, p->imm, base, shift->imm);
+        if (reg == IR_NOREG) {
+            continue;
+        }
+        next = add->next;
+        if (d) {
+            add->src1 = reg;
+            add->src2 = IR_NOREG;
+            add->imm = d * (1 << shift->imm);
+        } else if (renameUses(f, add, add->dst, reg)) {
+            irRemove(f, add);
+        } else {
+            makeMove(add, add->dst, reg);
+        }
+        irRemove(f, shift);
+        if (offset) {
+            irRemove(f, offset);
+        }
+        irRemove(f, p);
+    }
+}
+
+/**
+ * irLoops - Optimizes the loops of a routine.
+ *
+ * @param f The routine. Its basic blocks, if any, must be rebuilt afterwards.
+ */
+void irLoops(IRFunc *f) {
+    unsigned used = 0;
+    for (IRInstr *p = f->head; p; p = p->next) {
+        for (int reg = 0; reg < IR_NUM_REGS; ++reg) {
+            if (mentions(p, reg)) {
+                used |= 1u << reg;
+            }
+        }
+    }
+
+    int count;
+    Loop *loops = findLoops(f, &count);
+    for (int i = 0; i < count; ++i) {
+        if (!isCold(&loops[i]) && canOptimize(f, &loops[i])) {
+            hoistInvariants(f, &loops[i], used);
+            reduceStrength(f, &loops[i], used);
+        }
+    }
+    free(loops);
+}
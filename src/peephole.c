@@ -0,0 +1,643 @@
+/**************************************************************************************************
+ * File: peephole.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Peephole Optimizer**. It runs over the IR instruction list of
+ *    each routine (see ir.h) after code generation has finished the routine and before it is
+ *    lowered to MIPS, rewriting short windows of instructions into cheaper equivalents.
+ *
+ *    The rules live in the `peep_rules` table. Each entry names the operations the window may
+ *    start with and a rewrite function that checks the rest of the window and transforms it.
+ *    Adding a rule means writing one function and one table line; the driver does the rest.
+ *
+ *    The current rules are:
+ *
+ *    1. **Address Folding:**
+ *       - `$t1 = $fp + -4; ...; lw $t0, 0($t1)` becomes `lw $t0, -4($fp)` (likewise `sw`)
+ *         when `$t1` is not needed afterwards.
+ *
+ *    2. **Jump to Next:**
+ *       - A `j` or `beq` to a label that directly follows it is removed.
+ *
+ *    3. **Store/Reload:**
+ *       - `sw $t1, k($b)` followed by `lw $t2, k($b)` reloads what was just stored: the load
+ *         becomes `move $t2, $t1`.
+ *       - A push (`addi $sp, $sp, -4; sw $t1, 0($sp)`) whose slot is popped again
+ *         (`lw $t2, 0($sp); addi $sp, $sp, 4`) by the same straight-line code without any
+ *         other use of `$sp` becomes `move $t2, $t1` at the push.
+ *       - Two stack adjustments in a row (a callee's epilogue and its caller's argument pop,
+ *         once the call is inlined) become one.
+ *
+ *    4. **Move Folding:**
+ *       - `move $r, $r` is removed, as is `move $b, $a` right after `move $a, $b`.
+ *       - An instruction computing `$a` followed by `move $b, $a` computes `$b` directly when
+ *         `$a` is not needed afterwards.
+ *       - `move $a, $b` followed by an instruction reading `$a` lets that instruction read `$b`
+ *         instead, when it is the last reader of `$a` and `$b` is still unchanged.
+ *
+ *    5. **Immediate Operands:**
+ *       - `li $t3, 10; ...; sgt $t1, $t0, $t3` becomes `sgt $t1, $t0, 10` when `$t3` is not
+ *         needed afterwards; likewise for branches (`blt $t0, 10, L_1`). Subtraction of a
+ *         constant becomes `addi` of its negation.
+ *
+ *    6. **Print Merging:**
+ *       - Consecutive prints of constant strings (`print_str S_1; print_str Enter`) become one
+ *         print of a pooled string holding both, so the program makes one syscall for them.
+ *
+ *    Whether a register is "needed afterwards" is decided by scanning forward from the window
+ *    to the first read or write of the register on every path, following fall-through, jumps
+ *    and branches. Each label is visited once, and after a fixed number of labels the scan
+ *    gives up and assumes the register is needed.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void irPeephole(IRFunc *f):**
+ *       - Entry point: applies the rules to a routine until none matches.
+ *
+ *    2. **int deadAfter(IRFunc *f, IRInstr *p, int reg):**
+ *       - Reports whether the value of a register after `p` is never read.
+ *
+ *    3. **IRInstr *nextUse(IRInstr *p, int reg, int keep):**
+ *       - Finds the instruction a window ends at: the next reader of a register.
+ *
+ **************************************************************************************************/
+
+#include "emit.h"
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PEEP_WINDOW 16  // Maximum number of instructions a rule looks ahead
+#define PEEP_LABELS 16  // Maximum number of labels a liveness scan visits
+
+/**
+ * nextCode - Returns the instruction after `p`, skipping comments.
+ *
+ * @param p The instruction.
+ */
+IRInstr *nextCode(IRInstr *p) {
+    for (p = p->next; p && p->op == IR_COMMENT; p = p->next)
+        ;
+    return p;
+}
+
+/**
+ * isStraight - Reports whether control always continues with the next instruction.
+ *
+ * @param p The instruction.
+ *
+ * Labels end a window too: code after them may be reached from elsewhere.
+ */
+int isStraight(IRInstr *p) {
+    switch (p->op) {
+    case IR_LABEL:
+    case IR_J:
+    case IR_CALL:
+    case IR_RET:
+    case IR_EXIT:
+        return 0;
+    default:
+        return !irIsBranch(p->op);
+    }
+}
+
+/**
+ * fitsImm - Reports whether a value fits the 16-bit immediate field of a MIPS instruction.
+ *
+ * @param v The value.
+ */
+int fitsImm(int v) { return v >= -32768 && v <= 32767; }
+
+/**
+ * labelOf - Finds the label instruction a jump or branch refers to.
+ *
+ * @param f      The routine.
+ * @param branch The jump or branch.
+ *
+ * @return The label, or NULL for labels outside the routine.
+ */
+IRInstr *labelOf(IRFunc *f, IRInstr *branch) {
+    for (IRInstr *q = f->head; q; q = q->next) {
+        if (q->op == IR_LABEL && sameLabel(branch, q)) {
+            return q;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * LabelSet - The labels a liveness scan has already visited.
+ */
+typedef struct LabelSet {
+    IRInstr *label[PEEP_LABELS];
+    int count;
+} LabelSet;
+
+/**
+ * deadFrom - Reports whether a register is overwritten before it is read on every path that
+ *            starts at an instruction.
+ *
+ * @param f    The routine.
+ * @param q    The first instruction of the paths.
+ * @param reg  The register.
+ * @param seen The labels already visited; paths through them need no second look.
+ *
+ * Temporaries die at a call or return. Once PEEP_LABELS labels have been visited, or at a jump
+ * out of the routine, the register is conservatively assumed to be live.
+ */
+int deadFrom(IRFunc *f, IRInstr *q, int reg, LabelSet *seen) {
+    for (; q; q = q->next) {
+        if (q->op == IR_LABEL) {
+            int i = 0;
+            while (i < seen->count && seen->label[i] != q) {
+                ++i;
+            }
+            if (i < seen->count) {
+                return 1;
+            }
+            if (seen->count == PEEP_LABELS) {
+                return 0;
+            }
+            seen->label[seen->count++] = q;
+        }
+        if (irReads(q, reg)) {
+            return 0;
+        }
+        if (irWrites(q, reg) || q->op == IR_RET || q->op == IR_EXIT) {
+            return 1;
+        }
+        if (q->op == IR_J || irIsBranch(q->op)) {
+            IRInstr *target = labelOf(f, q);
+            if (!target || !deadFrom(f, target, reg, seen)) {
+                return 0;
+            }
+            if (q->op == IR_J) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * deadAfter - Reports whether the value a register holds after an instruction is never read.
+ *
+ * @param f   The routine.
+ * @param p   The instruction.
+ * @param reg The register.
+ */
+int deadAfter(IRFunc *f, IRInstr *p, int reg) {
+    LabelSet seen = {.count = 0};
+    return deadFrom(f, p->next, reg, &seen);
+}
+
+/**
+ * nextUse - Finds the next instruction after `p` that reads a register, within one window.
+ *
+ * @param p    The instruction that defines the register.
+ * @param reg  The register.
+ * @param keep A register whose value must also stay unchanged until then (or IR_NOREG).
+ *
+ * @return The reader, or NULL if the window ends first, or `reg` or `keep` is overwritten
+ *         before the read.
+ */
+IRInstr *nextUse(IRInstr *p, int reg, int keep) {
+    IRInstr *q = p;
+    for (int n = 0; n < PEEP_WINDOW && (q = q->next); ++n) {
+        if (irReads(q, reg)) {
+            return q;
+        }
+        if (!isStraight(q) || irWrites(q, reg) || irWrites(q, keep)) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * untouched - Reports whether no instruction strictly between `from` and `to` reads or
+ *             writes a register.
+ *
+ * @param from First instruction (excluded).
+ * @param to   Last instruction (excluded).
+ * @param reg  The register.
+ */
+int untouched(IRInstr *from, IRInstr *to, int reg) {
+    for (IRInstr *q = from->next; q != to; q = q->next) {
+        if (irReads(q, reg) || irWrites(q, reg)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * defines - Reports whether an instruction only computes its `dst` register, so the result
+ *           can be redirected to another register.
+ *
+ * @param p The instruction.
+ */
+int defines(IRInstr *p) {
+    switch (p->op) {
+    case IR_LI:
+    case IR_LA:
+    case IR_LW:
+    case IR_MOVE:
+        return 1;
+    default:
+        return p->op >= IR_ADD && p->op <= IR_SRL;
+    }
+}
+
+/**
+ * makeMove - Turns an instruction into `move dst, src` in place.
+ *
+ * @param p   The instruction.
+ * @param dst Destination register.
+ * @param src Source register.
+ */
+void makeMove(IRInstr *p, int dst, int src) {
+    p->op = IR_MOVE;
+    p->dst = dst;
+    p->src1 = src;
+    p->src2 = IR_NOREG;
+    p->imm = 0;
+}
+
+/**
+ * isStackAdjust - Reports whether an instruction is `addi $sp, $sp, delta`.
+ *
+ * @param p     The instruction.
+ * @param delta The adjustment.
+ */
+int isStackAdjust(IRInstr *p, int delta) {
+    return p && p->op == IR_ADD && p->dst == R_SP && p->src1 == R_SP && p->src2 == IR_NOREG &&
+           p->imm == delta;
+}
+
+/* -------------------- Rules -------------------- */
+
+/**
+ * peepAddress - Folds `$a = $b + k` into the offset of the load or store that uses `$a` as
+ *               its base.
+ *
+ * @param f The routine.
+ * @param p The `add` with an immediate operand starting the window.
+ *
+ * Stack pointer adjustments are left alone: folding them would store below `$sp`.
+ */
+int peepAddress(IRFunc *f, IRInstr *p) {
+    int a = p->dst, b = p->src1;
+    if (p->src2 != IR_NOREG || a == R_SP) {
+        return 0;
+    }
+
+    IRInstr *mem = nextUse(p, a, b);
+    if (!mem || !fitsImm(mem->imm + p->imm)) {
+        return 0;
+    }
+    if (mem->op == IR_LW && mem->src1 == a) {
+        if (mem->dst != a && !deadAfter(f, mem, a)) {
+            return 0;
+        }
+        mem->src1 = b;
+    } else if (mem->op == IR_SW && mem->src2 == a && mem->src1 != a) {
+        if (!deadAfter(f, mem, a)) {
+            return 0;
+        }
+        mem->src2 = b;
+    } else {
+        return 0;
+    }
+    mem->imm += p->imm;
+    irRemove(f, p);
+    return 1;
+}
+
+/**
+ * peepJumpNext - Removes a jump or branch to a label that directly follows it.
+ *
+ * @param f The routine.
+ * @param p The `j` or `beq` starting the window.
+ */
+int peepJumpNext(IRFunc *f, IRInstr *p) {
+    for (IRInstr *q = nextCode(p); q && q->op == IR_LABEL; q = nextCode(q)) {
+        if (sameLabel(p, q)) {
+            irRemove(f, p);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * peepReload - Replaces the reload of a word that was just stored with a register move.
+ *
+ * @param f The routine.
+ * @param p The `sw` starting the window.
+ */
+int peepReload(IRFunc *f, IRInstr *p) {
+    IRInstr *q = nextCode(p);
+    if (!q || q->op != IR_LW || q->src1 != p->src2 || q->imm != p->imm) {
+        return 0;
+    }
+    if (q->dst == p->src1) {
+        irRemove(f, q);
+    } else {
+        makeMove(q, q->dst, p->src1);
+    }
+    return 1;
+}
+
+/**
+ * peepPushPop - Keeps a value in a register instead of pushing and popping it.
+ *
+ * @param f The routine.
+ * @param p The `addi $sp, $sp, -4` starting the window.
+ *
+ * The code between the push and the pop must be straight-line, must not use `$sp` and must
+ * neither read nor write the register popped into, which then receives the value at the push.
+ */
+int peepPushPop(IRFunc *f, IRInstr *p) {
+    IRInstr *push = nextCode(p);
+    if (!isStackAdjust(p, -4) || !push || push->op != IR_SW || push->src2 != R_SP ||
+        push->imm != 0) {
+        return 0;
+    }
+
+    IRInstr *q = push;
+    for (int n = 0; n < PEEP_WINDOW && (q = nextCode(q)); ++n) {
+        IRInstr *pop = nextCode(q);
+        if (q->op == IR_LW && q->src1 == R_SP && q->imm == 0 && isStackAdjust(pop, 4)) {
+            if (!untouched(push, q, q->dst)) {
+                return 0;
+            }
+            makeMove(p, q->dst, push->src1);
+            irRemove(f, push);
+            irRemove(f, q);
+            irRemove(f, pop);
+            return 1;
+        }
+        if (!isStraight(q) || irReads(q, R_SP) || irWrites(q, R_SP)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * peepStackMerge - Combines two consecutive adjustments of `$sp`.
+ *
+ * @param f The routine.
+ * @param p The `addi $sp, $sp, k` starting the window.
+ *
+ * A push (`addi $sp, $sp, -4; sw ..., 0($sp)`) stays apart so that "push-pop" can still take it.
+ */
+int peepStackMerge(IRFunc *f, IRInstr *p) {
+    IRInstr *q = nextCode(p);
+    if (!isStackAdjust(p, p->imm) || !isStackAdjust(q, q ? q->imm : 0) || !fitsImm(p->imm + q->imm)) {
+        return 0;
+    }
+    IRInstr *push = nextCode(q);
+    if (q->imm == -4 && push && push->op == IR_SW && push->src2 == R_SP && push->imm == 0) {
+        return 0;
+    }
+    p->imm += q->imm;
+    irRemove(f, q);
+    if (!p->imm) {
+        irRemove(f, p);
+    }
+    return 1;
+}
+
+/**
+ * peepMove - Removes moves that change nothing and folds moves into the instruction that
+ *            computed their source.
+ *
+ * @param f The routine.
+ * @param p The `move` starting the window.
+ */
+int peepMove(IRFunc *f, IRInstr *p) {
+    if (p->dst == p->src1) {
+        irRemove(f, p);
+        return 1;
+    }
+
+    IRInstr *q = nextCode(p);
+    if (q && q->op == IR_MOVE && q->dst == p->src1 && q->src1 == p->dst) {
+        irRemove(f, q); // `move $a, $b; move $b, $a`
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * peepForward - Lets the single reader of a copied register read the original instead.
+ *
+ * @param f The routine.
+ * @param p The `move` starting the window.
+ *
+ * Runtime services set `$v0`/`$a0` before they read their operand, so they keep reading the
+ * copy of those registers.
+ */
+int peepForward(IRFunc *f, IRInstr *p) {
+    int a = p->dst, b = p->src1;
+    IRInstr *q = nextUse(p, a, b);
+    if (!q || (irWrites(q, b) && q->dst != b) || (q->dst != a && !deadAfter(f, q, a))) {
+        return 0;
+    }
+    if (q->src1 == a) {
+        q->src1 = b;
+    }
+    if (q->src2 == a) {
+        q->src2 = b;
+    }
+    irRemove(f, p);
+    return 1;
+}
+
+/**
+ * peepCoalesce - Redirects the result of an instruction to the register it is moved to.
+ *
+ * @param f The routine.
+ * @param p The instruction starting the window.
+ */
+int peepCoalesce(IRFunc *f, IRInstr *p) {
+    if (!defines(p)) {
+        return 0;
+    }
+    IRInstr *mv = nextUse(p, p->dst, IR_NOREG);
+    if (!mv || mv->op != IR_MOVE || mv->src1 != p->dst || !untouched(p, mv, mv->dst) ||
+        !deadAfter(f, mv, p->dst)) {
+        return 0;
+    }
+    p->dst = mv->dst;
+    irRemove(f, mv);
+    return 1;
+}
+
+/**
+ * peepImmediate - Uses a loaded constant as the immediate operand of the operation reading it.
+ *
+ * @param f The routine.
+ * @param p The `li` starting the window.
+ *
+ * A constant first operand is swapped into second place for commutative operations and for
+ * comparisons and branches (which are mirrored). Division by zero is left alone so it still
+ * happens at run time, and a branch on zero compares with `$0` instead.
+ */
+int peepImmediate(IRFunc *f, IRInstr *p) {
+    int k = p->dst;
+    IRInstr *q = nextUse(p, k, IR_NOREG);
+    if (!q || !((q->op >= IR_ADD && q->op <= IR_OR) || irIsBranch(q->op)) ||
+        q->src2 == IR_NOREG || q->src1 == q->src2 || !fitsImm(p->imm)) {
+        return 0;
+    }
+    if (q->dst != k && !deadAfter(f, q, k)) {
+        return 0;
+    }
+
+    if (q->src1 == k) {
+        // Constant first operand: mirror the operation
+        static int mirror[] = {
+            [IR_ADD] = IR_ADD, [IR_MUL] = IR_MUL, [IR_SEQ] = IR_SEQ, [IR_SNE] = IR_SNE,
+            [IR_AND] = IR_AND, [IR_OR] = IR_OR,   [IR_SLT] = IR_SGT, [IR_SGT] = IR_SLT,
+            [IR_SLE] = IR_SGE, [IR_SGE] = IR_SLE, [IR_BEQ] = IR_BEQ, [IR_BNE] = IR_BNE,
+            [IR_BLT] = IR_BGT, [IR_BGT] = IR_BLT, [IR_BLE] = IR_BGE, [IR_BGE] = IR_BLE,
+        };
+        if (!mirror[q->op]) {
+            return 0;
+        }
+        q->op = mirror[q->op];
+        q->src1 = q->src2;
+    }
+    if (q->op == IR_DIV && p->imm == 0) {
+        return 0;
+    }
+    if (irIsBranch(q->op) && p->imm == 0) {
+        q->src2 = R_ZERO;
+        irRemove(f, p);
+        return 1;
+    }
+    q->src2 = IR_NOREG;
+    q->imm = p->imm;
+    if (q->op == IR_SUB && p->imm != -32768) {
+        q->op = IR_ADD;
+        q->imm = -p->imm;
+    }
+    irRemove(f, p);
+    return 1;
+}
+
+/**
+ * printText - Returns the characters a `print_str` prints, or NULL if they are not known.
+ *
+ * @param p The `print_str`.
+ */
+char *printText(IRInstr *p) {
+    int is_word;
+    if (!strcmp(p->sym, "Enter")) {
+        return "\n";
+    }
+    char *text = emitLiteralText(p->sym, &is_word);
+    return text && !is_word ? text : NULL;
+}
+
+/**
+ * peepPrintMerge - Prints a run of consecutive constant strings with one `print_str`.
+ *
+ * @param f The routine.
+ * @param p The `print_str` starting the window.
+ */
+int peepPrintMerge(IRFunc *f, IRInstr *p) {
+    IRInstr *q = nextCode(p);
+    if (!q || q->op != IR_PRINT_STR || !printText(p) || !printText(q)) {
+        return 0;
+    }
+    int len = strlen(printText(p));
+    for (q = nextCode(p); q && q->op == IR_PRINT_STR && printText(q); q = nextCode(q)) {
+        len += strlen(printText(q));
+    }
+    char *text = malloc(len + 1);
+    strcpy(text, printText(p));
+    while ((q = nextCode(p)) && q->op == IR_PRINT_STR && printText(q)) {
+        strcat(text, printText(q));
+        irRemove(f, q);
+    }
+    free(p->sym);
+    p->sym = strdup(emitString(text));
+    free(text);
+    return 1;
+}
+
+/*
+ * PeepRule - One peephole rule: the operation a window starts with and its rewrite.
+ *
+ * The rewrite returns 1 if it changed the instruction list. It may remove the first
+ * instruction of the window and anything after it, but nothing before it.
+ */
+typedef struct PeepRule {
+    char *name;                            // Short name of the rule
+    int first_op, last_op;                 // Range of operations the window may start with
+    int (*rewrite)(IRFunc *f, IRInstr *p); // Checks and rewrites the window starting at p
+} PeepRule;
+
+PeepRule peep_rules[] = {
+    {"push-pop", IR_ADD, IR_ADD, peepPushPop},
+    {"address", IR_ADD, IR_ADD, peepAddress},
+    {"stack-merge", IR_ADD, IR_ADD, peepStackMerge},
+    {"jump-next", IR_J, IR_J, peepJumpNext},
+    {"branch-next", IR_BEQ, IR_BGE, peepJumpNext},
+    {"reload", IR_SW, IR_SW, peepReload},
+    {"move", IR_MOVE, IR_MOVE, peepMove},
+    {"forward", IR_MOVE, IR_MOVE, peepForward},
+    {"immediate", IR_LI, IR_LI, peepImmediate},
+    {"coalesce", IR_LI, IR_SRL, peepCoalesce},
+    {"print-merge", IR_PRINT_STR, IR_PRINT_STR, peepPrintMerge},
+};
+
+/**
+ * applyRules - Tries every rule that may start with the operation of `p`, in table order.
+ *
+ * @param f The routine.
+ * @param p The instruction starting the window.
+ *
+ * @return 1 if a rule changed the instruction list.
+ */
+int applyRules(IRFunc *f, IRInstr *p) {
+    for (int i = 0; i < sizeof(peep_rules) / sizeof(peep_rules[0]); ++i) {
+        PeepRule *rule = &peep_rules[i];
+        if (p->op >= rule->first_op && p->op <= rule->last_op && rule->rewrite(f, p)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * irPeephole - Applies the peephole rules to a routine until none of them matches.
+ *
+ * @param f The routine. Its basic blocks, if any, must be rebuilt afterwards.
+ *
+ * After a rewrite the scan resumes at the instruction before the window, since the rewrite
+ * may have completed a pattern that starts there.
+ */
+void irPeephole(IRFunc *f) {
+    int changed = 1;
+    while (changed) {
+        // Patterns completed further back than one instruction are picked up by the next sweep
+        changed = 0;
+        IRInstr *p = f->head;
+        while (p) {
+            IRInstr *prev = p->prev;
+            if (applyRules(f, p)) {
+                changed = 1;
+                p = prev ? prev : f->head;
+            } else {
+                p = p->next;
+            }
+        }
+    }
+}
@@ -0,0 +1,195 @@
+/**************************************************************************************************
+ * File: profile.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements **Execution Profiles**: counting how often the methods and loops of
+ *    a program run under SPIM (`-profile`), and reading those counts back into a later
+ *    compilation (`-use-profile FILE`).
+ *
+ *    1. **Counters:**
+ *       - The code generator registers one counter per method, incremented on entry, and one
+ *         per `while` loop, incremented at the top of every iteration. Counters are named
+ *         after the method's label, loops as `Class.method/loopN` with the loops of a method
+ *         numbered in source order, so the names survive edits in other methods.
+ *       - The counters are the words of the table `prof.counts` in the `.data` section. Each
+ *         increment is one `IR_COUNT` instruction.
+ *
+ *    2. **Report:**
+ *       - When `main` returns, the start-up routine prints one line per counter:
+ *         `profile <name> <count>`. The lines follow the program's own output and a newline
+ *         (which may leave an empty line), through the same (possibly buffered) printing.
+ *
+ *    3. **Feedback:**
+ *       - `-use-profile FILE` reads the `profile` lines of a saved SPIM output and ignores all
+ *         other lines. The code generator then asks for the count of each routine and loop;
+ *         a name the profile does not mention has no count.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **int profileCounter(char *name):**
+ *       - Registers a counter and returns its offset in `prof.counts`.
+ *
+ *    2. **void profileReport():**
+ *       - Emits the counter table and the IR that prints it.
+ *
+ *    3. **int profileLoad(char *path) / int profileCount(char *name):**
+ *       - Read a profile, and look a count up in it.
+ *
+ **************************************************************************************************/
+
+#include "emit.h"
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_LINE 1024 // Longest line of a profile that is read in one piece
+#define PROFILE_HOT 100   // A count is hot if it is at least 1/PROFILE_HOT of the largest one...
+#define PROFILE_MIN_HOT 16 // ...and at least PROFILE_MIN_HOT, so code run a few times stays cold
+
+/*
+ * ProfileEntry - One count read from a profile.
+ */
+typedef struct ProfileEntry {
+    char *name;
+    int count;
+} ProfileEntry;
+
+/*
+ * ProfileState - The counters of the program being compiled and the profile being used.
+ */
+typedef struct ProfileState {
+    char **counters;       // Name of each counter, by its position in `prof.counts`
+    int count;             // Number of counters
+    int cap;               // Number of slots of `counters`
+    ProfileEntry *entries; // Counts read by `profileLoad`, sorted by name
+    int entry_count;       // Number of entries
+    int max;               // Largest count read
+} ProfileState;
+
+ProfileState profile_state = {0};
+
+/**
+ * profileCounter - Registers a counter.
+ *
+ * @param name The routine label or loop name it counts.
+ *
+ * @return Its byte offset in the `prof.counts` table, for `IR_COUNT`.
+ */
+int profileCounter(char *name) {
+    ProfileState *s = &profile_state;
+    if (s->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->counters = realloc(s->counters, s->cap * sizeof(char *));
+    }
+    s->counters[s->count] = strdup(name);
+    return 4 * s->count++;
+}
+
+/**
+ * profileReset - Forgets the counters of the previous compilation unit of a batch. The
+ *                profile read by `profileLoad` stays.
+ */
+void profileReset() {
+    ProfileState *s = &profile_state;
+    for (int i = 0; i < s->count; ++i) {
+        free(s->counters[i]);
+    }
+    s->count = 0;
+}
+
+/**
+ * profileReport - Emits the counter table and the code that prints it.
+ *
+ * Called in the start-up routine after `main` returns. A newline ends the program's last
+ * line, then each line is a pooled string `profile <name> ` followed by the count and a
+ * newline.
+ */
+void profileReport() {
+    ProfileState *s = &profile_state;
+    if (!s->count) {
+        return;
+    }
+    emitData(".align 2\n");
+    emitData("prof.counts: .space %d\n", 4 * s->count);
+
+    irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, "Enter");
+    irLa(R_T0, "prof.counts");
+    for (int i = 0; i < s->count; ++i) {
+        char *text = malloc(strlen(s->counters[i]) + 16);
+        sprintf(text, "profile %s ", s->counters[i]);
+        irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, emitString(text));
+        irLoad(R_T1, 4 * i, R_T0);
+        irEmit(IR_PRINT_INT, IR_NOREG, R_T1, IR_NOREG, 0, NULL);
+        irEmit(IR_PRINT_STR, IR_NOREG, IR_NOREG, IR_NOREG, 0, "Enter");
+        free(text);
+    }
+}
+
+/**
+ * byName - Orders profile entries by name. Comparison function for qsort and bsearch.
+ */
+int byName(const void *a, const void *b) {
+    return strcmp(((ProfileEntry *)a)->name, ((ProfileEntry *)b)->name);
+}
+
+/**
+ * profileLoad - Reads the counts of a profile.
+ *
+ * @param path A file holding the output of a program compiled with `-profile`.
+ *
+ * @return 1 on success, 0 if the file cannot be read.
+ */
+int profileLoad(char *path) {
+    ProfileState *s = &profile_state;
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        return 0;
+    }
+
+    char line[PROFILE_LINE], name[PROFILE_LINE];
+    int count, cap = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (sscanf(line, "profile %s %d", name, &count) != 2) {
+            continue;
+        }
+        if (s->entry_count == cap) {
+            cap = cap ? cap * 2 : 64;
+            s->entries = realloc(s->entries, cap * sizeof(ProfileEntry));
+        }
+        s->entries[s->entry_count++] = (ProfileEntry){strdup(name), count};
+        if (count > s->max) {
+            s->max = count;
+        }
+    }
+    fclose(in);
+    qsort(s->entries, s->entry_count, sizeof(ProfileEntry), byName);
+    return 1;
+}
+
+/**
+ * profileCount - Looks up how often a routine or loop ran.
+ *
+ * @param name The routine label or loop name, or NULL.
+ *
+ * @return The count, or -1 if the profile has none for the name.
+ */
+int profileCount(char *name) {
+    ProfileState *s = &profile_state;
+    ProfileEntry key = {name, 0};
+    ProfileEntry *e = name && s->entry_count
+                          ? bsearch(&key, s->entries, s->entry_count, sizeof(ProfileEntry), byName)
+                          : NULL;
+    return e ? e->count : -1;
+}
+
+/**
+ * profileHot - Reports whether a routine or loop ran often, compared with the hottest one.
+ *
+ * @param name The routine label or loop name, or NULL.
+ */
+int profileHot(char *name) {
+    int count = profileCount(name);
+    return count >= PROFILE_MIN_HOT && (long long)count * PROFILE_HOT >= profile_state.max;
+}
@@ -0,0 +1,154 @@
+/**************************************************************************************************
+ * File: reach.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Reachability** pass. It runs after constant folding and before
+ *    code generation, and marks every method that the program can call with `REACH_ATTR` in
+ *    the symbol table. The code generator emits no code for the other methods.
+ *
+ *    The program starts in the start-up routine, which runs the `.init` routine of every
+ *    class and then calls `main`. The roots are therefore the methods named `main` and the
+ *    methods called from field initializers. From there the pass follows the call graph: a
+ *    method is reachable if the body of a reachable method names it. Any `STNode` of a
+ *    method counts as a call, whether it is a plain call or a call through an object.
+ *
+ *    Folding runs first, so calls inside branches removed as dead do not keep their targets
+ *    alive.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void markReachable(tree node):**
+ *       - Entry point: marks the reachable methods of the whole program.
+ *
+ **************************************************************************************************/
+
+#include "symbol_table.h"
+#include "tree.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ReachState - The method bodies of the program and the methods waiting to be scanned.
+ */
+typedef struct ReachState {
+    tree *body; // Body of each method, indexed by its symbol table index
+    int cap;    // Number of slots of `body`
+    int *work;  // Reachable methods whose bodies are not scanned yet
+    int count;  // Number of entries of `work`
+    int size;   // Number of slots of `work`
+} ReachState;
+
+/**
+ * isMethod - Reports whether a symbol table entry is a method.
+ *
+ * @param id The symbol table index.
+ */
+int isMethod(int id) {
+    return IsAttr(id, KIND_ATTR) && (GetAttr(id, KIND_ATTR) == FUNC || GetAttr(id, KIND_ATTR) == PROCE);
+}
+
+/**
+ * reachMethod - Marks a method reachable and queues its body for scanning.
+ *
+ * @param s  The pass state.
+ * @param id The method's symbol table index.
+ */
+void reachMethod(ReachState *s, int id) {
+    if (IsAttr(id, REACH_ATTR)) {
+        return;
+    }
+    SetAttr(id, REACH_ATTR, 1);
+    if (s->count == s->size) {
+        s->size = s->size ? s->size * 2 : 64;
+        s->work = realloc(s->work, s->size * sizeof(int));
+    }
+    s->work[s->count++] = id;
+}
+
+/**
+ * scanCalls - Marks every method named in a subtree reachable.
+ *
+ * @param s        The pass state.
+ * @param treenode The subtree: a method body or a field initializer.
+ */
+void scanCalls(ReachState *s, tree treenode) {
+    TreeStack pending; // Subtrees still to scan; statement lists are long spines
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode)) {
+            continue;
+        }
+        if (NodeKind(treenode) == STNode) {
+            if (isMethod(IntVal(treenode))) {
+                reachMethod(s, IntVal(treenode));
+            }
+            continue;
+        }
+        if (NodeKind(treenode) != EXPRNode) {
+            continue;
+        }
+        PushTree(&pending, RightChild(treenode));
+        PushTree(&pending, LeftChild(treenode));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * collectMethods - Records the body of every method and marks the roots reachable.
+ *
+ * @param s        The pass state.
+ * @param treenode A subtree of the program outside any method.
+ *
+ * Code outside methods belongs to field initializers, which the start-up routine runs, so
+ * the methods it names are roots just like `main`.
+ */
+void collectMethods(ReachState *s, tree treenode) {
+    TreeStack pending; // Subtrees still to walk; class bodies and field lists are long spines
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode) || NodeKind(treenode) != EXPRNode) {
+            scanCalls(s, treenode);
+            continue;
+        }
+        if (NodeOp(treenode) != MethodOp) {
+            PushTree(&pending, RightChild(treenode));
+            PushTree(&pending, LeftChild(treenode));
+            continue;
+        }
+        int id = IntVal(LeftChild(LeftChild(treenode)));
+        if (id >= s->cap) {
+            int cap = s->cap;
+            s->cap = id * 2 + 64;
+            s->body = realloc(s->body, s->cap * sizeof(tree));
+            memset(s->body + cap, 0, (s->cap - cap) * sizeof(tree));
+        }
+        s->body[id] = RightChild(treenode);
+        if (!strcmp(getname(GetAttr(id, NAME_ATTR)), "main")) {
+            reachMethod(s, id);
+        }
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * markReachable - Marks the methods the program can call with `REACH_ATTR`.
+ *
+ * @param treenode The root of the syntax tree (`ProgramOp`), after folding.
+ */
+void markReachable(tree treenode) {
+    ReachState s = {NULL, 0, NULL, 0, 0};
+    collectMethods(&s, treenode);
+    while (s.count) {
+        int id = s.work[--s.count];
+        if (id < s.cap && s.body[id]) { // Predefined methods such as `println` have no body
+            scanCalls(&s, s.body[id]);
+        }
+    }
+    free(s.body);
+    free(s.work);
+}
@@ -49,7 +49,7 @@
  * Major Functions:
  *
  *    1. **void MkST(tree node):**
- *       - Recursively traverses the AST and delegates semantic checks to specialized functions.
+ *       - Traverses the AST and delegates semantic checks to specialized functions.
  *       - Handles nodes like class definitions, method declarations, variable declarations, etc.
  *
  *    2. **void declop(tree node):**
@@ -347,7 +347,7 @@ void classdefop(tree node) {
      * - The **right child** is updated to point to the symbol table entry (`STNode`),
      *   linking the syntax tree to the symbol table for future reference.
      */
-    free(child);
+    FreeNode(child);
     SetRightChild(node, MakeLeaf(STNode, nSymInd)); // Link class to symbol table
 
     /**
@@ -522,7 +522,7 @@ void methodop(tree node) {
      * - Free the original method name node.
      * - Replace it with a symbol table node (`STNode`) that links to the method's symbol table entry.
      */
-    free(LeftChild(child));                         // Free the old name node
+    FreeNode(LeftChild(child));                     // Free the old name node
     SetLeftChild(child, MakeLeaf(STNode, nSymInd)); // Link to the symbol table entry
 
     /**
@@ -673,7 +673,7 @@ void declop(tree node) {
         SetAttr(nSymInd, TYPE_ATTR, (int)typenode);     /* Set type attribute */
 
         /* Step 5: Replace the IDNode with an STNode in the syntax tree */
-        free(LeftChild(child1));                         /* Free the old IDNode */
+        FreeNode(LeftChild(child1));                     /* Free the old IDNode */
         SetLeftChild(child1, MakeLeaf(STNode, nSymInd)); /* Link to the symbol table */
 
         /* Step 6: Handle the type (scalar or array) */
@@ -937,7 +937,7 @@ void specop(tree node) {
          * - Free the original **IDNode** to prevent memory leaks.
          * - Replace it with an **STNode** that links to the parameter's symbol table entry.
          */
-        free(LeftChild(child1));                         /* Free the old parameter name node */
+        FreeNode(LeftChild(child1));                     /* Free the old parameter name node */
         SetLeftChild(child1, MakeLeaf(STNode, nSymInd)); /* Link parameter to the symbol table */
 
         /**
@@ -1087,7 +1087,7 @@ void typeidop(tree node) {
             nSymInd = LookUp(IntVal(lchild));
 
             /* Free the original left child (IDNode) after lookup */
-            free(lchild);
+            FreeNode(lchild);
 
             /* Replace the left child with a symbol table node (STNode) referencing the type */
             SetLeftChild(rchild, MakeLeaf(STNode, nSymInd));
@@ -1267,7 +1267,7 @@ void varop(tree node, int declop) {
     /* Step 2: Symbol Table Lookup */
     if ((nSymInd = LookUp(IntVal(lchild)))) {
         /* Found in the symbol table, replace IDNode with STNode */
-        // free(lchild);
+        // FreeNode(lchild);
         SetLeftChild(node, MakeLeaf(STNode, nSymInd));
     } else {
         /* Not found, return (undeclared variable) */
@@ -1373,7 +1373,7 @@ void varop(tree node, int declop) {
                  * - Terminate the program with `exit(1)` to stop further processing.
                  */
                 printf("method %s members cannot be accessed\n", getname(IntVal(lchild)));
-                free(lchild);
+                FreeNode(lchild);
                 exit(1);
             }
             break;
@@ -1430,8 +1430,9 @@ void varop(tree node, int declop) {
                          * - Replace the **IDNode** of the field with a **STNode** linked to the symbol table entry.
                          * - This allows the compiler to reference the field's declaration directly.
                          */
-                        free(LeftChild(fld_indop));
+                        FreeNode(LeftChild(fld_indop));
                         SetLeftChild(fld_indop, MakeLeaf(STNode, i));
+                        SetAttr(i, USED_ATTR, true); // The field is referenced through an object
                         found = true;
 
                         /**
@@ -1831,7 +1832,7 @@ void routinecallop(tree node) {
 /**
  * MkST(): Builds the Symbol Table by Traversing the Syntax Tree.
  * --------------------------------------------------------------
- * This function recursively traverses the syntax tree and performs semantic analysis
+ * This function traverses the syntax tree and performs semantic analysis
  * by handling different kinds of nodes. It processes declarations, class definitions,
  * methods, and other constructs, updating the symbol table as needed.
  *
@@ -1842,11 +1843,24 @@ void routinecallop(tree node) {
  *   1. Checks if the node is null.
  *   2. Determines the node's operation type using `NodeOp()`.
  *   3. Calls the corresponding handler function for each operation type.
- *   4. Recursively processes the left and right child nodes for non-special cases.
+ *   4. Processes the left and then the right child nodes for non-special cases.
+ *
+ * The children of non-special nodes are kept on an explicit stack (`TreeStack`) instead of
+ * being processed by recursive calls, because statement and declaration lists are long
+ * spines of such nodes. The handlers only rewrite their own subtree, so the right child of
+ * a node can be pushed before its left child is processed.
  */
 void MkST(tree treenode) {
-    /* Step 1: Check if the current node is null. If it is, do nothing. */
-    if (!IsNull(treenode)) {
+    TreeStack pending; /* Subtrees still to process, the next one on top */
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+
+    while (pending.top) {
+        treenode = PopTree(&pending);
+
+        /* Step 1: Check if the current node is null. If it is, do nothing. */
+        if (IsNull(treenode))
+            continue;
 
         /* Step 2: Identify the operation type of the current node */
         switch (NodeOp(treenode)) {
@@ -1886,12 +1900,12 @@ void MkST(tree treenode) {
             routinecallop(treenode); // Process function/procedure calls
             break;
 
-        /* Step 10: Default case—recursively process child nodes */
+        /* Step 10: Default case—process the left child, then the right child */
         default:
-            /* If the node doesn't match any specific case, recursively process its children */
-            MkST((tree)LeftChild(treenode));  // Process the left child
-            MkST((tree)RightChild(treenode)); // Process the right child
+            PushTree(&pending, (tree)RightChild(treenode)); /* Processed second */
+            PushTree(&pending, (tree)LeftChild(treenode));  /* Processed first */
             break;
         }
     }
+    FreeTreeStack(&pending);
 }
\ No newline at end of file
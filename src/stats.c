@@ -0,0 +1,176 @@
+/**************************************************************************************************
+ * File: stats.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **Compilation Statistics** of `--stats`. The driver and the code
+ *    generator report what they built through the functions below; nothing is counted unless
+ *    the option is given. At the end, `statsPrint` writes one line per figure to stderr:
+ *
+ *    1. **Syntax Tree:**
+ *       - The number of nodes of the parsed program and their memory, then the count of each
+ *         operator (`NodeOp`) and leaf kind that occurs.
+ *
+ *    2. **Tables:**
+ *       - Symbol table entries against its capacity, attributes set, and the deepest the scope
+ *         stack got during semantic analysis.
+ *       - String table occupancy: distinct identifiers and strings, hash slots, and the bytes
+ *         of text stored against the bytes reserved.
+ *
+ *    3. **Code:**
+ *       - The number of MIPS instructions emitted for each routine, in emission order, and in
+ *         total. Classes replayed from the compilation cache emit no routines of their own.
+ *
+ *    4. **Memory:**
+ *       - The peak resident set size of the compiler.
+ *
+ *    Each line starts with `stats` and the name of its group, so scripts can pick figures out
+ *    with `awk` the same way as the `phase` lines of `--time-report`.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void statsTree(tree node):**
+ *       - Counts the nodes of the syntax tree by operator and leaf kind.
+ *
+ *    2. **void statsRoutine(char *name, int instructions):**
+ *       - Records the instructions emitted for one routine.
+ *
+ *    3. **void statsPrint(FILE *out):**
+ *       - Writes all figures.
+ *
+ **************************************************************************************************/
+
+#include "symbol_table.h"
+#include "tree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+extern char *opnodenames[];
+extern int st_top, st_cap, *st_attr_set, stack_peak;
+void string_tbl_usage(int *count, int *slots, int *used, int *reserved);
+
+/*
+ * leaf_names - Names of the leaf kinds, indexed by `NodeKind - IDNode`.
+ */
+char *leaf_names[] = {"IDNode",    "NUMNode",      "CHARNode",  "STRINGNode",   "DUMMYNode",
+                      "EXPRNode",  "INTEGERTNode", "CHARTNode", "BOOLEANTNode", "STNode"};
+
+/*
+ * StatsState - Everything counted so far.
+ */
+typedef struct StatsState {
+    int nodes;                          // Nodes of the syntax tree
+    int ops[ShrOp - ProgramOp + 1];     // Operator nodes, by `NodeOp - ProgramOp`
+    int leaves[STNode - IDNode + 1];    // Other nodes, by `NodeKind - IDNode`
+    char **routines;                    // Label of each routine emitted
+    int *instructions;                  // Instructions emitted for each routine
+    int count;                          // Number of routines
+    int cap;                            // Number of slots of `routines` and `instructions`
+} StatsState;
+
+StatsState stats_state = {0};
+
+/**
+ * statsTree - Counts the nodes of a syntax tree by operator and leaf kind.
+ *
+ * @param treenode The root of the tree.
+ *
+ * Every `DUMMYNode` is the same shared node, so each one in the tree counts, but not as memory.
+ */
+void statsTree(tree treenode) {
+    TreeStack pending; // Subtrees still to count
+    InitTreeStack(&pending);
+    PushTree(&pending, treenode);
+    while (pending.top) {
+        treenode = PopTree(&pending);
+        if (IsNull(treenode)) {
+            stats_state.leaves[DUMMYNode - IDNode]++;
+            continue;
+        }
+        stats_state.nodes++;
+        if (NodeKind(treenode) != EXPRNode) {
+            stats_state.leaves[NodeKind(treenode) - IDNode]++;
+            continue;
+        }
+        stats_state.ops[NodeOp(treenode) - ProgramOp]++;
+        PushTree(&pending, RightChild(treenode));
+        PushTree(&pending, LeftChild(treenode));
+    }
+    FreeTreeStack(&pending);
+}
+
+/**
+ * statsReset - Forgets the counts of the previous compilation unit of a batch.
+ */
+void statsReset() {
+    StatsState *s = &stats_state;
+    for (int i = 0; i < s->count; ++i) {
+        free(s->routines[i]);
+    }
+    *s = (StatsState){.routines = s->routines, .instructions = s->instructions, .cap = s->cap};
+}
+
+/**
+ * statsRoutine - Records the instructions emitted for one routine.
+ *
+ * @param name         The routine's label, or NULL for the start-up jump.
+ * @param instructions The number of MIPS instructions emitted for it.
+ */
+void statsRoutine(char *name, int instructions) {
+    StatsState *s = &stats_state;
+    if (s->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->routines = realloc(s->routines, s->cap * sizeof(char *));
+        s->instructions = realloc(s->instructions, s->cap * sizeof(int));
+    }
+    s->routines[s->count] = strdup(name ? name : "(start)");
+    s->instructions[s->count++] = instructions;
+}
+
+/**
+ * statsPrint - Writes every figure, one per line.
+ *
+ * @param out The stream, normally stderr.
+ */
+void statsPrint(FILE *out) {
+    StatsState *s = &stats_state;
+
+    // Step 1: The syntax tree
+    fprintf(out, "stats ast nodes %d bytes %d\n", s->nodes, s->nodes * (int)sizeof(ILTree));
+    for (int i = 0; i <= ShrOp - ProgramOp; ++i) {
+        if (s->ops[i]) {
+            fprintf(out, "stats ast %-14s %d\n", opnodenames[i], s->ops[i]);
+        }
+    }
+    for (int i = 0; i <= STNode - IDNode; ++i) {
+        if (s->leaves[i]) {
+            fprintf(out, "stats ast %-14s %d\n", leaf_names[i], s->leaves[i]);
+        }
+    }
+
+    // Step 2: The symbol and string tables
+    int attrs = 0;
+    for (int i = 1; i <= st_top; ++i) {
+        attrs += __builtin_popcount(st_attr_set[i]);
+    }
+    fprintf(out, "stats symtab entries %d capacity %d attributes %d stack-peak %d\n", st_top, st_cap,
+            attrs, stack_peak);
+    int count, slots, used, reserved;
+    string_tbl_usage(&count, &slots, &used, &reserved);
+    fprintf(out, "stats strings entries %d slots %d bytes %d reserved %d\n", count, slots, used, reserved);
+
+    // Step 3: The code of each routine
+    int total = 0;
+    for (int i = 0; i < s->count; ++i) {
+        fprintf(out, "stats code %-24s %d\n", s->routines[i], s->instructions[i]);
+        total += s->instructions[i];
+    }
+    fprintf(out, "stats code routines %d instructions %d\n", s->count, total);
+
+    // Step 4: Memory
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(out, "stats memory peak-rss %ld KB\n", usage.ru_maxrss);
+}
@@ -5,71 +5,81 @@
  *                                                             *
  * Key Components:                                             *
  *   1. **Hash Table (`hash_tbl`)**:                           *
- *      - Stores metadata about tokens using the PJW hash.     *
- *      - Handles collisions using separate chaining.          *
+ *      - Stores metadata about tokens inline in one array     *
+ *        of slots (open addressing, linear probing).          *
+ *      - Doubles in size whenever it becomes half full.       *
  *                                                             *
- *   2. **String Table (`strg_tbl`)**:                         *
+ *   2. **String Table (`str_chunks`)**:                       *
  *      - Stores the actual text of identifiers and strings.   *
- *      - Uses a continuous character array with separators.   *
+ *      - Text is packed into chunks of `STR_CHUNK_LEN` bytes  *
+ *        with separators; new chunks are added on demand.     *
+ *      - A string index `i` lives in chunk                    *
+ *        `i >> STR_CHUNK_BITS`, so `str_at(i)` is O(1).       *
  *                                                             *
- *   3. **Hash Function (`hashpjw`)**:                         *
- *      - Computes hash values using the Peter J. Weinberger   *
- *        (PJW) hashing algorithm for even distribution.       *
+ *   3. **Hash Function (`hashfnv`)**:                         *
+ *      - Computes hash values using the 32-bit FNV-1a         *
+ *        algorithm (Fowler/Noll/Vo) for even distribution.    *
  *                                                             *
  *   4. **Insertion (`install_id`)**:                          *
  *      - Inserts tokens into the hash table and string table. *
  *      - Prevents duplicates and manages escape sequences.    *
+ *      - Looks text without escapes up in the scanner's       *
+ *        buffer and copies it only if it is new.              *
  *                                                             *
- * Example: Hashing and Handling Collision for Strings "cat"   *
- *          and "bat" (TBL_LEN = 101)                          *
+ * Example: Hashing and Handling Collision for Strings "bat"   *
+ *          and "rat" (8 slots)                                *
  * ----------------------------------------------------------- *
  * Step-by-step demonstration of hash collision handling:      *
  *                                                             *
- *  Inserting "cat":                                           *
+ *  Inserting "bat":                                           *
  *  ----------------                                           *
- *  - Compute hash: `"cat"` → hashpjw("cat") → index `5`       *
- *  - `hash_tbl[5]` is **empty**, so create a new entry:       *
+ *  - Compute hash: `"bat"` → hashfnv("bat") & 7 → slot `0`    *
+ *  - `hash_tbl[0]` is **empty**, so fill it in place:         *
  *      id = IDnum                                             *
  *      len = 3                                                *
- *      index = 0 (start in `strg_tbl`)                        *
- *  - Store `"cat"` in `strg_tbl`:                             *
- *      strg_tbl = ['c', 'a', 't', 0, ...]                     *
+ *      index = 0 (start in the string table)                  *
+ *  - Store `"bat"` in the string table:                       *
+ *      chunk 0 = ['b', 'a', 't', 0, ...]                      *
  *                                                             *
- *  Inserting "bat" (Collision Occurs):                        *
+ *  Inserting "rat" (Collision Occurs):                        *
  *  -----------------------------------                        *
- *  - Compute hash: `"bat"` → hashpjw("bat") → index `5`       *
- *  - `hash_tbl[5]` already contains `"cat"` → **collision**   *
- *  - Create a new `hash_ele` entry for `"bat"`:               *
+ *  - Compute hash: `"rat"` → hashfnv("rat") & 7 → slot `0`    *
+ *  - `hash_tbl[0]` already contains `"bat"` → **collision**   *
+ *  - **Probing**: try the next slot, `hash_tbl[1]`, which is  *
+ *    empty, so fill it in place:                              *
  *      id = IDnum                                             *
  *      len = 3                                                *
- *      index = 4 (next available in `strg_tbl`)               *
- *  - Store `"bat"` in `strg_tbl`:                             *
- *      strg_tbl = ['c', 'a', 't', 0, 'b', 'a', 't', 0, ...]   *
- *  - **Chaining**: Link `"bat"` to the existing `"cat"` node: *
+ *      index = 4 (next available in the string table)         *
+ *  - Store `"rat"` in the string table:                       *
+ *      chunk 0 = ['b', 'a', 't', 0, 'r', 'a', 't', 0, ...]    *
  *                                                             *
- *      hash_tbl[5] → [cat | index: 0] → [bat | index: 4] → NULL *
+ *      hash_tbl[0] = [bat | index: 0]                         *
+ *      hash_tbl[1] = [rat | index: 4]                         *
  *                                                             *
  *  **Lookup Process:**                                        *
  *  -------------------                                        *
- *  - Searching for `"bat"`:                                   *
- *      1. Compute hash → index `5`                            *
- *      2. Check first node → `"cat"` ≠ `"bat"`                *
- *      3. Follow `next` pointer → `"bat"` matches → found!    *
+ *  - Searching for `"rat"`:                                   *
+ *      1. Compute hash → slot `0`                             *
+ *      2. Check slot 0 → `"bat"` ≠ `"rat"`                    *
+ *      3. Check slot 1 → `"rat"` matches → found!             *
+ *  - A search stops at the first empty slot: the string is    *
+ *    not in the table, and that slot is where it would go.    *
  *                                                             *
  *  **Result:**                                                *
- *  - Both `"cat"` and `"bat"` coexist in the same bucket.     *
- *  - **Chaining** ensures both are accessible despite collision. *
+ *  - Both `"bat"` and `"rat"` coexist despite the collision.  *
+ *  - Keeping the table at most half full keeps probe          *
+ *    sequences short, so lookups stay O(1) on large inputs.   *
  ***************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define TBL_LEN 101 /* Length of the hash table used for storing identifiers and strings. \
-                     * A prime number is chosen to reduce hash collisions. */
+#define HASH_INIT_SIZE 1024 /* Initial number of slots in the hash table. \
+                             * Must be a power of two; the table doubles when half full. */
 
-#define STRTBL_LEN 3001 /* Length of the string table for storing actual text of identifiers \
-                         * and string constants. A larger prime number reduces overflow risk. */
+#define STR_CHUNK_BITS 16                   /* log2 of the string table chunk size. */
+#define STR_CHUNK_LEN (1 << STR_CHUNK_BITS) /* Bytes per string table chunk (64 KiB). */
 
 #define STR_SPRTR 0 /* String separator used in the string table to mark the end of each entry. \
                      * Helps distinguish between different strings stored consecutively. */
@@ -81,160 +91,309 @@ extern int yyleng;
 extern long yylval;
 
 /**
- * Structure representing an entry in the hash table.
+ * Structure representing a slot in the hash table.
  *
  * Used to store identifiers or string constants along with their metadata.
+ * A slot whose `index` is -1 is empty.
  */
 struct hash_ele {
-    int id;                // Token ID (e.g., ICONSTnum for constants or IDnum for identifiers)
-    int len;               // Length of the token (number of characters)
-    int index;             // Starting index in the string table where the token is stored
-    struct hash_ele *next; // Pointer to the next entry in case of a hash collision (chaining)
+    unsigned hash; // Full FNV-1a hash of the text, kept so the table can grow without rehashing
+    int id;        // Token ID (e.g., ICONSTnum for constants or IDnum for identifiers)
+    int len;       // Length of the stored text (after escape sequences are decoded)
+    int index;     // Starting index in the string table where the token is stored
 };
 
 /**
  * Hash table for storing identifiers and string constants.
  *
- * The table uses separate chaining to handle collisions.
+ * `hash_cap` is a power of two, so a hash is mapped to a slot with `hash & (hash_cap - 1)`.
  */
-struct hash_ele *hash_tbl[TBL_LEN]; // Array of pointers to hash table entries
+struct hash_ele *hash_tbl = NULL; // Array of `hash_cap` slots
+int hash_cap = 0;                 // Number of slots
+int hash_count = 0;               // Number of occupied slots
+
+/**
+ * A block of string table storage.
+ *
+ * A block normally spans one chunk of `STR_CHUNK_LEN` bytes; a string longer than that gets a
+ * block spanning as many consecutive chunks as it needs.
+ */
+struct str_block {
+    struct str_block *next; // Previously filled block
+    int start;              // String table index of `text[0]`
+    int size;               // Capacity of `text` in bytes (a multiple of `STR_CHUNK_LEN`)
+    int used;               // Bytes of `text` holding stored strings
+    char text[];            // String storage
+};
 
 /**
  * String table for storing the actual text of identifiers and string constants.
  *
- * All strings are stored contiguously in this array, with a separator marking the end of each string.
+ * Strings are stored contiguously inside a block, with a separator marking the end of each
+ * string. Blocks never move, so pointers returned by `str_at()` stay valid.
  */
-char strg_tbl[STRTBL_LEN]; // String table with fixed size
+struct str_block *str_blocks = NULL; // Block currently being filled
+char **str_chunks = NULL;            // Start of each chunk, indexed by `index >> STR_CHUNK_BITS`
+int str_nchunks = 0;                 // Number of chunks handed out
+int str_chunk_cap = 0;               // Capacity of `str_chunks`
+struct str_block *str_spare = NULL;  // One-chunk blocks of an earlier unit, for reuse
 
 /**
  * Tracks the current end of the string table.
  *
- * Points to the next available index in `strg_tbl` where new strings can be inserted.
+ * Points to the next available index in the string table where new strings can be inserted.
  */
 int last = 0; // Initially, the string table is empty
 
 /**
- * Initializes the hash table by setting all entries to NULL.
+ * Initializes the hash table by marking all slots empty.
  *
  * This prepares the hash table for use by clearing any existing data.
- * Each entry in the table initially points to NULL, indicating that
+ * Each slot initially holds index -1, indicating that
  * no identifiers or strings have been stored yet.
  */
 void init_hash_tbl() {
     int i;
-    for (i = 0; i < TBL_LEN; i++) {
-        hash_tbl[i] = NULL; // Clear each entry in the hash table
+    free(hash_tbl);
+    hash_cap = HASH_INIT_SIZE;
+    hash_count = 0;
+    hash_tbl = (struct hash_ele *)malloc(hash_cap * sizeof(struct hash_ele));
+    for (i = 0; i < hash_cap; i++) {
+        hash_tbl[i].index = -1; // Clear each slot in the hash table
     }
 }
 
 /**
- * Initializes the string table by setting all characters to 0.
+ * Initializes the string table by releasing all of its blocks.
  *
  * This clears the string table to ensure no leftover data interferes
  * with new string entries. It effectively resets the table to an empty state.
  */
 void init_string_tbl() {
+    while (str_blocks != NULL) {
+        struct str_block *next = str_blocks->next;
+        free(str_blocks);
+        str_blocks = next;
+    }
+    str_nchunks = 0;
+    last = 0;
+}
+
+/**
+ * Empties the hash table and the string table for the next compilation unit.
+ *
+ * Unlike the init functions this keeps the memory: the hash table keeps its slots, and
+ * one-chunk blocks of the string table go to `str_spare`, where `reserve_string` takes them
+ * before allocating.
+ */
+void reset_string_tbl() {
     int i;
-    for (i = 0; i < STRTBL_LEN; i++) {
-        strg_tbl[i] = 0; // Clear each position in the string table
+    for (i = 0; i < hash_cap; i++) {
+        hash_tbl[i].index = -1;
     }
+    hash_count = 0;
+    while (str_blocks != NULL) {
+        struct str_block *next = str_blocks->next;
+        if (str_blocks->size == STR_CHUNK_LEN) {
+            str_blocks->next = str_spare;
+            str_spare = str_blocks;
+        } else {
+            free(str_blocks);
+        }
+        str_blocks = next;
+    }
+    str_nchunks = 0;
+    last = 0;
 }
 
+/**
+ * Returns the text stored at a string table index.
+ *
+ * @param i A string table index (as stored in `yylval` by `install_id`).
+ */
+char *str_at(int i) { return str_chunks[i >> STR_CHUNK_BITS] + (i & (STR_CHUNK_LEN - 1)); }
+
 /**
  * Prints the contents of the hash table.
  *
- * This function iterates through the hash table and displays each entry's
+ * This function iterates through the hash table and displays each occupied slot's
  * token ID, token length, and the index where the string is stored in the
- * string table. It also traverses linked lists to handle hash collisions.
+ * string table.
  */
 void prt_hash_tbl() {
     int i;
-    struct hash_ele *p;
 
-    printf("TokenID\tTokenLen\tIndex\tNext...\n"); // Table header
+    printf("Slot\tTokenID\tTokenLen\tIndex\n"); // Table header
 
-    for (i = 0; i < TBL_LEN; i++) {
-        p = hash_tbl[i]; // Get the head of the linked list at index i
-
-        // Traverse the linked list for collision handling
-        while (p != NULL) {
-            printf("%d\t%d\t%d\t\t", p->id, p->len, p->index); // Print entry details
-            p = p->next;                                       // Move to the next entry in the list
+    for (i = 0; i < hash_cap; i++) {
+        if (hash_tbl[i].index != -1) {
+            printf("%d\t%d\t%d\t\t%d\n", i, hash_tbl[i].id, hash_tbl[i].len, hash_tbl[i].index);
         }
-        printf("\n"); // Newline after each bucket
     }
 }
 
 /**
- * Prints the contents of the string table.
+ * Prints the characters of a string table block, after those of every older block.
  *
- * This function iterates through the string table and prints all stored
- * characters. If it encounters a separator (-1), it prints a space to
- * visually separate strings.
+ * @param b The block to print (`str_blocks` prints the whole table).
  */
-void prt_string_tbl() {
+void prt_string_blocks(struct str_block *b) {
     int i;
 
-    for (i = 0; i < last; i++) {
-        if (strg_tbl[i] == -1)
+    if (b == NULL) {
+        return;
+    }
+    prt_string_blocks(b->next);
+    for (i = 0; i < b->used; i++) {
+        if (b->text[i] == STR_SPRTR)
             printf(" "); // Print a space for string separators
         else
-            printf("%c", strg_tbl[i]); // Print the stored character
+            printf("%c", b->text[i]); // Print the stored character
     }
+}
+
+/**
+ * Prints the contents of the string table.
+ *
+ * This function iterates through the string table blocks, oldest first, and prints all
+ * stored characters. If it encounters a separator, it prints a space to
+ * visually separate strings.
+ */
+void prt_string_tbl() {
+    prt_string_blocks(str_blocks);
     printf("\n");
 }
 
 /**
- * Computes a hash value for a given string using the PJW (Peter J. Weinberger) hash algorithm.
- * This function ensures even distribution of hash values and minimizes collisions.
+ * Computes a hash value for a given string using the 32-bit FNV-1a (Fowler/Noll/Vo) algorithm.
+ * Each byte is mixed in with one XOR and one multiplication, which spreads similar identifiers
+ * (`a1`, `a2`, ...) over the whole table.
  *
  * @param s Pointer to the input string to be hashed.
  * @param l The length of the input string.
- * @return The computed hash value, constrained to the size of the hash table.
+ * @return The full 32-bit hash value; callers reduce it to a slot number.
  *
- * Example: Hashing the string "abc" with TBL_LEN = 101
- * -----------------------------------------------------
- * Step-by-step calculation:
+ * Example: Hashing the string "ab"
+ * --------------------------------
+ * Step-by-step calculation (all arithmetic modulo 2^32):
  *
  * Initial state:
- *     h = 0
+ *     h = 2166136261 (offset basis, 0x811c9dc5)
  *
  * Processing character 'a' (ASCII 97):
- *     h = (0 << 4) + 97  → 97
- *     No high bits set, skip overflow handling.
+ *     h = (0x811c9dc5 ^ 97) * 16777619  → 0xe40c292c
  *
  * Processing character 'b' (ASCII 98):
- *     h = (97 << 4) + 98 → (1552) + 98 → 1650
- *     No high bits set, skip overflow handling.
- *
- * Processing character 'c' (ASCII 99):
- *     h = (1650 << 4) + 99 → (26400) + 99 → 26499
- *     No high bits set, skip overflow handling.
- *
- * Final step:
- *     hash = 26499 % 101 → 72
+ *     h = (0xe40c292c ^ 98) * 16777619  → 0x4d2505ca
  *
  * Result:
- *     The string "abc" maps to bucket 72 in the hash table.
+ *     With 1024 slots, "ab" maps to slot 0x4d2505ca & 1023 = 458.
  */
-int hashpjw(char *s, int l) {
-    int i;          // Loop counter
-    char *p;        // Pointer to iterate through the string
-    unsigned h = 0; // Hash value (accumulator)
-    unsigned g;     // Temporary variable for high-order bits
+unsigned hashfnv(char *s, int l) {
+    int i;                    // Loop counter
+    unsigned h = 2166136261u; // Hash value (FNV offset basis)
 
     // Iterate over each character in the input string
-    for (i = 0, p = s; i < l; p = p + 1, i++) {
-        h = (h << 4) + (*p); // Shift hash left by 4 bits and add current character
+    for (i = 0; i < l; i++) {
+        h ^= (unsigned char)s[i]; // Mix in the current character
+        h *= 16777619u;           // Multiply by the FNV prime
+    }
+
+    return h;
+}
 
-        // Check if high-order bits (above 28 bits) are set
-        if ((g = h & 0xf0000000)) {
-            h = h ^ (g >> 24); // Mix high-order bits back into the hash
-            h = h ^ g;         // Clear the high-order bits
+/**
+ * Finds the slot holding a string, or the empty slot where it would be inserted.
+ *
+ * @param s The text to look for.
+ * @param l The length of the text.
+ * @param h The FNV-1a hash of the text.
+ */
+struct hash_ele *find_slot(char *s, int l, unsigned h) {
+    unsigned mask = hash_cap - 1;
+    unsigned i = h & mask;
+
+    /* Probe consecutive slots until the string or an empty slot is found */
+    while (hash_tbl[i].index != -1) {
+        if (hash_tbl[i].hash == h && hash_tbl[i].len == l && !memcmp(str_at(hash_tbl[i].index), s, l)) {
+            return &hash_tbl[i];
         }
+        i = (i + 1) & mask;
+    }
+    return &hash_tbl[i];
+}
+
+/**
+ * Doubles the hash table and reinserts every occupied slot.
+ *
+ * Slots keep their full hash, so no string is rehashed.
+ */
+void grow_hash_tbl() {
+    struct hash_ele *old = hash_tbl;
+    int old_cap = hash_cap;
+    int i;
+    unsigned j, mask;
+
+    hash_cap *= 2;
+    mask = hash_cap - 1;
+    hash_tbl = (struct hash_ele *)malloc(hash_cap * sizeof(struct hash_ele));
+    for (i = 0; i < hash_cap; i++) {
+        hash_tbl[i].index = -1;
+    }
+
+    for (i = 0; i < old_cap; i++) {
+        if (old[i].index != -1) {
+            for (j = old[i].hash & mask; hash_tbl[j].index != -1; j = (j + 1) & mask)
+                ;
+            hash_tbl[j] = old[i];
+        }
+    }
+    free(old);
+}
+
+/**
+ * Makes room for `n` more bytes at the end of the string table.
+ *
+ * When the current block is too small, a new block starts at the next chunk boundary and
+ * `last` moves there; the unused tail of the old block is skipped.
+ *
+ * @param n The number of bytes needed, including the separator.
+ */
+void reserve_string(int n) {
+    struct str_block *b;
+    int chunks, i;
+
+    if (str_blocks != NULL && str_blocks->used + n <= str_blocks->size) {
+        return;
     }
 
-    return h % TBL_LEN; // Map the hash value to the table size to avoid overflow
+    /* Step 1: Allocate a block of as many chunks as the string needs */
+    chunks = (n + STR_CHUNK_LEN - 1) / STR_CHUNK_LEN;
+    if (chunks == 1 && str_spare != NULL) {
+        b = str_spare;
+        str_spare = b->next;
+    } else {
+        b = (struct str_block *)malloc(sizeof(struct str_block) + (size_t)chunks * STR_CHUNK_LEN);
+    }
+    if (b == NULL) {
+        printf("There is not enough space in string table!!!\n");
+        exit(0);
+    }
+    b->next = str_blocks;
+    b->start = str_nchunks << STR_CHUNK_BITS;
+    b->size = chunks * STR_CHUNK_LEN;
+    b->used = 0;
+    str_blocks = b;
+
+    /* Step 2: Map each chunk of the block's index range to its storage */
+    if (str_nchunks + chunks > str_chunk_cap) {
+        str_chunk_cap = (str_nchunks + chunks) * 2;
+        str_chunks = (char **)realloc(str_chunks, str_chunk_cap * sizeof(char *));
+    }
+    for (i = 0; i < chunks; i++) {
+        str_chunks[str_nchunks++] = b->text + i * STR_CHUNK_LEN;
+    }
+    last = b->start;
 }
 
 /**
@@ -245,89 +404,97 @@ int hashpjw(char *s, int l) {
  * @param tokenid The token ID representing the type of the input (e.g., IDnum, SCONSTnum).
  */
 void install_id(char *text, int tokenid) {
-    int ind, i;
-    struct hash_ele *p, *p0;
-
-    yylval = last; // Set yylval to the current end of the string table
+    int i, len;
+    int plain = memchr(text, '\\', yyleng) == NULL; // No escape sequences to decode
+    char *dst;
+    unsigned h;
+    struct hash_ele *p;
 
-    /* Step 1: Compute the hash index for the input text */
-    ind = hashpjw(text, yyleng); // Generate hash index using PJW hash function
-    p = hash_tbl[ind];           // Get the head of the linked list at that index
-    p0 = p;
+    if (hash_tbl == NULL) {
+        init_hash_tbl();
+    }
 
-    /* Step 2: Search for the string in the hash table to avoid duplicates */
-    while (p != NULL) {
-        // Compare existing strings in the table with the input text
-        if (!strncmp((char *)&strg_tbl[p->index], text, yyleng)) {
+    /* Step 1: Text without escapes is looked up where the scanner left it (in the mapped
+     * source, see lexMapInput), so a repeated identifier or string costs no copy */
+    if (plain) {
+        h = hashfnv(text, yyleng);
+        p = find_slot(text, yyleng, h);
+        if (p->index != -1) {
             yylval = p->index; // If found, update yylval with the existing index
-            return;            // Exit as the entry already exists
+            return;
         }
-        p0 = p;
-        p = p->next; // Move to the next entry in case of a collision
     }
 
-    /* Step 3: If the text is not found, insert it into the table */
-    if (p == NULL) {
-        // Check for string table overflow
-        if (last + yyleng > STRTBL_LEN) {
-            printf("There is not enough space in string table!!!\n");
-            exit(0);
-        }
-
-        /* Allocate a new hash table entry */
-        p = (struct hash_ele *)malloc(sizeof(struct hash_ele)); // Allocate memory for the new entry
-        p->id = tokenid;                                        // Set the token ID (e.g., IDnum, SCONSTnum)
-        p->len = yyleng;
-        p->index = last; // Set the starting index in the string table
-        p->next = NULL;  // Initialize next pointer to NULL
-
-        // Insert the new entry into the hash table
-        if (hash_tbl[ind] == NULL)
-            hash_tbl[ind] = p; // Directly insert if no collision
-        else
-            p0->next = p; // Handle collision by chaining
-
-        /* Step 4: Copy the input text into the string table */
+    /* Step 2: Copy the text to the end of the string table. Only a string constant with
+     * escape sequences is decoded, and only then looked up, since decoding changes it. */
+    reserve_string(yyleng + 1); // Decoding never makes the text longer
+    dst = str_at(last);
+    if (plain) {
+        memcpy(dst, text, yyleng);
+        len = yyleng;
+    } else {
         i = 0;
+        len = 0;
         while (i < yyleng) {
             // Handle escape sequences for string constants
             if (text[i] != '\\') {
-                strg_tbl[last] = text[i]; // Directly copy the character
+                dst[len] = text[i]; // Directly copy the character
             } else {
                 i++;
                 switch (text[i]) {
                 case 't':
-                    strg_tbl[last] = '\t';
+                    dst[len] = '\t';
                     break; // Tab character
                 case 'n':
-                    strg_tbl[last] = '\n';
+                    dst[len] = '\n';
                     break; // Newline character
                 case '\\':
-                    strg_tbl[last] = '\\';
+                    dst[len] = '\\';
                     break; // Backslash
                 case '\'':
-                    strg_tbl[last] = '\'';
+                    dst[len] = '\'';
                     break; // Single quote
                 default:
-                    strg_tbl[last] = '\\';
+                    dst[len] = '\\';
                     i--; // Unrecognized escape, store backslash
                 }
             }
 
             i++;
-            last++; // Move to the next position in the string table
+            len++; // Move to the next position in the string table
         }
+    }
+    dst[len] = STR_SPRTR; // Add a separator to mark the end of the string
+
+    if (!plain) {
+        h = hashfnv(dst, len);
+        p = find_slot(dst, len, h);
+        if (p->index != -1) {
+            yylval = p->index; // If found, update yylval with the existing index
+            return;            // The copy is overwritten by the next insertion
+        }
+    }
+
+    /* Step 3: If the text is not found, keep the copy and fill the empty slot */
+    p->hash = h;
+    p->id = tokenid; // Set the token ID (e.g., IDnum, SCONSTnum)
+    p->len = len;
+    p->index = last; // Set the starting index in the string table
+    yylval = last;
 
-        /* Step 5: Mark the end of the string in the string table */
-        strg_tbl[last] = STR_SPRTR; // Add a separator to mark the end of the string
-        last++;                     // Move the pointer forward for the next insertion
+    str_blocks->used += len + 1;
+    last += len + 1; // Move the pointer forward for the next insertion
+
+    /* Step 4: Keep the table at most half full */
+    if (++hash_count * 2 > hash_cap) {
+        grow_hash_tbl();
     }
 }
 
 /*
  * loc_str(): Searches for a string in the string table.
  * ----------------------------------------------------
- * This function checks if a given string is already stored in the global string table (`strg_tbl`).
+ * This function checks if a given string is already stored in the string table.
  *
  * Parameters:
  *   - string: A pointer to the string to search for in the string table.
@@ -337,25 +504,129 @@ void install_id(char *text, int tokenid) {
  *   - **-1** if the string is not found in the string table.
  *
  * Note:
- *   - The string table (`strg_tbl`) stores strings consecutively, with each string
- *     **separated by `STR_SPRTR` (defined as `0`)**.
- *   - This separator allows for efficient storage and traversal of multiple strings.
+ *   - The lookup goes through the hash table, so it costs one hash and a short probe
+ *     sequence instead of a scan of every stored string.
  */
 int loc_str(char *string) {
-    int i = 0; /* Initialize index to start at the beginning of the string table */
+    int len = strlen(string);
+    struct hash_ele *p;
+
+    /* Step 1: Nothing has been installed yet */
+    if (hash_tbl == NULL) {
+        return -1;
+    }
 
-    /* Step 1: Iterate through the string table */
-    while (i < last) { // 'last' marks the end of the used portion of the string table
+    /* Step 2: Probe the hash table */
+    p = find_slot(string, len, hashfnv(string, len));
 
-        /* Step 2: Compare the current string in the table with the target string */
-        if (strcmp((char *)&strg_tbl[i], string) == 0) {
-            return i; // If the string is found, return its starting index in the string table
+    /* Step 3: An empty slot means the string is not stored */
+    return p->index; // -1 for an empty slot
+}
+
+/**
+ * Writes every stored identifier and string constant to a binary AST file (see astfile.c).
+ *
+ * Each entry is its token ID, length and string table index, then its text. The index is
+ * written because the syntax tree and symbol table refer to strings by it.
+ *
+ * @param out The file, open for binary writing.
+ */
+void save_string_tbl(FILE *out) {
+    int i;
+
+    fwrite(&hash_count, sizeof(int), 1, out);
+    for (i = 0; i < hash_cap; i++) {
+        struct hash_ele *p = &hash_tbl[i];
+        if (p->index == -1) {
+            continue;
         }
+        fwrite(&p->id, sizeof(int), 1, out);
+        fwrite(&p->len, sizeof(int), 1, out);
+        fwrite(&p->index, sizeof(int), 1, out);
+        fwrite(str_at(p->index), 1, p->len, out);
+    }
+}
 
-        /* Step 3: Move to the next stored string */
-        i += strlen((char *)&strg_tbl[i]) + 1; // Skip to the next string (past the separator)
+/**
+ * Replaces the hash table and string table with the entries written by `save_string_tbl`.
+ *
+ * Every string goes back to its old index, so the indices held by a loaded syntax tree and
+ * symbol table stay valid. All strings share one block that spans every index written.
+ *
+ * @param in The file, positioned at the entries.
+ * @return 1 on success, 0 if the entries are malformed.
+ */
+int load_string_tbl(FILE *in) {
+    int count, i, end = 0, ok = 1;
+    struct hash_ele *ele;
+    char **text;
+
+    /* Step 1: Read the entries */
+    if (fread(&count, sizeof(int), 1, in) != 1 || count < 0) {
+        return 0;
+    }
+    ele = (struct hash_ele *)malloc((count + 1) * sizeof(struct hash_ele));
+    text = (char **)calloc(count + 1, sizeof(char *));
+    for (i = 0; i < count && ok; i++) {
+        ok = fread(&ele[i].id, sizeof(int), 1, in) == 1 && fread(&ele[i].len, sizeof(int), 1, in) == 1 &&
+             fread(&ele[i].index, sizeof(int), 1, in) == 1 && ele[i].len >= 0 && ele[i].index >= 0 &&
+             ele[i].len < (1 << 30) && ele[i].index < (1 << 30);
+        if (ok) {
+            text[i] = (char *)malloc(ele[i].len + 1);
+            ok = fread(text[i], 1, ele[i].len, in) == (size_t)ele[i].len;
+            text[i][ele[i].len] = STR_SPRTR;
+            if (ele[i].index + ele[i].len + 1 > end) {
+                end = ele[i].index + ele[i].len + 1;
+            }
+        }
     }
 
-    /* Step 4: String not found in the table */
-    return -1; // Return -1 if the string is not stored in the string table
-}
\ No newline at end of file
+    /* Step 2: Put each text back at its index and into the hash table */
+    if (ok) {
+        init_hash_tbl();
+        init_string_tbl();
+        if (end > 0) {
+            reserve_string(end);
+            str_blocks->used = end;
+            last = end;
+        }
+        for (i = 0; i < count; i++) {
+            struct hash_ele *p;
+            memcpy(str_at(ele[i].index), text[i], ele[i].len + 1);
+            ele[i].hash = hashfnv(text[i], ele[i].len);
+            p = find_slot(text[i], ele[i].len, ele[i].hash);
+            *p = ele[i];
+            if (++hash_count * 2 > hash_cap) {
+                grow_hash_tbl();
+            }
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        free(text[i]);
+    }
+    free(text);
+    free(ele);
+    return ok;
+}
+
+/**
+ * Reports how full the hash table and the string table are (for `--stats`).
+ *
+ * @param count    Set to the number of distinct identifiers and strings stored.
+ * @param slots    Set to the number of hash table slots.
+ * @param used     Set to the bytes of the string table holding text and separators.
+ * @param reserved Set to the bytes allocated for the string table.
+ */
+void string_tbl_usage(int *count, int *slots, int *used, int *reserved) {
+    struct str_block *b;
+
+    *count = hash_count;
+    *slots = hash_cap;
+    *used = 0;
+    *reserved = 0;
+    for (b = str_blocks; b != NULL; b = b->next) {
+        *used += b->used;
+        *reserved += b->size;
+    }
+}
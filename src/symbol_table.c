@@ -3,57 +3,67 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /********************************* Data Structures **********************/
 /*
- * There are three arrays for symbol table operation.  "st" is the real
- * symbol table, it carries all the information of an id and will still be
- * used in code generation phase.  The attributes for an id are kept in a
- * link list pointed by its symbol table entry. It is easy to be extended in
- * the next phase to include more attributes, such like the size and the
- * location of a varialbe. "stack" is a temporary structure in which all the
- * id's in the current scoping context are visible.  "attrarray" is to store
- * all the attributes in symbol table.
+ * There are two structures for symbol table operation. The symbol table itself
+ * is stored as a struct of arrays: every attribute has its own array indexed by
+ * symbol table index, so `GetAttr`/`SetAttr` are a single array access and a pass
+ * over one attribute (e.g., every name) touches contiguous memory. It still
+ * carries all the information of an id and will still be used in the code
+ * generation phase. "stack" is a temporary structure in which all the id's in
+ * the current scoping context are visible. Both grow on demand, so the size of
+ * the input program is only limited by memory.
  */
 
-/* Definition of the stack array with a size of STACK_SIZE. */
-StackEntry stack[STACK_SIZE];
+/*
+ * Scope Stack
+ * -----------
+ * `stack[0]` is a permanent marker below the outermost scope, so scans of the current
+ * block always stop at a marker. `stack_cap` is the allocated number of entries.
+ */
+StackEntry *stack = NULL;
+int stack_cap = 0;
 
 /*
- * Symbol Table Array
- * ------------------
- * This array holds the main symbol table entries. Each entry in this array
- * points to the starting index of the linked list of attributes in `attrarray`
- * for a specific identifier.
+ * Scope Hash Index
+ * ----------------
+ * `scope_hash` maps a name (string table index) to the newest stack entry in its bucket;
+ * older entries of the bucket follow through `StackEntry.shadow`. Since the stack only
+ * grows and shrinks at the top, every chain stays ordered from the innermost declaration
+ * outwards, so the first entry with a matching name is the visible one. The index has as
+ * many buckets as the stack has entries and is rebuilt whenever the stack grows.
  *
- * - Each index in `st` corresponds to a unique identifier (variable, function, etc.).
- * - The linked list of attributes holds detailed information about the identifier.
+ * `block_marker` is the stack index of the innermost block marker; each marker keeps the
+ * index of the enclosing one in its `shadow` field.
  */
-int st[ST_SIZE]; /* Symbol table array with size defined by ST_SIZE. */
+int *scope_hash = NULL;
+int scope_hash_bits = 0;
+int block_marker = 0;
 
 /*
- * Attribute Array
- * ---------------
- * This array stores all attributes associated with the identifiers in the symbol table.
- *
- * - Each symbol table entry in `st` points to its attributes in this array.
- * - Attributes are linked together via `next_attr`, forming a linked list.
- * - Attributes may include information such as type, value, nesting level, etc.
- *
- * This design avoids dynamic memory allocation, simplifying testing and debugging.
+ * Symbol Table Arrays
+ * -------------------
+ * `st_attrs[attr_num][st_ptr]` holds the value of attribute `attr_num` of symbol `st_ptr`.
+ * `st_attr_set[st_ptr]` has bit `1 << attr_num` set for every attribute assigned with
+ * `SetAttr`, which is what `IsAttr` reports. `st_cap` is the allocated number of symbols;
+ * index 0 is never handed out, so 0 can mean "no symbol".
  */
-attr_type attrarray[ATTR_SIZE]; /* Array of attributes for identifiers. */
+int *st_attrs[NUM_ATTRS];
+int *st_attr_set = NULL;
+int st_cap = 0;
 
 /*
  * Global Counters
  * ---------------
  * These counters keep track of the current positions within the symbol table,
- * stack, nesting levels, and attribute array.
+ * stack and nesting levels.
  */
 int stack_top = 0; /* Tracks the top index of the stack used for managing scopes. */
-int st_top = 0;    /* Tracks the top index of the symbol table (`st`). */
+int stack_peak = 0; /* Highest `stack_top` so far (reported by `--stats`). */
+int st_top = 0;    /* Tracks the top index of the symbol table. */
 int nesting = 0;   /* Tracks the current nesting level (scope depth). */
-int attr_top = 0;  /* Tracks the top index of the attribute array (`attrarray`). */
 
 /*
  * External Variables
@@ -61,11 +71,92 @@ int attr_top = 0;  /* Tracks the top index of the attribute array (`attrarray`).
  * These external variables are declared elsewhere but used here.
  */
 extern int yyline;                /* Current line number in the source code (used for error reporting). */
-extern char strg_tbl[];           /* String table storing identifier names, defined in table.c. */
 extern int loc_str(char *string); // Declare the function
 
 /************************ routines *****************************/
 
+/*
+ * growSymbols(): Makes room for symbol table index `need`.
+ * --------------------------------------------------------
+ * Doubles the capacity of every attribute array until `need` fits. New entries start
+ * with no attributes. Aborts with ST_OVERFLOW only if memory runs out.
+ */
+void growSymbols(int need) {
+    int cap = st_cap ? st_cap : ST_INIT_SIZE;
+    int a;
+
+    while (cap <= need)
+        cap *= 2;
+    if (cap == st_cap)
+        return;
+
+    for (a = 1; a < NUM_ATTRS; a++) {
+        st_attrs[a] = realloc(st_attrs[a], cap * sizeof(int));
+        if (!st_attrs[a])
+            error_msg(ST_OVERFLOW, ABORT, 0, 0);
+    }
+    st_attr_set = realloc(st_attr_set, cap * sizeof(int));
+    if (!st_attr_set)
+        error_msg(ST_OVERFLOW, ABORT, 0, 0);
+
+    /* Unused entries have no attributes */
+    for (a = st_cap; a < cap; a++)
+        st_attr_set[a] = 0;
+    st_cap = cap;
+}
+
+/*
+ * scopeBucket(): Returns the scope hash bucket of a name.
+ * -------------------------------------------------------
+ * Fibonacci hashing: the top bits of the product spread consecutive string table
+ * indices over the whole table.
+ */
+int scopeBucket(int name) {
+    return (int)(((unsigned)name * 2654435761u) >> (32 - scope_hash_bits));
+}
+
+/*
+ * growStack(): Makes room for one more entry on the scope stack.
+ * ---------------------------------------------------------------
+ * Doubles the capacity of `stack` when it is full and rebuilds the scope hash index with
+ * as many buckets. The first allocation also creates the bottom marker `stack[0]`.
+ * Aborts with STACK_OVERFLOW only if memory runs out.
+ */
+void growStack() {
+    int i, b;
+
+    if (stack_top + 1 < stack_cap)
+        return;
+
+    int cap = stack_cap ? stack_cap * 2 : STACK_INIT_SIZE;
+    stack = realloc(stack, cap * sizeof(StackEntry));
+    free(scope_hash);
+    scope_hash = calloc(cap, sizeof(int));
+    if (!stack || !scope_hash)
+        error_msg(STACK_OVERFLOW, ABORT, 0, 0);
+
+    if (!stack_cap) {
+        stack[0].marker = true; /* Bottom marker: ends every scan of the current block */
+        stack[0].name = 0;
+        stack[0].st_ptr = 0;
+        stack[0].dummy = false;
+        stack[0].used = false;
+        stack[0].shadow = 0;
+    }
+    stack_cap = cap;
+
+    /* Re-insert the live entries bottom-up so each chain stays newest-first */
+    for (scope_hash_bits = 0; (1 << scope_hash_bits) < cap; scope_hash_bits++)
+        ;
+    for (i = 1; i <= stack_top; i++) {
+        if (!stack[i].marker) {
+            b = scopeBucket(stack[i].name);
+            stack[i].shadow = scope_hash[b];
+            scope_hash[b] = i;
+        }
+    }
+}
+
 /*
  * STInit(): Initialize the Symbol Table.
  * -------------------------------------
@@ -76,10 +167,25 @@ extern int loc_str(char *string); // Declare the function
  * - "system": A predefined class used for system-level operations.
  * - "readln": A predefined procedure for reading input.
  * - "println": A predefined procedure for printing output.
+ *
+ * It runs once per compilation unit and starts from an empty table each time.
  */
 void STInit() {
     int nStrInd, nSymInd; /* nStrInd: index in the string table, nSymInd: index in the symbol table */
 
+    /* Forget the symbols and scopes of a previous compilation unit, keeping the memory */
+    st_top = 0;
+    stack_top = 0;
+    stack_peak = 0;
+    block_marker = 0;
+    nesting = 0;
+    if (scope_hash)
+        memset(scope_hash, 0, stack_cap * sizeof(int));
+
+    /* Allocate the initial symbol table and scope stack (including its bottom marker) */
+    growSymbols(0);
+    growStack();
+
     /* Insert the predefined class "system" */
     nStrInd = loc_str("system");        /* Find or insert "system" in the string table */
     if (nStrInd != -1) {                /* Check if "system" was successfully added/found */
@@ -156,7 +262,7 @@ void error_msg(int type, int action, int id, int seq) {
         break;
 
     case ATTR_OVERFLOW:
-        printf("attribute array overflowed.\n"); // Attribute array exceeded its capacity
+        printf("attribute number out of range.\n"); // Attribute has no slot in the symbol table
         break;
 
     case BOUND:
@@ -275,15 +381,12 @@ int InsertEntry(int id) {
         return 0; // Return 0 to indicate failure to insert due to redeclaration.
     }
 
-    /* Step 2: Check for symbol table overflow */
-    if (st_top >= ST_SIZE - 1) {
-        // If the symbol table is full, report an overflow error and abort the program.
-        error_msg(ST_OVERFLOW, ABORT, 0, 0);
-    }
+    /* Step 2: Make room for the new entry, growing the symbol table if it is full */
+    growSymbols(st_top + 1);
 
     /* Step 3: Insert the new entry into the symbol table */
-    st_top++;       // Move to the next free slot in the symbol table.
-    st[st_top] = 0; // Initialize the new symbol table entry.
+    st_top++;                // Move to the next free slot in the symbol table.
+    st_attr_set[st_top] = 0; // The new entry has no attributes yet.
 
     /* Step 4: Set basic attributes for the identifier */
     SetAttr(st_top, NAME_ATTR, id);      // Set the identifier's name attribute.
@@ -299,7 +402,8 @@ int InsertEntry(int id) {
 /*
  * LookUp(): Searches for an identifier across all visible scopes.
  * ---------------------------------------------------------------
- * This function searches the stack from the top down for a given identifier (`id`).
+ * This function searches the stack from the top down for a given identifier (`id`),
+ * following the identifier's scope hash chain instead of scanning every entry.
  * If found, it returns the symbol table entry pointer (`st_ptr`) associated with the identifier.
  * If not found, it reports an undeclared error and pushes a dummy entry onto the stack to
  * prevent repeated error reports for the same identifier.
@@ -314,12 +418,13 @@ int InsertEntry(int id) {
 int LookUp(int id) {
     int i;
 
-    /* Step 1: Search the stack for the identifier from top to bottom */
-    for (i = stack_top; i > 0; i--) {
-        if (!stack[i].marker && stack[i].name == id) {
+    /* Step 1: Walk the name's hash chain, innermost declaration first */
+    for (i = scope_hash[scopeBucket(id)]; i > 0; i = stack[i].shadow) {
+        if (stack[i].name == id) {
             // If the identifier is found and it's not a block marker:
-            stack[i].used = true;   // Mark the identifier as used.
-            return stack[i].st_ptr; // Return the symbol table entry pointer.
+            stack[i].used = true;                      // Mark the identifier as used.
+            SetAttr(stack[i].st_ptr, USED_ATTR, true); // Keep the mark after the block closes.
+            return stack[i].st_ptr;                    // Return the symbol table entry pointer.
         }
     }
 
@@ -336,7 +441,8 @@ int LookUp(int id) {
  * LookUpHere(): Searches for an identifier within the current block (scope).
  * --------------------------------------------------------------------------
  * This function searches the stack for a given identifier (`id`) but limits the search
- * to the current block. It stops searching once a scope marker (`marker`) is encountered.
+ * to the current block. It stops searching once it reaches an entry below the current
+ * block's marker (`block_marker`).
  * This function is useful for checking redeclarations or forward declarations within a scope.
  *
  * Parameters:
@@ -349,8 +455,8 @@ int LookUp(int id) {
 int LookUpHere(int id) {
     int i;
 
-    /* Step 1: Search only within the current block (scope) */
-    for (i = stack_top; !stack[i].marker; i--) {
+    /* Step 1: Walk the name's hash chain, stopping at entries older than the current block */
+    for (i = scope_hash[scopeBucket(id)]; i > block_marker; i = stack[i].shadow) {
         if (stack[i].name == id && !stack[i].dummy) {
             // If the identifier is found and it's not a dummy entry:
             return stack[i].st_ptr; // Return the symbol table entry pointer.
@@ -378,6 +484,9 @@ int LookUpHere(int id) {
 void OpenBlock() {
     nesting++;               /* Increase the nesting level to represent entering a new block. */
     Push(true, 0, 0, false); /* Push a marker onto the stack to mark the start of the new block. */
+
+    stack[stack_top].shadow = block_marker; /* Remember the enclosing block's marker. */
+    block_marker = stack_top;               /* The new marker starts the current block. */
 }
 
 /*
@@ -408,47 +517,35 @@ void CloseBlock() {
     /* Step 2: Exit the current block by decrementing the nesting level */
     nesting--;
 
-    /* Step 3: Remove all identifiers declared in the current block by trimming the stack */
+    /* Step 3: Unlink the block's identifiers from the scope hash; each one is the newest
+     * entry of its bucket because entries are removed in reverse order of insertion */
+    for (; stack_top > i; stack_top--) {
+        scope_hash[scopeBucket(stack[stack_top].name)] = stack[stack_top].shadow;
+    }
+
+    /* Step 4: Remove the block marker itself and return to the enclosing block */
+    block_marker = stack[i].shadow;
     stack_top = i - 1; /* Move the stack top to just before the block marker */
 }
 
 /*
  * IsAttr(): Checks if a symbol table entry has a specific attribute.
  * -------------------------------------------------------------------
- * This function searches for a given attribute (`attr_num`) in the attribute list
- * associated with a symbol table entry (`st_ptr`).
+ * This function tests the presence bit of the given attribute (`attr_num`) for a
+ * symbol table entry (`st_ptr`).
  *
  * Parameters:
- *   - st_ptr: The index of the symbol in the symbol table (`st` array).
+ *   - st_ptr: The index of the symbol in the symbol table.
  *   - attr_num: The attribute number to search for (e.g., NAME_ATTR, TYPE_ATTR).
  *
  * Returns:
- *   - The index of the attribute in the `attrarray` if found.
- *   - 0 if the attribute is not found.
+ *   - 1 if the attribute has been set.
+ *   - 0 if the attribute is not set (or `st_ptr`/`attr_num` is out of range).
  */
 int IsAttr(int st_ptr, int attr_num) {
-    int i;
-
-    /* Step 1: Get the starting index of the attribute list for the symbol */
-    i = st[st_ptr]; // Points to the first attribute for this symbol.
-
-    /* Step 2: Traverse the linked list of attributes */
-    while (i) {
-        if (attrarray[i].attr_num == attr_num) {
-            // If the current attribute matches the desired attribute, return its index.
-            return i;
-        }
-
-        if (attrarray[i].attr_num > attr_num) {
-            // Attributes are sorted by `attr_num`. If the current attribute exceeds `attr_num`, stop.
-            break;
-        }
-
-        i = attrarray[i].next_attr; // Move to the next attribute in the list.
-    }
-
-    /* Step 3: Attribute not found */
-    return 0;
+    if (st_ptr < 0 || st_ptr >= st_cap || attr_num <= 0 || attr_num >= NUM_ATTRS)
+        return 0;
+    return (st_attr_set[st_ptr] >> attr_num) & 1;
 }
 
 /*
@@ -458,7 +555,7 @@ int IsAttr(int st_ptr, int attr_num) {
  * table entry (`st_ptr`). If the attribute does not exist, it reports a debug error.
  *
  * Parameters:
- *   - st_ptr: The index of the symbol in the symbol table (`st` array).
+ *   - st_ptr: The index of the symbol in the symbol table.
  *   - attr_num: The attribute number to retrieve.
  *
  * Returns:
@@ -466,73 +563,40 @@ int IsAttr(int st_ptr, int attr_num) {
  *   - 0 if the attribute is not found.
  */
 int GetAttr(int st_ptr, int attr_num) {
-    int i;
-
     /* Step 1: Check if the attribute exists using IsAttr() */
-    i = IsAttr(st_ptr, attr_num);
-
-    if (!i) {
+    if (!IsAttr(st_ptr, attr_num)) {
         /* Step 2: Attribute not found — print debug information */
         printf("DEBUG--The wanted attribute number %d does not exist\n", attr_num);
         return 0; // Return 0 to indicate the attribute is missing.
     }
 
     /* Step 3: Return the attribute value if found */
-    return attrarray[i].attr_val;
+    return st_attrs[attr_num][st_ptr];
 }
 
 /*
  * SetAttr(): Assigns or updates an attribute for a symbol table entry.
  * --------------------------------------------------------------------
  * This function sets a specific attribute (`attr_num`) with a given value (`attr_val`)
- * for a symbol table entry (`st_ptr`). If the attribute already exists, it updates its value.
- * If not, it inserts the attribute into the symbol's attribute list in sorted order.
+ * for a symbol table entry (`st_ptr`), overwriting any previous value.
  *
  * Parameters:
- *   - st_ptr  : The index of the symbol in the symbol table (`st` array).
+ *   - st_ptr  : The index of the symbol in the symbol table.
  *   - attr_num: The attribute number to set (e.g., NAME_ATTR, TYPE_ATTR).
  *   - attr_val: The value to assign to the attribute.
  */
 void SetAttr(int st_ptr, int attr_num, int attr_val) {
-    int *p, next;
-    int i;
-
-    /* Step 1: Check if the attribute already exists */
-    if ((i = IsAttr(st_ptr, attr_num))) {
-        /*
-        printf("DEBUG--The attribute number %d to be added already exists\n", attr_num);
-        */
-        attrarray[i].attr_val = attr_val; // Update the existing attribute value.
-        return;                           // No need to insert a new attribute.
+    /* Step 1: Reject attribute numbers without a slot */
+    if (st_ptr < 0 || attr_num <= 0 || attr_num >= NUM_ATTRS) {
+        error_msg(ATTR_OVERFLOW, ABORT, 0, 0);
     }
 
-    /* Step 2: Prepare to insert a new attribute */
-    p = &st[st_ptr];   // Pointer to the first attribute of the symbol.
-    next = st[st_ptr]; // Start traversing the linked list of attributes.
-
-    /* Step 3: Find the correct insertion point in the sorted attribute list */
-    while (next) {
-        if (attrarray[next].attr_num < attr_num) {
-            p = &(attrarray[next].next_attr); // Move to the next attribute.
-            next = attrarray[next].next_attr; // Advance to the next attribute.
-        } else {
-            break; // Found the right place to insert.
-        }
-    }
+    /* Step 2: Make sure the entry exists (callers may set attributes of index 0) */
+    growSymbols(st_ptr);
 
-    /* Step 4: Check for attribute array overflow */
-    if (attr_top >= ATTR_SIZE - 1) {
-        error_msg(ATTR_OVERFLOW, ABORT, 0, 0); // Stop execution if out of space.
-    }
-
-    /* Step 5: Insert the new attribute */
-    attr_top++; // Move to the next free slot in the attribute array.
-
-    attrarray[attr_top].attr_num = attr_num; // Set the attribute number.
-    attrarray[attr_top].attr_val = attr_val; // Assign the value.
-    attrarray[attr_top].next_attr = next;    // Link to the next attribute.
-
-    *p = attr_top; // Update the previous link to point to the new attribute.
+    /* Step 3: Store the value and mark the attribute as present */
+    st_attrs[attr_num][st_ptr] = attr_val;
+    st_attr_set[st_ptr] |= 1 << attr_num;
 }
 
 /*
@@ -610,12 +674,13 @@ char *kind_name[] = {
  */
 void STPrint() {
     // FILE *table;
-    int i, attr_num, attr_val, attr_ptr;
+    int i, attr_num, attr_val;
     // int treeval;
     tree ptrTree;
 
-    /* Step 1: Set the output stream to the console */
-    table = stdout;
+    /* Step 1: Print to the stream the driver chose (the console unless compiling a batch) */
+    if (table == NULL)
+        table = stdout;
 
     /* Step 2: Print the header of the symbol table */
     fprintf(table,
@@ -633,8 +698,8 @@ void STPrint() {
         /* Step 4: Iterate through all possible attributes for each symbol */
         for (attr_num = NAME_ATTR; attr_num <= ARGNUM_ATTR; attr_num++) {
             /* Check if the current attribute exists for the symbol */
-            if ((attr_ptr = IsAttr(i, attr_num))) {
-                attr_val = attrarray[attr_ptr].attr_val; // Retrieve the attribute's value.
+            if (IsAttr(i, attr_num)) {
+                attr_val = st_attrs[attr_num][i]; // Retrieve the attribute's value.
 
                 /* Step 5: Print attribute values based on their type */
                 switch (attr_num) {
@@ -726,13 +791,13 @@ void STPrint() {
  */
 void Push(int marker, int name, int st_ptr, int dummy) {
 
-    /* Step 1: Check for stack overflow */
-    if (stack_top >= STACK_SIZE - 1) {
-        error_msg(STACK_OVERFLOW, ABORT, 0, 0); // Abort if the stack is full.
-    }
+    /* Step 1: Grow the stack if it is full */
+    growStack();
 
     /* Step 2: Move to the next available position on the stack */
     stack_top++;
+    if (stack_top > stack_peak)
+        stack_peak = stack_top;
 
     /* Step 3: Push the new entry onto the stack */
     stack[stack_top].marker = (bool)marker; // Marks the start of a new block if true.
@@ -740,6 +805,14 @@ void Push(int marker, int name, int st_ptr, int dummy) {
     stack[stack_top].st_ptr = st_ptr;       // Links to the symbol table entry.
     stack[stack_top].dummy = (bool)dummy;   // Flags this entry as a dummy if true.
     stack[stack_top].used = false;          // Marks the identifier as unused by default.
+    stack[stack_top].shadow = 0;            // Not linked into the scope hash yet.
+
+    /* Step 4: Link identifiers (not block markers) into their scope hash chain */
+    if (!marker) {
+        int b = scopeBucket(name);
+        stack[stack_top].shadow = scope_hash[b];
+        scope_hash[b] = stack_top;
+    }
 }
 
 /*
@@ -3,6 +3,7 @@
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
  * Global dummy node used as a placeholder in the syntax tree.
@@ -27,6 +28,119 @@ tree NullExp() {
     return (&dummy); // Returns a pointer to the global dummy node
 }
 
+/**
+ * Node Arena
+ * ----------
+ * Syntax tree nodes are bump-allocated from fixed-size slabs instead of one `malloc` per node.
+ * Nodes created one after another sit next to each other in memory, and a whole compilation
+ * unit is released with `FreeAllNodes()` instead of node by node.
+ *
+ * - Slabs hold `NODES_PER_SLAB` nodes and are chained through `next`; `node_slabs` is the
+ *   slab currently being filled.
+ * - `FreeNode()` pushes a node onto `free_nodes` (linked through `LeftC`) so the semantic
+ *   analyzer's replaced `IDNode` leaves are reused by the `STNode` leaves that replace them.
+ * - `CompactTree()` copies a finished tree into fresh slabs in depth-first order, so the
+ *   traversals of later phases walk memory mostly sequentially.
+ * - `RecycleAllNodes()` releases a unit's nodes but keeps its slabs on `spare_slabs`, so the
+ *   next unit of a batch compilation reuses them.
+ */
+#define NODES_PER_SLAB 1024
+
+struct node_slab {
+    struct node_slab *next;        // Previously filled slab
+    int used;                      // Number of nodes handed out from `nodes`
+    ILTree nodes[NODES_PER_SLAB];  // Node storage
+} *node_slabs = NULL, *spare_slabs = NULL;
+
+/*
+ * free_nodes - Nodes returned by `FreeNode()`, reused before the current slab is bumped.
+ */
+tree free_nodes = NULL;
+
+/*
+ * node_count - Number of nodes handed out since the last `FreeAllNodes()`.
+ */
+int node_count = 0;
+
+/**
+ * allocNode - Returns storage for one syntax tree node.
+ *
+ * Reuses a freed node if there is one, otherwise bumps the current slab, starting a new
+ * slab when it is full.
+ */
+tree allocNode() {
+    tree p;
+
+    ++node_count;
+    if (free_nodes) {
+        p = free_nodes;
+        free_nodes = p->LeftC;
+        return (p);
+    }
+
+    if (!node_slabs || node_slabs->used == NODES_PER_SLAB) {
+        struct node_slab *slab = spare_slabs;
+        if (slab) {
+            spare_slabs = slab->next;
+        } else {
+            slab = malloc(sizeof(struct node_slab));
+        }
+        if (!slab) {
+            fprintf(stderr, "out of memory allocating syntax tree nodes\n");
+            exit(1);
+        }
+        slab->used = 0;
+        slab->next = node_slabs;
+        node_slabs = slab;
+    }
+    return (&node_slabs->nodes[node_slabs->used++]);
+}
+
+/**
+ * Returns a single node to the arena for reuse.
+ *
+ * Replaces `free()` for nodes that were created with `MakeLeaf`/`MakeTree`. The dummy node
+ * is shared and never released.
+ *
+ * @param T The node to release; it must no longer be referenced.
+ */
+void FreeNode(tree T) {
+    if (T == &dummy || T == NULL)
+        return;
+    T->LeftC = free_nodes;
+    free_nodes = T;
+    --node_count;
+}
+
+/**
+ * Releases every syntax tree node at once.
+ *
+ * Called once per compilation unit, after the last phase that reads the tree (or the type
+ * trees referenced from the symbol table) has finished.
+ */
+void FreeAllNodes() {
+    RecycleAllNodes();
+    while (spare_slabs) {
+        struct node_slab *next = spare_slabs->next;
+        free(spare_slabs);
+        spare_slabs = next;
+    }
+}
+
+/**
+ * Releases every syntax tree node at once, keeping the slabs for the next compilation unit.
+ */
+void RecycleAllNodes() {
+    while (node_slabs) {
+        struct node_slab *next = node_slabs->next;
+        node_slabs->next = spare_slabs;
+        spare_slabs = node_slabs;
+        node_slabs = next;
+    }
+    free_nodes = NULL;
+    node_count = 0;
+}
+
 /**
  * Creates a new leaf node with the specified node type and integer value.
  *
@@ -36,7 +150,7 @@ tree NullExp() {
 tree MakeLeaf(int Kind, int N) {
     tree p;
 
-    p = (tree)malloc(sizeof(ILTree)); // Allocate memory for the new node
+    p = allocNode();                  // Take the new node from the arena
     p->NodeKind = Kind;               // Set the node type (e.g., identifier, number)
     p->IntVal = N;                    // Set the integer value for the node
     p->LeftC = NullExp();             // Initialize left child as a dummy node
@@ -55,9 +169,10 @@ tree MakeLeaf(int Kind, int N) {
 tree MakeTree(int NodeOp, tree Left, tree Right) {
     tree p;
 
-    p = (tree)malloc(sizeof(ILTree)); // Allocate memory for the new expression node
+    p = allocNode();                  // Take the new expression node from the arena
     p->NodeKind = EXPRNode;           // Set the node type as an expression node
     p->NodeOpType = NodeOp;           // Set the specific operation type (e.g., addition, subtraction)
+    p->IntVal = 0;                    // No list length cached yet (see LeftDepth)
     p->LeftC = Left;                  // Attach the left child subtree
     p->RightC = Right;                // Attach the right child subtree
 
@@ -196,8 +311,9 @@ void SetNode(tree Target, tree Source) {
         Target->LeftC = NullExp();  // Set left child to dummy node
         Target->RightC = NullExp(); // Set right child to dummy node
     } else {
-        // If the node is an expression node, copy its operator type and children
+        // If the node is an expression node, copy its operator type, children and cached length
         Target->NodeOpType = Source->NodeOpType;
+        Target->IntVal = Source->IntVal;
         Target->LeftC = Source->LeftC;
         Target->RightC = Source->RightC;
     }
@@ -259,8 +375,10 @@ void SetRightTreeOp(tree T, int Op) {
 void SetLeftChild(tree T, tree NewC) {
     if (NodeKind(T) != EXPRNode)
         printf("SetLeftChild(): This node must be an EXPRNode!\n"); // Error if T is not an expression node
-    else
+    else {
         T->LeftC = NewC; // Attach the new left child
+        T->IntVal = 0;   // Forget the cached length of the left spine
+    }
 }
 
 /**
@@ -285,16 +403,163 @@ void SetRightChild(tree T, tree NewC) {
  * This function counts how many consecutive left children exist in the tree.
  * It is primarily used to determine the number of elements in a comma-separated
  * array initialization.
+ *
+ * The count is cached in the `IntVal` of the root, which expression nodes do not use
+ * otherwise, so the semantic passes and the code generator walk each initializer once
+ * between them. Lists are only relinked while parsing, before any count is taken.
  */
 int LeftDepth(tree treenode) {
     int ret = 0;
+    tree root = treenode;
+    if (NodeKind(root) == EXPRNode && root->IntVal > 0)
+        return (root->IntVal); // Counted before
     while (!IsNull(treenode)) {
         ++ret;                          // Increment depth for each left child
         treenode = LeftChild(treenode); // Move to the next left child
     }
+    if (NodeKind(root) == EXPRNode)
+        root->IntVal = ret;
     return ret;
 }
 
+/**
+ * CompactTree - Copies a tree into fresh slabs in depth-first (node, left, right) order.
+ *
+ * @param root The root of the tree to copy.
+ * @return The root of the copy.
+ *
+ * The walk uses an explicit stack because statement lists form long left spines. Shared
+ * subtrees stay shared: a pointer map from original to copy makes every node copied once.
+ * The original nodes are left untouched and stay valid until `FreeAllNodes()`, since the
+ * symbol table keeps pointers to type subtrees (`TYPE_ATTR`).
+ */
+tree CompactTree(tree root) {
+    struct slot {
+        tree node; // Original node still to be copied
+        tree *ref; // Where the copy's address must be stored
+    } *stack;
+    tree *from, *to; // Original-to-copy map, open addressing on the node address
+    int size, mask, top = 0;
+    tree result = root;
+
+    if (IsNull(root))
+        return (root);
+
+    // Step 1: Size the map for every live node at a load factor of at most 1/2
+    for (size = 64; size < 2 * node_count; size <<= 1)
+        ;
+    mask = size - 1;
+    from = calloc(size, sizeof(tree));
+    to = malloc(size * sizeof(tree));
+    stack = malloc((node_count + 1) * sizeof(struct slot));
+    if (!from || !to || !stack) {
+        fprintf(stderr, "out of memory compacting the syntax tree\n");
+        exit(1);
+    }
+
+    // Step 2: Start a new slab so the copy does not interleave with older nodes
+    if (node_slabs)
+        node_slabs->used = NODES_PER_SLAB;
+    free_nodes = NULL;
+
+    // Step 3: Copy nodes in pre-order, pushing the right child below the left one
+    stack[top].node = root;
+    stack[top++].ref = &result;
+    while (top) {
+        struct slot s = stack[--top];
+
+        if (s.node == &dummy || s.node == NULL) {
+            *s.ref = s.node;
+            continue;
+        }
+
+        unsigned long h = ((unsigned long)s.node >> 3) & mask;
+        while (from[h] && from[h] != s.node)
+            h = (h + 1) & mask;
+        if (from[h]) { // Already copied through another parent
+            *s.ref = to[h];
+            continue;
+        }
+
+        tree copy = allocNode();
+        *copy = *s.node;
+        from[h] = s.node;
+        to[h] = copy;
+        *s.ref = copy;
+
+        stack[top].node = copy->RightC;
+        stack[top++].ref = &copy->RightC;
+        stack[top].node = copy->LeftC;
+        stack[top++].ref = &copy->LeftC;
+    }
+
+    free(from);
+    free(to);
+    free(stack);
+    return (result);
+}
+
+/**
+ * Tree Stacks
+ * -----------
+ * Statement lists, declaration lists and argument lists are spines of `StmtOp` or `CommaOp`
+ * nodes as long as the list, so a walk that made one C call per node would need stack in
+ * proportion to the size of a method or an initializer. The walks over whole bodies keep
+ * their pending subtrees on a `TreeStack` instead, declared in the walker's frame.
+ */
+
+/**
+ * Empties a tree stack declared by the caller.
+ *
+ * @param S The stack.
+ */
+void InitTreeStack(TreeStack *S) {
+    S->items = S->local;
+    S->top = 0;
+    S->cap = TREE_STACK_LOCAL;
+}
+
+/**
+ * Pushes a subtree, moving the stack to a larger heap block when it is full.
+ *
+ * @param S The stack.
+ * @param T The subtree.
+ */
+void PushTree(TreeStack *S, tree T) {
+    if (S->top == S->cap) {
+        tree *grown = malloc(2 * S->cap * sizeof(tree));
+        if (!grown) {
+            fprintf(stderr, "out of memory walking the syntax tree\n");
+            exit(1);
+        }
+        memcpy(grown, S->items, S->top * sizeof(tree));
+        if (S->items != S->local)
+            free(S->items);
+        S->items = grown;
+        S->cap *= 2;
+    }
+    S->items[S->top++] = T;
+}
+
+/**
+ * Pops the subtree pushed last. The stack must not be empty.
+ *
+ * @param S The stack.
+ */
+tree PopTree(TreeStack *S) {
+    return (S->items[--S->top]);
+}
+
+/**
+ * Releases the heap block of a tree stack, if it grew one.
+ *
+ * @param S The stack.
+ */
+void FreeTreeStack(TreeStack *S) {
+    if (S->items != S->local)
+        free(S->items);
+}
+
 /**
  * External file pointer used for syntax tree printing. - Defined in codegen.c
  * This file pointer (`treelst`) is used to direct the output of the printed tree.
@@ -320,16 +585,34 @@ char *opnodenames[] = {
     "UnaryNegOp", "NotOp",                                       // Unary operations
     "VarOp", "SelectOp", "IndexOp", "FieldOp",                   // Variable and field access
     "SubrangeOp", "ExitOp",                                      // Range and control operations
-    "ClassOp", "MethodOp", "ClassDefOp"                          // Class and method operations
+    "ClassOp", "MethodOp", "ClassDefOp",                         // Class and method operations
+    "ShlOp", "ShrOp"                                             // Shifts introduced by constant folding
 };
 
 /**
  * Array used for managing indentation and line connections during tree printing.
  *
  * The `crosses` array tracks vertical connectors when printing the syntax tree.
- * It ensures proper formatting for hierarchical node relationships.
+ * It ensures proper formatting for hierarchical node relationships. It has one entry per
+ * depth level (`cross_cap` of them) and grows with the depth of the tree being printed.
  */
-static int crosses[162];
+static int *crosses = NULL;
+static int cross_cap = 0;
+
+/**
+ * Grows the `crosses` array to cover depth levels up to `x`, without connectors.
+ *
+ * @param x The deepest level that will be printed.
+ */
+void growcrosses(int x) {
+    int n = cross_cap ? cross_cap : 162;
+
+    while (n <= x)
+        n *= 2;
+    crosses = realloc(crosses, n * sizeof(int));
+    while (cross_cap < n)
+        crosses[cross_cap++] = 0; // New levels have no branch connection
+}
 
 /**
  * Prints indentation and branch connectors for the syntax tree visualization.
@@ -362,7 +645,7 @@ void indent(int x) {
 void zerocrosses() {
     register int i;
 
-    for (i = 0; i < 162; i++) {
+    for (i = 0; i < cross_cap; i++) {
         crosses[i] = 0; // Reset each entry to 0 (no branch connection)
     }
 }
@@ -371,9 +654,9 @@ void zerocrosses() {
  * External string table that stores all identifiers and string constants.
  *
  * This table is populated during lexical analysis and is used to retrieve
- * identifier names or string constants by their index.
+ * identifier names or string constants by their index. Implemented in string_hash_table.c.
  */
-extern char strg_tbl[];
+extern char *str_at(int i);
 
 /**
  * Retrieves an identifier's name from the string table.
@@ -381,7 +664,7 @@ extern char strg_tbl[];
  * @param i The index in the string table where the identifier's name is stored.
  */
 char *getname(int i) {
-    return (strg_tbl + i); // Return the identifier name at the given index
+    return str_at(i); // Return the identifier name at the given index
 }
 
 /**
@@ -390,35 +673,18 @@ char *getname(int i) {
  * @param i The index in the string table where the string constant is stored.
  */
 char *getstring(int i) {
-    return (strg_tbl + i); // Return the string constant at the given index
+    return str_at(i); // Return the string constant at the given index
 }
 
 /**
- * Recursively prints the syntax tree in a structured and readable format.
+ * printnode - Prints one node of the syntax tree printout, after its indentation.
  *
- * @param nd    The current tree node to print.
- * @param depth The depth level of the current node (used for indentation).
+ * @param nd    The node, not a dummy node.
+ * @param depth The depth level of the node.
  */
-void printtree(tree nd, int depth) {
+void printnode(tree nd, int depth) {
     int id, indx;
 
-    // Initialize the printout for the first call (root of the tree)
-    if (!depth) {
-        zerocrosses(); // Reset the vertical connection indicators
-        fprintf(treelst, "************* SYNTAX TREE PRINTOUT ***********\n\n");
-    }
-
-    // Print a placeholder for null (dummy) nodes
-    if (IsNull(nd)) {
-        indent(depth); // Indent according to the depth level
-        fprintf(treelst, "[DUMMYnode]\n");
-        return;
-    }
-
-    // Recursively print the right subtree first for proper visual alignment
-    if (NodeKind(nd) == EXPRNode)
-        printtree(RightChild(nd), depth + 1);
-
     indent(depth); // Indent the current node based on depth
 
     // Print the current node based on its type
@@ -471,8 +737,60 @@ void printtree(tree nd, int depth) {
         fprintf(treelst, "INVALID!!!\n");
         break;
     }
+}
+
+/**
+ * Prints the syntax tree in a structured and readable format.
+ *
+ * @param nd    The root of the tree to print.
+ * @param depth The depth level of the root (used for indentation).
+ *
+ * Each expression node is printed between its right subtree (above it) and its left subtree
+ * (below it). The walk keeps the pending nodes on an explicit stack, since statement lists
+ * are long left spines: an entry with `mid` set has its right subtree printed already and
+ * still needs the node itself and its left subtree.
+ */
+void printtree(tree nd, int depth) {
+    struct pending {
+        tree node; // Subtree to print
+        int depth; // Its depth level
+        int mid;   // 1 once its right subtree is printed
+    } *stack;
+    int top = 0, cap = 64;
+
+    // Initialize the printout for the first call (root of the tree)
+    if (!depth) {
+        zerocrosses(); // Reset the vertical connection indicators
+        fprintf(treelst, "************* SYNTAX TREE PRINTOUT ***********\n\n");
+    }
+
+    stack = malloc(cap * sizeof(struct pending));
+    stack[top++] = (struct pending){nd, depth, 0};
+    while (top) {
+        struct pending s = stack[--top];
 
-    // Recursively print the left subtree
-    if (NodeKind(nd) == EXPRNode)
-        printtree(LeftChild(nd), depth + 1);
-}
\ No newline at end of file
+        if (top + 2 > cap) {
+            cap *= 2;
+            stack = realloc(stack, cap * sizeof(struct pending));
+        }
+        if (s.depth + 1 >= cross_cap)
+            growcrosses(s.depth + 1);
+
+        // Print a placeholder for null (dummy) nodes
+        if (IsNull(s.node)) {
+            indent(s.depth); // Indent according to the depth level
+            fprintf(treelst, "[DUMMYnode]\n");
+        } else if (NodeKind(s.node) != EXPRNode) {
+            printnode(s.node, s.depth);
+        } else if (!s.mid) {
+            // Print the right subtree first for proper visual alignment
+            stack[top++] = (struct pending){s.node, s.depth, 1};
+            stack[top++] = (struct pending){RightChild(s.node), s.depth + 1, 0};
+        } else {
+            // Then the node itself, then its left subtree
+            printnode(s.node, s.depth);
+            stack[top++] = (struct pending){LeftChild(s.node), s.depth + 1, 0};
+        }
+    }
+    free(stack);
+}
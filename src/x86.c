@@ -0,0 +1,428 @@
+/**************************************************************************************************
+ * File: x86.c
+ * ------------------------------------------------------------------------------------------------
+ * Description:
+ *    This file implements the **x86-64 Backend** of `-target x86-64`. It lowers the same IR
+ *    the MIPS backend in codegen.c lowers, after the same optimization passes, to GNU
+ *    assembler (AT&T syntax) for Linux. The frame layout (`OFFSET_ATTR`), the class
+ *    singletons and every other decision of code generation stay as they are; only the last
+ *    step differs. The program is linked with the C runtime in runtime/mjrt.c:
+ *
+ *        gcc -no-pie -o program code.s runtime/mjrt.c
+ *
+ *    1. **Registers:**
+ *       - The MIPS registers the IR names most often live in x86 registers (see x86_regs);
+ *         the others live in the 32 words of `mj.regs`. `%eax`, `%ecx` and `%edx` are
+ *         scratch registers of the lowering.
+ *       - Values are 32-bit, so arithmetic wraps as on MIPS. Every address fits in 32 bits
+ *         too: the program is not position independent and the runtime places the stack and
+ *         the heap in the low 2 GiB. A register holding an address is used as a 64-bit base
+ *         register, since 32-bit writes clear the upper half.
+ *
+ *    2. **Stack and Calls:**
+ *       - `$sp` is `%ebp` and points into a stack the runtime allocates, so all frame
+ *         offsets are kept. Calls use `call`/`ret` on the native stack; the IR's saves and
+ *         restores of `$ra` then only move an unused word.
+ *
+ *    3. **Runtime Services:**
+ *       - Printing, reading, allocation and exit call small assembly stubs (`mj.print_int`,
+ *         ...) that save the caller-saved x86 registers holding MIPS registers, align the
+ *         native stack and call the C function. Output goes through stdio, so it is buffered
+ *         without `-buffer-output`.
+ *
+ *    4. **Data:**
+ *       - The `.data` section is written in MIPS syntax by the rest of the compiler and
+ *         translated when the program is written: `.asciiz` becomes `.asciz`, `.word`
+ *         becomes `.long` and `.align n` becomes `.balign 2^n`.
+ *
+ * ------------------------------------------------------------------------------------------------
+ * Major Functions:
+ *
+ *    1. **void x86LowerInstr(IRInstr *i):**
+ *       - Emits the x86-64 assembly for one IR instruction.
+ *
+ *    2. **void x86Begin() / void x86Finish():**
+ *       - Emit the entry point, and the runtime stubs and register words.
+ *
+ *    3. **void x86Write(FILE *out):**
+ *       - Writes the program, translating its `.data` section.
+ *
+ **************************************************************************************************/
+
+#include "emit.h"
+#include "ir.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * X86Reg - The x86 register a MIPS register lives in.
+ */
+typedef struct X86Reg {
+    int reg;     // R_* number
+    char *name;  // 32-bit name
+    char *wide;  // 64-bit name, for addressing
+} X86Reg;
+
+/*
+ * x86_regs - MIPS registers kept in x86 registers. `$t1` holds every expression result and
+ *            `$sp` every frame address. `%rbx`, `%rbp` and `%r12-%r15` survive calls into C.
+ */
+X86Reg x86_regs[] = {
+    {R_SP, "%ebp", "%rbp"},  {R_T1, "%ebx", "%rbx"},  {R_T0, "%r12d", "%r12"}, {R_T2, "%r13d", "%r13"},
+    {R_T3, "%r14d", "%r14"}, {R_V0, "%r15d", "%r15"}, {R_S0, "%esi", "%rsi"},  {R_A0, "%edi", "%rdi"},
+    {R_FP, "%r8d", "%r8"},   {R_T4, "%r9d", "%r9"},   {R_T5, "%r10d", "%r10"}, {R_A1, "%r11d", "%r11"},
+};
+
+/*
+ * x86_set_ops, x86_jump_ops - Condition codes of the IR comparisons and branches.
+ */
+char *x86_set_ops[] = {[IR_SLT] = "l", [IR_SGT] = "g", [IR_SEQ] = "e",
+                       [IR_SNE] = "ne", [IR_SLE] = "le", [IR_SGE] = "ge"};
+char *x86_jump_ops[] = {[IR_BEQ] = "e", [IR_BNE] = "ne", [IR_BLT] = "l",
+                        [IR_BGT] = "g", [IR_BLE] = "le", [IR_BGE] = "ge"};
+
+/*
+ * x86_alu_ops - Instructions of the IR operations that take a source and a destination.
+ */
+char *x86_alu_ops[] = {[IR_ADD] = "addl", [IR_SUB] = "subl", [IR_MUL] = "imull",
+                       [IR_AND] = "andl", [IR_OR] = "orl",   [IR_SLL] = "sall",
+                       [IR_SRA] = "sarl", [IR_SRL] = "shrl"};
+
+/**
+ * x86Find - Returns the x86 register a MIPS register lives in, or NULL if it lives in memory.
+ *
+ * @param r The R_* number.
+ */
+X86Reg *x86Find(int r) {
+    for (int i = 0; i < (int)(sizeof(x86_regs) / sizeof(x86_regs[0])); ++i) {
+        if (x86_regs[i].reg == r) {
+            return &x86_regs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * x86Operand - Returns an operand that reads a MIPS register: its x86 register, `$0` for
+ *              `$zero`, or its word of `mj.regs`.
+ *
+ * @param r The R_* number.
+ *
+ * The text is valid until the fourth call after this one.
+ */
+char *x86Operand(int r) {
+    static char bufs[4][24];
+    static int next = 0;
+    X86Reg *x = x86Find(r);
+    if (x) {
+        return x->name;
+    }
+    if (r == R_ZERO) {
+        return "$0";
+    }
+    char *buf = bufs[next++ & 3];
+    sprintf(buf, "mj.regs+%d", 4 * r);
+    return buf;
+}
+
+/**
+ * x86Source - Returns an operand for the second source of an instruction: the register, or
+ *             the immediate when the IR has no second register.
+ *
+ * @param r   The R_* number or IR_NOREG.
+ * @param imm The immediate.
+ */
+char *x86Source(int r, int imm) {
+    static char buf[24];
+    if (r != IR_NOREG) {
+        return x86Operand(r);
+    }
+    sprintf(buf, "$%d", imm);
+    return buf;
+}
+
+/**
+ * x86InReg - Returns an x86 register holding a MIPS register, loading it into a scratch
+ *            register if it lives elsewhere.
+ *
+ * @param r       The R_* number.
+ * @param scratch The 32-bit scratch register to load into.
+ */
+char *x86InReg(int r, char *scratch) {
+    X86Reg *x = x86Find(r);
+    if (x) {
+        return x->name;
+    }
+    emitText("\tmovl %s, %s\n", x86Operand(r), scratch);
+    return scratch;
+}
+
+/**
+ * x86Base - Returns a 64-bit register holding an address held in a MIPS register, loading
+ *           it into `%rax` if the register lives elsewhere.
+ *
+ * @param r The R_* number.
+ */
+char *x86Base(int r) {
+    X86Reg *x = x86Find(r);
+    if (x) {
+        return x->wide;
+    }
+    emitText("\tmovl %s, %%eax\n", x86Operand(r));
+    return "%rax";
+}
+
+/**
+ * x86Store - Moves a value into a MIPS register.
+ *
+ * @param r    The R_* number of the destination.
+ * @param from An x86 register, or an immediate if the destination lives in a register.
+ */
+void x86Store(int r, char *from) {
+    char *to = x86Operand(r);
+    if (r != R_ZERO && strcmp(to, from)) {
+        emitText("\tmovl %s, %s\n", from, to);
+    }
+}
+
+/**
+ * x86Sym - Returns the assembly name of an IR label.
+ *
+ * @param sym The label.
+ *
+ * The start-up routine is called `main` in the IR, which is the C runtime's entry point
+ * here. MiniJava names have no underscores, so `mj_main` cannot clash with them.
+ */
+char *x86Sym(char *sym) { return strcmp(sym, "main") ? sym : "mj_main"; }
+
+/**
+ * x86Jump - Emits a jump, conditional or not, to the target of an IR instruction.
+ *
+ * @param op The x86 jump instruction.
+ * @param i  The IR instruction.
+ */
+void x86Jump(char *op, IRInstr *i) {
+    if (i->sym) {
+        emitText("\t%s %s\n", op, x86Sym(i->sym));
+    } else {
+        emitText("\t%s L_%d\n", op, i->label);
+    }
+}
+
+/**
+ * x86LowerInstr - Emits the x86-64 assembly for one IR instruction into the `.text` section.
+ *
+ * @param i The instruction to lower.
+ */
+void x86LowerInstr(IRInstr *i) {
+    if (i->sym) {
+        emitReference(i->sym);
+    }
+    switch (i->op) {
+    case IR_LABEL:
+        if (i->sym) {
+            emitText("%s:\n", x86Sym(i->sym));
+        } else {
+            emitText("L_%d:\n", i->label);
+        }
+        break;
+    case IR_COMMENT:
+        emitText("\t# %s\n", i->sym);
+        break;
+    case IR_LI:
+        emitText("\tmovl $%d, %s\n", i->imm, x86Operand(i->dst));
+        break;
+    case IR_LA:
+        emitText("\tmovl $%s, %s\n", x86Sym(i->sym), x86Operand(i->dst));
+        break;
+    case IR_LW: {
+        char *base = x86Base(i->src1);
+        X86Reg *x = x86Find(i->dst);
+        emitText("\tmovl %d(%s), %s\n", i->imm, base, x ? x->name : "%eax");
+        if (!x) {
+            x86Store(i->dst, "%eax");
+        }
+        break;
+    }
+    case IR_SW: {
+        char *value = i->src1 == R_ZERO ? "$0" : x86InReg(i->src1, "%edx");
+        emitText("\tmovl %s, %d(%s)\n", value, i->imm, x86Base(i->src2));
+        break;
+    }
+    case IR_MOVE:
+        x86Store(i->dst, x86InReg(i->src1, "%eax"));
+        break;
+    case IR_NEG:
+        emitText("\tmovl %s, %%eax\n\tnegl %%eax\n", x86Operand(i->src1));
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_DIV: // Truncates toward zero, as on MIPS
+        emitText("\tmovl %s, %%ecx\n", x86Source(i->src2, i->imm));
+        emitText("\tmovl %s, %%eax\n\tcltd\n\tidivl %%ecx\n", x86Operand(i->src1));
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_SLT:
+    case IR_SGT:
+    case IR_SEQ:
+    case IR_SNE:
+    case IR_SLE:
+    case IR_SGE:
+        emitText("\tmovl %s, %%eax\n\tcmpl %s, %%eax\n", x86Operand(i->src1), x86Source(i->src2, i->imm));
+        emitText("\tset%s %%al\n\tmovzbl %%al, %%eax\n", x86_set_ops[i->op]);
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_SLL:
+    case IR_SRA:
+    case IR_SRL: // A shift by a register takes its count in %cl
+        if (i->src2 != IR_NOREG) {
+            emitText("\tmovl %s, %%ecx\n", x86Operand(i->src2));
+        }
+        emitText("\tmovl %s, %%eax\n", x86Operand(i->src1));
+        emitText("\t%s %s, %%eax\n", x86_alu_ops[i->op], i->src2 != IR_NOREG ? "%cl" : x86Source(i->src2, i->imm));
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_J:
+        x86Jump("jmp", i);
+        break;
+    case IR_CALL:
+        x86Jump("call", i);
+        break;
+    case IR_RET:
+        emitText("\tret\n");
+        break;
+    case IR_PRINT_INT:
+        emitText("\tmovl %s, %%eax\n\tcall mj.print_int\n", x86Operand(i->src1));
+        break;
+    case IR_PRINT_STR:
+        emitText("\tmovl $%s, %%eax\n\tcall mj.print_str\n", i->sym);
+        break;
+    case IR_READ_INT:
+        emitText("\tcall mj.read_int\n");
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_ALLOC:
+        emitText("\tmovl %s, %%eax\n\tcall mj.alloc\n", x86Source(i->src1, i->imm));
+        x86Store(i->dst, "%eax");
+        break;
+    case IR_EXIT:
+        emitText("\tcall mj.exit\n");
+        break;
+    case IR_BOUNDS: // One unsigned comparison also catches negative indexes
+        emitText("\tmovl %s, %%eax\n\tcmpl %s, %%eax\n", x86Operand(i->src1), x86Source(i->src2, i->imm));
+        emitText("\tjae bounds.error\n");
+        break;
+    case IR_COUNT:
+        emitText("\tincl %s+%d\n", i->sym, i->imm);
+        break;
+    default: // Binary operation or conditional branch
+        if (irIsBranch(i->op)) {
+            char *lhs = x86InReg(i->src1, "%eax");
+            emitText("\tcmpl %s, %s\n", x86Source(i->src2, i->imm), lhs);
+            char op[8];
+            sprintf(op, "j%s", x86_jump_ops[i->op]);
+            x86Jump(op, i);
+        } else {
+            emitText("\tmovl %s, %%eax\n", x86Operand(i->src1));
+            emitText("\t%s %s, %%eax\n", x86_alu_ops[i->op], x86Source(i->src2, i->imm));
+            x86Store(i->dst, "%eax");
+        }
+        break;
+    }
+}
+
+/**
+ * x86Begin - Emits the entry point the C runtime calls with the top of the MiniJava stack.
+ */
+void x86Begin() { emitText("\t.globl mj_start\nmj_start:\n\tmovl %%edi, %%ebp\n"); }
+
+/**
+ * x86Stub - Emits the stub of one runtime service.
+ *
+ * @param name The stub's label.
+ * @param func The C function it calls with the argument in `%eax`.
+ *
+ * The stub saves the caller-saved x86 registers that hold MIPS registers and aligns the
+ * native stack to 16 bytes for the call. The result comes back in `%eax`.
+ */
+void x86Stub(char *name, char *func) {
+    emitText("%s:\n", name);
+    emitText("\tpush %%rsi\n\tpush %%rdi\n\tpush %%r8\n\tpush %%r9\n\tpush %%r10\n\tpush %%r11\n");
+    emitText("\tmovl %%eax, %%edi\n\tmov %%rsp, %%rax\n\tand $-16, %%rsp\n\tsub $8, %%rsp\n\tpush %%rax\n");
+    emitText("\tcall %s\n\tmov (%%rsp), %%rsp\n", func);
+    emitText("\tpop %%r11\n\tpop %%r10\n\tpop %%r9\n\tpop %%r8\n\tpop %%rdi\n\tpop %%rsi\n\tret\n");
+}
+
+/**
+ * x86Finish - Emits the runtime stubs and the words of the registers kept in memory.
+ */
+void x86Finish() {
+    x86Stub("mj.print_int", "mj_print_int");
+    x86Stub("mj.print_str", "mj_print_str");
+    x86Stub("mj.read_int", "mj_read_int");
+    x86Stub("mj.alloc", "mj_alloc");
+    x86Stub("mj.exit", "mj_exit");
+    emitData(".align 2\nmj.regs: .space %d\n", 4 * IR_NUM_REGS);
+}
+
+/**
+ * isDirective - Reports whether a directive starts at a position of the `.data` section.
+ *
+ * @param data The section.
+ * @param i    The position.
+ * @param name The directive, which must be followed by a blank and preceded by one or a
+ *             line start (the labels of fields may contain `.word`).
+ */
+int isDirective(char *data, int i, char *name) {
+    int n = strlen(name);
+    return (i == 0 || data[i - 1] == ' ' || data[i - 1] == '\t' || data[i - 1] == '\n') &&
+           !strncmp(data + i, name, n) && (data[i + n] == ' ' || data[i + n] == '\t');
+}
+
+/**
+ * x86Write - Writes the program, translating the MIPS directives of its `.data` section.
+ *
+ * @param out The assembly file.
+ *
+ * Newlines inside string literals (the `Enter` string has one) are written as `\n`, and the
+ * `.space 0` of a singleton without fields is left out, since the assembler warns about it.
+ */
+void x86Write(FILE *out) {
+    char *data, *text;
+    int data_len, text_len;
+    emitSections(&data, &data_len, &text, &text_len);
+
+    fputs(".data\n", out);
+    for (int i = 0, in_string = 0; i < data_len; ++i) {
+        char *p = data + i;
+        if (in_string) {
+            if (*p == '\\' && i + 1 < data_len) {
+                fputc(*p, out);
+                fputc(p[1], out);
+                ++i;
+                continue;
+            }
+            in_string = *p != '"';
+            fputs(*p == '\n' ? "\\n" : (char[]){*p, 0}, out);
+        } else if (isDirective(data, i, ".asciiz")) {
+            fputs(".asciz", out);
+            i += 6;
+        } else if (isDirective(data, i, ".word")) {
+            fputs(".long", out);
+            i += 4;
+        } else if (isDirective(data, i, ".space") && !strncmp(p + 6, " 0\n", 3)) {
+            i += 7;
+        } else if (isDirective(data, i, ".align")) {
+            int n = atoi(p + 7);
+            fprintf(out, ".balign %d", 1 << n);
+            for (i += 7; i + 1 < data_len && data[i + 1] >= '0' && data[i + 1] <= '9'; ++i) {
+            }
+        } else {
+            in_string = *p == '"';
+            fputc(*p, out);
+        }
+    }
+    fputs(".text\n", out);
+    fwrite(text, 1, text_len, out);
+    fputs(".section .note.GNU-stack,\"\",@progbits\n", out);
+}
@@ -27,6 +27,269 @@ compare_outputs() {
     done
 }
 
+# Function to run test program src$1 with `codegen.linux` and `codegen` and compare the
+# outputs; the `code.s` of `codegen` is left for the caller to inspect
+run_program() {
+    ./codegen.linux < ./test/src$1 > ast_symbol_table_groundtruth$1.txt
+    echo 1 | ./spim.linux -quiet -file code.s > codegen_groundtruth$1.out
+    dos2unix codegen_groundtruth$1.out
+    LD_LIBRARY_PATH=. ./codegen < ./test/src$1 > ast_symbol_table_$1.txt
+    echo 1 | ./spim.linux -quiet -file code.s > codegen$1.out
+    cp code.s codegen_$1.s
+    dos2unix codegen$1.out
+    diff -b codegen_groundtruth$1.out codegen$1.out > /dev/null
+}
+
+# Function to check that src11 matches the expected results with its constant branches
+# removed and its constant operators evaluated
+compare_fold() {
+    if run_program 11 && ! grep -qE '^\s+(mul|sub|neg) |dead' code.s; then
+        echo "[PASS] Folded code for src11 matches expected results."
+    else
+        echo "[FAIL] Folded code for src11 does not match expected results."
+    fi
+}
+
+# Function to check that src12 matches the expected results with its address computations
+# folded into the loads and stores
+compare_peephole() {
+    if run_program 12 && ! grep -qE 'addi \$t[0-9], \$(fp|sp), |lw \$t[0-9], 0\(\$t[0-9]\)' code.s; then
+        echo "[PASS] Peephole-optimized code for src12 matches expected results."
+    else
+        echo "[FAIL] Peephole-optimized code for src12 does not match expected results."
+    fi
+}
+
+# Function to check that src13 matches the expected results with its conditions, `&&` and
+# `||` compiled to branches instead of computed truth values
+compare_conditions() {
+    if run_program 13 && ! grep -qE '^\s+(slt|sgt|sle|sge|seq|sne|and|or|xori) ' code.s; then
+        echo "[PASS] Branch code for src13 matches expected results."
+    else
+        echo "[FAIL] Branch code for src13 does not match expected results."
+    fi
+}
+
+# Function to check that src14 matches the expected results with its loop tested at the
+# bottom and the invariant `a * b` computed before the loop
+compare_loops() {
+    if run_program 14 && awk '/:$/ { seen[substr($1, 1, length($1) - 1)] = NR }
+            $1 == "mul" { last_mul = NR }
+            $1 ~ /^[bj]/ && $1 != "jal" && ($NF in seen) { loops++; if ($1 == "j" || $1 == "b" || last_mul > seen[$NF]) bad = 1 }
+            END { exit !(loops && !bad) }' code.s; then
+        echo "[PASS] Loop code for src14 matches expected results."
+    else
+        echo "[FAIL] Loop code for src14 does not match expected results."
+    fi
+}
+
+# Function to check that src15 matches the expected results with the self tail call of
+# `sum` turned into a jump
+compare_tail_calls() {
+    if run_program 15 && grep -q 'j c15.sum.tail' code.s && [ "$(grep -c 'jal c15.sum' code.s)" -le 1 ]; then
+        echo "[PASS] Tail-call code for src15 matches expected results."
+    else
+        echo "[FAIL] Tail-call code for src15 does not match expected results."
+    fi
+}
+
+# Function to check that src16 matches the expected results with the value arguments of
+# `mix` passed in `$a0-$a2` and read from there
+compare_register_args() {
+    if run_program 16 && grep -q '\$a2' code.s && ! grep -q 'sw \$a[0-2]' code.s; then
+        echo "[PASS] Register-argument code for src16 matches expected results."
+    else
+        echo "[FAIL] Register-argument code for src16 does not match expected results."
+    fi
+}
+
+# Function to check that src17 matches the expected results with the leaf method `sq`
+# inlined into the loop of `main`
+compare_inlining() {
+    if run_program 17 && ! grep -q 'jal c17.sq' code.s; then
+        echo "[PASS] Inlined code for src17 matches expected results."
+    else
+        echo "[FAIL] Inlined code for src17 does not match expected results."
+    fi
+}
+
+# Function to check that src18 matches the expected results without code for the method
+# nobody calls, still running the assignment after the `return` of `f`
+compare_reachability() {
+    if run_program 18 && ! grep -q 'c18.unused:' code.s; then
+        echo "[PASS] Reachable code for src18 matches expected results."
+    else
+        echo "[FAIL] Reachable code for src18 does not match expected results."
+    fi
+}
+
+# Function to check that src19 matches the expected results with the constant fields of
+# its singleton laid out as `.word` data instead of being set by `c19.init`
+compare_static_data() {
+    if run_program 19 && grep -q '\.word 5, 42' code.s && ! grep -q 'jal c19.init' code.s; then
+        echo "[PASS] Static data for src19 matches expected results."
+    else
+        echo "[FAIL] Static data for src19 does not match expected results."
+    fi
+}
+
+# Function to check that `-check-bounds` keeps the results of the programs and stops src20 (and
+# src23, whose index wraps around to a negative value) at their first out-of-range index
+compare_bounds() {
+    for i in $(seq 1 10); do
+        LD_LIBRARY_PATH=. ./codegen -check-bounds < ./test/src$i > /dev/null
+        echo 1 | ./spim.linux -quiet -file code.s > codegen_bounds$i.out
+        dos2unix codegen_bounds$i.out
+
+        if diff -b codegen_groundtruth$i.out codegen_bounds$i.out > /dev/null; then
+            echo "[PASS] Bounds-checked output for src$i matches expected results."
+        else
+            echo "[FAIL] Bounds-checked output for src$i does not match expected results."
+        fi
+    done
+
+    for i in 20 23; do
+        LD_LIBRARY_PATH=. ./codegen -check-bounds < ./test/src$i > /dev/null
+        echo 1 | ./spim.linux -quiet -file code.s > codegen_bounds$i.out
+        dos2unix codegen_bounds$i.out
+
+        if grep -q "Array index out of bounds" codegen_bounds$i.out && ! grep -q "after loop" codegen_bounds$i.out; then
+            echo "[PASS] Out-of-range index in src$i stops the program."
+        else
+            echo "[FAIL] Out-of-range index in src$i does not stop the program."
+        fi
+    done
+}
+
+# Function to compile each program twice with `-cache`, once into an empty cache and once
+# reusing it, and compare both `code.s` with the uncached compilation
+compare_cache() {
+    rm -rf cache
+    mkdir cache
+    for i in $(seq 1 10); do
+        LD_LIBRARY_PATH=. ./codegen -cache cache < ./test/src$i > /dev/null
+        cp code.s codegen_cold$i.s
+        LD_LIBRARY_PATH=. ./codegen -cache cache < ./test/src$i > /dev/null
+
+        if cmp -s codegen_$i.s codegen_cold$i.s && cmp -s codegen_$i.s code.s; then
+            echo "[PASS] Cached code for src$i matches an uncached compilation."
+        else
+            echo "[FAIL] Cached code for src$i does not match an uncached compilation."
+        fi
+    done
+}
+
+# Function to compile each program with `-buffer-output` and compare its output with the
+# expected results (src22 reads input in a routine with register arguments)
+compare_buffer() {
+    run_program 22
+    for i in $(seq 1 10) 22; do
+        LD_LIBRARY_PATH=. ./codegen -buffer-output < ./test/src$i > /dev/null
+        echo 1 | ./spim.linux -quiet -file code.s > codegen_buffer$i.out
+        dos2unix codegen_buffer$i.out
+
+        if diff -b codegen_groundtruth$i.out codegen_buffer$i.out > /dev/null; then
+            echo "[PASS] Buffered output for src$i matches expected results."
+        else
+            echo "[FAIL] Buffered output for src$i does not match expected results."
+        fi
+    done
+}
+
+# Function to profile each program with `-profile`, compile it again with `-use-profile` and
+# compare the output of the second build with the expected results
+compare_profile() {
+    for i in $(seq 1 10); do
+        LD_LIBRARY_PATH=. ./codegen -profile < ./test/src$i > /dev/null
+        echo 1 | ./spim.linux -quiet -file code.s > src$i.profile
+        dos2unix src$i.profile
+        LD_LIBRARY_PATH=. ./codegen -use-profile src$i.profile < ./test/src$i > /dev/null
+        echo 1 | ./spim.linux -quiet -file code.s > codegen_profile$i.out
+        dos2unix codegen_profile$i.out
+
+        if grep -q "^profile " src$i.profile && diff -b codegen_groundtruth$i.out codegen_profile$i.out > /dev/null; then
+            echo "[PASS] Profile-guided output for src$i matches expected results."
+        else
+            echo "[FAIL] Profile-guided output for src$i does not match expected results."
+        fi
+    done
+}
+
+# Function to compile each program with `-target x86-64`, run it natively and compare its
+# output with the expected results
+compare_x86() {
+    for i in $(seq 1 10); do
+        LD_LIBRARY_PATH=. ./codegen -target x86-64 < ./test/src$i > /dev/null
+        gcc -no-pie -o codegen_x86_$i code.s runtime/mjrt.c
+        echo 1 | ./codegen_x86_$i > codegen_x86_$i.out
+
+        if diff -b codegen_groundtruth$i.out codegen_x86_$i.out > /dev/null; then
+            echo "[PASS] x86-64 output for src$i matches expected results."
+        else
+            echo "[FAIL] x86-64 output for src$i does not match expected results."
+        fi
+    done
+}
+
+# Function to compile each program with `-j 2` and `-j 4` and compare `code.s` byte for byte
+# with `-j 1` (src21 has several classes for the workers)
+compare_jobs() {
+    for i in $(seq 1 21); do
+        LD_LIBRARY_PATH=. ./codegen -j 1 < ./test/src$i > /dev/null
+        cp code.s codegen_j1_$i.s
+        LD_LIBRARY_PATH=. ./codegen -j 2 < ./test/src$i > /dev/null
+        cp code.s codegen_j2_$i.s
+        LD_LIBRARY_PATH=. ./codegen -j 4 < ./test/src$i > /dev/null
+
+        if cmp -s codegen_j1_$i.s codegen_j2_$i.s && cmp -s codegen_j1_$i.s code.s; then
+            echo "[PASS] Parallel code for src$i matches -j 1."
+        else
+            echo "[FAIL] Parallel code for src$i does not match -j 1."
+        fi
+    done
+}
+
+# Function to compile every program in one batch and compare each unit's code and IR with
+# a compilation of that program alone, also after a unit with a syntax error
+compare_batch() {
+    rm -rf batch
+    mkdir batch
+    cp ./test/src* batch/
+    LD_LIBRARY_PATH=. ./codegen -emit-ir -dump none $(seq -f batch/src%g 1 10)
+    for i in $(seq 1 10); do
+        LD_LIBRARY_PATH=. ./codegen -emit-ir < ./test/src$i > /dev/null
+
+        if cmp -s code.s batch/src$i.s && cmp -s code.ir batch/src$i.ir; then
+            echo "[PASS] Batch output for src$i matches a single compilation."
+        else
+            echo "[FAIL] Batch output for src$i does not match a single compilation."
+        fi
+    done
+
+    rm -f batch/src1.s
+    if ! LD_LIBRARY_PATH=. ./codegen -dump none batch/src24 batch/src1 > /dev/null 2>&1 && cmp -s codegen_1.s batch/src1.s; then
+        echo "[PASS] Batch with the syntax error of src24 still compiles src1."
+    else
+        echo "[FAIL] Batch with the syntax error of src24 does not compile src1."
+    fi
+}
+
 # Main script execution
 run_codegen
-compare_outputs
\ No newline at end of file
+compare_outputs
+compare_fold
+compare_peephole
+compare_conditions
+compare_loops
+compare_tail_calls
+compare_register_args
+compare_inlining
+compare_reachability
+compare_static_data
+compare_bounds
+compare_cache
+compare_buffer
+compare_profile
+compare_x86
+compare_jobs
+compare_batch
\ No newline at end of file